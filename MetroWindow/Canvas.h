@@ -0,0 +1,51 @@
+#pragma once
+
+namespace MetroWindow
+{
+
+struct CanvasRect
+{
+    int left;
+    int top;
+    int right;
+    int bottom;
+};
+
+// A premultiplied 32-bit BGRA image. 'bits' is the top row and rows are
+// 'stride' bytes apart, negative for a bottom-up bitmap. 'handle' is the
+// HBITMAP the pixels belong to, for backends that draw with GDI.
+struct CanvasImage
+{
+    const unsigned char* bits;
+    int stride;
+    int width;
+    int height;
+    void* handle;
+};
+
+// What the frame is drawn with. Colors are COLORREF values and
+// coordinates are logical, the way GDI takes them, so the frame draws
+// the same through GDI on Windows and into plain memory anywhere.
+class ICanvas
+{
+public:
+    virtual ~ICanvas() {}
+
+    virtual void FillRect(const CanvasRect& rect, unsigned long color) = 0;
+
+    // A 1 pixel outline just inside 'rect'.
+    virtual void FrameRect(const CanvasRect& rect, unsigned long color) = 0;
+
+    // Draws the 'src' part of 'image' over the canvas at (x, y).
+    virtual void BlendImage(int x, int y, const CanvasImage& image, const CanvasRect& src) = 0;
+
+    // Draws a width x height run of glyph coverage, rows 'stride' bytes
+    // apart, in 'color' at (x, y).
+    virtual void BlendGlyphRun(int x, int y, const unsigned char* coverage, int stride,
+        int width, int height, unsigned long color) = 0;
+
+    // False if nothing drawn in 'rect' would be seen.
+    virtual bool IsVisible(const CanvasRect& rect) const = 0;
+};
+
+} //namespace MetroWindow
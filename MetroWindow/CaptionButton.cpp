@@ -2,6 +2,7 @@
 #include "CaptionButton.h"
 #include "MiscWapppers.h"
 #include "WindowExtenders.h"
+#include "GdiCanvas.h"
 
 namespace MetroWindow
 {
@@ -9,6 +10,8 @@ namespace MetroWindow
 CCaptionButton::CCaptionButton(LONG hitTest, CMetroCaptionTheme& theme)
     : theme_(theme), hit_test_(hitTest), image_(NULL)
 {
+    ::ZeroMemory(&image_pixels_, sizeof(image_pixels_));
+
     pressed_ = false;
     hovered_ = false;
     enabled_ = true;
@@ -20,53 +23,44 @@ CCaptionButton::~CCaptionButton(void)
 {
 }
 
-void CCaptionButton::Draw(HDC hdc)
+void CCaptionButton::Draw(ICanvas& canvas)
 {
-    if (!Visible()) return;
+    CanvasRect bounds = ToCanvasRect(bounds_);
+    if (!Visible() || !canvas.IsVisible(bounds)) return;
 
-    HBITMAP image = image_;
     CRect srcRect(0, 0, 14, 14);
 
     if (pressed_)
     {
-        FillSolidRect(hdc, &bounds_, theme_.ButtonPressColor());
+        canvas.FillRect(bounds, theme_.ButtonPressColor());
         srcRect.OffsetRect(28, 0);
     }
     else if (hovered_)
     {
-        FillSolidRect(hdc, &bounds_, theme_.ButtonHoverColor());
+        canvas.FillRect(bounds, theme_.ButtonHoverColor());
         srcRect.OffsetRect(14, 0);
     }
 
-    if (image != NULL)
+    if (image_ != NULL)
     {
-        CRect destRect;
-        destRect.top = bounds_.top + (Height() - srcRect.Height()) / 2;
-        destRect.left = bounds_.left + (Width() - srcRect.Width()) / 2 + 1;
-        destRect.Width(srcRect.Width());
-        destRect.Height(srcRect.Height());
-
-        HDC hdcBmpMem = ::CreateCompatibleDC(hdc);
-        HBITMAP hbmOldBmp = (HBITMAP)::SelectObject(hdcBmpMem, image);
+        int top = bounds_.top + (Height() - srcRect.Height()) / 2;
+        int left = bounds_.left + (Width() - srcRect.Width()) / 2 + 1;
 
-        BLENDFUNCTION bf = { AC_SRC_OVER, 0, 0xFF, AC_SRC_ALPHA };
-        ::GdiAlphaBlend(hdc, destRect.left, destRect.top, destRect.Width(), destRect.Height(), 
-            hdcBmpMem, srcRect.left, srcRect.top, srcRect.Width(), srcRect.Height(), bf);
-
-        ::SelectObject(hdcBmpMem, hbmOldBmp);
-        ::DeleteDC(hdcBmpMem);
+        canvas.BlendImage(left, top, image_pixels_, ToCanvasRect(srcRect));
     }
 }
 
-void CCaptionButton::FillSolidRect(HDC hdc, LPCRECT lpRect, COLORREF clr)
+void CCaptionButton::Image(HBITMAP image)
 {
-    COLORREF clrOld = ::SetBkColor(hdc, clr);
-    ::ExtTextOut(hdc, 0, 0, ETO_OPAQUE, lpRect, NULL, 0, NULL);
-    ::SetBkColor(hdc, clrOld);
+    image_ = image;
 
-    //HBRUSH hBrush = ::CreateSolidBrush(clr);
-    //::FillRect(hdc, lpRect, hBrush);
-    //::DeleteObject(hBrush);
+    // The theme images are DIB sections that live as long as the module,
+    // their pixels are looked up once.
+    if (!CGdiCanvas::GetImage(image, &image_pixels_))
+    {
+        ::ZeroMemory(&image_pixels_, sizeof(image_pixels_));
+        image_pixels_.handle = image;
+    }
 }
 
 CCaptionButtonManager::CCaptionButtonManager()
@@ -85,86 +79,62 @@ CCaptionButtonManager::~CCaptionButtonManager()
         delete *iter;
 }
 
-void CCaptionButtonManager::UpdateCaptionButtons(HWND hWnd, CMetroCaptionTheme& captionTheme, bool dwmEnabled)
+void CCaptionButtonManager::CreateCaptionButtons(HWND hWnd, CMetroCaptionTheme& captionTheme)
 {
-    // create buttons
-    if (caption_buttons_.size() == 0)
-    {
-        CCaptionButton * closeButton = new CCaptionButton(HTCLOSE, captionTheme);
-        caption_buttons_.push_back(closeButton);
+    if (caption_buttons_.size() != 0)
+        return;
 
-        closeButton->Image(captionTheme.CloseButton());
+    CCaptionButton * closeButton = new CCaptionButton(HTCLOSE, captionTheme);
+    caption_buttons_.push_back(closeButton);
 
-        if (WindowExtenders::IsDrawMaximizeBox(hWnd))
-        {
-            max_button_ = new CCaptionButton(HTMAXBUTTON, captionTheme);
-            caption_buttons_.push_back(max_button_);
-
-            max_button_->Image(::IsZoomed(hWnd) ?
-                captionTheme.RestoreButton() : captionTheme.MaximizeButton());
-        }
-
-        if (WindowExtenders::IsDrawMinimizeBox(hWnd))
-        {
-            min_button_ = new CCaptionButton(HTMINBUTTON, captionTheme);
-            caption_buttons_.push_back(min_button_);
-
-            min_button_->Image(::IsIconic(hWnd) ?
-                captionTheme.RestoreButton() : captionTheme.MinimizeButton());
-        }
+    closeButton->Image(captionTheme.CloseButton());
 
-        // add command handlers
-        //foreach (CaptionButton button in caption_buttons_)
-        //    button.PropertyChanged += OnCommandButtonPropertyChanged;
-    }
-    else
+    if (WindowExtenders::IsDrawMaximizeBox(hWnd))
     {
-        if (min_button_ != NULL)
-        {
-            min_button_->Image(::IsIconic(hWnd) ?
-                captionTheme.RestoreButton() : captionTheme.MinimizeButton());
-        }
-
-        if (max_button_ != NULL)
-        {
-            max_button_->Image(::IsZoomed(hWnd) ?
-                captionTheme.RestoreButton() : captionTheme.MaximizeButton());
-        }
+        max_button_ = new CCaptionButton(HTMAXBUTTON, captionTheme);
+        caption_buttons_.push_back(max_button_);
     }
 
-    // Calculate Caption Button Bounds
-    CRect rect;
-    ::GetWindowRect(hWnd, &rect);
-    rect.OffsetRect(-rect.left, -rect.top);
+    if (WindowExtenders::IsDrawMinimizeBox(hWnd))
+    {
+        min_button_ = new CCaptionButton(HTMINBUTTON, captionTheme);
+        caption_buttons_.push_back(min_button_);
+    }
 
-    CSize borderSize = WindowExtenders::GetBorderSize(hWnd, dwmEnabled);
-    CSize captionButtonSize = WindowExtenders::GetCaptionButtonSize(hWnd);
+    // add command handlers
+    //foreach (CaptionButton button in caption_buttons_)
+    //    button.PropertyChanged += OnCommandButtonPropertyChanged;
+}
 
-    CRect buttonRect;
-    buttonRect.left = rect.right - borderSize.cx - captionButtonSize.cx;
-    buttonRect.top = rect.top;
-    buttonRect.Width(captionButtonSize.cx);
-    buttonRect.Height(captionButtonSize.cy);
+void CCaptionButtonManager::UpdateCaptionButtons(HWND hWnd, CMetroCaptionTheme& captionTheme, const FrameLayout& layout)
+{
+    if (min_button_ != NULL)
+    {
+        min_button_->Image(::IsIconic(hWnd) ?
+            captionTheme.RestoreButton() : captionTheme.MinimizeButton());
+    }
 
-    // Do not overlap the frame border
-    if (!dwmEnabled/* && captionTheme.BackgroundImage == null*/)
+    if (max_button_ != NULL)
     {
-        buttonRect.InflateRect(0, -1);
+        max_button_->Image(::IsZoomed(hWnd) ?
+            captionTheme.RestoreButton() : captionTheme.MaximizeButton());
     }
 
+    // Calculate Caption Button Bounds
+    int index = 0;
+
     std::vector<CCaptionButton *>::iterator btnIter;
     for (btnIter = caption_buttons_.begin(); btnIter != caption_buttons_.end(); btnIter++)
     {
         CCaptionButton* button = *btnIter;
         if (button != NULL && button->Visible())
         {
-            button->Bounds(buttonRect);
-            buttonRect.MoveToX(buttonRect.left - captionButtonSize.cx);
+            button->Bounds(ToRect(layout.GetButton(index++)));
         }
     }
 }
 
-int CCaptionButtonManager::Draw(HDC hdc)
+int CCaptionButtonManager::Draw(ICanvas& canvas)
 {
     int width = 0;
 
@@ -174,7 +144,7 @@ int CCaptionButtonManager::Draw(HDC hdc)
         CCaptionButton* button = *btnIter;
         if (button != NULL)
         {
-            button->Draw(hdc);
+            button->Draw(canvas);
             width += button->Width();
         }
     }
@@ -182,6 +152,23 @@ int CCaptionButtonManager::Draw(HDC hdc)
     return width;
 }
 
+int CCaptionButtonManager::Count() const
+{
+    int count = 0;
+
+    std::vector<CCaptionButton *>::const_iterator btnIter;
+    for (btnIter = caption_buttons_.begin(); btnIter != caption_buttons_.end(); btnIter++)
+    {
+        const CCaptionButton* button = *btnIter;
+        if (button != NULL && button->Visible())
+        {
+            ++count;
+        }
+    }
+
+    return count;
+}
+
 void CCaptionButtonManager::EnableButton(LONG hitTest, bool enable)
 {
     std::vector<CCaptionButton *>::iterator btnIter;
@@ -230,4 +217,19 @@ CCaptionButton * CCaptionButtonManager::CommandButtonByHitTest(LONG hitTest)
     return foundButton;
 }
 
+CCaptionButton * CCaptionButtonManager::CommandButtonByIndex(int index)
+{
+    std::vector<CCaptionButton *>::const_iterator btnIter;
+    for (btnIter = caption_buttons_.begin(); btnIter != caption_buttons_.end(); btnIter++)
+    {
+        CCaptionButton* button = *btnIter;
+        if (button != NULL && button->Visible() && index-- == 0)
+        {
+            return button;
+        }
+    }
+
+    return NULL;
+}
+
 } //namespace MetroWindow
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "MetroCaptionTheme.h"
+#include "Canvas.h"
+#include "FrameLayout.h"
 
 #include <vector>
 
@@ -13,14 +15,14 @@ public:
     CCaptionButton(LONG hitTest, CMetroCaptionTheme& theme);
     ~CCaptionButton(void);
 
-    void Draw(HDC hdc);
+    void Draw(ICanvas& canvas);
 
     RECT Bounds() const { return bounds_; }
     void Bounds(const RECT& bounds) { ::CopyRect(&bounds_, &bounds); }
     int Width() const { return bounds_.right - bounds_.left; }
     int Height() const { return bounds_.bottom - bounds_.top; }
     HBITMAP Image() const { return image_; }
-    void Image(HBITMAP image) { image_ = image; }
+    void Image(HBITMAP image);
     bool Visible() const { return visible_; }
     void Visible(bool visible) { visible_ = visible; }
     bool Enabled() const { return enabled_; }
@@ -31,14 +33,12 @@ public:
     void Hovered(bool hovered) { hovered_ = hovered; }
     LONG HitTest() const { return hit_test_; }
 
-private:
-    void FillSolidRect(HDC hdc, LPCRECT lpRect, COLORREF clr);
-
 private:
     CMetroCaptionTheme& theme_; //TODO: Using smart ptr like std::shared_ptr
 
     LONG hit_test_;
     HBITMAP image_;
+    CanvasImage image_pixels_;
     HBITMAP hover_image_;
     RECT bounds_;
     bool pressed_;
@@ -53,14 +53,22 @@ public:
     CCaptionButtonManager();
     ~CCaptionButtonManager();
 
-    void UpdateCaptionButtons(HWND hWnd, CMetroCaptionTheme& captionTheme, bool dwmEnabled);
+    void CreateCaptionButtons(HWND hWnd, CMetroCaptionTheme& captionTheme);
 
-    int Draw(HDC hdc);
+    // Sets the button images for the window state and puts the buttons
+    // where 'layout' has them.
+    void UpdateCaptionButtons(HWND hWnd, CMetroCaptionTheme& captionTheme, const FrameLayout& layout);
+
+    int Draw(ICanvas& canvas);
+    int Count() const;
     void EnableButton(LONG hitTest, bool enable);
 
     CCaptionButton * CommandButtonFromPoint(POINT point);
     CCaptionButton * CommandButtonByHitTest(LONG hitTest);
 
+    // The visible button 'index' buttons from the right.
+    CCaptionButton * CommandButtonByIndex(int index);
+
 private:
     CCaptionButton * min_button_;
     CCaptionButton * max_button_;
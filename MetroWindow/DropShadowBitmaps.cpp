@@ -1,5 +1,6 @@
 #include "stdafx.h"
 #include "DropShadowBitmaps.h"
+#include "ShadowSurround.h"
 
 namespace MetroWindow
 {
@@ -48,273 +49,124 @@ static const BYTE kShadowBorder[12][1] = {
     { 115 }
 };
 
-DropShadowBitmaps::DropShadowBitmaps(COLORREF color)
-    : color_(color),
-    corner_nw_(NULL),
-    corner_ne_(NULL),
-    corner_sw_(NULL),
-    corner_se_(NULL),
-    border_n_(NULL),
-    border_e_(NULL),
-    border_s_(NULL),
-    border_w_(NULL),
-    initialized_(false)
-{
-}
-
-
-DropShadowBitmaps::~DropShadowBitmaps(void)
+namespace
 {
-    DeleteBitmaps();
-}
-
-void DropShadowBitmaps::Initialize()
-{
-    if (!initialized_)
+    // Moves a mask by (offsetX, offsetY) away from the window and clears
+    // the part of it that the window covers.
+    void ShiftMask(const BYTE* table, int width, int height, int shadowSize,
+        int offsetX, int offsetY, std::vector<BYTE>* mask)
     {
-        corner_nw_ = BuildShadowImage(0, 2, 2, true);
-        corner_ne_ = BuildShadowImage(1, 2, 0, true);
-        corner_se_ = BuildShadowImage(2, 0, 0, true);
-        corner_sw_ = BuildShadowImage(3, 0, 2, true);
-        border_n_ = BuildShadowImage(0, 0, 2, false);
-        border_e_ = BuildShadowImage(1, 0, 0, false);
-        border_s_ = BuildShadowImage(2, 0, 0, false);
-        border_w_ = BuildShadowImage(3, 0, 2, false);
-
-        initialized_ = true;
-    }
-}
-
-void DropShadowBitmaps::DeleteBitmaps()
-{
-    if (corner_nw_ != NULL) { ::DeleteObject(corner_nw_); corner_nw_ = NULL; }
-    if (corner_ne_ != NULL) { ::DeleteObject(corner_ne_); corner_ne_ = NULL; }
-    if (corner_se_ != NULL) { ::DeleteObject(corner_se_); corner_se_ = NULL; }
-    if (corner_sw_ != NULL) { ::DeleteObject(corner_sw_); corner_sw_ = NULL; }
-
-    if (border_n_ != NULL) { ::DeleteObject(border_n_); border_n_ = NULL; }
-    if (border_e_ != NULL) { ::DeleteObject(border_e_); border_e_ = NULL; }
-    if (border_s_ != NULL) { ::DeleteObject(border_s_); border_s_ = NULL; }
-    if (border_w_ != NULL) { ::DeleteObject(border_w_); border_w_ = NULL; }
-
-     initialized_ = false;
-}
-
-void DropShadowBitmaps::MakeShadow(HDC hdc, int width, int height, ShadowSide side) const
-{
-    int cornerSize = arraysize(kShadowCorner);
-    int borderWidth = arraysize(kShadowBorder);
-
-    int top = 0;
-    int left = 0;
-    int right = width;
-    int bottom = height;
+        mask->assign(width * height, 0);
 
-    // The top and bottom borders extend over the sides of the window.
-    // The left and right borders do no. This means that we need to
-    // update the bounds to make it seem like the left and right
-    // borders do extend outside of the window.
-    if (side == Left || side == Right)
-    {
-        top -= borderWidth;
-        bottom += borderWidth;
-        height += borderWidth * 2;
-    }
-
-    // Left top corner
-    if (side == Left || side == Top)
-    {
-        DrawShadowCorner(hdc, corner_nw_, left, top, cornerSize, cornerSize);
-    }
+        for (int y = offsetY; y < height; ++y)
+        {
+            BYTE* row = &(*mask)[y * width];
+            memcpy(row + offsetX, table + (y - offsetY) * width, width - offsetX);
 
-    // Right top corner
-    if (side == Right || side == Top)
-    {
-        DrawShadowCorner(hdc, corner_ne_, right - cornerSize, top, cornerSize, cornerSize);
+            if (y >= shadowSize && width > shadowSize)
+                memset(row + shadowSize, 0, width - shadowSize);
+        }
     }
 
-    // Left bottom corner
-    if (side == Left || side == Bottom)
+    // The built-in shadow: every corner and edge is the north-west one,
+    // shifted a little and turned into place.
+    void BuildDefaultMasks(ShadowMasks* masks)
     {
-        DrawShadowCorner(hdc, corner_sw_, left, bottom - cornerSize, cornerSize, cornerSize);
+        static const struct
+        {
+            int rotation;
+            int offsetX;
+            int offsetY;
+        } kCorners[4] = {
+            { 0, 2, 2 },    // CornerNW
+            { 1, 2, 0 },    // CornerNE
+            { 2, 0, 0 },    // CornerSE
+            { 3, 0, 2 }     // CornerSW
+        }, kEdges[4] = {
+            { 0, 0, 2 },    // EdgeN
+            { 1, 0, 0 },    // EdgeE
+            { 2, 0, 0 },    // EdgeS
+            { 3, 0, 2 }     // EdgeW
+        };
+
+        int cornerSize = arraysize(kShadowCorner);
+        int shadowSize = arraysize(kShadowBorder);
+        std::vector<BYTE> shifted;
+
+        masks->corner_size = cornerSize;
+        masks->shadow_size = shadowSize;
+
+        for (int i = 0; i < 4; ++i)
+        {
+            ShiftMask(&kShadowCorner[0][0], cornerSize, cornerSize, shadowSize,
+                kCorners[i].offsetX, kCorners[i].offsetY, &shifted);
+            ShadowGenerator::RotateMask(shifted, cornerSize, cornerSize,
+                kCorners[i].rotation, &masks->corners[i]);
+
+            ShiftMask(&kShadowBorder[0][0], 1, shadowSize, shadowSize,
+                kEdges[i].offsetX, kEdges[i].offsetY, &shifted);
+            ShadowGenerator::RotateMask(shifted, 1, shadowSize,
+                kEdges[i].rotation, &masks->edges[i]);
+        }
     }
 
-    // Right bottom corner
-    if (side == Right || side == Bottom)
-    {
-        DrawShadowCorner(hdc, corner_se_, right - cornerSize, bottom - cornerSize, cornerSize, cornerSize);
-    }
+} // namespace
 
-    if (side == Top)
-    {
-        DrawShadowBorder(hdc, border_n_, left + cornerSize, top,
-            width - cornerSize * 2, borderWidth);
-    }
-    else if (side == Bottom)
-    {
-        DrawShadowBorder(hdc, border_s_, left + cornerSize,
-            bottom - borderWidth, width - cornerSize * 2, borderWidth);
-    }
-    else if (side == Left)
-    {
-        DrawShadowBorder(hdc, border_w_, left, top + cornerSize,
-            borderWidth, height - cornerSize * 2);
-    }
-    else if (side == Right)
-    {
-        DrawShadowBorder(hdc, border_e_, right - borderWidth,
-            top + cornerSize, borderWidth, height - cornerSize * 2);
-    }
+DropShadowBitmaps::DropShadowBitmaps(void)
+    : use_params_(false),
+    initialized_(false)
+{
+    ::ZeroMemory(&params_, sizeof(params_));
+    masks_.shadow_size = arraysize(kShadowBorder);
+    masks_.corner_size = arraysize(kShadowCorner);
 }
 
-int DropShadowBitmaps::GetShadowSize() const
+DropShadowBitmaps::DropShadowBitmaps(const ShadowParams& params)
+    : params_(params),
+    use_params_(true),
+    initialized_(false)
 {
-    return arraysize(kShadowBorder);
+    masks_.shadow_size = arraysize(kShadowBorder);
+    masks_.corner_size = arraysize(kShadowCorner);
 }
 
-HBITMAP DropShadowBitmaps::CreateBitmap(int width, int height, void ** ppvBits) const
+DropShadowBitmaps::~DropShadowBitmaps(void)
 {
-    BITMAPINFO bmi;
-    ::ZeroMemory(&bmi, sizeof(BITMAPINFO));
-
-    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
-    bmi.bmiHeader.biWidth = width;
-    bmi.bmiHeader.biHeight = -height;
-    bmi.bmiHeader.biPlanes = 1;
-    bmi.bmiHeader.biBitCount = 32;
-    bmi.bmiHeader.biCompression = BI_RGB;
-    bmi.bmiHeader.biSizeImage = width * height * 4;
-    
-    HBITMAP bitmap = ::CreateDIBSection(NULL, &bmi, DIB_RGB_COLORS, ppvBits, NULL, 0);
-
-    ZeroMemory(*ppvBits, bmi.bmiHeader.biSizeImage);
-
-    return bitmap;
 }
 
-HBITMAP DropShadowBitmaps::BuildShadowImage(int rotation, int offsetX, int offsetY, bool corner) const
+void DropShadowBitmaps::Initialize()
 {
-    int height = corner ? arraysize(kShadowCorner) : arraysize(kShadowBorder);
-    int width = corner ? arraysize(kShadowCorner[0]) : arraysize(kShadowBorder[0]);
-
-    if (rotation % 2 == 1)
-    {
-        int tmp = width;
-        width = height;
-        height = tmp;
-    }
-
-    BYTE *pvBits;
-    HBITMAP bitmap = CreateBitmap(width, height, (void **)&pvBits);
-
-    BYTE r = GetRValue(color_);
-    BYTE g = GetGValue(color_);
-    BYTE b = GetBValue(color_);
-
-    for (int x = 0; x < width; ++x)
+    if (!initialized_)
     {
-        for (int y = 0; y < height; ++y)
-        {
-            BYTE alpha = GetAlpha(x, y, width, height, rotation, offsetX, offsetY, corner);
-
-            int pos = y * width * 4  + x * 4;
+        // The built-in shadow is also used if the parameters are bad.
+        if (!use_params_ || !ShadowGenerator::Generate(params_, &masks_))
+            BuildDefaultMasks(&masks_);
 
-            pvBits[pos]     = (b * alpha) >> 8;
-            pvBits[pos + 1] = (g * alpha) >> 8;
-            pvBits[pos + 2] = (r * alpha) >> 8;
-            pvBits[pos + 3] = alpha;
-        }
+        initialized_ = true;
     }
-
-    return bitmap;
 }
 
-BYTE DropShadowBitmaps::GetAlpha(int x, int y, int width, int height,
-    int rotation, int offsetX, int offsetY, bool corner) const
+int DropShadowBitmaps::MakeShadow(BYTE* bits, int stride, int width, int height, ShadowSide side,
+    COLORREF color, int from) const
 {
-    BYTE alpha = 0;
-    int borderSize = arraysize(kShadowBorder);
-
-    int xPos = 0;
-    int yPos = 0;
-    int signX = 1;
-    int signY = 1;
-
-    int n = rotation % 4;
-    switch (n)
-    {
-    case 0:
-        {
-            xPos = x;
-            yPos = y;
-            signX = -1;
-            signY = -1;
-        }
-        break;
-    case 1:
-        {
-            xPos = y;
-            yPos = (width - 1) - x;
-            signX = -1;
-            signY = 1;
-        }
-        break;
-    case 2:
-        {
-            xPos = (width - 1) - x;
-            yPos = (height - 1) - y;
-            signX = 1;
-            signY = 1;
-        }
-        break;
-    case 3:
-        {
-            xPos = (height - 1) - y;
-            yPos = x;
-            signX = 1;
-            signY = -1;
-        }
-        break;
-    default:
-        return alpha;
-    }
-
-    if (xPos < offsetX || yPos < offsetY)
-        alpha = 0;
-    else if (xPos >= borderSize && yPos >= borderSize)
-        alpha = 0;
-    else
-    {
-        xPos += offsetX * signX;
-        yPos += offsetY * signY;
-
-        alpha = corner ? kShadowCorner[yPos][xPos] : kShadowBorder[yPos][xPos];
-    }
-
-    return alpha;
+    return ShadowCompositor::ComposeSide(masks_, GetRValue(color), GetGValue(color), GetBValue(color),
+        side, bits, stride, width, height, from);
 }
 
-void DropShadowBitmaps::DrawShadowCorner(HDC hdc, HBITMAP image, int x, int y, int width, int height) const
+int DropShadowBitmaps::MakeSurround(BYTE* bits, int stride, int width, int height, COLORREF color) const
 {
-    HDC hdcMem = ::CreateCompatibleDC(hdc);
-    HBITMAP hbmOldBmp = (HBITMAP)::SelectObject(hdcMem, image);
-
-    ::BitBlt(hdc, x, y, width, height, hdcMem, 0, 0, SRCCOPY);
-
-    ::SelectObject(hdcMem, hbmOldBmp);
-    ::DeleteDC(hdcMem);
+    return ShadowSurround::Compose(masks_, GetRValue(color), GetGValue(color), GetBValue(color),
+        bits, stride, width, height);
 }
 
-void DropShadowBitmaps::DrawShadowBorder(HDC hdc, HBITMAP image, int x, int y, int width, int height) const
+int DropShadowBitmaps::GetShadowSize() const
 {
-    HBRUSH hBrush = ::CreatePatternBrush(image);
-    ::SetBrushOrgEx(hdc, x, y, NULL);
-
-    RECT rect = {x, y, x + width, y + height};
-
-    ::FillRect(hdc, &rect, hBrush);
+    return masks_.shadow_size;
+}
 
-    ::DeleteObject(hBrush);
+int DropShadowBitmaps::GetFarCornerExtent(ShadowSide side) const
+{
+    return ShadowCompositor::GetFarCornerExtent(masks_, side);
 }
 
 } //namespace MetroWindow
@@ -1,48 +1,44 @@
 #pragma once
 
+#include "ShadowCompositor.h"
+
 namespace MetroWindow
 {
 
-enum ShadowSide
-{
-    Left,
-    Top,
-    Right,
-    Bottom
-};
-
+// The alpha masks of a drop shadow. They are colored when the shadow is
+// drawn, so one set serves the active and the inactive shadow, or any
+// other color.
 class DropShadowBitmaps
 {
 public:
-    explicit DropShadowBitmaps(COLORREF color);
+    DropShadowBitmaps(void);
+    explicit DropShadowBitmaps(const ShadowParams& params);
     ~DropShadowBitmaps(void);
 
     void Initialize();
-    void MakeShadow(HDC hdc, int width, int height, ShadowSide side) const;
 
-    int GetShadowSize() const;
+    // Draws the shadow strip of one side into 'bits', a top-down 32-bit
+    // surface of width x height pixels with rows 'stride' bytes apart.
+    // Only the strip from 'from' on is drawn, see ShadowCompositor.
+    // Returns the number of pixels written.
+    int MakeShadow(BYTE* bits, int stride, int width, int height, ShadowSide side,
+        COLORREF color, int from = 0) const;
 
-private:
-    void DeleteBitmaps();
-    HBITMAP CreateBitmap(int width, int height, void ** ppvBits) const;
-    HBITMAP BuildShadowImage(int rotation, int offsetX, int offsetY, bool corner) const;
-    BYTE GetAlpha(int x, int y, int width, int height,
-        int rotation, int offsetX, int offsetY, bool corner) const;
-    void DrawShadowCorner(HDC hdc, HBITMAP image, int x, int y, int width, int height) const;
-    void DrawShadowBorder(HDC hdc, HBITMAP image, int x, int y, int width, int height) const;
+    // Draws the whole shadow of a width x height window into a surface
+    // laid out by ShadowSurround. Returns the number of pixels written.
+    int MakeSurround(BYTE* bits, int stride, int width, int height, COLORREF color) const;
+
+    // The masks the shadow is drawn from, after Initialize().
+    const ShadowMasks& GetMasks() const { return masks_; }
+
+    int GetShadowSize() const;
+    int GetFarCornerExtent(ShadowSide side) const;
 
 private:
-    COLORREF color_;
-    HBITMAP corner_nw_;
-    HBITMAP corner_ne_;
-    HBITMAP corner_se_;
-    HBITMAP corner_sw_;
-    HBITMAP border_n_;
-    HBITMAP border_e_;
-    HBITMAP border_s_;
-    HBITMAP border_w_;
+    ShadowParams params_;
+    bool use_params_;
+    ShadowMasks masks_;
     bool initialized_;
 };
 
 } //namespace MetroWindow
-
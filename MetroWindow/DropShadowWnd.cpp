@@ -1,6 +1,13 @@
 #include "stdafx.h"
 #include "DropShadowWnd.h"
 
+#include <algorithm>
+
+#include "ShadowRegistry.h"
+#include "ShadowSurround.h"
+#include "SurfaceCapacity.h"
+#include "WindowExtenders.h"
+
 namespace MetroWindow
 {
 
@@ -8,8 +15,12 @@ static const TCHAR *kDropShadowWndClassName = TEXT("MetroShadowWnd");
 
 namespace
 {
-    DropShadowBitmaps active_shadow_(RGB(0, 0, 0));
-    DropShadowBitmaps inactive_shadow_(RGB(102, 102, 102));
+    const COLORREF kActiveShadowColor = RGB(0, 0, 0);
+    const COLORREF kInactiveShadowColor = RGB(102, 102, 102);
+
+    const BLENDFUNCTION kShadowBlend = { AC_SRC_OVER, 0, 255, AC_SRC_ALPHA };
+
+    const UINT_PTR kFadeTimerId = 1;
 
     LRESULT CALLBACK DropShadowWndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
     {
@@ -20,80 +31,147 @@ namespace
             return DefWindowProc(hwnd, uMsg, wParam, lParam);
     }
 
-} // namespace
+    bool RegisterWindowClass(HINSTANCE hInstance)
+    {
+        // Register window class for shadow window
+        WNDCLASSEX wcex;
+
+        memset(&wcex, 0, sizeof(wcex));
+        wcex.cbSize = sizeof(WNDCLASSEX);
+
+        wcex.style          = CS_HREDRAW | CS_VREDRAW;
+        wcex.lpfnWndProc    = DropShadowWndProc;
+        wcex.cbClsExtra     = 0;
+        wcex.cbWndExtra     = 0;
+        wcex.hInstance      = hInstance;
+        wcex.hIcon          = NULL;
+        wcex.hCursor        = LoadCursor(NULL, IDC_ARROW);
+        wcex.hbrBackground  = (HBRUSH)(COLOR_WINDOW+1);
+        wcex.lpszMenuName   = NULL;
+        wcex.lpszClassName  = kDropShadowWndClassName;
+        wcex.hIconSm        = NULL;
+
+        ATOM ret = ::RegisterClassEx(&wcex);
+
+        ASSERT(ret != NULL || ::GetLastError() == ERROR_CLASS_ALREADY_EXISTS);
+        return ret != NULL || ::GetLastError() == ERROR_CLASS_ALREADY_EXISTS;
+    }
 
-CDropShadowWnd::CDropShadowWnd(ShadowSide side)
-    : side_(side), hWnd_(NULL), shadow_image_(NULL), width_(0), height_(0)
-{
-}
+    HWND CreateShadowWindow(HINSTANCE hInstance, HWND hParentWnd)
+    {
+        if (!RegisterWindowClass(hInstance))
+            return NULL;
 
+        HWND hWnd = ::CreateWindowEx(
+            WS_EX_LAYERED | WS_EX_TRANSPARENT | WS_EX_NOACTIVATE,
+            kDropShadowWndClassName,
+            NULL,
+            WS_POPUP, CW_USEDEFAULT,
+            0, 0, 0, hParentWnd, NULL, hInstance, NULL);
 
-CDropShadowWnd::~CDropShadowWnd(void)
-{
-    if (shadow_image_ != NULL)
-    {
-        ::DeleteObject(shadow_image_);
-        shadow_image_ = NULL;
+        ASSERT(hWnd != NULL);
+
+        // Disable message handler of drop shadow window,
+        // this will avoid break the modal dialog lost modal behavior.
+        ::EnableWindow(hWnd, FALSE);
+        return hWnd;
     }
 
-    if (hWnd_ != NULL)
+    HBITMAP CreateBitmap(int width, int height, void ** ppvBits)
     {
-        ::DestroyWindow(hWnd_);
+        BITMAPINFO bmi;
+        ::ZeroMemory(&bmi, sizeof(BITMAPINFO));
+
+        bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        bmi.bmiHeader.biWidth = width;
+        bmi.bmiHeader.biHeight = -height;
+        bmi.bmiHeader.biPlanes = 1;
+        bmi.bmiHeader.biBitCount = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+        bmi.bmiHeader.biSizeImage = width * height * 4;
+
+        return ::CreateDIBSection(NULL, &bmi, DIB_RGB_COLORS, ppvBits, NULL, 0);
     }
-}
 
-bool CDropShadowWnd::RegisterWindowClass(HINSTANCE hInstance)
+    // The layered window keeps the pixels it was given, moving it is enough.
+    const UINT kMoveFlags = SWP_NOSIZE | SWP_NOZORDER | SWP_NOACTIVATE | SWP_NOREDRAW;
+
+} // namespace
+
+CShadowSurface::CShadowSurface(void)
+    : hdc_(NULL), hbmp_(NULL), old_bmp_(NULL), bits_(NULL), width_(0), height_(0)
 {
-    // Register window class for shadow window
-    WNDCLASSEX wcex;
+}
 
-    memset(&wcex, 0, sizeof(wcex));
-    wcex.cbSize = sizeof(WNDCLASSEX);
+CShadowSurface::~CShadowSurface(void)
+{
+    Release();
+}
 
-    wcex.style          = CS_HREDRAW | CS_VREDRAW;
-    wcex.lpfnWndProc    = DropShadowWndProc;
-    wcex.cbClsExtra     = 0;
-    wcex.cbWndExtra     = 0;
-    wcex.hInstance      = hInstance;
-    wcex.hIcon          = NULL;
-    wcex.hCursor        = LoadCursor(NULL, IDC_ARROW);
-    wcex.hbrBackground  = (HBRUSH)(COLOR_WINDOW+1);
-    wcex.lpszMenuName   = NULL;
-    wcex.lpszClassName  = kDropShadowWndClassName;
-    wcex.hIconSm        = NULL;
+bool CShadowSurface::Create(int width, int height)
+{
+    Release();
 
-    ATOM ret = ::RegisterClassEx(&wcex);
+    void* pvBits;
+    hbmp_ = CreateBitmap(width, height, &pvBits);
+    if (hbmp_ == NULL)
+        return false;
 
-    if (ret != NULL)
+    hdc_ = ::CreateCompatibleDC(NULL);
+    if (hdc_ == NULL)
     {
-        // Initialize at here to reduce lock.
-        active_shadow_.Initialize();
-        inactive_shadow_.Initialize();
+        ::DeleteObject(hbmp_);
+        hbmp_ = NULL;
+        return false;
     }
 
-    ASSERT(ret != NULL || ::GetLastError() == ERROR_CLASS_ALREADY_EXISTS);
-    return ret != NULL || ::GetLastError() == ERROR_CLASS_ALREADY_EXISTS;
+    old_bmp_ = ::SelectObject(hdc_, hbmp_);
+    bits_ = (BYTE *)pvBits;
+    width_ = width;
+    height_ = height;
+    return true;
 }
 
-void CDropShadowWnd::Create(HINSTANCE hInstance, HWND hParentWnd)
+void CShadowSurface::Release()
 {
-    if (RegisterWindowClass(hInstance))
+    if (hdc_ != NULL)
     {
-        hWnd_ = ::CreateWindowEx(
-            WS_EX_LAYERED | WS_EX_TRANSPARENT | WS_EX_NOACTIVATE,
-            kDropShadowWndClassName,
-            NULL,
-            WS_POPUP, CW_USEDEFAULT,
-            0, 0, 0, hParentWnd, NULL, hInstance, NULL);
+        ::SelectObject(hdc_, old_bmp_);
+        ::DeleteDC(hdc_);
+        hdc_ = NULL;
+        old_bmp_ = NULL;
+    }
 
-        ASSERT(hWnd_ != NULL);
+    if (hbmp_ != NULL)
+    {
+        ::DeleteObject(hbmp_);
+        hbmp_ = NULL;
+    }
 
-        // Disable message handler of drop shadow window,
-        // this will avoid break the modal dialog lost modal behavior.
-        ::EnableWindow(hWnd_, FALSE);
+    bits_ = NULL;
+    width_ = 0;
+    height_ = 0;
+}
+
+CDropShadowWnd::CDropShadowWnd(ShadowSide side)
+    : side_(side), hWnd_(NULL), width_(0), height_(0), color_(0)
+{
+}
+
+
+CDropShadowWnd::~CDropShadowWnd(void)
+{
+    if (hWnd_ != NULL)
+    {
+        ::DestroyWindow(hWnd_);
     }
 }
 
+void CDropShadowWnd::Create(HINSTANCE hInstance, HWND hParentWnd)
+{
+    hWnd_ = CreateShadowWindow(hInstance, hParentWnd);
+}
+
 void CDropShadowWnd::Destroy()
 {
     ASSERT(hWnd_ != NULL);
@@ -106,75 +184,62 @@ void CDropShadowWnd::HideShadow()
     ::ShowWindow(hWnd_, SW_HIDE);
 }
 
-HBITMAP CDropShadowWnd::CreateBitmap(int width, int height)
-{
-    BITMAPINFO bmi;
-    ::ZeroMemory(&bmi, sizeof(BITMAPINFO));
-
-    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
-    bmi.bmiHeader.biWidth = width;
-    bmi.bmiHeader.biHeight = height;
-    bmi.bmiHeader.biPlanes = 1;
-    bmi.bmiHeader.biBitCount = 32;
-    bmi.bmiHeader.biCompression = BI_RGB;
-    bmi.bmiHeader.biSizeImage = width * height * 4;
-
-    BYTE *pvBits;
-    return ::CreateDIBSection(NULL, &bmi, DIB_RGB_COLORS, (void **)&pvBits, NULL, 0);
-}
-
-void CDropShadowWnd::UpdateShadow(HWND hParentWnd, const DropShadowBitmaps& shadow, bool force)
+void CDropShadowWnd::UpdateShadow(HWND hParentWnd, const DropShadowBitmaps& shadow, COLORREF color, bool force,
+    DropShadowStats* stats)
 {
     int width = bounds_.right - bounds_.left;
     int height = bounds_.bottom - bounds_.top;
-
-    HDC hScreenDC = ::GetDC(NULL);
-    HDC hMemDC = ::CreateCompatibleDC(hScreenDC);
-    ::ReleaseDC(NULL, hScreenDC);
-
-    HBITMAP hMemBmp = CreateBitmap(width, height);
-    ::SelectObject(hMemDC, hMemBmp);
-
-    HDC hPaintDC = ::CreateCompatibleDC(hMemDC);
-
-    if (width != width_ || height != height_ || force || shadow_image_ == NULL)
+    if (width <= 0 || height <= 0)
+        return;
+
+    // Moving the window redraws nothing, resizing it only the far end of
+    // the strip, and the surface is only allocated again when it grows
+    // past its capacity.
+    SurfaceCapacity::Strip strip = { surface_.GetWidth(), surface_.GetHeight(), width_, height_,
+        surface_.IsCreated() };
+    SurfaceCapacity::Update update = SurfaceCapacity::PlanStripUpdate(strip, width, height,
+        side_ == Top || side_ == Bottom, shadow.GetFarCornerExtent(side_), force || color != color_);
+
+    if (update.reallocate)
     {
-        width_ = width;
-        height_ = height;
+        if (!surface_.Create(update.capacity_width, update.capacity_height))
+            return;
 
-        if (shadow_image_ != NULL)
-        {
-            ::DeleteObject(shadow_image_);
-            shadow_image_ = NULL;
-        }
-
-        shadow_image_ = CreateBitmap(width, height);
-        ::SelectObject(hPaintDC, shadow_image_);
-
-        shadow.MakeShadow(hPaintDC, width, height, side_);
+        ++stats->allocations;
     }
-    else
+
+    if (update.redraw_from >= 0)
     {
-        ::SelectObject(hPaintDC, shadow_image_);
+        // Let GDI finish with the surface before writing into it.
+        ::GdiFlush();
+        int written = shadow.MakeShadow(surface_.GetBits(), surface_.GetStride(), width, height, side_, color,
+            update.redraw_from);
+        stats->bytes_written += written * 4;
     }
 
-    ::BitBlt(hMemDC, 0, 0, width, height, hPaintDC, 0, 0, SRCCOPY);
-
-    ::DeleteDC(hPaintDC);
+    width_ = width;
+    height_ = height;
+    color_ = color;
 
     POINT ptDst = {bounds_.left, bounds_.top};
     POINT ptSrc = {0, 0};
     SIZE wndSize = {width, height};
-    BLENDFUNCTION blendPixelFunction= { AC_SRC_OVER, 0, 255, AC_SRC_ALPHA };
+    BLENDFUNCTION blendPixelFunction = kShadowBlend;
 
     ::ShowWindow(hWnd_, SW_SHOWNOACTIVATE);
 
-    ::UpdateLayeredWindow(hWnd_, NULL, &ptDst, &wndSize, hMemDC,
+    ::UpdateLayeredWindow(hWnd_, NULL, &ptDst, &wndSize, surface_.GetDC(),
         &ptSrc, 0, &blendPixelFunction, ULW_ALPHA);
+}
+
+HDWP CDropShadowWnd::DeferMove(HDWP hdwp)
+{
+    return ::DeferWindowPos(hdwp, hWnd_, NULL, bounds_.left, bounds_.top, 0, 0, kMoveFlags);
+}
 
-    // Delete the Memory DC, this will release its hold on the memory bitmap.
-    ::DeleteDC(hMemDC);
-    ::DeleteObject(hMemBmp);
+void CDropShadowWnd::Move()
+{
+    ::SetWindowPos(hWnd_, NULL, bounds_.left, bounds_.top, 0, 0, kMoveFlags);
 }
 
 void CDropShadowWnd::CalculateBounds(RECT rectParent, int shadowSize)
@@ -227,17 +292,126 @@ void CDropShadowWnd::CalculateBounds(RECT rectParent, int shadowSize)
     }
 }
 
-CDropShadow::CDropShadow(void)
-    : active_(false)
+CDropShadowSurroundWnd::CDropShadowSurroundWnd(void)
+    : hWnd_(NULL), width_(0), height_(0), color_(0)
 {
-    shadow_wnds_[0] = new CDropShadowWnd(Left);
-    shadow_wnds_[1] = new CDropShadowWnd(Top);
-    shadow_wnds_[2] = new CDropShadowWnd(Right);
-    shadow_wnds_[3] = new CDropShadowWnd(Bottom);
+}
+
+CDropShadowSurroundWnd::~CDropShadowSurroundWnd(void)
+{
+    if (hWnd_ != NULL)
+    {
+        ::DestroyWindow(hWnd_);
+    }
+}
+
+void CDropShadowSurroundWnd::Create(HINSTANCE hInstance, HWND hParentWnd)
+{
+    hWnd_ = CreateShadowWindow(hInstance, hParentWnd);
+}
+
+void CDropShadowSurroundWnd::Destroy()
+{
+    ASSERT(hWnd_ != NULL);
+    ::DestroyWindow(hWnd_);
+    hWnd_ = NULL;
+}
+
+void CDropShadowSurroundWnd::HideShadow()
+{
+    ::ShowWindow(hWnd_, SW_HIDE);
+}
+
+void CDropShadowSurroundWnd::UpdateShadow(RECT rectParent, const DropShadowBitmaps& shadow, COLORREF color, bool force,
+    DropShadowStats* stats)
+{
+    int width = rectParent.right - rectParent.left;
+    int height = rectParent.bottom - rectParent.top;
+    if (width <= 0 || height <= 0)
+        return;
+
+    int shadowSize = shadow.GetShadowSize();
+    int surfaceWidth = ShadowSurround::GetSurfaceWidth(width, shadowSize);
+    int surfaceHeight = ShadowSurround::GetSurfaceHeight(height, shadowSize);
+
+    int written = 0;
+    if (surfaceWidth > surface_.GetWidth() || surfaceHeight > surface_.GetHeight())
+    {
+        int capacityWidth = std::max<int>(SurfaceCapacity::RoundUp(surfaceWidth), surface_.GetWidth());
+        int capacityHeight = std::max<int>(SurfaceCapacity::RoundUp(surfaceHeight), surface_.GetHeight());
+        if (!surface_.Create(capacityWidth, capacityHeight))
+            return;
+
+        ++stats->allocations;
+
+        // Everything but the strips stays transparent from here on.
+        memset(surface_.GetBits(), 0, surface_.GetStride() * surface_.GetHeight());
+        written = surface_.GetWidth() * surface_.GetHeight();
+        written += shadow.MakeSurround(surface_.GetBits(), surface_.GetStride(), width, height, color);
+    }
+    else if (width != width_ || height != height_ || color != color_ || force)
+    {
+        // The strips move with the size, so the old ones are cleared
+        // and the new ones drawn in full.
+        ::GdiFlush();
+        written = ShadowSurround::Clear(surface_.GetBits(), surface_.GetStride(), width_, height_, shadowSize);
+        written += shadow.MakeSurround(surface_.GetBits(), surface_.GetStride(), width, height, color);
+    }
+
+    width_ = width;
+    height_ = height;
+    color_ = color;
+
+    POINT ptDst = {rectParent.left - shadowSize, rectParent.top - shadowSize};
+    POINT ptSrc = {0, 0};
+    SIZE wndSize = {surfaceWidth, surfaceHeight};
+    BLENDFUNCTION blendPixelFunction = kShadowBlend;
+
+    ::ShowWindow(hWnd_, SW_SHOWNOACTIVATE);
+
+    ::UpdateLayeredWindow(hWnd_, NULL, &ptDst, &wndSize, surface_.GetDC(),
+        &ptSrc, 0, &blendPixelFunction, ULW_ALPHA);
+
+    stats->bytes_written += written * 4;
+}
+
+void CDropShadowSurroundWnd::Move(RECT rectParent, int shadowSize)
+{
+    ::SetWindowPos(hWnd_, NULL, rectParent.left - shadowSize, rectParent.top - shadowSize, 0, 0,
+        kMoveFlags);
+}
+
+CDropShadow::CDropShadow(bool surround, const ShadowParams* params)
+    : active_(false), hParentWnd_(NULL), surround_wnd_(NULL), shadow_(NULL), use_params_(params != NULL),
+      visible_(false), color_(0), fade_timer_(false)
+{
+    ::ZeroMemory(&stats_, sizeof(stats_));
+
+    if (params != NULL)
+        params_ = *params;
+    else
+        ::ZeroMemory(&params_, sizeof(params_));
+
+    if (surround)
+    {
+        surround_wnd_ = new CDropShadowSurroundWnd();
+        for (int i = 0; i < 4; ++i)
+            shadow_wnds_[i] = NULL;
+    }
+    else
+    {
+        shadow_wnds_[0] = new CDropShadowWnd(Left);
+        shadow_wnds_[1] = new CDropShadowWnd(Top);
+        shadow_wnds_[2] = new CDropShadowWnd(Right);
+        shadow_wnds_[3] = new CDropShadowWnd(Bottom);
+    }
 }
 
 CDropShadow::~CDropShadow(void)
 {
+    ShadowRegistry::Release(shadow_);
+    delete surround_wnd_;
+
     for (int i = 0; i < 4; ++i)
     {
         delete shadow_wnds_[i];
@@ -246,14 +420,45 @@ CDropShadow::~CDropShadow(void)
 
 void CDropShadow::Create(HINSTANCE hInstance, HWND hParentWnd)
 {
-    for (int i = 0; i < 4; ++i)
+    if (shadow_ == NULL)
+    {
+        HDC hdc = ::GetDC(NULL);
+        int dpi = ::GetDeviceCaps(hdc, LOGPIXELSY);
+        ::ReleaseDC(NULL, hdc);
+
+        shadow_ = ShadowRegistry::Acquire(use_params_ ? &params_ : NULL, dpi);
+    }
+
+    hParentWnd_ = hParentWnd;
+
+    if (surround_wnd_ != NULL)
     {
-        shadow_wnds_[i]->Create(hInstance, hParentWnd);
+        surround_wnd_->Create(hInstance, hParentWnd);
     }
+    else
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            shadow_wnds_[i]->Create(hInstance, hParentWnd);
+        }
+    }
+
+    // The fade timer goes to one of the shadow windows.
+    ::SetWindowLongPtr(GetTimerWnd(), GWLP_USERDATA, (LONG_PTR)this);
 }
 
 void CDropShadow::Destroy()
 {
+    StopFade();
+    ShadowRegistry::Release(shadow_);
+    shadow_ = NULL;
+
+    if (surround_wnd_ != NULL)
+    {
+        surround_wnd_->Destroy();
+        return;
+    }
+
     for (int i = 0; i < 4; ++i)
     {
         shadow_wnds_[i]->Destroy();
@@ -262,11 +467,11 @@ void CDropShadow::Destroy()
 
 void CDropShadow::ShowShadow(HWND hParentWnd, bool active)
 {
-    bool force = false;
+    bool changed = false;
     if (active != active_)
     {
         active_ = active;
-        force = true;
+        changed = true;
     }
 
     LONG lParentStyle = ::GetWindowLong(hParentWnd, GWL_STYLE);
@@ -279,7 +484,8 @@ void CDropShadow::ShowShadow(HWND hParentWnd, bool active)
             if (hParentOwner != NULL)
             {
                 // Show drop shadow if the parent window has owner and minimized.
-                UpdateShadow(hParentWnd, inactive_shadow_, force);
+                StopFade();
+                UpdateShadow(hParentWnd, kInactiveShadowColor, false);
             }
             else
             {
@@ -289,7 +495,16 @@ void CDropShadow::ShowShadow(HWND hParentWnd, bool active)
         else
         {
             // Show drop shadow if parent is normal and visiable.
-            UpdateShadow(hParentWnd, active ? active_shadow_ : inactive_shadow_, force);
+            COLORREF color = active ? kActiveShadowColor : kInactiveShadowColor;
+
+            // A shadow on screen fades to the new color.
+            if (changed && visible_)
+                StartFade(color);
+
+            if (fade_.IsRunning())
+                color = fade_.GetColor();
+
+            UpdateShadow(hParentWnd, color, false);
         }
     }
     else
@@ -298,26 +513,151 @@ void CDropShadow::ShowShadow(HWND hParentWnd, bool active)
     }
 }
 
-void CDropShadow::UpdateShadow(HWND hParentWnd, const DropShadowBitmaps& shadow, bool force)
+void CDropShadow::UpdateShadow(HWND hParentWnd, COLORREF color, bool force)
 {
+    if (shadow_ == NULL)
+        return;
+
+    visible_ = true;
+    color_ = color;
+
     RECT rectParent;
     ::GetWindowRect(hParentWnd, &rectParent);
 
-    int shadowSize = shadow.GetShadowSize();
+    int shadowSize = shadow_->GetShadowSize();
+
+    ShadowPlacement placement = { rectParent.left, rectParent.top,
+        rectParent.right - rectParent.left, rectParent.bottom - rectParent.top, color };
+
+    ShadowAction action = tracker_.Update(placement, force);
+    if (action == ShadowUnchanged)
+        return;
+
+    LONGLONG start = WindowExtenders::GetTicks();
+
+    if (action == ShadowMoved)
+    {
+        MoveShadow(rectParent, shadowSize);
+        ++stats_.moves;
+    }
+    else if (surround_wnd_ != NULL)
+    {
+        surround_wnd_->UpdateShadow(rectParent, *shadow_, color, force, &stats_);
+        ++stats_.updates;
+    }
+    else
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            shadow_wnds_[i]->CalculateBounds(rectParent, shadowSize);
+            shadow_wnds_[i]->UpdateShadow(hParentWnd, *shadow_, color, force, &stats_);
+        }
+        ++stats_.updates;
+    }
+
+    stats_.update_ns += WindowExtenders::TicksToNanoseconds(WindowExtenders::GetTicks() - start);
+}
+
+void CDropShadow::MoveShadow(RECT rectParent, int shadowSize)
+{
+    if (surround_wnd_ != NULL)
+    {
+        surround_wnd_->Move(rectParent, shadowSize);
+        return;
+    }
+
+    // Move the four windows in one go so that they do not trail each
+    // other while the window is dragged.
+    HDWP hdwp = ::BeginDeferWindowPos(4);
 
     for (int i = 0; i < 4; ++i)
     {
         shadow_wnds_[i]->CalculateBounds(rectParent, shadowSize);
-        shadow_wnds_[i]->UpdateShadow(hParentWnd, shadow, force);
+        if (hdwp != NULL)
+            hdwp = shadow_wnds_[i]->DeferMove(hdwp);
+    }
+
+    if (hdwp != NULL)
+    {
+        ::EndDeferWindowPos(hdwp);
+    }
+    else
+    {
+        // A failed DeferWindowPos drops the whole batch.
+        for (int i = 0; i < 4; ++i)
+        {
+            shadow_wnds_[i]->Move();
+        }
     }
 }
 
 void CDropShadow::HideShadow()
 {
+    StopFade();
+    tracker_.Reset();
+    visible_ = false;
+
+    if (surround_wnd_ != NULL)
+    {
+        surround_wnd_->HideShadow();
+        return;
+    }
+
     for (int i = 0; i < 4; ++i)
     {
         shadow_wnds_[i]->HideShadow();
     }
 }
 
+HWND CDropShadow::GetTimerWnd() const
+{
+    return (surround_wnd_ != NULL) ? surround_wnd_->GetHWnd() : shadow_wnds_[0]->GetHWnd();
+}
+
+void CDropShadow::StartFade(COLORREF color)
+{
+    // From whatever is on screen, also halfway through another fade.
+    fade_.Start(color_, color);
+
+    if (!fade_timer_)
+    {
+        fade_timer_ = WindowExtenders::SetCoalescedTimer(GetTimerWnd(), kFadeTimerId,
+            WindowExtenders::GetFrameInterval(), FadeTimerProc, 0) != 0;
+
+        // Without a timer there is no fade.
+        if (!fade_timer_)
+            fade_.Stop();
+    }
+}
+
+void CDropShadow::StopFade()
+{
+    fade_.Stop();
+
+    if (fade_timer_)
+    {
+        ::KillTimer(GetTimerWnd(), kFadeTimerId);
+        fade_timer_ = false;
+    }
+}
+
+void CDropShadow::StepFade()
+{
+    // Every frame draws each side once in the next color.
+    bool running = fade_.Step();
+
+    if (visible_)
+        UpdateShadow(hParentWnd_, fade_.GetColor(), false);
+
+    if (!running || !visible_)
+        StopFade();
+}
+
+void CALLBACK CDropShadow::FadeTimerProc(HWND hwnd, UINT /*uMsg*/, UINT_PTR /*idEvent*/, DWORD /*dwTime*/)
+{
+    CDropShadow* shadow = (CDropShadow *)::GetWindowLongPtr(hwnd, GWLP_USERDATA);
+    if (shadow != NULL)
+        shadow->StepFade();
+}
+
 } //namespace MetroWindow
@@ -2,10 +2,49 @@
 
 #include "MetroCaptionTheme.h"
 #include "DropShadowBitmaps.h"
+#include "ShadowFade.h"
+#include "ShadowTracker.h"
 
 namespace MetroWindow
 {
 
+// What the drop shadow of a frame has cost so far.
+struct DropShadowStats
+{
+    unsigned long updates;      // times the shadow was drawn and shown
+    unsigned long moves;        // times it was only moved
+    ULONGLONG update_ns;        // time spent in both
+    ULONGLONG bytes_written;    // shadow pixels drawn or cleared, in bytes
+    unsigned long allocations;  // surfaces created
+};
+
+// A top-down 32-bit DIB selected into a memory DC. It is kept between
+// updates and given to UpdateLayeredWindow as is.
+class CShadowSurface
+{
+public:
+    CShadowSurface(void);
+    ~CShadowSurface(void);
+
+    bool Create(int width, int height);
+    void Release();
+
+    bool IsCreated() const { return bits_ != NULL; }
+    HDC GetDC() const { return hdc_; }
+    BYTE* GetBits() const { return bits_; }
+    int GetStride() const { return width_ * 4; }
+    int GetWidth() const { return width_; }
+    int GetHeight() const { return height_; }
+
+private:
+    HDC hdc_;
+    HBITMAP hbmp_;
+    HGDIOBJ old_bmp_;
+    BYTE* bits_;
+    int width_;
+    int height_;
+};
+
 class CDropShadowWnd
 {
 public:
@@ -15,39 +54,100 @@ public:
     void Create(HINSTANCE hInstance, HWND hParentWnd);
     void Destroy();
     void HideShadow();
-    void UpdateShadow(HWND hParentWnd, const DropShadowBitmaps& shadow, bool force);
+    void UpdateShadow(HWND hParentWnd, const DropShadowBitmaps& shadow, COLORREF color, bool force,
+        DropShadowStats* stats);
+    HDWP DeferMove(HDWP hdwp);
+    void Move();
     void CalculateBounds(RECT rectParent, int shadowSize);
 
-private:
-    bool RegisterWindowClass(HINSTANCE hInstance);
-    HBITMAP CreateBitmap(int width, int height);
+    HWND GetHWnd() const { return hWnd_; }
 
 private:
     ShadowSide side_;
     HWND hWnd_;
-    HBITMAP shadow_image_;
+
+    // The surface the shadow is drawn in and given to UpdateLayeredWindow
+    // from. It holds a width_ x height_ shadow of color_ and may be
+    // bigger than that.
+    CShadowSurface surface_;
     int width_;
     int height_;
+    COLORREF color_;
     RECT bounds_;
 };
 
+// One layered window around the owner that shows all of the shadow. Its
+// inside is transparent and lets the mouse through, so it can lie over
+// the owner. Moving or updating the shadow is one call instead of four.
+class CDropShadowSurroundWnd
+{
+public:
+    CDropShadowSurroundWnd(void);
+    ~CDropShadowSurroundWnd(void);
+
+    void Create(HINSTANCE hInstance, HWND hParentWnd);
+    void Destroy();
+    void HideShadow();
+    void UpdateShadow(RECT rectParent, const DropShadowBitmaps& shadow, COLORREF color, bool force,
+        DropShadowStats* stats);
+    void Move(RECT rectParent, int shadowSize);
+
+    HWND GetHWnd() const { return hWnd_; }
+
+private:
+    HWND hWnd_;
+
+    // The surface holds the shadow of a width_ x height_ window.
+    CShadowSurface surface_;
+    int width_;
+    int height_;
+    COLORREF color_;
+};
+
 class CDropShadow
 {
 public:
-    CDropShadow(void);
+    // With 'surround' the shadow is one window around the owner instead
+    // of four windows along its sides. 'params' describe the shadow at
+    // 96 dpi, NULL is the built-in one.
+    explicit CDropShadow(bool surround = false, const ShadowParams* params = NULL);
     ~CDropShadow(void);
 
     void Create(HINSTANCE hInstance, HWND hParentWnd);
     void Destroy();
     void ShowShadow(HWND hParentWnd, bool active);
 
+    const DropShadowStats& GetStats() const { return stats_; }
+
 private:
-    void UpdateShadow(HWND hParentWnd, const DropShadowBitmaps& shadow, bool force);
+    void UpdateShadow(HWND hParentWnd, COLORREF color, bool force);
+    void MoveShadow(RECT rectParent, int shadowSize);
     void HideShadow();
 
+    HWND GetTimerWnd() const;
+    void StartFade(COLORREF color);
+    void StopFade();
+    void StepFade();
+    static void CALLBACK FadeTimerProc(HWND hwnd, UINT uMsg, UINT_PTR idEvent, DWORD dwTime);
+
 private:
     bool active_;
+    HWND hParentWnd_;
     CDropShadowWnd* shadow_wnds_[4];
+    CDropShadowSurroundWnd* surround_wnd_;
+    const DropShadowBitmaps* shadow_;
+    ShadowParams params_;
+    bool use_params_;
+    ShadowTracker tracker_;
+
+    // What is on screen, and the fade from it to the color for the
+    // activation state.
+    bool visible_;
+    COLORREF color_;
+    ShadowFade fade_;
+    bool fade_timer_;
+
+    DropShadowStats stats_;
 };
 
 } //namespace MetroWindow
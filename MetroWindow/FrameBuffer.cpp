@@ -0,0 +1,137 @@
+#include "stdafx.h"
+#include "FrameBuffer.h"
+
+#include "SurfaceCapacity.h"
+
+namespace MetroWindow
+{
+
+namespace
+{
+    HBITMAP CreateBitmap(int width, int height, void ** ppvBits)
+    {
+        BITMAPINFO bmi;
+        ::ZeroMemory(&bmi, sizeof(BITMAPINFO));
+
+        bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        bmi.bmiHeader.biWidth = width;
+        bmi.bmiHeader.biHeight = -height;
+        bmi.bmiHeader.biPlanes = 1;
+        bmi.bmiHeader.biBitCount = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+        bmi.bmiHeader.biSizeImage = width * height * 4;
+
+        return ::CreateDIBSection(NULL, &bmi, DIB_RGB_COLORS, ppvBits, NULL, 0);
+    }
+
+} // namespace
+
+CFrameBuffer::CFrameBuffer(void)
+    : hdc_(NULL), hbmp_(NULL), old_bmp_(NULL), bits_(NULL)
+    , capacity_width_(0), capacity_height_(0)
+    , hrgn_(NULL), hrgn_rect_(NULL), allocations_(0)
+{
+}
+
+CFrameBuffer::~CFrameBuffer(void)
+{
+    Release();
+}
+
+HDC CFrameBuffer::Prepare(int width, int height)
+{
+    int capacityWidth = capacity_width_;
+    int capacityHeight = capacity_height_;
+    if (!SurfaceCapacity::Grow(&capacityWidth, &capacityHeight, width, height) && hdc_ != NULL)
+        return hdc_;
+
+    if (hdc_ == NULL)
+    {
+        hdc_ = ::CreateCompatibleDC(NULL);
+        if (hdc_ == NULL)
+            return NULL;
+
+        ++allocations_;
+    }
+
+    void* pvBits;
+    HBITMAP hbmp = CreateBitmap(capacityWidth, capacityHeight, &pvBits);
+    if (hbmp == NULL)
+        return NULL;
+
+    ++allocations_;
+
+    HGDIOBJ old = ::SelectObject(hdc_, hbmp);
+    if (hbmp_ != NULL)
+        ::DeleteObject(hbmp_);
+    else
+        old_bmp_ = old;
+
+    hbmp_ = hbmp;
+    bits_ = (BYTE *)pvBits;
+    capacity_width_ = capacityWidth;
+    capacity_height_ = capacityHeight;
+    return hdc_;
+}
+
+HRGN CFrameBuffer::GetDamageRgn(const FrameDamage& damage, int dx, int dy)
+{
+    if (hrgn_ == NULL)
+    {
+        hrgn_ = ::CreateRectRgn(0, 0, 0, 0);
+        hrgn_rect_ = ::CreateRectRgn(0, 0, 0, 0);
+        allocations_ += 2;
+
+        if (hrgn_ == NULL || hrgn_rect_ == NULL)
+        {
+            Release();
+            return NULL;
+        }
+    }
+
+    ::SetRectRgn(hrgn_, 0, 0, 0, 0);
+    for (int i = 0; i < damage.GetCount(); ++i)
+    {
+        const DamageRect& rect = damage.GetRect(i);
+        ::SetRectRgn(hrgn_rect_, rect.left + dx, rect.top + dy, rect.right + dx, rect.bottom + dy);
+        ::CombineRgn(hrgn_, hrgn_, hrgn_rect_, RGN_OR);
+    }
+
+    return hrgn_;
+}
+
+void CFrameBuffer::Release()
+{
+    if (hdc_ != NULL)
+    {
+        if (hbmp_ != NULL)
+            ::SelectObject(hdc_, old_bmp_);
+        ::DeleteDC(hdc_);
+        hdc_ = NULL;
+        old_bmp_ = NULL;
+    }
+
+    if (hbmp_ != NULL)
+    {
+        ::DeleteObject(hbmp_);
+        hbmp_ = NULL;
+    }
+
+    if (hrgn_ != NULL)
+    {
+        ::DeleteObject(hrgn_);
+        hrgn_ = NULL;
+    }
+
+    if (hrgn_rect_ != NULL)
+    {
+        ::DeleteObject(hrgn_rect_);
+        hrgn_rect_ = NULL;
+    }
+
+    bits_ = NULL;
+    capacity_width_ = 0;
+    capacity_height_ = 0;
+}
+
+} //namespace MetroWindow
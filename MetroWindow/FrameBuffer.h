@@ -0,0 +1,53 @@
+#pragma once
+
+#include "FrameDamage.h"
+
+namespace MetroWindow
+{
+
+// What the frame is painted with when there is no buffered paint: a
+// top-down 32-bit DIB selected into a memory DC, and the region the
+// damage is clipped with. They are kept between paints and the DIB is
+// only reallocated when the frame outgrows it, so painting a frame of
+// the same or a smaller size creates no GDI objects.
+class CFrameBuffer
+{
+public:
+    CFrameBuffer(void);
+    ~CFrameBuffer(void);
+
+    // Makes sure the buffer holds width x height pixels. Returns the DC
+    // to paint in, NULL if the buffer could not be created.
+    HDC Prepare(int width, int height);
+
+    // The damage moved by (dx, dy) as a region, which is valid until the
+    // next call. Returns NULL if the region could not be created.
+    HRGN GetDamageRgn(const FrameDamage& damage, int dx, int dy);
+
+    // Frees everything, the next paint allocates again.
+    void Release();
+
+    HDC GetDC() const { return hdc_; }
+    BYTE* GetBits() const { return bits_; }
+    int GetStride() const { return capacity_width_ * 4; }
+    int GetCapacityWidth() const { return capacity_width_; }
+    int GetCapacityHeight() const { return capacity_height_; }
+
+    // GDI objects created so far.
+    unsigned long GetAllocations() const { return allocations_; }
+
+private:
+    HDC hdc_;
+    HBITMAP hbmp_;
+    HGDIOBJ old_bmp_;
+    BYTE* bits_;
+    int capacity_width_;
+    int capacity_height_;
+
+    HRGN hrgn_;
+    HRGN hrgn_rect_;
+
+    unsigned long allocations_;
+};
+
+} //namespace MetroWindow
@@ -0,0 +1,147 @@
+#include "FrameDamage.h"
+
+#include <algorithm>
+
+namespace MetroWindow
+{
+
+namespace
+{
+    bool IsEmptyRect(const DamageRect& rect)
+    {
+        return rect.left >= rect.right || rect.top >= rect.bottom;
+    }
+
+    long Area(const DamageRect& rect)
+    {
+        return (long)(rect.right - rect.left) * (rect.bottom - rect.top);
+    }
+
+    DamageRect Union(const DamageRect& a, const DamageRect& b)
+    {
+        DamageRect rect;
+        rect.left = std::min<int>(a.left, b.left);
+        rect.top = std::min<int>(a.top, b.top);
+        rect.right = std::max<int>(a.right, b.right);
+        rect.bottom = std::max<int>(a.bottom, b.bottom);
+        return rect;
+    }
+
+    DamageRect Intersection(const DamageRect& a, const DamageRect& b)
+    {
+        DamageRect rect;
+        rect.left = std::max<int>(a.left, b.left);
+        rect.top = std::max<int>(a.top, b.top);
+        rect.right = std::min<int>(a.right, b.right);
+        rect.bottom = std::min<int>(a.bottom, b.bottom);
+        return rect;
+    }
+
+    bool Overlaps(const DamageRect& a, const DamageRect& b)
+    {
+        return !IsEmptyRect(Intersection(a, b));
+    }
+
+    // Merging does not paint a pixel that neither rectangle covers.
+    bool ShouldMerge(const DamageRect& a, const DamageRect& b)
+    {
+        return Area(Union(a, b)) <= Area(a) + Area(b);
+    }
+
+} // namespace
+
+FrameDamage::FrameDamage(void)
+{
+}
+
+void FrameDamage::Add(const DamageRect& rect)
+{
+    if (IsEmptyRect(rect))
+        return;
+
+    // A merged rectangle can now be mergeable with one that was kept
+    // apart before, so the search starts over after every merge.
+    DamageRect merged = rect;
+    for (size_t i = 0; i < rects_.size(); )
+    {
+        if (ShouldMerge(rects_[i], merged))
+        {
+            merged = Union(rects_[i], merged);
+            rects_.erase(rects_.begin() + i);
+            i = 0;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    rects_.push_back(merged);
+
+    if ((int)rects_.size() > kMaxRects)
+    {
+        DamageRect bounds = GetBounds();
+        rects_.assign(1, bounds);
+    }
+}
+
+void FrameDamage::Add(int left, int top, int right, int bottom)
+{
+    DamageRect rect = { left, top, right, bottom };
+    Add(rect);
+}
+
+void FrameDamage::Clear()
+{
+    rects_.clear();
+}
+
+bool FrameDamage::Intersects(const DamageRect& rect) const
+{
+    for (size_t i = 0; i < rects_.size(); ++i)
+    {
+        if (Overlaps(rects_[i], rect))
+            return true;
+    }
+
+    return false;
+}
+
+void FrameDamage::Clip(const DamageRect& bounds)
+{
+    std::vector<DamageRect> clipped;
+    for (size_t i = 0; i < rects_.size(); ++i)
+    {
+        DamageRect rect = Intersection(rects_[i], bounds);
+        if (!IsEmptyRect(rect))
+            clipped.push_back(rect);
+    }
+
+    rects_.swap(clipped);
+}
+
+DamageRect FrameDamage::GetBounds() const
+{
+    if (rects_.empty())
+    {
+        DamageRect empty = { 0, 0, 0, 0 };
+        return empty;
+    }
+
+    DamageRect bounds = rects_[0];
+    for (size_t i = 1; i < rects_.size(); ++i)
+        bounds = Union(bounds, rects_[i]);
+
+    return bounds;
+}
+
+long FrameDamage::GetArea() const
+{
+    long area = 0;
+    for (size_t i = 0; i < rects_.size(); ++i)
+        area += Area(rects_[i]);
+
+    return area;
+}
+
+} //namespace MetroWindow
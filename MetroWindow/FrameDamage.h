@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+
+namespace MetroWindow
+{
+
+struct DamageRect
+{
+    int left;
+    int top;
+    int right;
+    int bottom;
+};
+
+// The parts of the frame that have to be painted again, in window
+// coordinates. A rectangle is merged with another one when their
+// union covers no more pixels than the two of them, so neighbouring
+// caption buttons become one rectangle while the caption and a border
+// stay apart. Past kMaxRects the set collapses to its bounds.
+class FrameDamage
+{
+public:
+    static const int kMaxRects = 8;
+
+    FrameDamage(void);
+
+    // Empty rectangles are ignored.
+    void Add(const DamageRect& rect);
+    void Add(int left, int top, int right, int bottom);
+    void Clear();
+
+    bool IsEmpty() const { return rects_.empty(); }
+    bool Intersects(const DamageRect& rect) const;
+
+    // Drops everything outside 'bounds'.
+    void Clip(const DamageRect& bounds);
+
+    DamageRect GetBounds() const;
+    int GetCount() const { return (int)rects_.size(); }
+    const DamageRect& GetRect(int index) const { return rects_[index]; }
+
+    // The pixels covered by the rectangles, overlaps counted twice.
+    long GetArea() const;
+
+private:
+    std::vector<DamageRect> rects_;
+};
+
+} //namespace MetroWindow
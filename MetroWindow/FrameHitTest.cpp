@@ -0,0 +1,71 @@
+#include "FrameHitTest.h"
+
+namespace MetroWindow
+{
+
+namespace
+{
+    bool Contains(const CanvasRect& rect, int x, int y)
+    {
+        return x >= rect.left && x < rect.right && y >= rect.top && y < rect.bottom;
+    }
+
+    // The borders are the window's own when it can be sized or DWM does
+    // not draw them; else they belong to the client.
+    FrameHit BorderHit(const FrameMetrics& metrics)
+    {
+        return (!metrics.dwm_enabled || metrics.sizable) ? FrameHitDefault : FrameHitClient;
+    }
+
+} // namespace
+
+namespace FrameHitTest
+{
+
+FrameHit Classify(const FrameLayout& layout, bool fullscreen, int x, int y, int* button)
+{
+    const FrameMetrics& metrics = layout.GetMetrics();
+    int width = metrics.window_width;
+    int height = metrics.window_height;
+
+    if (x < 0 || y < 0 || x >= width || y >= height)
+        return FrameHitNowhere;
+
+    // The outer pixel is always left to the system, even where the
+    // buttons are.
+    if (!fullscreen && (x < 1 || y < 1 || x >= width - 1 || y >= height - 1))
+        return BorderHit(metrics);
+
+    // The buttons are side by side from the right, so the one under
+    // the point follows from its distance to the right end.
+    const CanvasRect& buttons = layout.GetButtons();
+    if (Contains(buttons, x, y))
+    {
+        *button = (buttons.right - 1 - x) / metrics.button_cx;
+        return FrameHitButton;
+    }
+
+    int top = 0;
+    if (!fullscreen)
+    {
+        if (x < metrics.border_cx || y < metrics.border_cy ||
+            x >= width - metrics.border_cx || y >= height - metrics.border_cy)
+        {
+            return BorderHit(metrics);
+        }
+
+        top = metrics.border_cy;
+    }
+
+    if (y >= top + metrics.caption_height)
+        return FrameHitClient;
+
+    if (metrics.has_sys_menu && Contains(layout.GetIcon(), x, y))
+        return FrameHitSysMenu;
+
+    return FrameHitCaption;
+}
+
+} // namespace FrameHitTest
+
+} //namespace MetroWindow
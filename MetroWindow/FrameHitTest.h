@@ -0,0 +1,27 @@
+#pragma once
+
+#include "FrameLayout.h"
+
+namespace MetroWindow
+{
+
+enum FrameHit
+{
+    FrameHitNowhere,    // outside the window
+    FrameHitDefault,    // on a border, left to the default window procedure
+    FrameHitClient,
+    FrameHitCaption,
+    FrameHitSysMenu,
+    FrameHitButton
+};
+
+namespace FrameHitTest
+{
+    // Finds what is at (x, y), in window coordinates, from the layout
+    // alone. For FrameHitButton 'button' is set to the index of the
+    // button from the right, the way FrameLayout::GetButton counts.
+    FrameHit Classify(const FrameLayout& layout, bool fullscreen, int x, int y, int* button);
+
+} // namespace FrameHitTest
+
+} //namespace MetroWindow
@@ -0,0 +1,86 @@
+#include "FrameLayout.h"
+
+#include <string.h>
+
+namespace MetroWindow
+{
+
+namespace
+{
+    CanvasRect MakeRect(int left, int top, int right, int bottom)
+    {
+        CanvasRect rect = { left, top, right, bottom };
+        return rect;
+    }
+
+} // namespace
+
+FrameLayout::FrameLayout(void)
+{
+    FrameMetrics metrics;
+    memset(&metrics, 0, sizeof(metrics));
+
+    *this = FrameLayout(metrics);
+}
+
+FrameLayout::FrameLayout(const FrameMetrics& metrics)
+    : metrics_(metrics)
+{
+    int width = metrics.window_width;
+    int height = metrics.window_height;
+    int captionBottom = metrics.border_cy + metrics.caption_height;
+
+    window_ = MakeRect(0, 0, width, height);
+    client_ = MakeRect(metrics.border_cx, captionBottom,
+        width - metrics.border_cx, height - metrics.border_cy);
+    caption_ = MakeRect(0, 0, width, captionBottom);
+
+    int iconTop = (captionBottom - metrics.icon_cy) / 2;
+    icon_ = MakeRect(metrics.border_cx, iconTop,
+        metrics.border_cx + metrics.icon_cx, iconTop + metrics.icon_cy);
+
+    int buttonsRight = width - metrics.border_cx;
+    buttons_ = GetButton(metrics.button_count - 1);
+    buttons_.right = buttonsRight;
+
+    // The title runs from the icon to the buttons and keeps a pixel off
+    // both.
+    title_ = caption_;
+    if (metrics.show_icon)
+        title_.left = icon_.right + 1;
+    title_.right = buttonsRight - metrics.button_count * metrics.button_cx - 1;
+}
+
+bool FrameLayout::Matches(const FrameMetrics& metrics) const
+{
+    return metrics_.window_width == metrics.window_width &&
+        metrics_.window_height == metrics.window_height &&
+        metrics_.border_cx == metrics.border_cx &&
+        metrics_.border_cy == metrics.border_cy &&
+        metrics_.caption_height == metrics.caption_height &&
+        metrics_.icon_cx == metrics.icon_cx &&
+        metrics_.icon_cy == metrics.icon_cy &&
+        metrics_.button_cx == metrics.button_cx &&
+        metrics_.button_cy == metrics.button_cy &&
+        metrics_.button_count == metrics.button_count &&
+        metrics_.show_icon == metrics.show_icon &&
+        metrics_.has_sys_menu == metrics.has_sys_menu &&
+        metrics_.sizable == metrics.sizable &&
+        metrics_.dwm_enabled == metrics.dwm_enabled;
+}
+
+CanvasRect FrameLayout::GetButton(int index) const
+{
+    int right = metrics_.window_width - metrics_.border_cx - index * metrics_.button_cx;
+    CanvasRect button = MakeRect(right - metrics_.button_cx, 0, right, metrics_.button_cy);
+
+    if (!metrics_.dwm_enabled)
+    {
+        button.top += 1;
+        button.bottom -= 1;
+    }
+
+    return button;
+}
+
+} //namespace MetroWindow
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Canvas.h"
+
+namespace MetroWindow
+{
+
+// What the layout of a frame follows from, in pixels. All of it comes
+// from the window size, its styles and the system metrics.
+struct FrameMetrics
+{
+    int window_width;
+    int window_height;
+    int border_cx;
+    int border_cy;
+    int caption_height;
+    int icon_cx;
+    int icon_cy;
+    int button_cx;
+    int button_cy;
+    int button_count;
+    bool show_icon;     // an icon is drawn on the caption
+    bool has_sys_menu;  // the icon opens the system menu
+    bool sizable;
+    bool dwm_enabled;   // without DWM the buttons keep off the 1 pixel border
+};
+
+// Where every part of the frame is, in window coordinates. A layout is
+// not changed once it is made; a new one is made when the size, the
+// styles or the metrics of the window change.
+class FrameLayout
+{
+public:
+    // The layout of a 0 x 0 window without borders.
+    FrameLayout(void);
+    explicit FrameLayout(const FrameMetrics& metrics);
+
+    const FrameMetrics& GetMetrics() const { return metrics_; }
+
+    // True if the layout was made from the same metrics.
+    bool Matches(const FrameMetrics& metrics) const;
+
+    const CanvasRect& GetWindow() const { return window_; }
+    const CanvasRect& GetClient() const { return client_; }
+
+    // The caption with the top border above it.
+    const CanvasRect& GetCaption() const { return caption_; }
+    const CanvasRect& GetIcon() const { return icon_; }
+    const CanvasRect& GetTitle() const { return title_; }
+
+    // All caption buttons, and the one 'index' buttons from the right.
+    const CanvasRect& GetButtons() const { return buttons_; }
+    CanvasRect GetButton(int index) const;
+
+private:
+    FrameMetrics metrics_;
+    CanvasRect window_;
+    CanvasRect client_;
+    CanvasRect caption_;
+    CanvasRect icon_;
+    CanvasRect title_;
+    CanvasRect buttons_;
+};
+
+} //namespace MetroWindow
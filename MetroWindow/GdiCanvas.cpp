@@ -0,0 +1,130 @@
+#include "stdafx.h"
+#include "GdiCanvas.h"
+
+#include "PixelOps.h"
+
+namespace MetroWindow
+{
+
+namespace
+{
+    const BLENDFUNCTION kBlend = { AC_SRC_OVER, 0, 0xFF, AC_SRC_ALPHA };
+
+} // namespace
+
+CGdiCanvas::CGdiCanvas(HDC hdc)
+    : hdc_(hdc)
+{
+    ASSERT(hdc != NULL);
+}
+
+bool CGdiCanvas::GetImage(HBITMAP hbmp, CanvasImage* image)
+{
+    DIBSECTION ds;
+    if (hbmp == NULL || ::GetObject(hbmp, sizeof(ds), &ds) != sizeof(ds) ||
+        ds.dsBm.bmBits == NULL || ds.dsBm.bmBitsPixel != 32)
+    {
+        return false;
+    }
+
+    const unsigned char* bits = (const unsigned char*)ds.dsBm.bmBits;
+    int stride = ds.dsBm.bmWidthBytes;
+    if (ds.dsBmih.biHeight > 0)
+    {
+        // Bottom-up, the top row is the last one in memory.
+        bits += (ds.dsBm.bmHeight - 1) * stride;
+        stride = -stride;
+    }
+
+    image->bits = bits;
+    image->stride = stride;
+    image->width = ds.dsBm.bmWidth;
+    image->height = ds.dsBm.bmHeight;
+    image->handle = hbmp;
+    return true;
+}
+
+void CGdiCanvas::FillRect(const CanvasRect& rect, unsigned long color)
+{
+    RECT bounds = ToRect(rect);
+
+    COLORREF clrOld = ::SetBkColor(hdc_, color);
+    ASSERT(clrOld != CLR_INVALID);
+    if(clrOld != CLR_INVALID)
+    {
+        ::ExtTextOut(hdc_, 0, 0, ETO_OPAQUE, &bounds, NULL, 0, NULL);
+        ::SetBkColor(hdc_, clrOld);
+    }
+}
+
+void CGdiCanvas::FrameRect(const CanvasRect& rect, unsigned long color)
+{
+    HPEN hPen = ::CreatePen(PS_SOLID | PS_INSIDEFRAME, 1, color);
+    HPEN hOldPen = (HPEN)::SelectObject(hdc_, hPen);
+    HBRUSH hOldBrush = (HBRUSH)::SelectObject(hdc_, GetStockObject(NULL_BRUSH));
+    ::Rectangle(hdc_, rect.left, rect.top, rect.right, rect.bottom);
+    ::SelectObject(hdc_, hOldBrush);
+    ::SelectObject(hdc_, hOldPen);
+    ::DeleteObject(hPen);
+}
+
+void CGdiCanvas::BlendImage(int x, int y, const CanvasImage& image, const CanvasRect& src)
+{
+    if (image.handle == NULL)
+        return;
+
+    HDC hdcBmpMem = ::CreateCompatibleDC(hdc_);
+    HBITMAP hbmOldBmp = (HBITMAP)::SelectObject(hdcBmpMem, (HBITMAP)image.handle);
+
+    int width = src.right - src.left;
+    int height = src.bottom - src.top;
+    ::GdiAlphaBlend(hdc_, x, y, width, height,
+        hdcBmpMem, src.left, src.top, width, height, kBlend);
+
+    ::SelectObject(hdcBmpMem, hbmOldBmp);
+    ::DeleteDC(hdcBmpMem);
+}
+
+void CGdiCanvas::BlendGlyphRun(int x, int y, const unsigned char* coverage, int stride,
+    int width, int height, unsigned long color)
+{
+    if (coverage == NULL || width <= 0 || height <= 0)
+        return;
+
+    // GDI has no coverage blit, the run is colored into a premultiplied
+    // bitmap and alpha blended.
+    BITMAPINFO bmi;
+    ::ZeroMemory(&bmi, sizeof(BITMAPINFO));
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = width;
+    bmi.bmiHeader.biHeight = -height;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    void* pvBits = NULL;
+    HBITMAP hbmp = ::CreateDIBSection(NULL, &bmi, DIB_RGB_COLORS, &pvBits, NULL, 0);
+    if (hbmp == NULL)
+        return;
+
+    for (int row = 0; row < height; ++row)
+    {
+        PixelOps::ColorizeMask(coverage + row * stride, width,
+            GetRValue(color), GetGValue(color), GetBValue(color),
+            (unsigned char*)pvBits + row * width * 4);
+    }
+
+    CanvasImage image = { (const unsigned char*)pvBits, width * 4, width, height, hbmp };
+    CanvasRect src = { 0, 0, width, height };
+    BlendImage(x, y, image, src);
+
+    ::DeleteObject(hbmp);
+}
+
+bool CGdiCanvas::IsVisible(const CanvasRect& rect) const
+{
+    RECT bounds = ToRect(rect);
+    return ::RectVisible(hdc_, &bounds) != FALSE;
+}
+
+} //namespace MetroWindow
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Canvas.h"
+
+namespace MetroWindow
+{
+
+inline CanvasRect ToCanvasRect(const RECT& rect)
+{
+    CanvasRect result = { rect.left, rect.top, rect.right, rect.bottom };
+    return result;
+}
+
+inline RECT ToRect(const CanvasRect& rect)
+{
+    RECT result = { rect.left, rect.top, rect.right, rect.bottom };
+    return result;
+}
+
+// Draws with GDI into a DC, with the DC's own viewport and clipping.
+class CGdiCanvas : public ICanvas
+{
+public:
+    explicit CGdiCanvas(HDC hdc);
+
+    // Describes a 32-bit DIB section, such as the ones LoadPng makes.
+    // Returns false for any other bitmap.
+    static bool GetImage(HBITMAP hbmp, CanvasImage* image);
+
+    virtual void FillRect(const CanvasRect& rect, unsigned long color);
+    virtual void FrameRect(const CanvasRect& rect, unsigned long color);
+    virtual void BlendImage(int x, int y, const CanvasImage& image, const CanvasRect& src);
+    virtual void BlendGlyphRun(int x, int y, const unsigned char* coverage, int stride,
+        int width, int height, unsigned long color);
+    virtual bool IsVisible(const CanvasRect& rect) const;
+
+private:
+    HDC hdc_;
+};
+
+} //namespace MetroWindow
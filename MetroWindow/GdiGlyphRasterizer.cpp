@@ -0,0 +1,110 @@
+#include "stdafx.h"
+#include "GdiGlyphRasterizer.h"
+
+namespace MetroWindow
+{
+
+namespace
+{
+    const MAT2 kIdentity = { {0, 1}, {0, 0}, {0, 0}, {0, 1} };
+
+    // The face, weight and style tell fonts apart, the size is the
+    // height of the text metric.
+    unsigned long HashFont(HFONT hFont)
+    {
+        LOGFONTW lf;
+        if (::GetObjectW(hFont, sizeof(lf), &lf) != sizeof(lf))
+            return 0;
+
+        unsigned long hash = 2166136261u;
+        for (const WCHAR* p = lf.lfFaceName; *p != L'\0'; ++p)
+            hash = (hash ^ *p) * 16777619u;
+
+        hash = (hash ^ (unsigned long)lf.lfWeight) * 16777619u;
+        hash = (hash ^ (unsigned long)lf.lfItalic) * 16777619u;
+        hash = (hash ^ (unsigned long)lf.lfQuality) * 16777619u;
+        return hash;
+    }
+
+} // namespace
+
+CGdiGlyphRasterizer::CGdiGlyphRasterizer(HFONT hFont)
+    : hdc_(NULL), old_font_(NULL), font_id_(HashFont(hFont))
+{
+    ::ZeroMemory(&text_metric_, sizeof(text_metric_));
+
+    hdc_ = ::CreateCompatibleDC(NULL);
+    if (hdc_ != NULL)
+    {
+        old_font_ = (HFONT)::SelectObject(hdc_, hFont);
+        ::GetTextMetricsW(hdc_, &text_metric_);
+    }
+}
+
+CGdiGlyphRasterizer::~CGdiGlyphRasterizer()
+{
+    if (hdc_ != NULL)
+    {
+        ::SelectObject(hdc_, old_font_);
+        ::DeleteDC(hdc_);
+    }
+}
+
+bool CGdiGlyphRasterizer::Rasterize(unsigned int ch, GlyphBitmap* glyph)
+{
+    if (hdc_ == NULL || ch > 0xFFFF)
+        return false;
+
+    // A character the font has no glyph for is drawn by DrawText from a
+    // linked font, GetGlyphOutline would give the default glyph.
+    WCHAR text = (WCHAR)ch;
+    WORD index = 0;
+    if (::GetGlyphIndicesW(hdc_, &text, 1, &index, GGI_MARK_NONEXISTING_GLYPHS) == GDI_ERROR ||
+        index == 0xFFFF)
+    {
+        return false;
+    }
+
+    GLYPHMETRICS gm;
+    DWORD size = ::GetGlyphOutlineW(hdc_, ch, GGO_GRAY8_BITMAP, &gm, 0, NULL, &kIdentity);
+    if (size == GDI_ERROR)
+        return false;
+
+    glyph->left = gm.gmptGlyphOrigin.x;
+    glyph->top = gm.gmptGlyphOrigin.y;
+    glyph->advance = gm.gmCellIncX;
+
+    // Blank glyphs have no bitmap, their black box is still 1 x 1.
+    if (size == 0)
+    {
+        glyph->coverage = NULL;
+        glyph->stride = 0;
+        glyph->width = 0;
+        glyph->height = 0;
+        return true;
+    }
+
+    buffer_.resize(size);
+    if (::GetGlyphOutlineW(hdc_, ch, GGO_GRAY8_BITMAP, &gm, size, &buffer_[0], &kIdentity) == GDI_ERROR)
+        return false;
+
+    // Rows are DWORD aligned and the levels go from 0 to 64.
+    int width = gm.gmBlackBoxX;
+    int height = gm.gmBlackBoxY;
+    int stride = (width + 3) & ~3;
+
+    for (int row = 0; row < height; ++row)
+    {
+        unsigned char* line = &buffer_[row * stride];
+        for (int x = 0; x < width; ++x)
+            line[x] = (unsigned char)((line[x] * 255 + 32) / 64);
+    }
+
+    glyph->coverage = &buffer_[0];
+    glyph->stride = stride;
+    glyph->width = width;
+    glyph->height = height;
+    return true;
+}
+
+} //namespace MetroWindow
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+
+#include "GlyphAtlas.h"
+
+namespace MetroWindow
+{
+
+// Rasterizes the glyphs of a GDI font with GetGlyphOutline as 8-bit
+// gray. The font stays the caller's and has to outlive the rasterizer.
+class CGdiGlyphRasterizer : public IGlyphRasterizer
+{
+public:
+    explicit CGdiGlyphRasterizer(HFONT hFont);
+    virtual ~CGdiGlyphRasterizer();
+
+    // False if there is no DC to rasterize with.
+    bool IsValid() const { return hdc_ != NULL; }
+
+    virtual unsigned long GetFontId() const { return font_id_; }
+    virtual int GetFontSize() const { return text_metric_.tmHeight; }
+    virtual int GetAscent() const { return text_metric_.tmAscent; }
+    virtual int GetHeight() const { return text_metric_.tmHeight; }
+    virtual bool Rasterize(unsigned int ch, GlyphBitmap* glyph);
+
+private:
+    HDC hdc_;
+    HFONT old_font_;
+    TEXTMETRICW text_metric_;
+    unsigned long font_id_;
+    std::vector<unsigned char> buffer_;
+};
+
+} //namespace MetroWindow
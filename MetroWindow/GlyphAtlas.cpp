@@ -0,0 +1,192 @@
+#include "GlyphAtlas.h"
+
+#include <string.h>
+
+namespace MetroWindow
+{
+
+namespace
+{
+    const size_t kInitialSlots = 256;
+
+    size_t HashGlyph(unsigned long font, int size, unsigned int ch)
+    {
+        unsigned int hash = (unsigned int)font * 2654435761u;
+        hash ^= (unsigned int)size * 40503u;
+        hash ^= ch * 2246822519u;
+        return hash ^ (hash >> 15);
+    }
+
+} // namespace
+
+GlyphAtlas::GlyphAtlas(int width, int height)
+    : width_(width), height_(height), count_(0), generation_(0)
+{
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+bool GlyphAtlas::GetGlyph(IGlyphRasterizer& rasterizer, unsigned int ch, AtlasGlyph* glyph)
+{
+    unsigned long font = rasterizer.GetFontId();
+    int size = rasterizer.GetFontSize();
+
+    Slot* slot = FindSlot(font, size, ch);
+    if (slot != NULL && slot->used)
+    {
+        ++stats_.hits;
+        *glyph = slot->glyph;
+        return true;
+    }
+
+    ++stats_.misses;
+
+    GlyphBitmap bitmap;
+    if (!rasterizer.Rasterize(ch, &bitmap))
+        return false;
+
+    if (bitmap.width > width_ || bitmap.height > height_)
+        return false;
+
+    // The atlas is only made when the first glyph goes in.
+    if (pixels_.empty())
+        pixels_.resize(width_ * height_, 0);
+
+    AtlasGlyph result;
+    memset(&result, 0, sizeof(result));
+
+    // Blank glyphs, such as the space, take no room.
+    if (bitmap.width > 0 && bitmap.height > 0)
+    {
+        int x = 0;
+        int y = 0;
+        if (!Allocate(bitmap.width, bitmap.height, &x, &y))
+        {
+            Reset();
+            ++stats_.resets;
+            if (!Allocate(bitmap.width, bitmap.height, &x, &y))
+                return false;
+        }
+
+        for (int row = 0; row < bitmap.height; ++row)
+        {
+            memcpy(&pixels_[(y + row) * width_ + x],
+                bitmap.coverage + row * bitmap.stride, bitmap.width);
+        }
+
+        result.x = (short)x;
+        result.y = (short)y;
+        result.width = (short)bitmap.width;
+        result.height = (short)bitmap.height;
+    }
+
+    result.left = (short)bitmap.left;
+    result.top = (short)bitmap.top;
+    result.advance = (short)bitmap.advance;
+
+    Insert(font, size, ch, result);
+
+    *glyph = result;
+    return true;
+}
+
+void GlyphAtlas::Clear()
+{
+    Reset();
+
+    std::vector<unsigned char>().swap(pixels_);
+    std::vector<Slot>().swap(slots_);
+}
+
+GlyphAtlas::Slot* GlyphAtlas::FindSlot(unsigned long font, int size, unsigned int ch)
+{
+    if (slots_.empty())
+        return NULL;
+
+    size_t mask = slots_.size() - 1;
+    size_t index = HashGlyph(font, size, ch) & mask;
+
+    // The table is never full, an unused slot ends every probe.
+    for (;;)
+    {
+        Slot& slot = slots_[index];
+        if (!slot.used || (slot.ch == ch && slot.font == font && slot.size == size))
+            return &slot;
+
+        index = (index + 1) & mask;
+    }
+}
+
+void GlyphAtlas::Insert(unsigned long font, int size, unsigned int ch, const AtlasGlyph& glyph)
+{
+    // Kept at most three quarters full.
+    if ((count_ + 1) * 4 > slots_.size() * 3)
+    {
+        std::vector<Slot> old;
+        old.swap(slots_);
+
+        Slot empty;
+        memset(&empty, 0, sizeof(empty));
+        slots_.resize(old.empty() ? kInitialSlots : old.size() * 2, empty);
+
+        for (size_t i = 0; i < old.size(); ++i)
+        {
+            if (old[i].used)
+                *FindSlot(old[i].font, old[i].size, old[i].ch) = old[i];
+        }
+    }
+
+    Slot* slot = FindSlot(font, size, ch);
+    if (!slot->used)
+        ++count_;
+
+    slot->used = true;
+    slot->font = font;
+    slot->size = size;
+    slot->ch = ch;
+    slot->glyph = glyph;
+}
+
+bool GlyphAtlas::Allocate(int width, int height, int* x, int* y)
+{
+    // The least high shelf the glyph fits in wastes the least room.
+    Shelf* best = NULL;
+    for (size_t i = 0; i < shelves_.size(); ++i)
+    {
+        Shelf& shelf = shelves_[i];
+        if (shelf.height >= height && shelf.x + width <= width_ &&
+            (best == NULL || shelf.height < best->height))
+        {
+            best = &shelf;
+        }
+    }
+
+    if (best == NULL)
+    {
+        int top = shelves_.empty() ? 0 : shelves_.back().y + shelves_.back().height;
+        if (top + height > height_)
+            return false;
+
+        Shelf shelf = { top, height, 0 };
+        shelves_.push_back(shelf);
+        best = &shelves_.back();
+    }
+
+    *x = best->x;
+    *y = best->y;
+    best->x += width;
+
+    return true;
+}
+
+void GlyphAtlas::Reset()
+{
+    shelves_.clear();
+
+    for (size_t i = 0; i < slots_.size(); ++i)
+        slots_[i].used = false;
+    count_ = 0;
+
+    ++generation_;
+}
+
+} //namespace MetroWindow
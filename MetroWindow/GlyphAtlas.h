@@ -0,0 +1,123 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+namespace MetroWindow
+{
+
+// The coverage of one glyph as a rasterizer makes it, and where it goes
+// from the pen position on the baseline.
+struct GlyphBitmap
+{
+    const unsigned char* coverage;  // 8 bits per pixel, 255 is covered
+    int stride;
+    int width;
+    int height;
+    int left;       // from the pen position to the first column
+    int top;        // from the baseline up to the first row
+    int advance;    // to the pen position of the next glyph
+};
+
+// Makes glyphs of one font at one size.
+class IGlyphRasterizer
+{
+public:
+    virtual ~IGlyphRasterizer() {}
+
+    // Tell fonts and sizes apart in the atlas. Rasterizers that make
+    // the same glyphs give the same font and size.
+    virtual unsigned long GetFontId() const = 0;
+    virtual int GetFontSize() const = 0;
+
+    // The line the glyphs stand on, from the top of the line, and the
+    // height of the line.
+    virtual int GetAscent() const = 0;
+    virtual int GetHeight() const = 0;
+
+    // False if the font has no glyph for 'ch'. The bitmap is good until
+    // the next call.
+    virtual bool Rasterize(unsigned int ch, GlyphBitmap* glyph) = 0;
+};
+
+struct GlyphAtlasStats
+{
+    unsigned long hits;     // glyphs found in the atlas
+    unsigned long misses;   // glyphs rasterized
+    unsigned long resets;   // times the atlas was full and started over
+};
+
+// A glyph in the atlas. Its coverage is the width x height pixels at
+// (x, y) of the atlas.
+struct AtlasGlyph
+{
+    short x;
+    short y;
+    short width;
+    short height;
+    short left;
+    short top;
+    short advance;
+};
+
+// Keeps the coverage of the glyphs drawn so far in one 8-bit image, so a
+// glyph is rasterized once per font and size. Glyphs are packed in
+// shelves: rows as high as the tallest glyph put in them, filled from
+// the left. When no shelf has room the atlas starts over, which is rare
+// for the few fonts a frame draws with.
+class GlyphAtlas
+{
+public:
+    explicit GlyphAtlas(int width = 256, int height = 256);
+
+    // The glyph for 'ch' in the font of 'rasterizer', rasterized if it is
+    // not in the atlas yet. Returns false if the font has no glyph for
+    // it or the glyph is larger than the atlas.
+    bool GetGlyph(IGlyphRasterizer& rasterizer, unsigned int ch, AtlasGlyph* glyph);
+
+    // The atlas image. Glyphs keep their place until the atlas starts
+    // over, which changes the generation.
+    const unsigned char* GetPixels() const { return pixels_.empty() ? NULL : &pixels_[0]; }
+    int GetStride() const { return width_; }
+    unsigned long GetGeneration() const { return generation_; }
+
+    // Forgets every glyph, for when fonts are deleted.
+    void Clear();
+
+    const GlyphAtlasStats& GetStats() const { return stats_; }
+
+private:
+    struct Shelf
+    {
+        int y;
+        int height;
+        int x;      // where the next glyph goes
+    };
+
+    struct Slot
+    {
+        bool used;
+        unsigned long font;
+        int size;
+        unsigned int ch;
+        AtlasGlyph glyph;
+    };
+
+    Slot* FindSlot(unsigned long font, int size, unsigned int ch);
+    void Insert(unsigned long font, int size, unsigned int ch, const AtlasGlyph& glyph);
+
+    // A place for a width x height glyph, false if there is no room.
+    bool Allocate(int width, int height, int* x, int* y);
+    void Reset();
+
+    int width_;
+    int height_;
+    std::vector<unsigned char> pixels_;
+    std::vector<Shelf> shelves_;
+    std::vector<Slot> slots_;   // open addressing, a power of 2 long
+    size_t count_;
+    unsigned long generation_;
+    GlyphAtlasStats stats_;
+};
+
+} //namespace MetroWindow
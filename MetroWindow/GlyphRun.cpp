@@ -0,0 +1,201 @@
+#include "GlyphRun.h"
+#include "PixelOps.h"
+
+#include <string.h>
+
+namespace MetroWindow
+{
+
+GlyphRun::GlyphRun(void)
+{
+    Clear();
+}
+
+bool GlyphRun::Layout(GlyphAtlas& atlas, IGlyphRasterizer& rasterizer,
+    const wchar_t* text, int length, int maxWidth)
+{
+    Clear();
+
+    if (text == NULL || length <= 0 || !IsSimpleText(text, length))
+        return false;
+
+    // When the atlas starts over the glyphs placed before move, so they
+    // are placed again. The second time they all fit, unless the text
+    // needs more than the whole atlas.
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        unsigned long generation = atlas.GetGeneration();
+        if (!PlaceGlyphs(atlas, rasterizer, text, length, maxWidth))
+            break;
+
+        if (atlas.GetGeneration() == generation)
+        {
+            Compose(atlas, rasterizer.GetAscent());
+            return true;
+        }
+    }
+
+    Clear();
+    return false;
+}
+
+void GlyphRun::Draw(ICanvas& canvas, const CanvasRect& bounds, unsigned long color) const
+{
+    if (coverage_.empty())
+        return;
+
+    int x = bounds.left + (bounds.right - bounds.left - width_) / 2;
+    int y = bounds.top + (bounds.bottom - bounds.top - height_) / 2;
+
+    canvas.BlendGlyphRun(x + ink_left_, y + ink_top_, &coverage_[0], coverage_width_,
+        coverage_width_, coverage_height_, color);
+}
+
+void GlyphRun::Clear()
+{
+    glyphs_.clear();
+    coverage_.clear();
+    coverage_width_ = 0;
+    coverage_height_ = 0;
+    ink_left_ = 0;
+    ink_top_ = 0;
+    width_ = 0;
+    height_ = 0;
+    truncated_ = false;
+}
+
+bool GlyphRun::IsSimpleText(const wchar_t* text, int length)
+{
+    for (int i = 0; i < length; ++i)
+    {
+        unsigned int ch = (unsigned int)text[i];
+
+        if (ch < 0x20 || (ch >= 0x7F && ch < 0xA0))
+            return false;   // control characters
+        if (ch >= 0x0300 && ch < 0x0370)
+            return false;   // combining marks
+        if (ch >= 0x0590 && ch < 0x1E00)
+            return false;   // Hebrew, Arabic, Indic, Thai and the like
+        if (ch >= 0x200B && ch < 0x2010)
+            return false;   // zero width and direction marks
+        if (ch >= 0x2028 && ch < 0x202F)
+            return false;   // separators and embeddings
+        if (ch >= 0xD800 && ch < 0xE000)
+            return false;   // surrogates
+        if (ch >= 0xFB1D && ch < 0xFF00)
+            return false;   // presentation forms and the byte order mark
+        if (ch > 0xFFFF)
+            return false;
+    }
+
+    return true;
+}
+
+bool GlyphRun::PlaceGlyphs(GlyphAtlas& atlas, IGlyphRasterizer& rasterizer,
+    const wchar_t* text, int length, int maxWidth)
+{
+    glyphs_.clear();
+    truncated_ = false;
+    height_ = rasterizer.GetHeight();
+
+    int pen = 0;
+    for (int i = 0; i < length; ++i)
+    {
+        PlacedGlyph placed;
+        if (!atlas.GetGlyph(rasterizer, (unsigned int)text[i], &placed.glyph))
+            return false;
+
+        placed.pen = pen;
+        glyphs_.push_back(placed);
+        pen += placed.glyph.advance;
+    }
+
+    if (pen <= maxWidth)
+    {
+        width_ = pen;
+        return true;
+    }
+
+    // Too wide: as many characters are kept as fit with the ellipsis.
+    PlacedGlyph dot;
+    if (!atlas.GetGlyph(rasterizer, L'.', &dot.glyph))
+        return false;
+
+    int ellipsisWidth = dot.glyph.advance * 3;
+
+    size_t keep = glyphs_.size();
+    pen = glyphs_.back().pen + glyphs_.back().glyph.advance;
+    while (keep > 0 && pen + ellipsisWidth > maxWidth)
+    {
+        --keep;
+        pen = glyphs_[keep].pen;
+    }
+    glyphs_.resize(keep);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        dot.pen = pen;
+        glyphs_.push_back(dot);
+        pen += dot.glyph.advance;
+    }
+
+    width_ = pen;
+    truncated_ = true;
+    return true;
+}
+
+void GlyphRun::Compose(const GlyphAtlas& atlas, int ascent)
+{
+    // The ink can reach past the advances, so the coverage spans it.
+    int left = 0;
+    int top = 0;
+    int right = 0;
+    int bottom = 0;
+    bool empty = true;
+
+    for (size_t i = 0; i < glyphs_.size(); ++i)
+    {
+        const PlacedGlyph& placed = glyphs_[i];
+        if (placed.glyph.width == 0)
+            continue;
+
+        int x = placed.pen + placed.glyph.left;
+        int y = ascent - placed.glyph.top;
+
+        if (empty || x < left) left = x;
+        if (empty || y < top) top = y;
+        if (empty || x + placed.glyph.width > right) right = x + placed.glyph.width;
+        if (empty || y + placed.glyph.height > bottom) bottom = y + placed.glyph.height;
+        empty = false;
+    }
+
+    if (empty)
+        return;
+
+    coverage_width_ = right - left;
+    coverage_height_ = bottom - top;
+    ink_left_ = left;
+    ink_top_ = top;
+    coverage_.assign(coverage_width_ * coverage_height_, 0);
+
+    const unsigned char* pixels = atlas.GetPixels();
+    int stride = atlas.GetStride();
+
+    for (size_t i = 0; i < glyphs_.size(); ++i)
+    {
+        const AtlasGlyph& glyph = glyphs_[i].glyph;
+        if (glyph.width == 0)
+            continue;
+
+        int x = glyphs_[i].pen + glyph.left - left;
+        int y = ascent - glyph.top - top;
+
+        for (int row = 0; row < glyph.height; ++row)
+        {
+            PixelOps::AddCoverage(pixels + (glyph.y + row) * stride + glyph.x, glyph.width,
+                &coverage_[(y + row) * coverage_width_ + x]);
+        }
+    }
+}
+
+} //namespace MetroWindow
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+
+#include "Canvas.h"
+#include "GlyphAtlas.h"
+
+namespace MetroWindow
+{
+
+// A line of text laid out from the glyphs of an atlas, with its coverage
+// put together in one piece so it is drawn with a single blit. Once laid
+// out it no longer needs the atlas, and is drawn again in any color for
+// as long as the text stays the same.
+//
+// Glyphs are put side by side by their advances, the way DrawText does
+// for text that needs no shaping. Text that does need it is not laid
+// out, and neither is text the font has no glyphs for.
+class GlyphRun
+{
+public:
+    GlyphRun(void);
+
+    // Lays out 'length' characters of 'text' no wider than 'maxWidth',
+    // cut and ended with "..." when they do not fit, like DT_END_ELLIPSIS.
+    // Returns false, with the run left empty, if the text has to be drawn
+    // some other way.
+    bool Layout(GlyphAtlas& atlas, IGlyphRasterizer& rasterizer,
+        const wchar_t* text, int length, int maxWidth);
+
+    // Centered in 'bounds', like DT_CENTER | DT_VCENTER.
+    void Draw(ICanvas& canvas, const CanvasRect& bounds, unsigned long color) const;
+
+    // The advance of the laid out text and the height of its line.
+    int GetWidth() const { return width_; }
+    int GetHeight() const { return height_; }
+    bool IsTruncated() const { return truncated_; }
+    bool IsEmpty() const { return coverage_.empty(); }
+
+    void Clear();
+
+    // False for characters that need shaping, joining or another
+    // direction, and for control characters.
+    static bool IsSimpleText(const wchar_t* text, int length);
+
+private:
+    bool PlaceGlyphs(GlyphAtlas& atlas, IGlyphRasterizer& rasterizer,
+        const wchar_t* text, int length, int maxWidth);
+    void Compose(const GlyphAtlas& atlas, int ascent);
+
+    struct PlacedGlyph
+    {
+        AtlasGlyph glyph;
+        int pen;
+    };
+
+    std::vector<PlacedGlyph> glyphs_;
+    std::vector<unsigned char> coverage_;
+    int coverage_width_;
+    int coverage_height_;
+    int ink_left_;      // from the start of the line to the first column
+    int ink_top_;       // from the top of the line to the first row
+    int width_;
+    int height_;
+    bool truncated_;
+};
+
+} //namespace MetroWindow
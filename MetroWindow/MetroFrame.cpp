@@ -1,12 +1,30 @@
 #include "stdafx.h"
 #include "MetroFrame.h"
+
+#include <algorithm>
+
 #include "WindowExtenders.h"
 #include "DwmApi.h"
 #include "CaptionButton.h"
 #include "DropShadowWnd.h"
 #include "UxThemeApi.h"
+#include "GdiCanvas.h"
+#include "RasterCanvas.h"
+#include "GdiGlyphRasterizer.h"
+#include "FrameHitTest.h"
+#include "FrameDamage.h"
+#include "FrameBuffer.h"
+#include "FrameLayout.h"
+#include "TitleCache.h"
+#include "GlyphAtlas.h"
+#include "GlyphRun.h"
+#include "PaintScheduler.h"
 #include <Vssym32.h>
 
+#ifndef WM_DPICHANGED
+#define WM_DPICHANGED 0x02E0
+#endif
+
 namespace
 {
 enum OSVersion {
@@ -64,17 +82,74 @@ OSVersion GetOSVersion()
     return os_version_;
 }
 
+// Posted to the frame to paint the damage of one turn of the message
+// loop. Registered, so it cannot be taken for a message of the window.
+UINT GetFlushPaintMessage()
+{
+    static UINT message = ::RegisterWindowMessageW(L"MetroWindow.FlushPaint");
+    return message;
+}
+
+// The timer for a paint that waits during live resize.
+const UINT_PTR kPaintTimerId = 0x4D46;
+
+// How often the drop shadow follows the size during live resize, and
+// the timer that brings it to the last size when the sizing pauses.
+const DWORD kLiveResizeShadowInterval = 50;
+const UINT_PTR kShadowTimerId = 0x4D47;
+
+MetroWindow::DamageRect ToDamageRect(const RECT& rect)
+{
+    MetroWindow::DamageRect damage = { rect.left, rect.top, rect.right, rect.bottom };
+    return damage;
+}
+
+MetroWindow::DamageRect ToDamageRect(const MetroWindow::CanvasRect& rect)
+{
+    MetroWindow::DamageRect damage = { rect.left, rect.top, rect.right, rect.bottom };
+    return damage;
+}
+
 } // namespace
 
 namespace MetroWindow
 {
 
+// What the frame keeps between paints. It lives here so that clients of
+// MetroFrame.h need none of these headers.
+struct CMetroFrame::FrameState
+{
+    FrameState() : title_run_width(0), frame_layout_valid(false) {}
+
+    CTitleCache title_cache;
+
+    // The glyphs of the caption font and the title laid out from them,
+    // kept until the title or its width change.
+    GlyphAtlas glyph_atlas;
+    GlyphRun title_run;
+    std::wstring title_run_text;
+    int title_run_width;
+
+    // What has changed on the frame since it was last painted.
+    FrameDamage damage;
+    CFrameBuffer back_buffer;
+
+    // When the damage is painted, once per turn of the message loop.
+    PaintScheduler paint_scheduler;
+
+    // Where the parts of the frame are. It is made again on first use
+    // after the size, the styles or the system metrics have changed.
+    FrameLayout frame_layout;
+    bool frame_layout_valid;
+};
+
 CMetroFrame::CMetroFrame(HINSTANCE hInstance)
     : hInst_(hInstance)
     , hWnd_(NULL)
     , hIcon_(NULL)
     , hIcon_small_(NULL)
     , caption_font_(NULL)
+    , composited_theme_(NULL)
     , background_color_(RGB(255,255,255))
 {
     title_[0] = L'\0';
@@ -83,14 +158,20 @@ CMetroFrame::CMetroFrame(HINSTANCE hInstance)
     min_size_.cy = 0;
 
     show_drop_shadow_on_xp_ = false;
+    single_shadow_window_ = false;
     is_dwm_enabled_ = false;
     is_uxtheme_supported_ = false;
     trace_nc_mouse_ = false;
     is_non_client_area_active_ = false;
     is_sizing_ = false;
+    in_size_move_ = false;
+    shadow_update_pending_ = false;
+    last_shadow_update_ = 0;
     prepare_fullscreen_ = false;
     is_fullscreen_ = false;
-    caption_height_ = 0;
+    window_origin_.x = 0;
+    window_origin_.y = 0;
+    window_origin_valid_ = false;
     use_custom_title_ = false;
     client_area_movable_ = false;
     use_thick_frame_ = false;
@@ -99,7 +180,10 @@ CMetroFrame::CMetroFrame(HINSTANCE hInstance)
 
     drop_shadow_ = NULL;
 
+    memset(&paint_stats_, 0, sizeof(paint_stats_));
+
     caption_button_manager_ = new CCaptionButtonManager();
+    state_ = new FrameState();
 
     pressed_button_ = NULL;
     hovered_button_ = NULL;
@@ -109,6 +193,7 @@ CMetroFrame::CMetroFrame(HINSTANCE hInstance)
 CMetroFrame::~CMetroFrame(void)
 {
     delete caption_button_manager_;
+    delete state_;
 
     if (hIcon_small_ != NULL)
     {
@@ -123,6 +208,7 @@ CMetroFrame::~CMetroFrame(void)
     }
 
     if (caption_font_) ::DeleteObject(caption_font_);
+    if (composited_theme_) UxThemeApi::CloseThemeData(composited_theme_);
 
     if (drop_shadow_ != NULL)
     {
@@ -194,7 +280,8 @@ void CMetroFrame::EnableCloseButton(bool enable)
         {
             caption_button_manager_->EnableButton(HTCLOSE, enable);
 
-            PaintNonClientArea(NULL);
+            AddButtonDamage(caption_button_manager_->CommandButtonByHitTest(HTCLOSE));
+            SchedulePaint();
         }
     }
 }
@@ -277,6 +364,21 @@ void CMetroFrame::CenterWindow(HWND hWndCenter/* = NULL*/)
         SWP_NOSIZE | SWP_NOZORDER | SWP_NOACTIVATE);
 }
 
+const TitleCacheStats& CMetroFrame::GetTitleCacheStats() const
+{
+    return state_->title_cache.GetStats();
+}
+
+const GlyphAtlasStats& CMetroFrame::GetGlyphAtlasStats() const
+{
+    return state_->glyph_atlas.GetStats();
+}
+
+const PaintSchedulerStats& CMetroFrame::GetPaintSchedulerStats() const
+{
+    return state_->paint_scheduler.GetStats();
+}
+
 LRESULT CMetroFrame::OnDefWndProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
     return ::DefWindowProc(hWnd_, uMsg, wParam, lParam);
@@ -292,6 +394,12 @@ LRESULT CMetroFrame::OnWndProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
         bHandled = DwmApi::DwmDefWindowProc(hWnd_, uMsg, wParam, lParam, &lRes);
     }
 
+    if (uMsg == GetFlushPaintMessage() && uMsg != 0)
+    {
+        FlushPaint(false);
+        return 0;
+    }
+
     switch (uMsg)
     {
     case WM_STYLECHANGED:   this->RemoveWindowBorderStyle(); break;
@@ -316,6 +424,13 @@ LRESULT CMetroFrame::OnWndProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
     case WM_COMMAND:        lRes = OnCommand(uMsg, wParam, lParam, bHandled); break;
     case WM_SYSCOMMAND:		lRes = OnSysCommand(uMsg, wParam, lParam, bHandled); break;
     case WM_DWMCOMPOSITIONCHANGED: lRes = OnDwmCompositionChanged(uMsg, wParam, lParam, bHandled); break;
+    case WM_SETTINGCHANGE:
+    case WM_DISPLAYCHANGE:
+    case WM_DPICHANGED:     lRes = OnSettingChange(uMsg, wParam, lParam, bHandled); break;
+    case WM_THEMECHANGED:   lRes = OnThemeChanged(uMsg, wParam, lParam, bHandled); break;
+    case WM_ENTERSIZEMOVE:  lRes = OnEnterSizeMove(uMsg, wParam, lParam, bHandled); break;
+    case WM_EXITSIZEMOVE:   lRes = OnExitSizeMove(uMsg, wParam, lParam, bHandled); break;
+    case WM_TIMER:          lRes = OnTimer(uMsg, wParam, lParam, bHandled); break;
     default:				break;
     }
     if (bHandled) return lRes;
@@ -340,7 +455,17 @@ LRESULT CMetroFrame::OnSetText(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bH
         ModifyWindowStyle(0, WS_VISIBLE);
     }
 
-    PaintNonClientArea(NULL);
+    state_->damage.Add(ToDamageRect(GetFrameLayout().GetTitle()));
+
+    // The icon decides where the title starts.
+    if (uMsg == WM_SETICON)
+    {
+        InvalidateFrameLayout();
+        state_->damage.Add(ToDamageRect(GetFrameLayout().GetIcon()));
+        state_->damage.Add(ToDamageRect(GetFrameLayout().GetTitle()));
+    }
+
+    SchedulePaint();
 
     bHandled = TRUE;
     return lRes;
@@ -373,8 +498,9 @@ LRESULT CMetroFrame::OnCreate(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHa
         }
     }
 
+    caption_button_manager_->CreateCaptionButtons(hWnd_, caption_theme_);
     RemoveWindowBorderStyle();
-    caption_button_manager_->UpdateCaptionButtons(hWnd_, caption_theme_, is_dwm_enabled_);
+    caption_button_manager_->UpdateCaptionButtons(hWnd_, caption_theme_, GetFrameLayout());
     caption_button_manager_->EnableButton(HTCLOSE, close_button_enabled_);
 
     ::DisableProcessWindowsGhosting();
@@ -383,7 +509,7 @@ LRESULT CMetroFrame::OnCreate(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHa
     {
         if (drop_shadow_ == NULL)
         {
-            drop_shadow_ = new CDropShadow();
+            drop_shadow_ = new CDropShadow(single_shadow_window_);
         }
 
         drop_shadow_->Create(hInst_, hWnd_);
@@ -400,6 +526,9 @@ LRESULT CMetroFrame::OnClose(UINT /*uMsg*/, WPARAM /*wParam*/, LPARAM /*lParam*/
 
 LRESULT CMetroFrame::OnDestroy(UINT /*uMsg*/, WPARAM /*wParam*/, LPARAM /*lParam*/, BOOL& bHandled)
 {
+    ::KillTimer(hWnd_, kPaintTimerId);
+    ::KillTimer(hWnd_, kShadowTimerId);
+
     if (drop_shadow_ != NULL)
     {
         drop_shadow_->Destroy();
@@ -424,7 +553,8 @@ LRESULT CMetroFrame::OnNcActivate(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL&
             ::SetForegroundWindow(hWnd_);
         }
         is_non_client_area_active_ = ncactive;
-        PaintNonClientArea(NULL);
+        AddActivationDamage();
+        SchedulePaint();
 
         if (drop_shadow_ != NULL)
         {
@@ -438,7 +568,8 @@ LRESULT CMetroFrame::OnNcActivate(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL&
 
 LRESULT CMetroFrame::OnNcCalcSize(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled)
 {
-    CSize borderSize = WindowExtenders::GetBorderSize(hWnd_, is_dwm_enabled_);
+    const FrameMetrics& metrics = GetFrameLayout().GetMetrics();
+    CSize borderSize(metrics.border_cx, metrics.border_cy);
 
     if ( wParam == TRUE)
     {
@@ -446,7 +577,7 @@ LRESULT CMetroFrame::OnNcCalcSize(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL&
 
         ::CopyRect(&pncsp->rgrc[1], &pncsp->rgrc[0]);
 
-        pncsp->rgrc[0].top = pncsp->rgrc[0].top + GetCaptionHeight() + borderSize.cy;
+        pncsp->rgrc[0].top = pncsp->rgrc[0].top + metrics.caption_height + borderSize.cy;
         pncsp->rgrc[0].bottom = pncsp->rgrc[0].bottom - borderSize.cy;
         pncsp->rgrc[0].left = pncsp->rgrc[0].left + borderSize.cx;
         pncsp->rgrc[0].right = pncsp->rgrc[0].right - borderSize.cx;
@@ -455,7 +586,7 @@ LRESULT CMetroFrame::OnNcCalcSize(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL&
     {
         LPRECT pRect = (LPRECT)lParam;
 
-        pRect->top += GetCaptionHeight() + borderSize.cy;
+        pRect->top += metrics.caption_height + borderSize.cy;
         pRect->bottom -= borderSize.cy;
         pRect->left += borderSize.cx;
         pRect->right -= borderSize.cx;
@@ -478,109 +609,61 @@ LRESULT CMetroFrame::OnNcPaint(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bH
 
 LRESULT CMetroFrame::OnNcHitTest(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled)
 {
-    POINT point;
-    point.x = GET_X_LPARAM(lParam);
-    point.y = GET_Y_LPARAM(lParam);
-
-    CRect rectScreen;
-    ::GetWindowRect(hWnd_, &rectScreen);
-
-    // custom processing
-    if (rectScreen.PtInRect(point))
-    {
-        CRect rect = rectScreen;
-
-        if (!is_fullscreen_)
-        {
-            // let form handle hittest itself if we are on 1px borders
-            rect.InflateRect(-1, -1);
-            if (!rect.PtInRect(point))
-            {
-                if (!is_dwm_enabled_ || is_sizable_)
-                {
-                    bHandled = FALSE;
-                    return 0;
-                }
-                else
-                {
-                    bHandled = TRUE;
-                    return HTCLIENT;
-                }
-            }
-        }
-
-        // on Button?
-        CPoint pt(point.x - rectScreen.left, point.y - rectScreen.top);
-        CCaptionButton * sysButton = caption_button_manager_->CommandButtonFromPoint(pt);
-        if (sysButton != NULL)
-        {
-            bHandled = TRUE;
-            return sysButton->HitTest();
-        }
-
-        CSize borderSize = WindowExtenders::GetBorderSize(hWnd_, is_dwm_enabled_);
-        if (!is_fullscreen_)
-        {
-            // on border?
-            rect.InflateRect(-borderSize.cx + 1, -borderSize.cy + 1);
+    // This runs for every mouse move over the window, so it only looks
+    // at the cached layout and where the window was last moved to.
+    const FrameLayout& layout = GetFrameLayout();
+    POINT origin = GetWindowOrigin();
+    int x = GET_X_LPARAM(lParam) - origin.x;
+    int y = GET_Y_LPARAM(lParam) - origin.y;
 
-            // let form handle hittest itself if we are on borders
-            if (!rect.PtInRect(point))
-            {
-                if (!is_dwm_enabled_ || WindowExtenders::IsWindowSizable(hWnd_))
-                {
-                    bHandled = FALSE;
-                    return 0;
-                }
-                else
-                {
-                    bHandled = TRUE;
-                    return HTCLIENT;
-                }
-            }
-        }
+    int buttonIndex = 0;
+    FrameHit hit = FrameHitTest::Classify(layout, is_fullscreen_, x, y, &buttonIndex);
 
-        CRect rectCaption = rect;
-        rectCaption.bottom = rectCaption.top + GetCaptionHeight();
-
-        // not in caption -> client
-        if (!rectCaption.PtInRect(point))
-        {
-            bHandled = TRUE;
-            return HTCLIENT;
-        }
+    bHandled = TRUE;
 
-        // on icon?
-        if (WindowExtenders::HasSysMenu(hWnd_)/* && ShowIcon && Icon != null && ShowIconOnCaption*/)
+    switch (hit)
+    {
+    case FrameHitDefault:
+        // let form handle hittest itself if we are on borders
+        bHandled = FALSE;
+        return 0;
+    case FrameHitClient:
+        return HTCLIENT;
+    case FrameHitSysMenu:
+        return HTSYSMENU;
+    case FrameHitButton:
         {
-            CRect rectSysMenu = GetFrameIconBounds(rectScreen, borderSize);
-            if (rectSysMenu.PtInRect(point))
+            CCaptionButton * sysButton = caption_button_manager_->CommandButtonByIndex(buttonIndex);
+            if (sysButton != NULL)
             {
-                bHandled = TRUE;
-                return HTSYSMENU;
+                return sysButton->HitTest();
             }
         }
-
-        // on Caption?
-        bHandled = TRUE;
         return HTCAPTION;
+    case FrameHitCaption:
+        return HTCAPTION;
+    default:
+        return HTNOWHERE;
     }
-
-    bHandled = TRUE;
-    return HTNOWHERE;
 }
 
 LRESULT CMetroFrame::OnNcLButtonDown(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled)
 {
     CCaptionButton * button = caption_button_manager_->CommandButtonByHitTest(wParam);
     if (pressed_button_ != button && pressed_button_ != NULL)
+    {
         pressed_button_->Pressed(false);
+        AddButtonDamage(pressed_button_);
+    }
     if (button != NULL)
+    {
         button->Pressed(true);
+        AddButtonDamage(button);
+    }
     pressed_button_ = button;
     if (pressed_button_ != NULL)
     {
-        PaintNonClientArea(NULL);
+        SchedulePaint();
     }
 
     if (pressed_button_ != NULL || is_fullscreen_)
@@ -612,6 +695,7 @@ LRESULT CMetroFrame::OnNcMouseMove(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL
             if (pressed_button_->Pressed())
             {
                 pressed_button_->Pressed(false);
+                AddButtonDamage(pressed_button_);
                 buttonStateChanged = true;
             }
             pressed_button_ = NULL;
@@ -624,6 +708,7 @@ LRESULT CMetroFrame::OnNcMouseMove(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL
         if (hovered_button_->Hovered())
         {
             hovered_button_->Hovered(false);
+            AddButtonDamage(hovered_button_);
             buttonStateChanged = true;
         }
     }
@@ -635,6 +720,7 @@ LRESULT CMetroFrame::OnNcMouseMove(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL
             if (!button->Hovered())
             {
                 button->Hovered(true);
+                AddButtonDamage(button);
                 buttonStateChanged = true;
             }
         }
@@ -646,13 +732,14 @@ LRESULT CMetroFrame::OnNcMouseMove(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL
         if (pressed != pressed_button_->Pressed())
         {
             pressed_button_->Pressed(pressed);
+            AddButtonDamage(pressed_button_);
             buttonStateChanged = true;
         }
     }
 
     if (buttonStateChanged)
     {
-        PaintNonClientArea(NULL);
+        SchedulePaint();
     }
 
     return 0;
@@ -697,9 +784,10 @@ LRESULT CMetroFrame::OnNcLButtonUp(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL
 
         pressed_button_->Pressed(false);
         pressed_button_->Hovered(false);
+        AddButtonDamage(pressed_button_);
         pressed_button_ = NULL;
 
-        PaintNonClientArea(NULL);
+        SchedulePaint();
     }
 
     return 0;
@@ -711,7 +799,7 @@ LRESULT CMetroFrame::OnNcRButtonUp(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL
     if (button != NULL && (button->HitTest() == HTCLOSE || button->HitTest() == HTMAXBUTTON))
         return 0;
 
-    if (WindowExtenders::HasSysMenu(hWnd_))
+    if (GetFrameLayout().GetMetrics().has_sys_menu)
     {
         POINT point;
         point.x = GET_X_LPARAM(lParam);
@@ -719,7 +807,7 @@ LRESULT CMetroFrame::OnNcRButtonUp(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL
         CRect rectScreen;
         ::GetWindowRect(hWnd_, &rectScreen);
         CRect rectCaption = rectScreen;
-        rectCaption.Height(GetCaptionHeight());
+        rectCaption.Height(GetFrameLayout().GetMetrics().caption_height);
 
         // right click in caption
         if (rectCaption.PtInRect(point))
@@ -727,8 +815,9 @@ LRESULT CMetroFrame::OnNcRButtonUp(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL
             if (button != NULL)
             {
                 button->Hovered(false);
+                AddButtonDamage(button);
 
-                PaintNonClientArea(NULL);
+                SchedulePaint();
             }
 
             ShowSystemMenu(point);
@@ -762,6 +851,7 @@ LRESULT CMetroFrame::OnNcMouseLeave(UINT uMsg, WPARAM wParam, LPARAM lParam, BOO
     if (pressed_button_ != NULL)
     {
         pressed_button_->Pressed(false);
+        AddButtonDamage(pressed_button_);
         pressed_button_ = NULL;
 
         buttonStateChanged = true;
@@ -769,6 +859,7 @@ LRESULT CMetroFrame::OnNcMouseLeave(UINT uMsg, WPARAM wParam, LPARAM lParam, BOO
     if (hovered_button_ != NULL)
     {
         hovered_button_->Hovered(false);
+        AddButtonDamage(hovered_button_);
         hovered_button_ = NULL;
 
         buttonStateChanged = true;
@@ -776,7 +867,7 @@ LRESULT CMetroFrame::OnNcMouseLeave(UINT uMsg, WPARAM wParam, LPARAM lParam, BOO
 
     if (buttonStateChanged)
     {
-        PaintNonClientArea(NULL);
+        SchedulePaint();
     }
 
     return 0;
@@ -825,21 +916,64 @@ LRESULT CMetroFrame::OnSize(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHand
 
     prepare_fullscreen_ = false;
     is_sizing_ = false;
-    caption_button_manager_->UpdateCaptionButtons(hWnd_, caption_theme_, is_dwm_enabled_);
-    PaintNonClientArea(NULL);
+    InvalidateFrameLayout();
+    caption_button_manager_->UpdateCaptionButtons(hWnd_, caption_theme_, GetFrameLayout());
+
+    // The frame is not seen until it is restored, so the back buffer
+    // and the titles are given back rather than kept for a size that
+    // may never return. They are only let go once the frame has been
+    // painted, which is right away.
+    if (wParam == SIZE_MINIMIZED)
+    {
+        PaintNonClientArea(NULL);
+        state_->back_buffer.Release();
+        state_->title_cache.Clear();
+    }
+    else
+    {
+        InvalidateNonClientArea();
+    }
 
     return 0;
 }
 
 LRESULT CMetroFrame::OnWindowPosChanged(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled)
 {
+    WINDOWPOS *pwp = (WINDOWPOS *)lParam;
+    if (!(pwp->flags & SWP_NOSIZE) || (pwp->flags & SWP_FRAMECHANGED))
+    {
+        InvalidateFrameLayout();
+    }
+    if (!(pwp->flags & SWP_NOMOVE))
+    {
+        // pwp->x and pwp->y are in the parent's client area for a child
+        // frame, the origin is read again in screen coordinates.
+        window_origin_valid_ = false;
+    }
+
     if (drop_shadow_ != NULL)
     {
-        WINDOWPOS *pwp = (WINDOWPOS *)lParam;
-        if (pwp->flags & SWP_SHOWWINDOW || pwp->flags & SWP_HIDEWINDOW ||
-            !(pwp->flags & SWP_NOMOVE) || !(pwp->flags & SWP_NOSIZE))
+        bool shown = (pwp->flags & SWP_SHOWWINDOW) || (pwp->flags & SWP_HIDEWINDOW);
+        bool sized = !(pwp->flags & SWP_NOSIZE);
+
+        // A shadow of a new size is drawn again, during live resize only
+        // a few times a second. The timer catches it up with the last
+        // size when no other one comes in time.
+        DWORD now = ::GetTickCount();
+        DWORD elapsed = now - last_shadow_update_;
+        if (in_size_move_ && sized && !shown && elapsed < kLiveResizeShadowInterval)
+        {
+            if (!shadow_update_pending_)
+            {
+                shadow_update_pending_ =
+                    ::SetTimer(hWnd_, kShadowTimerId, kLiveResizeShadowInterval - elapsed, NULL) != 0;
+                if (!shadow_update_pending_)
+                    UpdateDropShadow();
+            }
+        }
+        else if (shown || sized || !(pwp->flags & SWP_NOMOVE))
         {
-            drop_shadow_->ShowShadow(hWnd_, is_non_client_area_active_);
+            UpdateDropShadow();
         }
     }
 
@@ -873,11 +1007,131 @@ LRESULT CMetroFrame::OnCommand(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bH
 LRESULT CMetroFrame::OnDwmCompositionChanged(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled)
 {
     is_dwm_enabled_ = DwmApi::IsDwmEnabled();
-    PaintNonClientArea(NULL);
+    InvalidateFrameLayout();
+    caption_button_manager_->UpdateCaptionButtons(hWnd_, caption_theme_, GetFrameLayout());
+    InvalidateNonClientArea();
+
+    return 0;
+}
+
+LRESULT CMetroFrame::OnSettingChange(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled)
+{
+    SystemMetricsCache::Refresh();
+
+    // Most setting changes leave the frame as it is.
+    FrameMetrics metrics = GetFrameMetrics();
+    if (state_->frame_layout_valid && state_->frame_layout.Matches(metrics))
+    {
+        bHandled = FALSE;
+        return 0;
+    }
+
+    state_->frame_layout = FrameLayout(metrics);
+    state_->frame_layout_valid = true;
+
+    // The client area follows the new border and caption sizes.
+    ::SetWindowPos(hWnd_, NULL, 0, 0, 0, 0,
+        SWP_FRAMECHANGED | SWP_NOACTIVATE | SWP_NOMOVE |
+        SWP_NOOWNERZORDER | SWP_NOSIZE | SWP_NOZORDER);
+
+    caption_button_manager_->UpdateCaptionButtons(hWnd_, caption_theme_, GetFrameLayout());
+    InvalidateNonClientArea();
+
+    bHandled = FALSE;
+    return 0;
+}
+
+LRESULT CMetroFrame::OnThemeChanged(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled)
+{
+    // The titles were drawn with the old theme and its caption font.
+    state_->title_cache.Clear();
+    state_->glyph_atlas.Clear();
+    state_->title_run.Clear();
+    state_->title_run_text.clear();
+
+    if (composited_theme_ != NULL)
+    {
+        UxThemeApi::CloseThemeData(composited_theme_);
+        composited_theme_ = NULL;
+    }
+
+    if (caption_font_ != NULL)
+    {
+        ::DeleteObject(caption_font_);
+        caption_font_ = NULL;
+    }
+
+    InvalidateNonClientArea();
+
+    bHandled = FALSE;
+    return 0;
+}
+
+LRESULT CMetroFrame::OnEnterSizeMove(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled)
+{
+    // Sizing sends WM_SIZE faster than the screen shows frames, paints
+    // in between would never be seen.
+    state_->paint_scheduler.SetMinInterval(WindowExtenders::GetFrameInterval());
+
+    // Until the user lets go the frame is painted for speed: the title
+    // is reused at the width it has, and the shadow follows less often.
+    in_size_move_ = true;
+    last_shadow_update_ = ::GetTickCount();
+
+    bHandled = FALSE;
+    return 0;
+}
+
+LRESULT CMetroFrame::OnExitSizeMove(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled)
+{
+    state_->paint_scheduler.SetMinInterval(0);
+    in_size_move_ = false;
+
+    // The shadow catches up and the frame is painted in full again, in
+    // place of any paint waiting for the timer.
+    if (shadow_update_pending_)
+    {
+        UpdateDropShadow();
+    }
+
+    ::KillTimer(hWnd_, kPaintTimerId);
+    InvalidateNonClientArea();
+
+    bHandled = FALSE;
+    return 0;
+}
+
+LRESULT CMetroFrame::OnTimer(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled)
+{
+    if (wParam == kPaintTimerId)
+    {
+        ::KillTimer(hWnd_, kPaintTimerId);
+        FlushPaint(true);
+
+        bHandled = TRUE;
+    }
+    else if (wParam == kShadowTimerId)
+    {
+        UpdateDropShadow();
+
+        bHandled = TRUE;
+    }
 
     return 0;
 }
 
+void CMetroFrame::UpdateDropShadow()
+{
+    ::KillTimer(hWnd_, kShadowTimerId);
+    shadow_update_pending_ = false;
+    last_shadow_update_ = ::GetTickCount();
+
+    if (drop_shadow_ != NULL)
+    {
+        drop_shadow_->ShowShadow(hWnd_, is_non_client_area_active_);
+    }
+}
+
 void CMetroFrame::RemoveWindowBorderStyle()
 {
     // remove the border style
@@ -897,7 +1151,7 @@ void CMetroFrame::RemoveWindowBorderStyle()
             SWP_NOSENDCHANGING | SWP_NOSIZE | SWP_NOZORDER);
     }
 
-    is_sizable_ = WindowExtenders::IsWindowSizable(hWnd_);
+    InvalidateFrameLayout();
 }
 
 BOOL CMetroFrame::ModifyWindowStyle(LONG removeStyle, LONG addStyle)
@@ -913,52 +1167,73 @@ BOOL CMetroFrame::ModifyWindowStyle(LONG removeStyle, LONG addStyle)
     return TRUE;
 }
 
-//TODO: Add HRGN paramter to improve draw speed.
 BOOL CMetroFrame::PaintNonClientArea(HRGN hrgnUpdate)
 {
-    BOOL result = FALSE;
-
-    // prepare paint bounds
-    CSize borderSize = WindowExtenders::GetBorderSize(hWnd_, is_dwm_enabled_);
-    int captionHeight = this->GetCaptionHeight();
-
     CRect rectWindow;
     ::GetWindowRect(hWnd_, &rectWindow);
 
-    //CRect dirty_region;
-    //// A value of 1 indicates paint all.
-    //if (!hrgnUpdate || hrgnUpdate == reinterpret_cast<HRGN>(1))
-    //{
-    //    dirty_region = CRect(0, 0, rectWindow.Width(), rectWindow.Height());
-    //}
-    //else
-    //{
-    //    RECT rgn_bounding_box;
-    //    ::GetRgnBox(hrgnUpdate, &rgn_bounding_box);
-    //    if (!::IntersectRect(&dirty_region, &rgn_bounding_box, &rectWindow))
-    //        return TRUE;  // Dirty region doesn't intersect window bounds, bale.
+    // A value of 1 indicates paint all.
+    if (!hrgnUpdate || hrgnUpdate == reinterpret_cast<HRGN>(1))
+    {
+        state_->damage.Add(0, 0, rectWindow.Width(), rectWindow.Height());
+    }
+    else
+    {
+        CRect dirtyRegion;
+        RECT rgnBoundingBox;
+        ::GetRgnBox(hrgnUpdate, &rgnBoundingBox);
+        if (::IntersectRect(&dirtyRegion, &rgnBoundingBox, &rectWindow))
+        {
+            // rgnBoundingBox is in screen coordinates. Map it to window coordinates.
+            dirtyRegion.OffsetRect(-rectWindow.left, -rectWindow.top);
+            state_->damage.Add(ToDamageRect(dirtyRegion));
+        }
+    }
 
-    //    // rgn_bounding_box is in screen coordinates. Map it to window coordinates.
-    //    dirty_region.OffsetRect(-rectWindow.left, -rectWindow.top);
-    //}
+    return PaintFrameDamage();
+}
+
+BOOL CMetroFrame::PaintFrameDamage()
+{
+    BOOL result = FALSE;
+    LONGLONG start = WindowExtenders::GetTicks();
+
+    // prepare paint bounds
+    const FrameLayout& layout = GetFrameLayout();
+    CRect rectWindow = ToRect(layout.GetWindow());
+
+    state_->damage.Clip(ToDamageRect(rectWindow));
+    if (state_->damage.IsEmpty())
+    {
+        state_->paint_scheduler.Painted(::GetTickCount());
+        return TRUE;  // Dirty region doesn't intersect window bounds, bale.
+    }
 
-    // Map it to window coordinates.
-    rectWindow.OffsetRect(-rectWindow.left, -rectWindow.top);
+    DamageRect damageBounds = state_->damage.GetBounds();
+    CRect rectDirty(damageBounds.left, damageBounds.top, damageBounds.right, damageBounds.bottom);
 
     // create graphics handle
     HDC hdc = ::GetDCEx(hWnd_, NULL, DCX_CACHE | DCX_CLIPSIBLINGS | DCX_WINDOW);
     //HDC hdc = ::GetWindowDC(hWnd_);
     if (hdc == NULL) return result;
 
-    HRGN hrgn = NULL;
+    // Apply clipping with the damage, so that only what changed reaches
+    // the screen. The DC keeps a copy of the region.
+    HRGN hrgn = state_->back_buffer.GetDamageRgn(state_->damage, 0, 0);
+    if (hrgn == NULL)
+    {
+        ::ReleaseDC(hWnd_, hdc);
+        return result;
+    }
+    ::SelectClipRgn(hdc, hrgn);
 
     if (!::IsIconic(hWnd_))
     {
         // prepare clipping
         CRect rectClip = rectWindow;
 
-        int cx = borderSize.cx;
-        int cy = borderSize.cy;
+        int cx = layout.GetMetrics().border_cx;
+        int cy = layout.GetMetrics().border_cy;
 
         if (!is_dwm_enabled_)
         {
@@ -972,28 +1247,20 @@ BOOL CMetroFrame::PaintNonClientArea(HRGN hrgnUpdate)
         }
 
         rectClip.InflateRect(-cx, -cy);
-        rectClip.top += captionHeight;
-
-        RECT rectBounds = rectWindow;
+        rectClip.top += layout.GetMetrics().caption_height;
 
-        //TODO: Apply clipping with the udpate region
-        //If no need to update just return
-
-        // Apply clipping
-        hrgn = ::CreateRectRgnIndirect(&rectBounds);
-        //HRGN hrgnClip = CreateRectRgnIndirect(&rectClip);
-        //::CombineRgn(hrgn, hrgn, hrgnClip, RGN_XOR);
-        ::SelectClipRgn(hdc, hrgn);
         ::ExcludeClipRect(hdc, rectClip.left, rectClip.top, rectClip.right, rectClip.bottom);
     }
     
     if (is_dwm_enabled_ && is_uxtheme_supported_)
     {
+        // The paint DC takes the clipping of the target DC.
         CBufferedPaint bufferedPaint;
         HDC hdcPaint = NULL;
-        if (bufferedPaint.BeginPaint(hdc, &rectWindow, &hdcPaint))
+        if (bufferedPaint.BeginPaint(hdc, &rectDirty, &hdcPaint))
         {
-            DrawWindowFrame(hdcPaint, rectWindow, borderSize, captionHeight);
+            CGdiCanvas canvas(hdcPaint);
+            DrawWindowFrame(canvas, hdcPaint, layout);
             bufferedPaint.EndPaint();
 
             result = TRUE;
@@ -1001,55 +1268,141 @@ BOOL CMetroFrame::PaintNonClientArea(HRGN hrgnUpdate)
     }
     else
     {
-        HDC hdcPaint = ::CreateCompatibleDC(hdc);
+        // The buffer is kept between paints and grows with the damage.
+        HDC hdcPaint = state_->back_buffer.Prepare(rectDirty.Width(), rectDirty.Height());
         if (hdcPaint)
         {
-            // TODO: Using bounds size to cache the buffer
-            HBITMAP hbmPaint = ::CreateCompatibleBitmap(hdc, rectWindow.Width(), rectWindow.Height());
-            if (hbmPaint)
-            {
-                HBITMAP hbmOld = (HBITMAP)::SelectObject(hdcPaint, hbmPaint);
-                ::SetViewportOrgEx(hdcPaint, -rectWindow.left, -rectWindow.top, NULL);
+            ::SetViewportOrgEx(hdcPaint, -rectDirty.left, -rectDirty.top, NULL);
 
-                // paint
-                DrawWindowFrame(hdcPaint, rectWindow, borderSize, captionHeight);
+            // The clip region is in device coordinates of the buffer.
+            ::SelectClipRgn(hdcPaint, state_->back_buffer.GetDamageRgn(state_->damage, -rectDirty.left, -rectDirty.top));
 
-                ::BitBlt(hdc, rectWindow.left, rectWindow.top, rectWindow.Width(), rectWindow.Height(),
-                    hdcPaint, 0, 0, SRCCOPY);
+            // The frame is rasterized straight into the buffer, GDI only
+            // draws the icon over it, and titles the glyph atlas cannot.
+            // What GDI still has queued for the buffer has to land first.
+            ::GdiFlush();
+            RasterCanvas canvas(state_->back_buffer.GetBits(), state_->back_buffer.GetStride(),
+                state_->back_buffer.GetCapacityWidth(), state_->back_buffer.GetCapacityHeight());
+            canvas.SetViewportOrg(-rectDirty.left, -rectDirty.top);
+            canvas.SetClip(ToCanvasRect(rectDirty));
 
-                ::SelectObject(hdcPaint, hbmOld);
-                ::DeleteObject(hbmPaint);
+            // paint
+            DrawWindowFrame(canvas, hdcPaint, layout);
 
-                result = TRUE;
-            }
+            ::BitBlt(hdc, rectDirty.left, rectDirty.top, rectDirty.Width(), rectDirty.Height(),
+                hdcPaint, 0, 0, SRCCOPY);
+
+            ::SelectClipRgn(hdcPaint, NULL);
+            ::SetViewportOrgEx(hdcPaint, 0, 0, NULL);
 
-            ::DeleteDC(hdcPaint);
+            result = TRUE;
         }
     }
 
     // cleanup data
-    if (hrgn != NULL)
-    {
-        ::SelectClipRgn(hdc, NULL);
-        ::DeleteObject(hrgn);
-    }
+    ::SelectClipRgn(hdc, NULL);
 
     ::ReleaseDC(hWnd_, hdc);
 
+    // What could not be painted stays for the next time.
+    if (result)
+    {
+        state_->damage.Clear();
+        state_->paint_scheduler.Painted(::GetTickCount());
+
+        ULONGLONG paintNs = WindowExtenders::TicksToNanoseconds(WindowExtenders::GetTicks() - start);
+        paint_stats_.last_paint_ns = paintNs;
+        ++paint_stats_.paints;
+        paint_stats_.paint_ns += paintNs;
+        if (in_size_move_)
+        {
+            ++paint_stats_.size_move_paints;
+            paint_stats_.size_move_paint_ns += paintNs;
+        }
+    }
+
     return result;
 }
 
-void CMetroFrame::DrawWindowFrame(HDC hdc, const RECT& bounds, const SIZE& borderSize, int captionHeight)
+void CMetroFrame::InvalidateNonClientArea()
 {
-    BOOL isMaxisized = ::IsZoomed(hWnd_);
+    CRect rectWindow;
+    ::GetWindowRect(hWnd_, &rectWindow);
 
-    // prepare bounds
-    CRect windowBounds = bounds;
+    state_->damage.Add(0, 0, rectWindow.Width(), rectWindow.Height());
+    SchedulePaint();
+}
+
+void CMetroFrame::SchedulePaint()
+{
+    // Changes only add damage, it is painted when the messages already
+    // queued have been handled. WM_NCPAINT still paints right away.
+    if (hWnd_ == NULL)
+        return;
+
+    if (state_->paint_scheduler.Request() &&
+        !::PostMessage(hWnd_, GetFlushPaintMessage(), 0, 0))
+    {
+        FlushPaint(false);
+    }
+}
+
+void CMetroFrame::FlushPaint(bool delayed)
+{
+    DWORD now = ::GetTickCount();
+    unsigned long delay = 0;
+
+    bool paint = delayed
+        ? state_->paint_scheduler.FlushDelayed(now, &delay)
+        : state_->paint_scheduler.Flush(now, &delay);
 
-    CRect captionBounds = windowBounds;
-    captionBounds.Height(borderSize.cy + captionHeight);
+    // Without the timer the paint cannot wait.
+    if (paint || (delay != 0 && ::SetTimer(hWnd_, kPaintTimerId, delay, NULL) == 0))
+    {
+        PaintFrameDamage();
+    }
+}
+
+void CMetroFrame::AddButtonDamage(CCaptionButton* button)
+{
+    if (button != NULL)
+    {
+        state_->damage.Add(ToDamageRect(button->Bounds()));
+    }
+}
 
-    CRect textBounds = captionBounds;
+void CMetroFrame::AddActivationDamage()
+{
+    const FrameLayout& layout = GetFrameLayout();
+    CRect rectWindow = ToRect(layout.GetWindow());
+
+    // The whole frame is filled with the caption color.
+    if (use_thick_frame_ || ::IsZoomed(hWnd_))
+    {
+        state_->damage.Add(ToDamageRect(rectWindow));
+        return;
+    }
+
+    CRect captionBounds = ToRect(layout.GetCaption());
+    state_->damage.Add(ToDamageRect(captionBounds));
+
+    // The one pixel border DrawWindowFrame draws in the activation color.
+    if (!is_dwm_enabled_ && drop_shadow_ == NULL)
+    {
+        state_->damage.Add(rectWindow.left, captionBounds.bottom, rectWindow.left + 1, rectWindow.bottom);
+        state_->damage.Add(rectWindow.right - 1, captionBounds.bottom, rectWindow.right, rectWindow.bottom);
+        state_->damage.Add(rectWindow.left, rectWindow.bottom - 1, rectWindow.right, rectWindow.bottom);
+    }
+}
+
+void CMetroFrame::DrawWindowFrame(ICanvas& canvas, HDC hdc, const FrameLayout& layout)
+{
+    BOOL isMaxisized = ::IsZoomed(hWnd_);
+
+    // prepare bounds
+    CRect windowBounds = ToRect(layout.GetWindow());
+    CRect captionBounds = ToRect(layout.GetCaption());
+    CRect textBounds = ToRect(layout.GetTitle());
     
     COLORREF captionColor = (!is_non_client_area_active_ && !is_fullscreen_) ?
         caption_theme_.InactiveCaptionColor() : caption_theme_.GetCaptionColor();
@@ -1058,7 +1411,7 @@ void CMetroFrame::DrawWindowFrame(HDC hdc, const RECT& bounds, const SIZE& borde
     COLORREF backColor = (use_thick_frame_ || isMaxisized)
         ? captionColor : background_color_;
 
-    FillSolidRect(hdc, &windowBounds, backColor);
+    canvas.FillRect(ToCanvasRect(windowBounds), backColor);
 
     int frameBorderWidth = 1;
 
@@ -1068,13 +1421,7 @@ void CMetroFrame::DrawWindowFrame(HDC hdc, const RECT& bounds, const SIZE& borde
         COLORREF borderColor = is_non_client_area_active_ ?
             caption_theme_.ActiveBorderColor() : caption_theme_.InactiveBorderColor();
 
-        HPEN hPen = ::CreatePen(PS_SOLID | PS_INSIDEFRAME, frameBorderWidth, borderColor);
-        HPEN hOldPen = (HPEN)::SelectObject(hdc, hPen);
-        HBRUSH hOldBrush = (HBRUSH)::SelectObject(hdc, GetStockObject(NULL_BRUSH));
-        ::Rectangle(hdc, windowBounds.left, windowBounds.top, windowBounds.right, windowBounds.bottom);
-        ::SelectObject(hdc, hOldBrush);
-        ::SelectObject(hdc, hOldPen);
-        ::DeleteObject(hPen);
+        canvas.FrameRect(ToCanvasRect(windowBounds), borderColor);
     }
 
 
@@ -1095,26 +1442,21 @@ void CMetroFrame::DrawWindowFrame(HDC hdc, const RECT& bounds, const SIZE& borde
             fillRect.InflateRect(-frameBorderWidth, -frameBorderWidth);
         }
 
-        FillSolidRect(hdc, &fillRect, captionColor);
+        canvas.FillRect(ToCanvasRect(fillRect), captionColor);
     }
 
     // Caculate caption icons size
     CRect iconBounds;
-    if (WindowExtenders::HasSysMenu(hWnd_) && GetSmallIcon() != NULL && show_icon_on_caption_)
+    if (layout.GetMetrics().show_icon)
     {
-        iconBounds = GetFrameIconBounds(bounds, borderSize);
-
-        textBounds.left = iconBounds.right + 1;
+        iconBounds = ToRect(layout.GetIcon());
     }
 
-    // Paint caption buttons
-    int buttonWidths = caption_button_manager_->Draw(hdc);
-    textBounds.right -= buttonWidths;
-
-    textBounds.right -= borderSize.cx + 1;
+    // Paint caption buttons, the ones outside the clipping are skipped.
+    caption_button_manager_->Draw(canvas);
 
     // draw the default caption title text
-    if (!use_custom_title_)
+    if (!use_custom_title_ && state_->damage.Intersects(ToDamageRect(textBounds)))
     {
         WCHAR title[256];
         int titleLen = ::GetWindowTextW(hWnd_, title, 255);
@@ -1129,7 +1471,7 @@ void CMetroFrame::DrawWindowFrame(HDC hdc, const RECT& bounds, const SIZE& borde
             else
             {
                 // Draw text using GDI (Whidbey feature).
-                DrawCaptionTitle(hdc, title, textBounds, captionTextColor);
+                DrawCaptionTitle(canvas, hdc, title, textBounds, captionTextColor);
             }
         }
     }
@@ -1163,7 +1505,7 @@ void CMetroFrame::DrawWindowFrame(HDC hdc, const RECT& bounds, const SIZE& borde
     }
 
     // delay draw caption icon
-    if (!iconBounds.IsRectNull())
+    if (!iconBounds.IsRectNull() && state_->damage.Intersects(ToDamageRect(iconBounds)))
     {
         ::DrawIconEx(hdc, iconBounds.left, iconBounds.top,
             GetSmallIcon(), iconBounds.Width(), iconBounds.Height(), 0, 0, DI_NORMAL);
@@ -1178,7 +1520,7 @@ void CMetroFrame::DrawWindowFrame(HDC hdc, const RECT& bounds, const SIZE& borde
     //}
 }
 
-void CMetroFrame::DrawCaptionTitle(HDC hdc, LPWSTR title, RECT bounds, COLORREF color)
+void CMetroFrame::DrawCaptionTitle(ICanvas& canvas, HDC hdc, LPCWSTR title, const RECT& bounds, COLORREF color)
 {
     if (caption_font_ == NULL)
     {
@@ -1196,6 +1538,38 @@ void CMetroFrame::DrawCaptionTitle(HDC hdc, LPWSTR title, RECT bounds, COLORREF
         caption_font_ = ::CreateFontIndirect(&lf);
     }
 
+    // The title is laid out from the glyph atlas once and drawn from the
+    // run until it changes, so a title that keeps changing only costs
+    // the glyphs it has not drawn before. A run that was not cut stays
+    // good for any width it fits in.
+    int width = bounds.right - bounds.left;
+    bool fits = (state_->title_run_width == width) ||
+        (!state_->title_run.IsTruncated() && state_->title_run.GetWidth() <= width);
+    if (state_->title_run_text.empty() || !fits || state_->title_run_text != title)
+    {
+        state_->title_run_text.clear();
+
+        if (caption_font_)
+        {
+            CGdiGlyphRasterizer rasterizer(caption_font_);
+            if (rasterizer.IsValid() &&
+                state_->title_run.Layout(state_->glyph_atlas, rasterizer, title, (int)wcslen(title), width))
+            {
+                state_->title_run_text = title;
+                state_->title_run_width = width;
+            }
+        }
+    }
+
+    if (!state_->title_run_text.empty())
+    {
+        state_->title_run.Draw(canvas, ToCanvasRect(bounds), color);
+        return;
+    }
+
+    // Text the atlas cannot draw goes through DrawText.
+    RECT rcText = bounds;
+
     HFONT hOldFont = NULL;
     if (caption_font_)
     {
@@ -1205,7 +1579,7 @@ void CMetroFrame::DrawCaptionTitle(HDC hdc, LPWSTR title, RECT bounds, COLORREF
     int oldBkMode = ::SetBkMode(hdc, TRANSPARENT);
     COLORREF oldColor = ::SetTextColor(hdc, color);
     
-    ::DrawText(hdc, title, -1, &bounds,
+    ::DrawText(hdc, title, -1, &rcText,
         DT_SINGLELINE | DT_CENTER | DT_VCENTER | DT_END_ELLIPSIS | DT_NOCLIP);
 
     ::SetTextColor(hdc, oldColor);
@@ -1216,125 +1590,148 @@ void CMetroFrame::DrawCaptionTitle(HDC hdc, LPWSTR title, RECT bounds, COLORREF
 
 void CMetroFrame::DrawThemeCaptionTitleEx(HDC hdc, LPCWSTR title, const RECT& bounds, COLORREF color, COLORREF bgColor)
 {
-    //TODO: Cache the theme?
-    HTHEME hTheme = UxThemeApi::OpenThemeData(NULL, L"CompositedWindow::Window");
+    // The theme is kept until the theme changes.
+    if (composited_theme_ == NULL)
+    {
+        composited_theme_ = UxThemeApi::OpenThemeData(NULL, L"CompositedWindow::Window");
+    }
+
+    HTHEME hTheme = composited_theme_;
     if (hTheme)
     {
-        HDC hdcPaint = ::CreateCompatibleDC(hdc);
-        if (hdcPaint)
+        int width = bounds.right - bounds.left;
+        int height = bounds.bottom - bounds.top;
+
+        // Create font
+        if (caption_font_ == NULL)
         {
-            int width = bounds.right - bounds.left;
-            int height = bounds.bottom - bounds.top;
-
-            // Define the BITMAPINFO structure used to draw text.
-            // Note that biHeight is negative. This is done because
-            // DrawThemeTextEx() needs the bitmap to be in top-to-bottom
-            // order.
-            BITMAPINFO dib = { 0 };
-            dib.bmiHeader.biSize            = sizeof(BITMAPINFOHEADER);
-            dib.bmiHeader.biWidth           = width;
-            dib.bmiHeader.biHeight          = -height;
-            dib.bmiHeader.biPlanes          = 1;
-            dib.bmiHeader.biBitCount        = 32;
-            dib.bmiHeader.biCompression     = BI_RGB;
-
-            HBITMAP hbm = ::CreateDIBSection(hdc, &dib, DIB_RGB_COLORS, NULL, NULL, 0);
-            if (hbm)
+            LOGFONT lgFont;
+            if (SUCCEEDED(UxThemeApi::GetThemeSysFont(hTheme, TMT_CAPTIONFONT, &lgFont)))
             {
-                HBITMAP hbmOld = (HBITMAP)::SelectObject(hdcPaint, hbm);
+                caption_font_ = ::CreateFontIndirect(&lgFont);
+            }
+        }
 
-                // Create font
-                if (caption_font_ == NULL)
-                {
-                    LOGFONT lgFont;
-                    if (SUCCEEDED(UxThemeApi::GetThemeSysFont(hTheme, TMT_CAPTIONFONT, &lgFont)))
-                    {
-                        caption_font_ = ::CreateFontIndirect(&lgFont);
-                    }
-                }
+        // Repaints that leave the title as it is blit the one drawn before.
+        // During live resize that is the title at any width, and one that
+        // has to be drawn goes without the glow, until the resize ends.
+        TitleKey key = { caption_font_, color, bgColor, width, height, 12 };
+        int titleWidth = width;
+        HDC hdcPaint = NULL;
+        if (in_size_move_)
+        {
+            hdcPaint = state_->title_cache.FindAnyWidth(title, key, &titleWidth);
+            key.glow_size = 0;
+        }
+        else
+        {
+            hdcPaint = state_->title_cache.Find(title, key);
+        }
 
-                // Select a font.
-                HFONT hFontOld = NULL;
-                if (caption_font_)
-                {
-                    hFontOld = (HFONT) SelectObject(hdcPaint, caption_font_);
-                }
+        if (hdcPaint == NULL)
+        {
+            titleWidth = width;
 
-                // Draw the title.
-                CRect rcPaint(0, 0, width, height);
+            // The cache keeps a top-down 32-bit DIB, which is what
+            // DrawThemeTextEx() needs.
+            hdcPaint = state_->title_cache.Add(title, key);
+            if (hdcPaint == NULL)
+                return;
 
-                FillSolidRect(hdcPaint, &rcPaint, bgColor);
+            // Select a font.
+            HFONT hFontOld = NULL;
+            if (caption_font_)
+            {
+                hFontOld = (HFONT) SelectObject(hdcPaint, caption_font_);
+            }
 
-                // Setup the theme drawing options.
-                DTTOPTS dttOpts = {sizeof(DTTOPTS)};
-                dttOpts.dwFlags = DTT_COMPOSITED | DTT_GLOWSIZE | DTT_TEXTCOLOR;
-                dttOpts.crText = color;
-                dttOpts.iGlowSize = 12;
+            // Draw the title.
+            CRect rcPaint(0, 0, width, height);
 
-                UxThemeApi::DrawThemeTextEx(hTheme, hdcPaint, 0, 0, title, -1,
-                    DT_SINGLELINE | DT_CENTER | DT_VCENTER | DT_WORD_ELLIPSIS | DT_NOPREFIX,
-                    &rcPaint, &dttOpts);
+            FillSolidRect(hdcPaint, &rcPaint, bgColor);
 
-                // Blit text to the frame.
-                ::BitBlt(hdc, bounds.left, bounds.top, width, height, hdcPaint, 0, 0, SRCCOPY);
+            // Setup the theme drawing options.
+            DTTOPTS dttOpts = {sizeof(DTTOPTS)};
+            dttOpts.dwFlags = DTT_COMPOSITED | DTT_GLOWSIZE | DTT_TEXTCOLOR;
+            dttOpts.crText = color;
+            dttOpts.iGlowSize = key.glow_size;
 
-                ::SelectObject(hdcPaint, hbmOld);
-                if (hFontOld)
-                {
-                    ::SelectObject(hdcPaint, hFontOld);
-                }
-                ::DeleteObject(hbm);
+            UxThemeApi::DrawThemeTextEx(hTheme, hdcPaint, 0, 0, title, -1,
+                DT_SINGLELINE | DT_CENTER | DT_VCENTER | DT_WORD_ELLIPSIS | DT_NOPREFIX,
+                &rcPaint, &dttOpts);
+
+            if (hFontOld)
+            {
+                ::SelectObject(hdcPaint, hFontOld);
             }
-            ::DeleteDC(hdcPaint);
         }
 
-        UxThemeApi::CloseThemeData(hTheme);
+        // Blit text to the frame, centered if it was drawn at another width.
+        int srcX = std::max<int>(0, (titleWidth - width) / 2);
+        int destX = bounds.left + std::max<int>(0, (width - titleWidth) / 2);
+        ::BitBlt(hdc, destX, bounds.top, std::min<int>(width, titleWidth), height,
+            hdcPaint, srcX, 0, SRCCOPY);
     }
 }
 
-int CMetroFrame::GetCaptionHeight()
+FrameMetrics CMetroFrame::GetFrameMetrics()
 {
-    if (caption_height_ == 0)
-    {
-        caption_height_ = WindowExtenders::GetCaptionHeight(hWnd_);
-
-        /*if (CaptionElements.Count > 0)
-        {
-        int defaultHeight = caption_height_;
-        int height = caption_height_;
+    CRect rectWindow;
+    ::GetWindowRect(hWnd_, &rectWindow);
 
-        foreach (ICaptionElement captionElement in CaptionElements)
-        {
-        if (captionElement.Align == CaptionElementAlign.BottomLeft ||
-        captionElement.Align == CaptionElementAlign.BottomRight)
-        {
-        height = Math.Max(height, defaultHeight + captionElement.Height);
-        }
-        else
-        {
-        height = Math.Max(height, captionElement.Height);
-        }
-        }
+    CSize borderSize = WindowExtenders::GetBorderSize(hWnd_, is_dwm_enabled_);
+    CSize iconSize = WindowExtenders::GetSmallIconSize();
+    CSize buttonSize = WindowExtenders::GetCaptionButtonSize(hWnd_);
+
+    FrameMetrics metrics;
+    metrics.window_width = rectWindow.Width();
+    metrics.window_height = rectWindow.Height();
+    metrics.border_cx = borderSize.cx;
+    metrics.border_cy = borderSize.cy;
+    metrics.caption_height = WindowExtenders::GetCaptionHeight(hWnd_);
+    metrics.icon_cx = iconSize.cx;
+    metrics.icon_cy = iconSize.cy;
+    metrics.button_cx = buttonSize.cx;
+    metrics.button_cy = buttonSize.cy;
+    metrics.button_count = caption_button_manager_->Count();
+    metrics.has_sys_menu = WindowExtenders::HasSysMenu(hWnd_);
+    metrics.show_icon = metrics.has_sys_menu && GetSmallIcon() != NULL && show_icon_on_caption_;
+    metrics.sizable = WindowExtenders::IsWindowSizable(hWnd_);
+    metrics.dwm_enabled = is_dwm_enabled_;
+
+    return metrics;
+}
 
-        caption_height_ = Math.Max(height, defaultHeight);
-        }*/
+const FrameLayout& CMetroFrame::GetFrameLayout()
+{
+    if (!state_->frame_layout_valid)
+    {
+        state_->frame_layout = FrameLayout(GetFrameMetrics());
+        state_->frame_layout_valid = true;
     }
 
-    return caption_height_;
+    return state_->frame_layout;
 }
 
-RECT CMetroFrame::GetFrameIconBounds(const RECT& windowBounds, SIZE borderSize)
+void CMetroFrame::InvalidateFrameLayout()
 {
-    int captionHeight = WindowExtenders::GetCaptionHeight(hWnd_);
-    CSize iconSize = WindowExtenders::GetSmallIconSize();
+    state_->frame_layout_valid = false;
+}
 
-    CRect iconBounds;
-    iconBounds.left = windowBounds.left + borderSize.cx;
-    iconBounds.top = windowBounds.top + (borderSize.cy + captionHeight - iconSize.cy) / 2;
-    iconBounds.Width(iconSize.cx);
-    iconBounds.Height(iconSize.cy);
+POINT CMetroFrame::GetWindowOrigin()
+{
+    // A child frame moves with its parent without being told, so only
+    // a top-level window keeps its origin until WM_WINDOWPOSCHANGED.
+    if (!window_origin_valid_ || (::GetWindowLong(hWnd_, GWL_STYLE) & WS_CHILD))
+    {
+        RECT rectWindow;
+        ::GetWindowRect(hWnd_, &rectWindow);
+        window_origin_.x = rectWindow.left;
+        window_origin_.y = rectWindow.top;
+        window_origin_valid_ = true;
+    }
 
-    return iconBounds;
+    return window_origin_;
 }
 
 void CMetroFrame::FillSolidRect(HDC hdc, LPCRECT lpRect, COLORREF clr)
@@ -10,6 +10,23 @@ namespace MetroWindow
 class CCaptionButton; // Forward declare
 class CCaptionButtonManager;
 class CDropShadow;
+class ICanvas;
+class FrameLayout;
+struct FrameMetrics;
+struct TitleCacheStats;
+struct GlyphAtlasStats;
+struct PaintSchedulerStats;
+
+// What painting the frame has cost so far, and the part of it between
+// WM_ENTERSIZEMOVE and WM_EXITSIZEMOVE.
+struct FramePaintStats
+{
+    unsigned long paints;
+    ULONGLONG paint_ns;
+    unsigned long size_move_paints;
+    ULONGLONG size_move_paint_ns;
+    ULONGLONG last_paint_ns;
+};
 
 class METROWINDOW_DECL CMetroFrame
 {
@@ -33,6 +50,7 @@ public:
     void SetMinSize(int cx, int cy);
 
     void ShowDropShadowOnXP(bool show);
+    void UseSingleShadowWindow(bool single) { single_shadow_window_ = single; }
     void ClientAreaMovable(bool movable) { client_area_movable_ = movable; }
     void UseCustomTitile(bool custom) { use_custom_title_ = custom; }
     void UseThickFrame(bool thick) { use_thick_frame_ = thick; }
@@ -40,6 +58,11 @@ public:
     void EnableCloseButton(bool enable);
     void CenterWindow(HWND hWndCenter = NULL);
 
+    const TitleCacheStats& GetTitleCacheStats() const;
+    const GlyphAtlasStats& GetGlyphAtlasStats() const;
+    const PaintSchedulerStats& GetPaintSchedulerStats() const;
+    const FramePaintStats& GetPaintStats() const { return paint_stats_; }
+
 protected:
     virtual LRESULT OnDefWndProc(UINT uMsg, WPARAM wParam, LPARAM lParam);
     virtual LRESULT OnWndProc(UINT uMsg, WPARAM wParam, LPARAM lParam);
@@ -62,18 +85,34 @@ protected:
     virtual LRESULT OnWindowPosChanged(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled);
     virtual LRESULT OnSysCommand(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled);
     virtual LRESULT OnDwmCompositionChanged(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled);
+    virtual LRESULT OnSettingChange(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled);
+    virtual LRESULT OnThemeChanged(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled);
+    virtual LRESULT OnEnterSizeMove(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled);
+    virtual LRESULT OnExitSizeMove(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled);
+    virtual LRESULT OnTimer(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled);
     virtual LRESULT OnCreate(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled);
     virtual LRESULT OnCommand(UINT uMsg, WPARAM wParam, LPARAM lParam, BOOL& bHandled);
 
 private:
+    struct FrameState;
+
     void RemoveWindowBorderStyle();
     BOOL ModifyWindowStyle(LONG removeStyle, LONG addStyle);
     BOOL PaintNonClientArea(HRGN hrgnUpdate);
-    void DrawWindowFrame(HDC hdc, const RECT& bounds, const SIZE& borderSize, int captionHeight);
-    void DrawCaptionTitle(HDC hdc, LPWSTR title, RECT bounds, COLORREF color);
+    BOOL PaintFrameDamage();
+    void InvalidateNonClientArea();
+    void SchedulePaint();
+    void FlushPaint(bool delayed);
+    void UpdateDropShadow();
+    void AddButtonDamage(CCaptionButton* button);
+    void AddActivationDamage();
+    void DrawWindowFrame(ICanvas& canvas, HDC hdc, const FrameLayout& layout);
+    void DrawCaptionTitle(ICanvas& canvas, HDC hdc, LPCWSTR title, const RECT& bounds, COLORREF color);
     void DrawThemeCaptionTitleEx(HDC hdc, LPCWSTR title, const RECT& bounds, COLORREF color, COLORREF bgColor);
-    int GetCaptionHeight();
-    RECT GetFrameIconBounds(const RECT& windowBounds, SIZE borderSize);
+    FrameMetrics GetFrameMetrics();
+    const FrameLayout& GetFrameLayout();
+    void InvalidateFrameLayout();
+    POINT GetWindowOrigin();
     void FillSolidRect(HDC hdc, LPCRECT lpRect, COLORREF clr);
     void ShowSystemMenu(POINT point);
 
@@ -86,19 +125,23 @@ protected:
 
 private:
     HFONT caption_font_;
+    HANDLE composited_theme_;       // an HTHEME, clients need not include Uxtheme.h
+
     COLORREF background_color_;
     SIZE min_size_;
 
     bool show_drop_shadow_on_xp_;
+    bool single_shadow_window_;
     bool is_dwm_enabled_;
     bool is_uxtheme_supported_;
     bool trace_nc_mouse_;
     bool is_non_client_area_active_;
     bool is_sizing_;
-    bool is_sizable_;
+    bool in_size_move_;             // between WM_ENTERSIZEMOVE and WM_EXITSIZEMOVE
+    bool shadow_update_pending_;    // the shadow was left behind by the size, the timer is set
+    DWORD last_shadow_update_;
     bool prepare_fullscreen_;
     bool is_fullscreen_;
-    int caption_height_;
 
     bool use_custom_title_;
     bool client_area_movable_;
@@ -115,6 +158,14 @@ private:
 
     CCaptionButton * pressed_button_;
     CCaptionButton * hovered_button_;
+
+    // The damage, the back buffer, the title caches and the layout.
+    FrameState * state_;
+    FramePaintStats paint_stats_;
+
+    // The top left corner of the window on the screen, for the hit test.
+    POINT window_origin_;
+    bool window_origin_valid_;
 };
 
 } //namespace MetroWindow
@@ -0,0 +1,83 @@
+#include "PaintScheduler.h"
+
+#include <string.h>
+
+namespace MetroWindow
+{
+
+PaintScheduler::PaintScheduler(void)
+    : pending_(false)
+    , posted_(false)
+    , delayed_(false)
+    , painted_(false)
+    , last_paint_(0)
+    , min_interval_(0)
+{
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+bool PaintScheduler::Request()
+{
+    ++stats_.requests;
+    pending_ = true;
+
+    // One message a turn, the changes after it wait for the same one.
+    if (posted_)
+        return false;
+
+    posted_ = true;
+    return true;
+}
+
+bool PaintScheduler::Flush(unsigned long now, unsigned long* delay)
+{
+    posted_ = false;
+    return FlushPending(now, delay);
+}
+
+bool PaintScheduler::FlushDelayed(unsigned long now, unsigned long* delay)
+{
+    delayed_ = false;
+    return FlushPending(now, delay);
+}
+
+void PaintScheduler::Painted(unsigned long now)
+{
+    pending_ = false;
+    delayed_ = false;
+    painted_ = true;
+    last_paint_ = now;
+}
+
+void PaintScheduler::SetMinInterval(unsigned long interval)
+{
+    min_interval_ = interval;
+}
+
+bool PaintScheduler::FlushPending(unsigned long now, unsigned long* delay)
+{
+    *delay = 0;
+
+    if (!pending_)
+        return false;
+
+    // Unsigned, so a clock that wrapped still gives the time since.
+    unsigned long elapsed = now - last_paint_;
+    if (min_interval_ != 0 && painted_ && elapsed < min_interval_)
+    {
+        // A timer that is already set paints it soon enough.
+        if (!delayed_)
+        {
+            delayed_ = true;
+            *delay = min_interval_ - elapsed;
+            ++stats_.delays;
+        }
+        return false;
+    }
+
+    ++stats_.paints;
+    Painted(now);
+    return true;
+}
+
+} //namespace MetroWindow
@@ -0,0 +1,58 @@
+#pragma once
+
+namespace MetroWindow
+{
+
+struct PaintSchedulerStats
+{
+    unsigned long requests; // changes that asked for a paint
+    unsigned long paints;   // paints made for them
+    unsigned long delays;   // flushes put off to keep the paint rate down
+};
+
+// Decides when the frame is painted after it changed. A change only adds
+// its damage and asks for a paint. The first one in a turn of the message
+// loop has the caller post a message, and when that arrives the damage of
+// all of them is painted at once. During live resize paints are also kept
+// a minimum interval apart, with a timer for the paint that has to wait.
+//
+// Times are in milliseconds, from a clock that may wrap.
+class PaintScheduler
+{
+public:
+    PaintScheduler(void);
+
+    // Asks for a paint. Returns true if the caller has to post the flush
+    // message; if it cannot be posted, the caller calls Flush right away.
+    bool Request();
+
+    // The flush message arrived at 'now'. Returns true if the frame is
+    // to be painted now. Otherwise, if '*delay' is not 0, the caller sets
+    // a timer for that long and calls FlushDelayed when it fires.
+    bool Flush(unsigned long now, unsigned long* delay);
+    bool FlushDelayed(unsigned long now, unsigned long* delay);
+
+    // All damage was painted at 'now', whatever the reason.
+    void Painted(unsigned long now);
+
+    // The least time between two paints, 0 for none.
+    void SetMinInterval(unsigned long interval);
+
+    // True if a paint was asked for and not made yet.
+    bool IsPending() const { return pending_; }
+
+    const PaintSchedulerStats& GetStats() const { return stats_; }
+
+private:
+    bool FlushPending(unsigned long now, unsigned long* delay);
+
+    bool pending_;      // a paint is owed
+    bool posted_;       // the flush message is on its way
+    bool delayed_;      // the timer is set
+    bool painted_;      // last_paint_ is known
+    unsigned long last_paint_;
+    unsigned long min_interval_;
+    PaintSchedulerStats stats_;
+};
+
+} //namespace MetroWindow
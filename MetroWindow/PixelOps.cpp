@@ -0,0 +1,195 @@
+#include "PixelOps.h"
+
+#include <string.h>
+
+#ifdef PIXELOPS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace MetroWindow
+{
+
+namespace PixelOps
+{
+
+void ColorizeMask(const unsigned char* mask, int count,
+    unsigned char r, unsigned char g, unsigned char b, unsigned char* dst)
+{
+    int i = 0;
+
+#ifdef PIXELOPS_SSE2
+    __m128i zero = _mm_setzero_si128();
+    __m128i red = _mm_set1_epi16(r);
+    __m128i green = _mm_set1_epi16(g);
+    __m128i blue = _mm_set1_epi16(b);
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i alpha = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(mask + i)), zero);
+
+        __m128i pb = _mm_srli_epi16(_mm_mullo_epi16(blue, alpha), 8);
+        __m128i pg = _mm_srli_epi16(_mm_mullo_epi16(green, alpha), 8);
+        __m128i pr = _mm_srli_epi16(_mm_mullo_epi16(red, alpha), 8);
+
+        // B | G << 8 and R | A << 8 per pixel, then interleaved.
+        __m128i bg = _mm_or_si128(pb, _mm_slli_epi16(pg, 8));
+        __m128i ra = _mm_or_si128(pr, _mm_slli_epi16(alpha, 8));
+
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_unpacklo_epi16(bg, ra));
+        _mm_storeu_si128((__m128i*)(dst + i * 4 + 16), _mm_unpackhi_epi16(bg, ra));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        unsigned int pixel = ColorizePixel(mask[i], r, g, b);
+        memcpy(dst + i * 4, &pixel, 4);
+    }
+}
+
+void FillPixels(unsigned char* dst, int count, unsigned int pixel)
+{
+    int i = 0;
+
+#ifdef PIXELOPS_SSE2
+    __m128i pixels = _mm_set1_epi32((int)pixel);
+
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_si128((__m128i*)(dst + i * 4), pixels);
+#endif
+
+    for (; i < count; ++i)
+        memcpy(dst + i * 4, &pixel, 4);
+}
+
+#ifdef PIXELOPS_SSE2
+namespace
+{
+    // Divide255 on eight 16-bit lanes.
+    inline __m128i Divide255Lanes(__m128i x)
+    {
+        x = _mm_add_epi16(x, _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+    }
+
+    // Spreads the alpha of two pixels, unpacked to 16 bits, over their
+    // four lanes each.
+    inline __m128i SpreadAlpha(__m128i pixels)
+    {
+        pixels = _mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3));
+        return _mm_shufflehi_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+
+} // namespace
+#endif
+
+void BlendPremultiplied(const unsigned char* src, int count, unsigned char* dst)
+{
+    int i = 0;
+
+#ifdef PIXELOPS_SSE2
+    __m128i zero = _mm_setzero_si128();
+    __m128i full = _mm_set1_epi16(255);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i * 4));
+
+        __m128i slo = _mm_unpacklo_epi8(s, zero);
+        __m128i shi = _mm_unpackhi_epi8(s, zero);
+        __m128i dlo = _mm_unpacklo_epi8(d, zero);
+        __m128i dhi = _mm_unpackhi_epi8(d, zero);
+
+        dlo = Divide255Lanes(_mm_mullo_epi16(dlo, _mm_sub_epi16(full, SpreadAlpha(slo))));
+        dhi = Divide255Lanes(_mm_mullo_epi16(dhi, _mm_sub_epi16(full, SpreadAlpha(shi))));
+
+        // The pack saturates what a source that is not premultiplied
+        // would push over 255.
+        _mm_storeu_si128((__m128i*)(dst + i * 4),
+            _mm_packus_epi16(_mm_add_epi16(slo, dlo), _mm_add_epi16(shi, dhi)));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        const unsigned char* s = src + i * 4;
+        unsigned char* d = dst + i * 4;
+        unsigned int inverse = 255 - s[3];
+
+        for (int c = 0; c < 4; ++c)
+        {
+            unsigned int value = s[c] + Divide255(d[c] * inverse);
+            d[c] = (unsigned char)(value > 255 ? 255 : value);
+        }
+    }
+}
+
+void BlendCoverage(const unsigned char* mask, int count,
+    unsigned char r, unsigned char g, unsigned char b, unsigned char* dst)
+{
+    int i = 0;
+
+#ifdef PIXELOPS_SSE2
+    __m128i zero = _mm_setzero_si128();
+    __m128i full = _mm_set1_epi16(255);
+    __m128i color = _mm_setr_epi16(b, g, r, 255, b, g, r, 255);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        // The coverage of each pixel in its four lanes.
+        int coverage;
+        memcpy(&coverage, mask + i, 4);
+        __m128i m = _mm_cvtsi32_si128(coverage);
+        m = _mm_unpacklo_epi8(m, m);
+        m = _mm_unpacklo_epi16(m, m);
+        __m128i mlo = _mm_unpacklo_epi8(m, zero);
+        __m128i mhi = _mm_unpackhi_epi8(m, zero);
+
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i * 4));
+        __m128i dlo = _mm_unpacklo_epi8(d, zero);
+        __m128i dhi = _mm_unpackhi_epi8(d, zero);
+
+        dlo = Divide255Lanes(_mm_add_epi16(_mm_mullo_epi16(color, mlo),
+            _mm_mullo_epi16(dlo, _mm_sub_epi16(full, mlo))));
+        dhi = Divide255Lanes(_mm_add_epi16(_mm_mullo_epi16(color, mhi),
+            _mm_mullo_epi16(dhi, _mm_sub_epi16(full, mhi))));
+
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_packus_epi16(dlo, dhi));
+    }
+#endif
+
+    unsigned char channels[4] = { b, g, r, 255 };
+    for (; i < count; ++i)
+    {
+        unsigned char* d = dst + i * 4;
+        unsigned int coverage = mask[i];
+
+        for (int c = 0; c < 4; ++c)
+            d[c] = (unsigned char)Divide255(channels[c] * coverage + d[c] * (255 - coverage));
+    }
+}
+
+void AddCoverage(const unsigned char* src, int count, unsigned char* dst)
+{
+    int i = 0;
+
+#ifdef PIXELOPS_SSE2
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_adds_epu8(s, d));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        unsigned int sum = src[i] + dst[i];
+        dst[i] = (unsigned char)(sum > 255 ? 255 : sum);
+    }
+}
+
+} // namespace PixelOps
+
+} //namespace MetroWindow
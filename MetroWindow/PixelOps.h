@@ -0,0 +1,54 @@
+#pragma once
+
+// SSE2 is used where the compiler targets it: always on x64, and on x86
+// with /arch:SSE2. Every kernel has a plain C++ version as well, and both
+// give the same bytes.
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define PIXELOPS_SSE2
+#endif
+
+namespace MetroWindow
+{
+
+namespace PixelOps
+{
+    // Writes 'count' 32-bit BGRA pixels of the color (r, g, b) with the
+    // alpha taken from 'mask', premultiplied the way the shadow bitmaps
+    // always were: (c * a) >> 8.
+    void ColorizeMask(const unsigned char* mask, int count,
+        unsigned char r, unsigned char g, unsigned char b, unsigned char* dst);
+
+    // Sets 'count' 32-bit pixels to 'pixel'.
+    void FillPixels(unsigned char* dst, int count, unsigned int pixel);
+
+    // Draws 'count' premultiplied BGRA pixels over 'dst' the way
+    // AlphaBlend does with AC_SRC_ALPHA: d = s + d * (255 - sa) / 255.
+    void BlendPremultiplied(const unsigned char* src, int count, unsigned char* dst);
+
+    // Draws the color (r, g, b) over 'dst' with the coverage of 'mask'
+    // as its alpha: d = (c * m + d * (255 - m)) / 255, alpha included.
+    void BlendCoverage(const unsigned char* mask, int count,
+        unsigned char r, unsigned char g, unsigned char b, unsigned char* dst);
+
+    // Adds the coverage of 'src' to 'dst', saturating at 255, so glyphs
+    // that overlap in a run keep the ink of both.
+    void AddCoverage(const unsigned char* src, int count, unsigned char* dst);
+
+    // x / 255 rounded, for x up to 255 * 255.
+    inline unsigned int Divide255(unsigned int x)
+    {
+        x += 128;
+        return (x + (x >> 8)) >> 8;
+    }
+
+    // The single pixel version of ColorizeMask.
+    inline unsigned int ColorizePixel(unsigned char alpha,
+        unsigned char r, unsigned char g, unsigned char b)
+    {
+        return ((b * alpha) >> 8) | (((g * alpha) >> 8) << 8) |
+            (((r * alpha) >> 8) << 16) | ((unsigned int)alpha << 24);
+    }
+
+} // namespace PixelOps
+
+} //namespace MetroWindow
@@ -0,0 +1,140 @@
+#include "RasterCanvas.h"
+
+#include <stddef.h>
+
+#include <algorithm>
+
+#include "PixelOps.h"
+
+namespace MetroWindow
+{
+
+namespace
+{
+    unsigned int ToPixel(unsigned long color)
+    {
+        unsigned int r = color & 0xFF;
+        unsigned int g = (color >> 8) & 0xFF;
+        unsigned int b = (color >> 16) & 0xFF;
+        return b | (g << 8) | (r << 16) | 0xFF000000;
+    }
+
+} // namespace
+
+RasterCanvas::RasterCanvas(unsigned char* bits, int stride, int width, int height)
+    : bits_(bits), stride_(stride), width_(width), height_(height)
+    , origin_x_(0), origin_y_(0)
+{
+    clip_.left = 0;
+    clip_.top = 0;
+    clip_.right = width;
+    clip_.bottom = height;
+}
+
+void RasterCanvas::SetViewportOrg(int x, int y)
+{
+    // The clip stays where it is on the surface.
+    origin_x_ = x;
+    origin_y_ = y;
+}
+
+void RasterCanvas::SetClip(const CanvasRect& clip)
+{
+    clip_.left = std::max<int>(clip.left + origin_x_, 0);
+    clip_.top = std::max<int>(clip.top + origin_y_, 0);
+    clip_.right = std::min<int>(clip.right + origin_x_, width_);
+    clip_.bottom = std::min<int>(clip.bottom + origin_y_, height_);
+}
+
+bool RasterCanvas::ToDevice(const CanvasRect& rect, CanvasRect* device) const
+{
+    device->left = std::max<int>(rect.left + origin_x_, clip_.left);
+    device->top = std::max<int>(rect.top + origin_y_, clip_.top);
+    device->right = std::min<int>(rect.right + origin_x_, clip_.right);
+    device->bottom = std::min<int>(rect.bottom + origin_y_, clip_.bottom);
+
+    return device->left < device->right && device->top < device->bottom;
+}
+
+void RasterCanvas::FillRect(const CanvasRect& rect, unsigned long color)
+{
+    CanvasRect device;
+    if (!ToDevice(rect, &device))
+        return;
+
+    unsigned int pixel = ToPixel(color);
+    for (int y = device.top; y < device.bottom; ++y)
+        PixelOps::FillPixels(Pixel(device.left, y), device.right - device.left, pixel);
+}
+
+void RasterCanvas::FrameRect(const CanvasRect& rect, unsigned long color)
+{
+    if (rect.left >= rect.right || rect.top >= rect.bottom)
+        return;
+
+    CanvasRect top = { rect.left, rect.top, rect.right, rect.top + 1 };
+    CanvasRect bottom = { rect.left, rect.bottom - 1, rect.right, rect.bottom };
+    CanvasRect left = { rect.left, rect.top + 1, rect.left + 1, rect.bottom - 1 };
+    CanvasRect right = { rect.right - 1, rect.top + 1, rect.right, rect.bottom - 1 };
+
+    FillRect(top, color);
+    FillRect(bottom, color);
+    FillRect(left, color);
+    FillRect(right, color);
+}
+
+void RasterCanvas::BlendImage(int x, int y, const CanvasImage& image, const CanvasRect& src)
+{
+    // Where the source lands, limited to the image.
+    int srcLeft = std::max<int>(src.left, 0);
+    int srcTop = std::max<int>(src.top, 0);
+    int srcRight = std::min<int>(src.right, image.width);
+    int srcBottom = std::min<int>(src.bottom, image.height);
+
+    CanvasRect dest = { x + srcLeft - src.left, y + srcTop - src.top,
+        x + srcRight - src.left, y + srcBottom - src.top };
+
+    CanvasRect device;
+    if (image.bits == NULL || !ToDevice(dest, &device))
+        return;
+
+    int sx = srcLeft + device.left - (dest.left + origin_x_);
+    int sy = srcTop + device.top - (dest.top + origin_y_);
+
+    for (int row = device.top; row < device.bottom; ++row)
+    {
+        const unsigned char* line = image.bits + (sy + row - device.top) * image.stride + sx * 4;
+        PixelOps::BlendPremultiplied(line, device.right - device.left, Pixel(device.left, row));
+    }
+}
+
+void RasterCanvas::BlendGlyphRun(int x, int y, const unsigned char* coverage, int stride,
+    int width, int height, unsigned long color)
+{
+    CanvasRect dest = { x, y, x + width, y + height };
+
+    CanvasRect device;
+    if (coverage == NULL || !ToDevice(dest, &device))
+        return;
+
+    int sx = device.left - (x + origin_x_);
+    int sy = device.top - (y + origin_y_);
+
+    unsigned char r = (unsigned char)(color & 0xFF);
+    unsigned char g = (unsigned char)((color >> 8) & 0xFF);
+    unsigned char b = (unsigned char)((color >> 16) & 0xFF);
+
+    for (int row = device.top; row < device.bottom; ++row)
+    {
+        PixelOps::BlendCoverage(coverage + (sy + row - device.top) * stride + sx,
+            device.right - device.left, r, g, b, Pixel(device.left, row));
+    }
+}
+
+bool RasterCanvas::IsVisible(const CanvasRect& rect) const
+{
+    CanvasRect device;
+    return ToDevice(rect, &device);
+}
+
+} //namespace MetroWindow
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Canvas.h"
+
+namespace MetroWindow
+{
+
+// Draws into a top-down 32-bit BGRA surface in memory. Like a GDI DC it
+// has a viewport origin, added to every coordinate, and a clip rectangle
+// in logical coordinates. Everything it fills is opaque.
+class RasterCanvas : public ICanvas
+{
+public:
+    RasterCanvas(unsigned char* bits, int stride, int width, int height);
+
+    void SetViewportOrg(int x, int y);
+    void SetClip(const CanvasRect& clip);
+
+    virtual void FillRect(const CanvasRect& rect, unsigned long color);
+    virtual void FrameRect(const CanvasRect& rect, unsigned long color);
+    virtual void BlendImage(int x, int y, const CanvasImage& image, const CanvasRect& src);
+    virtual void BlendGlyphRun(int x, int y, const unsigned char* coverage, int stride,
+        int width, int height, unsigned long color);
+    virtual bool IsVisible(const CanvasRect& rect) const;
+
+private:
+    // 'rect' in device coordinates, clipped. False if nothing is left.
+    bool ToDevice(const CanvasRect& rect, CanvasRect* device) const;
+
+    unsigned char* Pixel(int x, int y) const
+    {
+        return bits_ + y * stride_ + x * 4;
+    }
+
+    unsigned char* bits_;
+    int stride_;
+    int width_;
+    int height_;
+    int origin_x_;
+    int origin_y_;
+    CanvasRect clip_;   // device coordinates
+};
+
+} //namespace MetroWindow
@@ -0,0 +1,184 @@
+#include "ShadowCompositor.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "PixelOps.h"
+
+namespace MetroWindow
+{
+
+namespace
+{
+    struct Surface
+    {
+        unsigned char* bits;
+        int stride;
+        int width;
+        int height;
+        int clip_left;
+        int clip_top;
+
+        unsigned char* Row(int y) const
+        {
+            return bits + y * stride;
+        }
+    };
+
+    struct Color
+    {
+        unsigned char r;
+        unsigned char g;
+        unsigned char b;
+    };
+
+    // The Draw functions return the number of pixels they wrote.
+    int DrawCorner(const Surface& surface, const std::vector<unsigned char>& mask,
+        int size, int x, int y, const Color& color)
+    {
+        int left = std::max<int>(x, surface.clip_left);
+        int top = std::max<int>(y, surface.clip_top);
+        int right = std::min<int>(x + size, surface.width);
+        int bottom = std::min<int>(y + size, surface.height);
+
+        if (left >= right || top >= bottom)
+            return 0;
+
+        for (int row = top; row < bottom; ++row)
+        {
+            PixelOps::ColorizeMask(&mask[(row - y) * size + (left - x)], right - left,
+                color.r, color.g, color.b, surface.Row(row) + left * 4);
+        }
+
+        return (right - left) * (bottom - top);
+    }
+
+    // The top and bottom edges: every row is one color.
+    int DrawHorizontalEdge(const Surface& surface, const std::vector<unsigned char>& mask,
+        int x, int y, int cx, int cy, const Color& color)
+    {
+        int left = std::max<int>(x, surface.clip_left);
+        int top = std::max<int>(y, surface.clip_top);
+        int right = std::min<int>(x + cx, surface.width);
+        int bottom = std::min<int>(y + cy, surface.height);
+
+        if (left >= right || top >= bottom)
+            return 0;
+
+        for (int row = top; row < bottom; ++row)
+        {
+            unsigned int pixel = PixelOps::ColorizePixel(mask[(row - y) % mask.size()],
+                color.r, color.g, color.b);
+            PixelOps::FillPixels(surface.Row(row) + left * 4, right - left, pixel);
+        }
+
+        return (right - left) * (bottom - top);
+    }
+
+    // The left and right edges: every row is the same, so the first one
+    // is colored and the others are copies of it.
+    int DrawVerticalEdge(const Surface& surface, const std::vector<unsigned char>& mask,
+        int x, int y, int cx, int cy, const Color& color)
+    {
+        int left = std::max<int>(x, surface.clip_left);
+        int top = std::max<int>(y, surface.clip_top);
+        int right = std::min<int>(x + cx, surface.width);
+        int bottom = std::min<int>(y + cy, surface.height);
+
+        if (left >= right || top >= bottom)
+            return 0;
+
+        unsigned char* first = surface.Row(top) + left * 4;
+        PixelOps::ColorizeMask(&mask[left - x], right - left, color.r, color.g, color.b, first);
+
+        for (int row = top + 1; row < bottom; ++row)
+            memcpy(surface.Row(row) + left * 4, first, (right - left) * 4);
+
+        return (right - left) * (bottom - top);
+    }
+
+} // namespace
+
+namespace ShadowCompositor
+{
+
+int GetFarCornerExtent(const ShadowMasks& masks, ShadowSide side)
+{
+    // The side strips start and end a shadow size into the corners.
+    if (side == Left || side == Right)
+        return masks.corner_size - masks.shadow_size;
+    else
+        return masks.corner_size;
+}
+
+int ComposeSide(const ShadowMasks& masks,
+    unsigned char r, unsigned char g, unsigned char b,
+    ShadowSide side, unsigned char* bits, int stride, int width, int height,
+    int from)
+{
+    bool horizontal = (side == Top || side == Bottom);
+    Surface surface = { bits, stride, width, height,
+        horizontal ? from : 0, horizontal ? 0 : from };
+    Color color = { r, g, b };
+
+    int cornerSize = masks.corner_size;
+    int borderWidth = masks.shadow_size;
+
+    int written = 0;
+    int top = 0;
+    int left = 0;
+    int right = width;
+    int bottom = height;
+
+    // The left and right strips are drawn as if they reached over the
+    // corners of the window too, so the corners line up with the ones
+    // of the top and bottom strips.
+    if (side == Left || side == Right)
+    {
+        top -= borderWidth;
+        bottom += borderWidth;
+        height += borderWidth * 2;
+    }
+
+    // The corners are drawn in this order so that where they overlap on
+    // a small window the result stays the same as it always was.
+    if (side == Left || side == Top)
+        written += DrawCorner(surface, masks.corners[CornerNW], cornerSize, left, top, color);
+
+    if (side == Right || side == Top)
+        written += DrawCorner(surface, masks.corners[CornerNE], cornerSize, right - cornerSize, top, color);
+
+    if (side == Left || side == Bottom)
+        written += DrawCorner(surface, masks.corners[CornerSW], cornerSize, left, bottom - cornerSize, color);
+
+    if (side == Right || side == Bottom)
+        written += DrawCorner(surface, masks.corners[CornerSE], cornerSize, right - cornerSize, bottom - cornerSize, color);
+
+    if (side == Top)
+    {
+        written += DrawHorizontalEdge(surface, masks.edges[EdgeN], left + cornerSize, top,
+            width - cornerSize * 2, borderWidth, color);
+    }
+    else if (side == Bottom)
+    {
+        written += DrawHorizontalEdge(surface, masks.edges[EdgeS], left + cornerSize,
+            bottom - borderWidth, width - cornerSize * 2, borderWidth, color);
+    }
+    else if (side == Left)
+    {
+        written += DrawVerticalEdge(surface, masks.edges[EdgeW], left, top + cornerSize,
+            borderWidth, height - cornerSize * 2, color);
+    }
+    else if (side == Right)
+    {
+        written += DrawVerticalEdge(surface, masks.edges[EdgeE], right - borderWidth,
+            top + cornerSize, borderWidth, height - cornerSize * 2, color);
+    }
+
+    return written;
+}
+
+} // namespace ShadowCompositor
+
+} //namespace MetroWindow
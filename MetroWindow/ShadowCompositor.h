@@ -0,0 +1,39 @@
+#pragma once
+
+#include "ShadowGenerator.h"
+
+namespace MetroWindow
+{
+
+enum ShadowSide
+{
+    Left,
+    Top,
+    Right,
+    Bottom
+};
+
+namespace ShadowCompositor
+{
+    // Draws the shadow strip of one side of a window, nine-slice style:
+    // the two corners of that side and the edge stretched between them.
+    // 'bits' is a top-down 32-bit BGRA surface of width x height pixels
+    // with rows 'stride' bytes apart. The top and bottom strips reach
+    // over the corners of the window, the left and right ones are as
+    // high as the window.
+    //
+    // Only the part of the strip from 'from' on (a column for the top
+    // and bottom, a row for the sides) is drawn, the rest is left as is.
+    // Returns the number of pixels written.
+    int ComposeSide(const ShadowMasks& masks,
+        unsigned char r, unsigned char g, unsigned char b,
+        ShadowSide side, unsigned char* bits, int stride, int width, int height,
+        int from = 0);
+
+    // How far the corner at the far end of a strip (right or bottom)
+    // reaches into it. Nothing before that depends on the strip length.
+    int GetFarCornerExtent(const ShadowMasks& masks, ShadowSide side);
+
+} // namespace ShadowCompositor
+
+} //namespace MetroWindow
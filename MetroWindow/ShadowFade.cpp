@@ -0,0 +1,55 @@
+#include "ShadowFade.h"
+
+namespace MetroWindow
+{
+
+namespace
+{
+    // 256 * (3t^2 - 2t^3) for t = step / kSteps.
+    const int kFadeWeights[ShadowFade::kSteps + 1] = {
+        0, 7, 27, 55, 90, 128, 166, 201, 229, 249, 256
+    };
+
+    unsigned long LerpChannel(unsigned long from, unsigned long to, int shift, int weight)
+    {
+        unsigned long a = (from >> shift) & 0xFF;
+        unsigned long b = (to >> shift) & 0xFF;
+        return ((a * (256 - weight) + b * weight + 128) >> 8) << shift;
+    }
+
+} // namespace
+
+ShadowFade::ShadowFade(void)
+    : from_(0), to_(0), step_(kSteps)
+{
+}
+
+void ShadowFade::Start(unsigned long from, unsigned long to)
+{
+    from_ = from;
+    to_ = to;
+    step_ = 0;
+}
+
+void ShadowFade::Stop()
+{
+    from_ = to_;
+    step_ = kSteps;
+}
+
+bool ShadowFade::Step()
+{
+    if (step_ < kSteps)
+        ++step_;
+
+    return IsRunning();
+}
+
+unsigned long ShadowFade::GetColor() const
+{
+    int weight = kFadeWeights[step_];
+    return LerpChannel(from_, to_, 0, weight) | LerpChannel(from_, to_, 8, weight) |
+        LerpChannel(from_, to_, 16, weight);
+}
+
+} //namespace MetroWindow
@@ -0,0 +1,35 @@
+#pragma once
+
+namespace MetroWindow
+{
+
+// Fades the shadow color over a few frames when the window is activated
+// or deactivated. The masks are colored when they are drawn, so every
+// frame of the fade is one ordinary draw of each side in the color in
+// between. The steps follow an ease-in-out curve worked out beforehand.
+class ShadowFade
+{
+public:
+    static const int kSteps = 10;
+
+    ShadowFade(void);
+
+    // Colors are COLORREF values.
+    void Start(unsigned long from, unsigned long to);
+    void Stop();
+
+    // Moves on to the next frame. Returns false once the fade is done.
+    bool Step();
+
+    bool IsRunning() const { return step_ < kSteps; }
+
+    // The color of the current frame.
+    unsigned long GetColor() const;
+
+private:
+    unsigned long from_;
+    unsigned long to_;
+    int step_;
+};
+
+} //namespace MetroWindow
@@ -0,0 +1,288 @@
+#include "ShadowGenerator.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "PixelOps.h"
+
+#ifdef PIXELOPS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace MetroWindow
+{
+
+namespace
+{
+    // The blur is three passes of a box filter of this radius each
+    // way, together they reach three times as far.
+    int GetBoxRadius(int radius)
+    {
+        return (radius + 2) / 3;
+    }
+
+    // Box sums are divided by a multiply and a shift. With the box
+    // radius at most 32 the sum of a box of bytes stays below 65536,
+    // so the same math works on 16-bit SIMD lanes.
+    struct BoxDivider
+    {
+        explicit BoxDivider(int box)
+            : half((box * 2 + 1) / 2), inv(65536 / (box * 2 + 1))
+        {
+        }
+
+        unsigned char Divide(unsigned int sum) const
+        {
+            return (unsigned char)(((sum + half) * inv) >> 16);
+        }
+
+        unsigned int half;
+        unsigned int inv;
+    };
+
+    void BlurLine(const unsigned char* src, unsigned char* dst, int length, int box)
+    {
+        BoxDivider divider(box);
+        unsigned int sum = 0;
+
+        for (int i = 0; i <= box && i < length; ++i)
+            sum += src[i];
+
+        for (int i = 0; i < length; ++i)
+        {
+            dst[i] = divider.Divide(sum);
+
+            if (i + box + 1 < length)
+                sum += src[i + box + 1];
+            if (i - box >= 0)
+                sum -= src[i - box];
+        }
+    }
+
+    void AddRow(unsigned short* sums, const unsigned char* row, int length)
+    {
+        int i = 0;
+#ifdef PIXELOPS_SSE2
+        __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= length; i += 16)
+        {
+            __m128i pixels = _mm_loadu_si128((const __m128i*)(row + i));
+            __m128i lo = _mm_loadu_si128((const __m128i*)(sums + i));
+            __m128i hi = _mm_loadu_si128((const __m128i*)(sums + i + 8));
+            lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(pixels, zero));
+            hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(pixels, zero));
+            _mm_storeu_si128((__m128i*)(sums + i), lo);
+            _mm_storeu_si128((__m128i*)(sums + i + 8), hi);
+        }
+#endif
+        for (; i < length; ++i)
+            sums[i] = (unsigned short)(sums[i] + row[i]);
+    }
+
+    void SubtractRow(unsigned short* sums, const unsigned char* row, int length)
+    {
+        int i = 0;
+#ifdef PIXELOPS_SSE2
+        __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= length; i += 16)
+        {
+            __m128i pixels = _mm_loadu_si128((const __m128i*)(row + i));
+            __m128i lo = _mm_loadu_si128((const __m128i*)(sums + i));
+            __m128i hi = _mm_loadu_si128((const __m128i*)(sums + i + 8));
+            lo = _mm_sub_epi16(lo, _mm_unpacklo_epi8(pixels, zero));
+            hi = _mm_sub_epi16(hi, _mm_unpackhi_epi8(pixels, zero));
+            _mm_storeu_si128((__m128i*)(sums + i), lo);
+            _mm_storeu_si128((__m128i*)(sums + i + 8), hi);
+        }
+#endif
+        for (; i < length; ++i)
+            sums[i] = (unsigned short)(sums[i] - row[i]);
+    }
+
+    void DivideRow(const unsigned short* sums, unsigned char* row, int length, const BoxDivider& divider)
+    {
+        int i = 0;
+#ifdef PIXELOPS_SSE2
+        __m128i half = _mm_set1_epi16((short)divider.half);
+        __m128i inv = _mm_set1_epi16((short)divider.inv);
+        for (; i + 16 <= length; i += 16)
+        {
+            __m128i lo = _mm_loadu_si128((const __m128i*)(sums + i));
+            __m128i hi = _mm_loadu_si128((const __m128i*)(sums + i + 8));
+            lo = _mm_mulhi_epu16(_mm_add_epi16(lo, half), inv);
+            hi = _mm_mulhi_epu16(_mm_add_epi16(hi, half), inv);
+            _mm_storeu_si128((__m128i*)(row + i), _mm_packus_epi16(lo, hi));
+        }
+#endif
+        for (; i < length; ++i)
+            row[i] = divider.Divide(sums[i]);
+    }
+
+    // One vertical box pass over a size x size image. The running sums
+    // of all columns are kept in one row, so the image is walked row by
+    // row and every step is a vector add.
+    void BlurColumns(const unsigned char* src, unsigned char* dst, int size, int box,
+        unsigned short* sums)
+    {
+        BoxDivider divider(box);
+
+        memset(sums, 0, size * sizeof(unsigned short));
+        for (int y = 0; y <= box && y < size; ++y)
+            AddRow(sums, src + y * size, size);
+
+        for (int y = 0; y < size; ++y)
+        {
+            DivideRow(sums, dst + y * size, size, divider);
+
+            if (y + box + 1 < size)
+                AddRow(sums, src + (y + box + 1) * size, size);
+            if (y - box >= 0)
+                SubtractRow(sums, src + (y - box) * size, size);
+        }
+    }
+
+    void ExtractCorner(const std::vector<unsigned char>& canvas, int size,
+        int left, int top, int cornerSize, int clearLeft, int clearTop, int clearSize,
+        std::vector<unsigned char>* corner)
+    {
+        corner->resize(cornerSize * cornerSize);
+
+        for (int y = 0; y < cornerSize; ++y)
+        {
+            memcpy(&(*corner)[y * cornerSize], &canvas[(top + y) * size + left], cornerSize);
+
+            // The part of the corner that is under the window.
+            if (y >= clearTop && y < clearTop + clearSize)
+                memset(&(*corner)[y * cornerSize + clearLeft], 0, clearSize);
+        }
+    }
+
+} // namespace
+
+namespace ShadowGenerator
+{
+
+int GetShadowSize(const ShadowParams& params)
+{
+    int offset = std::max<int>(abs(params.offsetX), abs(params.offsetY));
+    int size = GetBoxRadius(params.radius) * 3 + std::max<int>(params.spread, 0) + offset;
+    return std::max<int>(size, 1);
+}
+
+void RotateMask(const std::vector<unsigned char>& src, int width, int height,
+    int rotation, std::vector<unsigned char>* dst)
+{
+    dst->resize(width * height);
+    unsigned char* out = dst->empty() ? NULL : &(*dst)[0];
+
+    switch (rotation % 4)
+    {
+    case 0:
+        if (out != NULL)
+            memcpy(out, &src[0], width * height);
+        break;
+    case 1:
+        // Row y of the result is column y of the source, bottom up.
+        for (int y = 0; y < width; ++y)
+            for (int x = 0; x < height; ++x)
+                *out++ = src[(height - 1 - x) * width + y];
+        break;
+    case 2:
+        for (int y = 0; y < height; ++y)
+        {
+            const unsigned char* row = &src[(height - 1 - y) * width];
+            for (int x = 0; x < width; ++x)
+                *out++ = row[width - 1 - x];
+        }
+        break;
+    case 3:
+        // Row y of the result is column (width - 1 - y) of the source.
+        for (int y = 0; y < width; ++y)
+            for (int x = 0; x < height; ++x)
+                *out++ = src[x * width + (width - 1 - y)];
+        break;
+    }
+}
+
+bool Generate(const ShadowParams& params, ShadowMasks* masks)
+{
+    if (params.radius < 1 || params.radius > kMaxShadowRadius ||
+        params.spread < -params.radius || params.spread > params.radius ||
+        params.opacity < 0 || params.opacity > 255 ||
+        abs(params.offsetX) > params.radius || abs(params.offsetY) > params.radius)
+    {
+        return false;
+    }
+
+    // The canvas holds a window of 2 x shadowSize pixels with its shadow
+    // around it. The middle of each side is far enough from the corners
+    // to give the edge profile, and each corner gets as much room along
+    // the window as the shadow is deep.
+    int box = GetBoxRadius(params.radius);
+    int shadowSize = GetShadowSize(params);
+    int cornerSize = shadowSize * 2;
+    int size = cornerSize * 2;
+
+    // The shape that casts the shadow: the window moved by the offset
+    // and grown by the spread.
+    int shapeLeft = shadowSize - params.spread + params.offsetX;
+    int shapeRight = size - shadowSize + params.spread + params.offsetX;
+    int shapeTop = shadowSize - params.spread + params.offsetY;
+    int shapeBottom = size - shadowSize + params.spread + params.offsetY;
+
+    std::vector<unsigned char> canvas(size * size);
+    std::vector<unsigned char> scratch(size * size);
+    std::vector<unsigned short> sums(size);
+
+    // Every row of the shape is the same, so the horizontal passes are
+    // done once and the result is copied.
+    std::vector<unsigned char> row(size);
+    std::vector<unsigned char> rowScratch(size);
+    memset(&row[shapeLeft], params.opacity, shapeRight - shapeLeft);
+    BlurLine(&row[0], &rowScratch[0], size, box);
+    BlurLine(&rowScratch[0], &row[0], size, box);
+    BlurLine(&row[0], &rowScratch[0], size, box);
+
+    for (int y = shapeTop; y < shapeBottom; ++y)
+        memcpy(&canvas[y * size], &rowScratch[0], size);
+
+    BlurColumns(&canvas[0], &scratch[0], size, box, &sums[0]);
+    BlurColumns(&scratch[0], &canvas[0], size, box, &sums[0]);
+    BlurColumns(&canvas[0], &scratch[0], size, box, &sums[0]);
+    canvas.swap(scratch);
+
+    masks->shadow_size = shadowSize;
+    masks->corner_size = cornerSize;
+
+    int far = size - cornerSize;
+    int window = cornerSize - shadowSize;
+    ExtractCorner(canvas, size, 0, 0, cornerSize, shadowSize, shadowSize, window,
+        &masks->corners[CornerNW]);
+    ExtractCorner(canvas, size, far, 0, cornerSize, 0, shadowSize, window,
+        &masks->corners[CornerNE]);
+    ExtractCorner(canvas, size, far, far, cornerSize, 0, 0, window,
+        &masks->corners[CornerSE]);
+    ExtractCorner(canvas, size, 0, far, cornerSize, shadowSize, 0, window,
+        &masks->corners[CornerSW]);
+
+    int middle = size / 2;
+    masks->edges[EdgeN].resize(shadowSize);
+    masks->edges[EdgeS].resize(shadowSize);
+    for (int y = 0; y < shadowSize; ++y)
+    {
+        masks->edges[EdgeN][y] = canvas[y * size + middle];
+        masks->edges[EdgeS][y] = canvas[(size - shadowSize + y) * size + middle];
+    }
+
+    masks->edges[EdgeW].assign(&canvas[middle * size], &canvas[middle * size] + shadowSize);
+    masks->edges[EdgeE].assign(&canvas[middle * size + size - shadowSize],
+        &canvas[middle * size + size]);
+
+    return true;
+}
+
+} // namespace ShadowGenerator
+
+} //namespace MetroWindow
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+
+namespace MetroWindow
+{
+
+// Describes a drop shadow the way a designer would: the blur extent,
+// how much the shadow shape grows before it is blurred, the alpha
+// right under the window and how far the light pushes the shadow.
+struct ShadowParams
+{
+    int radius;     // 1 - kMaxShadowRadius pixels
+    int spread;     // -radius - radius pixels
+    int opacity;    // 0 - 255
+    int offsetX;
+    int offsetY;
+};
+
+static const int kMaxShadowRadius = 96;
+
+enum ShadowCorner
+{
+    CornerNW,
+    CornerNE,
+    CornerSE,
+    CornerSW
+};
+
+enum ShadowEdge
+{
+    EdgeN,
+    EdgeE,
+    EdgeS,
+    EdgeW
+};
+
+// The eight alpha masks of a shadow, row-major and in the orientation
+// they are drawn in. Corners are corner_size x corner_size with the
+// window part cleared. The north and south edges are 1 pixel wide and
+// shadow_size high, the east and west edges shadow_size wide and 1
+// pixel high; they are tiled along the window.
+struct ShadowMasks
+{
+    int shadow_size;
+    int corner_size;
+    std::vector<unsigned char> corners[4];
+    std::vector<unsigned char> edges[4];
+};
+
+namespace ShadowGenerator
+{
+    // Renders the shadow of a window with a separable triple box blur,
+    // which is close enough to a Gaussian for a shadow. Returns false
+    // if the parameters are out of range.
+    bool Generate(const ShadowParams& params, ShadowMasks* masks);
+
+    // The depth of the shadow outside the window for the parameters.
+    int GetShadowSize(const ShadowParams& params);
+
+    // Turns a width x height mask by 'rotation' quarter turns clockwise.
+    // The result is written row by row.
+    void RotateMask(const std::vector<unsigned char>& src, int width, int height,
+        int rotation, std::vector<unsigned char>* dst);
+
+} // namespace ShadowGenerator
+
+} //namespace MetroWindow
@@ -0,0 +1,145 @@
+#include "stdafx.h"
+#include "ShadowRegistry.h"
+
+#include <vector>
+
+namespace MetroWindow
+{
+
+namespace
+{
+    struct Entry
+    {
+        bool use_params;
+        ShadowParams params;
+        DropShadowBitmaps* shadow;
+        int refs;
+    };
+
+    CRITICAL_SECTION lock_;
+    std::vector<Entry> entries_;
+
+    // The parameters are given at 96 dpi.
+    ShadowParams ScaleParams(const ShadowParams& params, int dpi)
+    {
+        ShadowParams scaled = params;
+
+        if (dpi > 0 && dpi != 96)
+        {
+            scaled.radius = ::MulDiv(params.radius, dpi, 96);
+            scaled.spread = ::MulDiv(params.spread, dpi, 96);
+            scaled.offsetX = ::MulDiv(params.offsetX, dpi, 96);
+            scaled.offsetY = ::MulDiv(params.offsetY, dpi, 96);
+
+            if (scaled.radius > kMaxShadowRadius)
+            {
+                // Keep the shape, only smaller.
+                scaled.spread = ::MulDiv(scaled.spread, kMaxShadowRadius, scaled.radius);
+                scaled.offsetX = ::MulDiv(scaled.offsetX, kMaxShadowRadius, scaled.radius);
+                scaled.offsetY = ::MulDiv(scaled.offsetY, kMaxShadowRadius, scaled.radius);
+                scaled.radius = kMaxShadowRadius;
+            }
+        }
+
+        return scaled;
+    }
+
+    bool IsSameParams(const ShadowParams& a, const ShadowParams& b)
+    {
+        return a.radius == b.radius && a.spread == b.spread && a.opacity == b.opacity &&
+            a.offsetX == b.offsetX && a.offsetY == b.offsetY;
+    }
+
+} // namespace
+
+namespace ShadowRegistry
+{
+    void Initialize()
+    {
+        ::InitializeCriticalSection(&lock_);
+    }
+
+    void Uninitialize()
+    {
+        // Frames that were never destroyed.
+        for (size_t i = 0; i < entries_.size(); ++i)
+        {
+            delete entries_[i].shadow;
+        }
+
+        entries_.clear();
+        ::DeleteCriticalSection(&lock_);
+    }
+
+    const DropShadowBitmaps* Acquire(const ShadowParams* params, int dpi)
+    {
+        Entry key;
+        ::ZeroMemory(&key, sizeof(key));
+        key.use_params = (params != NULL);
+        if (params != NULL)
+            key.params = ScaleParams(*params, dpi);
+
+        ::EnterCriticalSection(&lock_);
+
+        const DropShadowBitmaps* shadow = NULL;
+        for (size_t i = 0; i < entries_.size(); ++i)
+        {
+            Entry& entry = entries_[i];
+            if (entry.use_params == key.use_params &&
+                (!key.use_params || IsSameParams(entry.params, key.params)))
+            {
+                ++entry.refs;
+                shadow = entry.shadow;
+                break;
+            }
+        }
+
+        if (shadow == NULL)
+        {
+            // Made under the lock, so that two threads asking for the
+            // same shadow at once get one set.
+            key.shadow = key.use_params ? new DropShadowBitmaps(key.params) : new DropShadowBitmaps();
+            key.shadow->Initialize();
+            key.refs = 1;
+            entries_.push_back(key);
+            shadow = key.shadow;
+        }
+
+        ::LeaveCriticalSection(&lock_);
+        return shadow;
+    }
+
+    void Release(const DropShadowBitmaps* shadow)
+    {
+        if (shadow == NULL)
+            return;
+
+        ::EnterCriticalSection(&lock_);
+
+        for (size_t i = 0; i < entries_.size(); ++i)
+        {
+            if (entries_[i].shadow == shadow)
+            {
+                if (--entries_[i].refs == 0)
+                {
+                    delete entries_[i].shadow;
+                    entries_.erase(entries_.begin() + i);
+                }
+                break;
+            }
+        }
+
+        ::LeaveCriticalSection(&lock_);
+    }
+
+    int GetCount()
+    {
+        ::EnterCriticalSection(&lock_);
+        int count = (int)entries_.size();
+        ::LeaveCriticalSection(&lock_);
+        return count;
+    }
+
+} // namespace ShadowRegistry
+
+} //namespace MetroWindow
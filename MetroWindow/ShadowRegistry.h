@@ -0,0 +1,32 @@
+#pragma once
+
+#include "DropShadowBitmaps.h"
+
+namespace MetroWindow
+{
+
+// The drop shadow masks shared by all frames of the process. A set is
+// made the first time it is asked for and freed when the last frame
+// using it lets it go, so opening and closing frames does not add up.
+// The sets never change once made and can be used from any thread.
+namespace ShadowRegistry
+{
+    // Called from DllMain.
+    void Initialize();
+    void Uninitialize();
+
+    // Returns the shadow for 'params' (NULL for the built-in one) at
+    // 'dpi'. Every call has to be matched by a Release.
+    //
+    // The color is not part of the key, the masks are colored when they
+    // are drawn. The built-in shadow is a fixed bitmap and only comes in
+    // one size, so its dpi is ignored.
+    const DropShadowBitmaps* Acquire(const ShadowParams* params, int dpi);
+    void Release(const DropShadowBitmaps* shadow);
+
+    // The number of shadow sets alive.
+    int GetCount();
+
+} // namespace ShadowRegistry
+
+} //namespace MetroWindow
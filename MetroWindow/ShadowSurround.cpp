@@ -0,0 +1,106 @@
+#include "ShadowSurround.h"
+
+#include <string.h>
+
+namespace MetroWindow
+{
+
+namespace ShadowSurround
+{
+
+int GetSurfaceWidth(int width, int shadowSize)
+{
+    return width + shadowSize * 2;
+}
+
+int GetSurfaceHeight(int height, int shadowSize)
+{
+    return height + shadowSize * 2;
+}
+
+ShadowRect GetStripBounds(ShadowSide side, int width, int height, int shadowSize)
+{
+    int surfaceWidth = GetSurfaceWidth(width, shadowSize);
+    int surfaceHeight = GetSurfaceHeight(height, shadowSize);
+    ShadowRect bounds = { 0, 0, 0, 0 };
+
+    switch (side)
+    {
+        case Left:
+            {
+                ShadowRect left = { 0, shadowSize, shadowSize, shadowSize + height };
+                bounds = left;
+            }
+            break;
+
+        case Top:
+            {
+                ShadowRect top = { 0, 0, surfaceWidth, shadowSize };
+                bounds = top;
+            }
+            break;
+
+        case Right:
+            {
+                ShadowRect right = { shadowSize + width, shadowSize, surfaceWidth, shadowSize + height };
+                bounds = right;
+            }
+            break;
+
+        case Bottom:
+            {
+                ShadowRect bottom = { 0, shadowSize + height, surfaceWidth, surfaceHeight };
+                bounds = bottom;
+            }
+            break;
+    }
+
+    return bounds;
+}
+
+ShadowRect GetInterior(int width, int height, int shadowSize)
+{
+    ShadowRect interior = { shadowSize, shadowSize, shadowSize + width, shadowSize + height };
+    return interior;
+}
+
+int Compose(const ShadowMasks& masks,
+    unsigned char r, unsigned char g, unsigned char b,
+    unsigned char* bits, int stride, int width, int height)
+{
+    static const ShadowSide kSides[] = { Left, Top, Right, Bottom };
+
+    int written = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        ShadowRect strip = GetStripBounds(kSides[i], width, height, masks.shadow_size);
+        written += ShadowCompositor::ComposeSide(masks, r, g, b, kSides[i],
+            bits + strip.top * stride + strip.left * 4, stride,
+            strip.right - strip.left, strip.bottom - strip.top);
+    }
+
+    return written;
+}
+
+int Clear(unsigned char* bits, int stride, int width, int height, int shadowSize)
+{
+    static const ShadowSide kSides[] = { Left, Top, Right, Bottom };
+
+    int written = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        ShadowRect strip = GetStripBounds(kSides[i], width, height, shadowSize);
+        int cx = strip.right - strip.left;
+
+        for (int y = strip.top; y < strip.bottom; ++y)
+            memset(bits + y * stride + strip.left * 4, 0, cx * 4);
+
+        written += cx * (strip.bottom - strip.top);
+    }
+
+    return written;
+}
+
+} // namespace ShadowSurround
+
+} //namespace MetroWindow
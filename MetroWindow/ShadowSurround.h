@@ -0,0 +1,45 @@
+#pragma once
+
+#include "ShadowCompositor.h"
+
+namespace MetroWindow
+{
+
+struct ShadowRect
+{
+    int left;
+    int top;
+    int right;
+    int bottom;
+};
+
+// The layout of a drop shadow drawn as one surface around the window
+// instead of four strips. The surface is the window grown by the shadow
+// size on every side, the four strips sit along its border the way the
+// strip windows sit around the window, and the inside is transparent.
+namespace ShadowSurround
+{
+    int GetSurfaceWidth(int width, int shadowSize);
+    int GetSurfaceHeight(int height, int shadowSize);
+
+    // Where the strip of 'side' of a width x height window is in the
+    // surface.
+    ShadowRect GetStripBounds(ShadowSide side, int width, int height, int shadowSize);
+
+    // The part of the surface that is under the window.
+    ShadowRect GetInterior(int width, int height, int shadowSize);
+
+    // Draws the four strips into a top-down 32-bit surface with rows
+    // 'stride' bytes apart. The inside is not touched and has to be
+    // cleared already. Returns the number of pixels written.
+    int Compose(const ShadowMasks& masks,
+        unsigned char r, unsigned char g, unsigned char b,
+        unsigned char* bits, int stride, int width, int height);
+
+    // Clears the strips of a width x height window, so that the surface
+    // can be used for another size. Returns the number of pixels written.
+    int Clear(unsigned char* bits, int stride, int width, int height, int shadowSize);
+
+} // namespace ShadowSurround
+
+} //namespace MetroWindow
@@ -0,0 +1,44 @@
+#include "ShadowTracker.h"
+
+namespace MetroWindow
+{
+
+ShadowTracker::ShadowTracker(void)
+    : valid_(false)
+{
+    last_.left = 0;
+    last_.top = 0;
+    last_.width = 0;
+    last_.height = 0;
+    last_.color = 0;
+}
+
+ShadowAction ShadowTracker::Update(const ShadowPlacement& placement, bool force)
+{
+    ShadowAction action;
+
+    if (!valid_ || force || placement.width != last_.width ||
+        placement.height != last_.height || placement.color != last_.color)
+    {
+        action = ShadowChanged;
+    }
+    else if (placement.left != last_.left || placement.top != last_.top)
+    {
+        action = ShadowMoved;
+    }
+    else
+    {
+        action = ShadowUnchanged;
+    }
+
+    last_ = placement;
+    valid_ = true;
+    return action;
+}
+
+void ShadowTracker::Reset()
+{
+    valid_ = false;
+}
+
+} //namespace MetroWindow
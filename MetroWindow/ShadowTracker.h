@@ -0,0 +1,42 @@
+#pragma once
+
+namespace MetroWindow
+{
+
+// Where a drop shadow was last shown and how it looked.
+struct ShadowPlacement
+{
+    int left;
+    int top;
+    int width;
+    int height;
+    unsigned long color;
+};
+
+enum ShadowAction
+{
+    ShadowUnchanged,    // nothing to do
+    ShadowMoved,        // same pixels at another place
+    ShadowChanged       // the shadow has to be drawn again
+};
+
+// Tells a pure move of the owner window, which only has to reposition
+// the shadow windows, from a change that needs their pixels redrawn.
+class ShadowTracker
+{
+public:
+    ShadowTracker(void);
+
+    // Compares 'placement' with the last one and remembers it.
+    ShadowAction Update(const ShadowPlacement& placement, bool force);
+
+    // Forgets the last placement, the next update is a change. Called
+    // when the shadow is hidden.
+    void Reset();
+
+private:
+    ShadowPlacement last_;
+    bool valid_;
+};
+
+} //namespace MetroWindow
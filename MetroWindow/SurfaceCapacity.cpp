@@ -0,0 +1,60 @@
+#include "SurfaceCapacity.h"
+
+#include <algorithm>
+
+namespace MetroWindow
+{
+
+namespace SurfaceCapacity
+{
+
+int RoundUp(int length)
+{
+    int step = (length > 1024) ? 256 : 64;
+    return (length + step - 1) / step * step;
+}
+
+bool Grow(int* capacityWidth, int* capacityHeight, int width, int height)
+{
+    if (width <= *capacityWidth && height <= *capacityHeight)
+        return false;
+
+    *capacityWidth = std::max<int>(RoundUp(width), *capacityWidth);
+    *capacityHeight = std::max<int>(RoundUp(height), *capacityHeight);
+    return true;
+}
+
+Update PlanStripUpdate(const Strip& strip, int width, int height,
+    bool horizontal, int farExtent, bool force)
+{
+    Update update;
+    update.reallocate = false;
+    update.capacity_width = strip.capacity_width;
+    update.capacity_height = strip.capacity_height;
+    update.redraw_from = -1;
+
+    if (!strip.allocated || width > strip.capacity_width || height > strip.capacity_height)
+    {
+        update.reallocate = true;
+        update.capacity_width = std::max<int>(RoundUp(width), strip.allocated ? strip.capacity_width : 0);
+        update.capacity_height = std::max<int>(RoundUp(height), strip.allocated ? strip.capacity_height : 0);
+        update.redraw_from = 0;
+        return update;
+    }
+
+    int oldLength = horizontal ? strip.width : strip.height;
+    int newLength = horizontal ? width : height;
+    int oldDepth = horizontal ? strip.height : strip.width;
+    int newDepth = horizontal ? height : width;
+
+    if (force || oldDepth != newDepth)
+        update.redraw_from = 0;
+    else if (oldLength != newLength)
+        update.redraw_from = std::max<int>(std::min<int>(oldLength, newLength) - farExtent, 0);
+
+    return update;
+}
+
+} // namespace SurfaceCapacity
+
+} //namespace MetroWindow
@@ -0,0 +1,46 @@
+#pragma once
+
+namespace MetroWindow
+{
+
+// Decides when a retained drawing surface has to be reallocated or
+// redrawn. The surface is allocated with some slack and never shrinks,
+// so moving or resizing a window a little costs no allocation and only
+// the pixels that changed are drawn again.
+namespace SurfaceCapacity
+{
+    // Rounds a length up to 64 pixels, or to 256 above 1024 pixels.
+    int RoundUp(int length);
+
+    // Grows a capacity of *capacityWidth x *capacityHeight, which is
+    // 0 x 0 before the first allocation, so that it holds width x height.
+    // Returns false if it already did and nothing has to be allocated.
+    bool Grow(int* capacityWidth, int* capacityHeight, int width, int height);
+
+    struct Strip
+    {
+        int capacity_width;
+        int capacity_height;
+        int width;
+        int height;
+        bool allocated;
+    };
+
+    struct Update
+    {
+        bool reallocate;
+        int capacity_width;
+        int capacity_height;
+        int redraw_from;    // first column (row) to draw, -1 for none
+    };
+
+    // Plans the update of a strip that runs along x ('horizontal') or y.
+    // Along the strip everything up to 'farExtent' pixels before its end
+    // depends only on where it starts, so when just the length changes
+    // only the far end and what was newly exposed are drawn.
+    Update PlanStripUpdate(const Strip& strip, int width, int height,
+        bool horizontal, int farExtent, bool force);
+
+} // namespace SurfaceCapacity
+
+} //namespace MetroWindow
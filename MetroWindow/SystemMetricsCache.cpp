@@ -0,0 +1,115 @@
+#include "stdafx.h"
+#include "SystemMetricsCache.h"
+
+namespace MetroWindow
+{
+
+namespace
+{
+    CRITICAL_SECTION lock_;
+    SystemMetrics metrics_[2];
+    SystemMetrics* volatile current_ = NULL;
+    volatile LONG refreshes_ = 0;
+
+    SIZE GetSize(int cx, int cy)
+    {
+        SIZE size = { ::GetSystemMetrics(cx), ::GetSystemMetrics(cy) };
+        return size;
+    }
+
+    void Read(SystemMetrics* metrics)
+    {
+        metrics->border = GetSize(SM_CXBORDER, SM_CYBORDER);
+        metrics->edge = GetSize(SM_CXEDGE, SM_CYEDGE);
+        metrics->frame = GetSize(SM_CXFRAME, SM_CYFRAME);
+        metrics->fixed_frame = GetSize(SM_CXFIXEDFRAME, SM_CYFIXEDFRAME);
+        metrics->dialog_frame = GetSize(SM_CXDLGFRAME, SM_CYDLGFRAME);
+        metrics->caption_button = GetSize(SM_CXSIZE, SM_CYSIZE);
+        metrics->small_caption_button = GetSize(SM_CXSMSIZE, SM_CYSMSIZE);
+        metrics->small_icon = GetSize(SM_CXSMICON, SM_CYSMICON);
+        metrics->caption_height = ::GetSystemMetrics(SM_CYCAPTION);
+        metrics->small_caption_height = ::GetSystemMetrics(SM_CYSMCAPTION);
+
+        metrics->border_factor = 0;
+        ::SystemParametersInfo(SPI_GETBORDER, 0, &metrics->border_factor, 0);
+
+        OSVERSIONINFO ovi = { sizeof(OSVERSIONINFO) };
+        BOOL bRet = ::GetVersionEx(&ovi);
+        metrics->os_major_version = (bRet != FALSE) ? ovi.dwMajorVersion : 0;
+        metrics->os_minor_version = (bRet != FALSE) ? ovi.dwMinorVersion : 0;
+        metrics->is_vista = metrics->os_major_version >= 6;
+    }
+
+    bool IsSameSize(const SIZE& a, const SIZE& b)
+    {
+        return a.cx == b.cx && a.cy == b.cy;
+    }
+
+    bool IsSameMetrics(const SystemMetrics& a, const SystemMetrics& b)
+    {
+        return IsSameSize(a.border, b.border) && IsSameSize(a.edge, b.edge) &&
+            IsSameSize(a.frame, b.frame) && IsSameSize(a.fixed_frame, b.fixed_frame) &&
+            IsSameSize(a.dialog_frame, b.dialog_frame) && IsSameSize(a.caption_button, b.caption_button) &&
+            IsSameSize(a.small_caption_button, b.small_caption_button) &&
+            IsSameSize(a.small_icon, b.small_icon) &&
+            a.caption_height == b.caption_height && a.small_caption_height == b.small_caption_height &&
+            a.border_factor == b.border_factor && a.os_major_version == b.os_major_version &&
+            a.os_minor_version == b.os_minor_version && a.is_vista == b.is_vista;
+    }
+
+} // namespace
+
+namespace SystemMetricsCache
+{
+    void Initialize()
+    {
+        ::InitializeCriticalSection(&lock_);
+    }
+
+    void Uninitialize()
+    {
+        current_ = NULL;
+        ::DeleteCriticalSection(&lock_);
+    }
+
+    const SystemMetrics& Get()
+    {
+        SystemMetrics* current = current_;
+        if (current == NULL)
+        {
+            Refresh();
+            current = current_;
+        }
+
+        return *current;
+    }
+
+    bool Refresh()
+    {
+        ::EnterCriticalSection(&lock_);
+
+        // Every frame refreshes on the same broadcast; only the first
+        // one that sees new values switches the copies.
+        SystemMetrics* current = current_;
+        SystemMetrics* next = (current == &metrics_[0]) ? &metrics_[1] : &metrics_[0];
+        Read(next);
+
+        bool changed = (current == NULL || !IsSameMetrics(*current, *next));
+        if (changed)
+        {
+            ::InterlockedExchangePointer(reinterpret_cast<PVOID volatile*>(&current_), next);
+            ::InterlockedIncrement(&refreshes_);
+        }
+
+        ::LeaveCriticalSection(&lock_);
+        return changed;
+    }
+
+    long GetRefreshCount()
+    {
+        return refreshes_;
+    }
+
+} // namespace SystemMetricsCache
+
+} //namespace MetroWindow
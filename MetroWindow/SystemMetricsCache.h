@@ -0,0 +1,51 @@
+#pragma once
+
+namespace MetroWindow
+{
+
+// The system metrics the frames are laid out with, read together.
+struct SystemMetrics
+{
+    SIZE border;                    // SM_CXBORDER, SM_CYBORDER
+    SIZE edge;                      // SM_CXEDGE, SM_CYEDGE
+    SIZE frame;                     // SM_CXFRAME, SM_CYFRAME
+    SIZE fixed_frame;               // SM_CXFIXEDFRAME, SM_CYFIXEDFRAME
+    SIZE dialog_frame;              // SM_CXDLGFRAME, SM_CYDLGFRAME
+    SIZE caption_button;            // SM_CXSIZE, SM_CYSIZE
+    SIZE small_caption_button;      // SM_CXSMSIZE, SM_CYSMSIZE
+    SIZE small_icon;                // SM_CXSMICON, SM_CYSMICON
+    int caption_height;             // SM_CYCAPTION
+    int small_caption_height;       // SM_CYSMCAPTION
+    int border_factor;              // SPI_GETBORDER
+    DWORD os_major_version;
+    DWORD os_minor_version;
+    bool is_vista;                  // Vista or later
+};
+
+// One copy of the system metrics for the whole process, so painting and
+// hit testing do not ask the system for each of them every time.
+//
+// There are two copies. Refresh fills the one not in use and then
+// switches to it, so readers never see half an update. A reference from
+// Get stays valid until the second Refresh after it that finds new
+// values; take what is needed from it rather than holding on to it.
+namespace SystemMetricsCache
+{
+    // Called from DllMain.
+    void Initialize();
+    void Uninitialize();
+
+    // Reads the metrics the first time it is called.
+    const SystemMetrics& Get();
+
+    // Reads the metrics again. Frames call it when the settings, the
+    // dpi or the display change. Returns false, and keeps the copy in
+    // use, when nothing has changed.
+    bool Refresh();
+
+    // The number of times the metrics were read and found changed.
+    long GetRefreshCount();
+
+} // namespace SystemMetricsCache
+
+} //namespace MetroWindow
@@ -0,0 +1,137 @@
+#include "stdafx.h"
+#include "TitleCache.h"
+
+namespace MetroWindow
+{
+
+namespace
+{
+    // FNV-1a, so most entries are told apart without comparing text.
+    unsigned long HashTitle(LPCWSTR title)
+    {
+        unsigned long hash = 2166136261UL;
+        for (; *title != L'\0'; ++title)
+        {
+            hash ^= (unsigned long)*title;
+            hash *= 16777619UL;
+        }
+        return hash;
+    }
+
+    bool IsSameKey(const TitleKey& a, const TitleKey& b)
+    {
+        return a.font == b.font && a.text_color == b.text_color && a.back_color == b.back_color &&
+            a.width == b.width && a.height == b.height && a.glow_size == b.glow_size;
+    }
+
+    bool IsSameKeyAnyWidth(const TitleKey& a, const TitleKey& b)
+    {
+        return a.font == b.font && a.text_color == b.text_color && a.back_color == b.back_color &&
+            a.height == b.height;
+    }
+
+} // namespace
+
+CTitleCache::CTitleCache(void)
+    : clock_(0)
+{
+    for (int i = 0; i < kMaxEntries; ++i)
+    {
+        entries_[i].valid = false;
+        entries_[i].last_use = 0;
+    }
+
+    stats_.hits = 0;
+    stats_.misses = 0;
+}
+
+CTitleCache::~CTitleCache(void)
+{
+}
+
+HDC CTitleCache::Find(LPCWSTR title, const TitleKey& key)
+{
+    unsigned long hash = HashTitle(title);
+
+    for (int i = 0; i < kMaxEntries; ++i)
+    {
+        Entry& entry = entries_[i];
+        if (entry.valid && entry.hash == hash && IsSameKey(entry.key, key) &&
+            entry.title == title)
+        {
+            entry.last_use = ++clock_;
+            ++stats_.hits;
+            return buffers_[i].GetDC();
+        }
+    }
+
+    ++stats_.misses;
+    return NULL;
+}
+
+HDC CTitleCache::FindAnyWidth(LPCWSTR title, const TitleKey& key, int* width)
+{
+    unsigned long hash = HashTitle(title);
+
+    int found = -1;
+    for (int i = 0; i < kMaxEntries; ++i)
+    {
+        const Entry& entry = entries_[i];
+        if (entry.valid && entry.hash == hash && IsSameKeyAnyWidth(entry.key, key) &&
+            entry.title == title && (found < 0 || entry.last_use > entries_[found].last_use))
+        {
+            found = i;
+        }
+    }
+
+    if (found < 0)
+    {
+        ++stats_.misses;
+        return NULL;
+    }
+
+    entries_[found].last_use = ++clock_;
+    ++stats_.hits;
+    *width = entries_[found].key.width;
+    return buffers_[found].GetDC();
+}
+
+HDC CTitleCache::Add(LPCWSTR title, const TitleKey& key)
+{
+    int oldest = 0;
+    for (int i = 1; i < kMaxEntries; ++i)
+    {
+        if (!entries_[i].valid ||
+            (entries_[oldest].valid && entries_[i].last_use < entries_[oldest].last_use))
+        {
+            oldest = i;
+        }
+    }
+
+    Entry& entry = entries_[oldest];
+    entry.valid = false;
+
+    // The bitmap is kept and only grows, like the frame's back buffer.
+    HDC hdc = buffers_[oldest].Prepare(key.width, key.height);
+    if (hdc == NULL)
+        return NULL;
+
+    entry.valid = true;
+    entry.hash = HashTitle(title);
+    entry.title = title;
+    entry.key = key;
+    entry.last_use = ++clock_;
+
+    return hdc;
+}
+
+void CTitleCache::Clear()
+{
+    for (int i = 0; i < kMaxEntries; ++i)
+    {
+        entries_[i].valid = false;
+        buffers_[i].Release();
+    }
+}
+
+} //namespace MetroWindow
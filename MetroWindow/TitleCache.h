@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+
+#include "FrameBuffer.h"
+
+namespace MetroWindow
+{
+
+struct TitleCacheStats
+{
+    unsigned long hits;     // titles blitted from the cache
+    unsigned long misses;   // titles drawn again
+};
+
+// Everything besides the text that a drawn title depends on.
+struct TitleKey
+{
+    HFONT font;
+    COLORREF text_color;
+    COLORREF back_color;
+    int width;
+    int height;
+    int glow_size;
+};
+
+// The caption titles a frame has drawn with DrawThemeTextEx, so that a
+// repaint that leaves the title as it is can blit it instead of drawing
+// glowing text again. Two titles are kept, enough for the active and
+// the inactive caption of one frame.
+class CTitleCache
+{
+public:
+    static const int kMaxEntries = 2;
+
+    CTitleCache(void);
+    ~CTitleCache(void);
+
+    // The DC holding 'title' as drawn with 'key', at (0, 0). Returns NULL
+    // if it has to be drawn.
+    HDC Find(LPCWSTR title, const TitleKey& key);
+
+    // Like Find, but takes 'title' drawn at any width and with any glow,
+    // the last one used first, and returns its width in 'width'. For when
+    // the width changes too often to draw the title for each.
+    HDC FindAnyWidth(LPCWSTR title, const TitleKey& key, int* width);
+
+    // Makes room for 'title' in place of the one used longest ago and
+    // returns the DC to draw it in at (0, 0), or NULL if the bitmap could
+    // not be created. What is drawn is returned by Find from then on.
+    HDC Add(LPCWSTR title, const TitleKey& key);
+
+    // Forgets all titles and frees their bitmaps.
+    void Clear();
+
+    const TitleCacheStats& GetStats() const { return stats_; }
+
+private:
+    struct Entry
+    {
+        bool valid;
+        unsigned long hash;
+        std::wstring title;
+        TitleKey key;
+        unsigned long last_use;
+    };
+
+    Entry entries_[kMaxEntries];
+    CFrameBuffer buffers_[kMaxEntries];
+    unsigned long clock_;
+    TitleCacheStats stats_;
+};
+
+} //namespace MetroWindow
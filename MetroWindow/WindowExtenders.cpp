@@ -44,15 +44,15 @@ namespace WindowExtenders
 
     CSize GetBorderSize(HWND hWnd, bool dwmEnabled)
     {
+        const SystemMetrics& metrics = SystemMetricsCache::Get();
+
         // Check for Caption
         DWORD dwStyle = ::GetWindowLong(hWnd, GWL_STYLE);
         bool caption = (dwStyle & WS_CAPTION) != 0;
         DWORD dwExStyle = ::GetWindowLong(hWnd, GWL_EXSTYLE);
 
         // Get BorderMultiplierFactor
-        int bmfactor = 0;
-        ::SystemParametersInfo(SPI_GETBORDER, 0, &bmfactor, 0);
-        int factor = bmfactor - 1;
+        int factor = metrics.border_factor - 1;
 
         CSize border;
         if ((dwExStyle & WS_EX_CLIENTEDGE) != 0)
@@ -66,12 +66,12 @@ namespace WindowExtenders
             if ((dwExStyle & WS_EX_DLGMODALFRAME) != 0)
             {
                 // Dialog with WS_EX_DLGMODALFRAME has double border
-                int cx = ::GetSystemMetrics(SM_CXDLGFRAME);
-                int cy = ::GetSystemMetrics(SM_CYDLGFRAME);
+                int cx = metrics.dialog_frame.cx;
+                int cy = metrics.dialog_frame.cy;
                 border.SetSize(cx + cx, cy + cy);
             }
             // Sizable or SizableToolWindow
-            else if (IsVista())
+            else if (metrics.is_vista)
                 border = GetFrameBorderSize();
             else
                 border = GetFixedFrameBorderSize() +
@@ -102,9 +102,62 @@ namespace WindowExtenders
     int GetCaptionHeight(HWND hWnd)
     {
         DWORD dwExStyle = ::GetWindowLong(hWnd, GWL_EXSTYLE);
+        const SystemMetrics& metrics = SystemMetricsCache::Get();
         return ((dwExStyle & WS_EX_TOOLWINDOW) == WS_EX_TOOLWINDOW)
-            ? ::GetSystemMetrics(SM_CYSMCAPTION)
-            : ::GetSystemMetrics(SM_CYCAPTION);
+            ? metrics.small_caption_height
+            : metrics.caption_height;
+    }
+
+    UINT_PTR SetCoalescedTimer(HWND hWnd, UINT_PTR id, UINT elapse, TIMERPROC proc, ULONG tolerance)
+    {
+        typedef UINT_PTR (__stdcall *fnSetCoalescableTimer)(HWND, UINT_PTR, UINT, TIMERPROC, ULONG);
+
+        // Looked up once, every thread would find the same address.
+        static fnSetCoalescableTimer pfnSetCoalescableTimer = NULL;
+        static volatile LONG looked_up = 0;
+
+        if (looked_up == 0)
+        {
+            HMODULE hUser32 = ::GetModuleHandleW(L"user32.dll");
+            if (hUser32 != NULL)
+            {
+                pfnSetCoalescableTimer = reinterpret_cast<fnSetCoalescableTimer>(
+                    ::GetProcAddress(hUser32, "SetCoalescableTimer"));
+            }
+            ::InterlockedExchange(&looked_up, 1);
+        }
+
+        if (pfnSetCoalescableTimer != NULL)
+            return pfnSetCoalescableTimer(hWnd, id, elapse, proc, tolerance);
+        else
+            return ::SetTimer(hWnd, id, elapse, proc);
+    }
+
+    UINT GetFrameInterval()
+    {
+        HDC hdc = ::GetDC(NULL);
+        int refresh = ::GetDeviceCaps(hdc, VREFRESH);
+        ::ReleaseDC(NULL, hdc);
+
+        // 0 and 1 mean the hardware default.
+        if (refresh <= 1)
+            refresh = 60;
+
+        return (1000 + refresh - 1) / refresh;
+    }
+
+    LONGLONG GetTicks()
+    {
+        LARGE_INTEGER ticks;
+        ::QueryPerformanceCounter(&ticks);
+        return ticks.QuadPart;
+    }
+
+    ULONGLONG TicksToNanoseconds(LONGLONG ticks)
+    {
+        LARGE_INTEGER frequency;
+        ::QueryPerformanceFrequency(&frequency);
+        return (ULONGLONG)ticks * 1000000000 / (ULONGLONG)frequency.QuadPart;
     }
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "MiscWapppers.h"
+#include "SystemMetricsCache.h"
 
 namespace MetroWindow
 {
@@ -9,9 +10,7 @@ namespace WindowExtenders
 {
     inline bool IsVista()
     {
-        OSVERSIONINFO ovi = { sizeof(OSVERSIONINFO) };
-        BOOL bRet = ::GetVersionEx(&ovi);
-        return ((bRet != FALSE) && (ovi.dwMajorVersion >= 6));
+        return SystemMetricsCache::Get().is_vista;
     }
 
     inline bool HasSysMenu(HWND hWnd)
@@ -29,37 +28,37 @@ namespace WindowExtenders
 
     inline CSize GetBorderSize()
     {
-        return CSize(::GetSystemMetrics(SM_CXBORDER), ::GetSystemMetrics(SM_CYBORDER));
+        return CSize(SystemMetricsCache::Get().border);
     }
 
     inline CSize GetBorder3DSize()
     {
-        return CSize(::GetSystemMetrics(SM_CXEDGE), ::GetSystemMetrics(SM_CYEDGE));
+        return CSize(SystemMetricsCache::Get().edge);
     }
 
     inline CSize GetFrameBorderSize()
     {
-        return CSize(::GetSystemMetrics(SM_CXFRAME), ::GetSystemMetrics(SM_CYFRAME));
+        return CSize(SystemMetricsCache::Get().frame);
     }
 
     inline CSize GetFixedFrameBorderSize()
     {
-        return CSize(::GetSystemMetrics(SM_CXFIXEDFRAME), ::GetSystemMetrics(SM_CYFIXEDFRAME));
+        return CSize(SystemMetricsCache::Get().fixed_frame);
     }
 
     inline CSize GetCaptionButtonSize()
     {
-        return CSize(::GetSystemMetrics(SM_CXSIZE), ::GetSystemMetrics(SM_CYSIZE));
+        return CSize(SystemMetricsCache::Get().caption_button);
     }
 
     inline CSize GetToolWindowCaptionButtonSize()
     {
-        return CSize(::GetSystemMetrics(SM_CXSMSIZE), ::GetSystemMetrics(SM_CYSMSIZE));
+        return CSize(SystemMetricsCache::Get().small_caption_button);
     }
 
     inline CSize GetSmallIconSize()
     {
-        return CSize(::GetSystemMetrics(SM_CXSMICON), ::GetSystemMetrics(SM_CYSMICON));
+        return CSize(SystemMetricsCache::Get().small_icon);
     }
 
     bool IsDrawMaximizeBox(HWND hWnd);
@@ -70,6 +69,19 @@ namespace WindowExtenders
     CSize GetCaptionButtonSize(HWND hWnd);
 
     int GetCaptionHeight(HWND hWnd);
+
+    // A timer the system may line up with other timers to save wake-ups.
+    // Uses SetCoalescableTimer where there is one (Windows 8 and later),
+    // else SetTimer.
+    UINT_PTR SetCoalescedTimer(HWND hWnd, UINT_PTR id, UINT elapse, TIMERPROC proc, ULONG tolerance);
+
+    // About one frame of the display, for animations.
+    UINT GetFrameInterval();
+
+    // The performance counter, and a span of it in nanoseconds. For the
+    // short spans of one paint or update, which cannot overflow.
+    LONGLONG GetTicks();
+    ULONGLONG TicksToNanoseconds(LONGLONG ticks);
 };
 
 }; //namespace MetroWindow
@@ -3,6 +3,8 @@
 #include "MetroCaptionTheme.h"
 #include "UxThemeApi.h"
 #include "DwmApi.h"
+#include "ShadowRegistry.h"
+#include "SystemMetricsCache.h"
 
 BOOL APIENTRY DllMain( HMODULE hModule,
                        DWORD  ul_reason_for_call,
@@ -12,8 +14,10 @@ BOOL APIENTRY DllMain( HMODULE hModule,
     switch (ul_reason_for_call)
     {
     case DLL_PROCESS_ATTACH:
+        MetroWindow::SystemMetricsCache::Initialize();
         MetroWindow::UxThemeApi::LoadUxThemeApi();
         MetroWindow::DwmApi::LoadDwmApi();
+        MetroWindow::ShadowRegistry::Initialize();
         MetroWindow::CMetroCaptionTheme::LoadBitmapFromResource(hModule);
         break;
     case DLL_THREAD_ATTACH:
@@ -21,8 +25,10 @@ BOOL APIENTRY DllMain( HMODULE hModule,
         break;
     case DLL_PROCESS_DETACH:
         MetroWindow::CMetroCaptionTheme::FreeResources();
+        MetroWindow::ShadowRegistry::Uninitialize();
         MetroWindow::DwmApi::UnloadDwmApi();
         MetroWindow::UxThemeApi::UnloadUxThemeApi();
+        MetroWindow::SystemMetricsCache::Uninitialize();
         break;
     }
     return TRUE;
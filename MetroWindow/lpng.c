@@ -19,20 +19,62 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include <windows.h>
 
 #include "puff.h"
 #include "lpng.h"
 
 /*
- *	The following constant limits the maximum size of a PNG 
- *	image. Larger images are not loaded. 
+ *	The following constants are the default decode budget. Images
+ *	with more pixels, or whose compressed plus inflated data needs
+ *	more memory, are not loaded. See lpng_set_limits() in lpng.h.
  *
- *	The limit is arbitrary and can be increased as needed.
- *	It exists solely to prevent the accidental loading of 
- *	very large images.
+ *	The limits are arbitrary and can be increased as needed. They
+ *	exist to stop a malformed or hostile file (a theme pack asset,
+ *	say) from making the loader allocate an arbitrary amount of
+ *	memory.
  */
-#define MAX_IDAT_SIZE (128*1024)
+#define DEFAULT_MAX_PIXELS (4096UL*4096UL)
+#define DEFAULT_MAX_BYTES  (64UL*1024*1024)
+
+/*
+ *	Deflate cannot expand data by more than this ratio, so an image
+ *	whose IDAT data is too short to inflate to the expected size is
+ *	rejected before the pixel buffer is allocated.
+ */
+#define MAX_DEFLATE_RATIO 1032
+
+/*
+ *	The largest chunk length allowed by the PNG spec.
+ */
+#define MAX_CHUNK_SIZE 0x7fffffffUL
+
+/*
+ *	IDAT data is read in pieces of this size.
+ */
+#define READ_STEP (64*1024)
+
+/*
+ *	Parallel conversion, see lpng_set_threads() in lpng.h. Rows
+ *	are handed to the workers in bands of about BAND_PIXELS.
+ */
+#define DEFAULT_MIN_PARALLEL (1024UL*1024UL)
+#define BAND_PIXELS          (64UL*1024UL)
+#define MAX_THREADS          16
+
+/*
+ *	Linear light premultiplication works on LINEAR_BITS precision
+ *	values, see BuildLut().
+ */
+#define LINEAR_BITS 12
+#define LINEAR_MAX  ((1 << LINEAR_BITS) - 1)
+
+/*
+ *	lpng_probe() gives up looking for pHYs and acTL after this
+ *	many chunks.
+ */
+#define MAX_PROBE_CHUNKS 32
 
 /*
  *
@@ -43,12 +85,15 @@ typedef unsigned char  uchar;
 typedef unsigned long  ulong;
 typedef struct _png    png_t;
 typedef struct _buf    buf_t;
+typedef struct _job    job_t;
+typedef struct _lut    lut_t;
 
 struct _png
 {
     ulong w;
     ulong h;
     uchar bpp; /* 3 - truecolor, 4 - truecolor + alpha */
+    ulong gamma; /* gAMA value, 0 - sRGB */
     uchar pix[1];
 };
 
@@ -58,8 +103,45 @@ struct _buf
     ulong   len;
 };
 
+/*
+ *	Tables for premultiplying in linear light: 'dec' takes an
+ *	encoded component to linear, 'enc' takes it back.
+ */
+struct _lut
+{
+    unsigned short dec[256];
+    uchar          enc[LINEAR_MAX + 1];
+};
+
+/*
+ *	The state shared by the conversion workers. The thread that
+ *	unfilters the image releases 'ready' once per finished band,
+ *	so a worker that got past the wait can take the next band
+ *	and be sure it is complete.
+ */
+struct _job
+{
+    png_t * png;
+    uchar * dib;
+    BOOL    premultiply;
+    const lut_t * lut;
+    ulong   band_rows;
+    volatile LONG bands;
+    volatile LONG next;
+    HANDLE  ready;
+};
+
 typedef int (* read_cb)(uchar * buf, ulong len, void * arg);
 
+static ulong max_pixels = DEFAULT_MAX_PIXELS;
+static ulong max_bytes  = DEFAULT_MAX_BYTES;
+
+static lut_t srgb_lut;
+static volatile LONG srgb_lut_ready;
+
+static int   par_threads = 1;
+static ulong par_min_pixels = DEFAULT_MIN_PARALLEL;
+
 //
 static __inline ulong get_ulong(uchar * v)
 {
@@ -69,6 +151,15 @@ static __inline ulong get_ulong(uchar * v)
     return (r << 8) | v[3];
 }
 
+/* r = a * b, fails instead of wrapping around */
+static __inline int mul_ulong(ulong a, ulong b, ulong * r)
+{
+    if (b != 0 && a > (ulong)-1 / b)
+        return 0;
+    *r = a * b;
+    return 1;
+}
+
 static __inline uchar paeth(uchar a, uchar b, uchar c)
 {
     int p = a + b - c;
@@ -88,15 +179,16 @@ static png_t * LoadPngEx(read_cb read, void * read_arg)
     png_t * png = NULL;
 
     uchar buf[64];
-    ulong w, h, i, j;
+    ulong w, h;
     uchar bpp;
     ulong len;
     uchar * tmp, * dat = 0;
-    ulong dat_max, dat_len;
+    ulong dat_max, dat_len, n;
     ulong png_max, png_len;
     ulong out_len;
+    ulong gamma = 0;
+    int   srgb = 0;
     int   r;
-    uchar * line, * prev;
 
     /* sig and IHDR */
     if (! read(buf, 8 + 8 + 13 + 4, read_arg))
@@ -115,6 +207,9 @@ static png_t * LoadPngEx(read_cb read, void * read_arg)
     w = get_ulong(buf+16);
     h = get_ulong(buf+20);
 
+    if (w == 0 || h == 0 || w > MAX_CHUNK_SIZE || h > MAX_CHUNK_SIZE)
+        return NULL;
+
     if (buf[24] != 8)
         return NULL;
 
@@ -128,14 +223,41 @@ static png_t * LoadPngEx(read_cb read, void * read_arg)
     if (buf[26] != 0 || buf[27] != 0 || buf[28] != 0)
         return NULL;
 
-    /* IDAT */
+    /*
+     *	see comment at the top of this file, the size of the
+     *	inflated data is (w * bpp + 1) * h and must not wrap
+     */
+    if (w > max_pixels / h)
+        return NULL;
+
+    if (! mul_ulong(w, bpp, &len) || len + 1 < len ||
+        ! mul_ulong(len + 1, h, &png_max) || png_max > max_bytes)
+        return NULL;
+
+    /* IDAT, the chunks are parts of a single zlib stream */
     dat_max = 0;
+    dat_len = 0;
     for (;;)
     {
         if (! read(buf, 8, read_arg))
             goto err;
 
         len = get_ulong(buf);
+        if (len > MAX_CHUNK_SIZE)
+            goto err;
+
+        if (memcmp(buf+4, "gAMA", 4) == 0 && len == 4)
+        {
+            if (! read(buf, 4+4, read_arg))
+                goto err;
+
+            gamma = get_ulong(buf);
+            continue;
+        }
+
+        if (memcmp(buf+4, "sRGB", 4) == 0)
+            srgb = 1;
+
         if (memcmp(buf+4, "IDAT", 4) != 0)
         {
             if (! read(0, len+4, read_arg))
@@ -147,59 +269,96 @@ static png_t * LoadPngEx(read_cb read, void * read_arg)
             continue;
         }
 
-        /*
-        *	see comment at the top of this file
-        */
-        if (len > MAX_IDAT_SIZE)
+        /* compressed and inflated data share the budget */
+        if (len > max_bytes - png_max - dat_len)
             goto err;
 
-        if (len+4 > dat_max)
+        /*
+         *	read in steps, so that a bogus chunk length costs no
+         *	more memory than the data that is actually there
+         */
+        while (len > 0)
         {
-            dat_max = len+4;
-            tmp = realloc(dat, dat_max);
-            if (! tmp)
+            n = (len < READ_STEP) ? len : READ_STEP;
+            if (dat_len + n > dat_max)
+            {
+                dat_max = (dat_max > max_bytes - png_max - dat_max) ?
+                    max_bytes - png_max : dat_max * 2;
+                if (dat_max < dat_len + n)
+                    dat_max = dat_len + n;
+                tmp = realloc(dat, dat_max);
+                if (! tmp)
+                    goto err;
+                dat = tmp;
+            }
+
+            if (! read(dat + dat_len, n, read_arg))
                 goto err;
-            dat = tmp;
+
+            dat_len += n;
+            len -= n;
         }
 
-        if (! read(dat, len+4, read_arg))
+        if (! read(0, 4, read_arg))
             goto err;
+    }
 
-        if ((dat[0] & 0x0f) != 0x08 ||  /* compression method (rfc 1950) */
-            (dat[0] & 0xf0) > 0x70)     /* window size */
-            goto err;
+    /* zlib header, checksum and at least an empty block */
+    if (dat_len < 2 + 1 + 4)
+        goto err;
 
-        if ((dat[1] & 0x20) != 0)       /* preset dictionary present */
-            goto err;
+    if ((dat[0] & 0x0f) != 0x08 ||  /* compression method (rfc 1950) */
+        (dat[0] & 0xf0) > 0x70)     /* window size */
+        goto err;
 
-        if (! png)
-        {
-            png_max = (w * bpp + 1) * h;
-            png_len = 0;
-            png = malloc(sizeof(*png) - 1 + png_max);
-            if (! png)
-                goto err;
-            png->w = w;
-            png->h = h;
-            png->bpp = bpp;
-        }
+    if ((dat[1] & 0x20) != 0)       /* preset dictionary present */
+        goto err;
 
-        out_len = png_max - png_len;
-        dat_len = len - 2;
-        r = puff(png->pix + png_len, &out_len, dat+2, &dat_len);
-        if (r != 0)
-            goto err;
-        if (2+dat_len+4 != len)
-            goto err;
-        png_len += out_len;
-    }
+    if (png_max / MAX_DEFLATE_RATIO > dat_len)
+        goto err;
+
+    png = malloc(sizeof(*png) - 1 + png_max);
+    if (! png)
+        goto err;
+    png->w = w;
+    png->h = h;
+    png->bpp = bpp;
+    png->gamma = srgb ? 0 : gamma;  /* sRGB overrides gAMA */
+
+    out_len = png_max;
+    len = dat_len - 2;
+    r = puff(png->pix, &out_len, dat+2, &len);
+    if (r != 0)
+        goto err;
+    if (2+len+4 > dat_len)
+        goto err;
+    png_len = out_len;
+    if (png_len != png_max)
+        goto err;
+
+    free(dat);
+    return png;
+err:
+    free(png);
     free(dat);
+    return NULL;
+}
+
+/*
+ *	Undoes the filtering of rows [y0, y1). The rows above y0 must
+ *	be unfiltered already, the line above the first one is all
+ *	zeroes.
+ */
+static int UnfilterRows(png_t * png, ulong y0, ulong y1)
+{
+    ulong bpp = png->bpp;
+    ulong len = png->w * bpp + 1;
+    uchar * line, * prev;
+    ulong i, j;
 
-    /* unfilter */
-    len = w * bpp + 1;
-    line = png->pix;
-    prev = 0;
-    for (i=0; i<h; i++, prev = line, line += len)
+    line = png->pix + y0 * len;
+    prev = y0 ? line - len : 0;
+    for (i=y0; i<y1; i++, prev = line, line += len)
     {
         switch (line[0])
         {
@@ -217,7 +376,11 @@ static png_t * LoadPngEx(read_cb read, void * read_arg)
             break;
         case 3: /* avg */
             if (! prev)
-                goto err; /* $todo */
+            {
+                for (j=1+bpp; j<len; j++)
+                    line[j] += line[j-bpp]/2;
+                break;
+            }
             for (j=1; j<=bpp; j++)
                 line[j] += prev[j]/2;
             for (   ; j<len; j++)
@@ -225,22 +388,23 @@ static png_t * LoadPngEx(read_cb read, void * read_arg)
             break;
         case 4: /* paeth */
             if (! prev)
-                goto err; /* $todo */
+            {
+                /* paeth(a, 0, 0) is always a */
+                for (j=1+bpp; j<len; j++)
+                    line[j] += line[j-bpp];
+                break;
+            }
             for (j=1; j<=bpp; j++)
                 line[j] += prev[j];
             for (   ; j<len; j++)
-                line[j] += paeth(line[j-bpp], prev[j], prev[j-bpp]);			
+                line[j] += paeth(line[j-bpp], prev[j], prev[j-bpp]);
             break;
         default:
-            goto err;
+            return 0;
         }
     }
 
-    return png;
-err:
-    free(png);
-    free(dat);
-    return NULL;
+    return 1;
 }
 
 /*
@@ -287,66 +451,240 @@ static int data_reader(uchar * buf, ulong len, void * arg)
     return 1;
 }
 
-static png_t * LoadPngResource(const wchar_t * name, const wchar_t * type, HMODULE module)
+static int LockPngResource(const wchar_t * name, const wchar_t * type, HMODULE module, buf_t * buf)
 {
     HRSRC   hRes;
     HGLOBAL hResData;
-    buf_t   buf;
 
     hRes = FindResource(module, name, type);
     if (! hRes)
-        return NULL;
+        return 0;
 
     if (! SizeofResource(module, hRes))
-        return NULL;
+        return 0;
 
     if (! (hResData = LoadResource(module, hRes)))
-        return NULL;
+        return 0;
 
-    if (! (buf.ptr = LockResource(hResData)))
-        return NULL;
+    if (! (buf->ptr = LockResource(hResData)))
+        return 0;
 
-    buf.len = SizeofResource(module, hRes);
+    buf->len = SizeofResource(module, hRes);
+    return 1;
+}
+
+static png_t * LoadPngResource(const wchar_t * name, const wchar_t * type, HMODULE module)
+{
+    buf_t   buf;
+
+    if (! LockPngResource(name, type, module, &buf))
+        return NULL;
 
     return LoadPngEx(data_reader, &buf);
 }
 
 /*
- *
+ *	Reads the signature, IHDR and the pHYs/acTL chunks found before
+ *	the first IDAT. Other chunks are skipped without being read, so
+ *	the cost does not depend on the image size.
  */
-static HBITMAP PngToDib(png_t * png, BOOL premultiply)
+static int ProbePngEx(read_cb read, void * read_arg, lpng_info * info)
+{
+    uchar buf[64];
+    ulong len;
+    int   i;
+
+    memset(info, 0, sizeof(*info));
+
+    /* sig and IHDR */
+    if (! read(buf, 8 + 8 + 13 + 4, read_arg))
+        return 0;
+
+    if (memcmp(buf, png_sig, 8) != 0)
+        return 0;
+
+    if (get_ulong(buf+8) != 13 || memcmp(buf+12, "IHDR", 4) != 0)
+        return 0;
+
+    info->width = get_ulong(buf+16);
+    info->height = get_ulong(buf+20);
+    info->bit_depth = buf[24];
+    info->color_type = buf[25];
+    info->interlace = buf[28];
+    info->has_alpha = (buf[25] & 0x04) ? 1 : 0;
+
+    if (info->width == 0 || info->height == 0 ||
+        info->width > MAX_CHUNK_SIZE || info->height > MAX_CHUNK_SIZE)
+        return 0;
+
+    /* the same checks as LoadPngEx() does, minus the budget */
+    info->loadable = (buf[24] == 8 && (buf[25] & 0x03) == 0x02 &&
+                      buf[26] == 0 && buf[27] == 0 && buf[28] == 0);
+
+    /*
+     *	A truncated file still has a valid header, so a failed read
+     *	past IHDR ends the scan rather than the probe. The number of
+     *	chunks looked at is bounded too.
+     */
+    for (i = 0; i < MAX_PROBE_CHUNKS; i++)
+    {
+        if (! read(buf, 8, read_arg))
+            break;
+
+        len = get_ulong(buf);
+        if (len > MAX_CHUNK_SIZE)
+            break;
+
+        if (memcmp(buf+4, "IDAT", 4) == 0 || memcmp(buf+4, "IEND", 4) == 0)
+            break;
+
+        if (memcmp(buf+4, "pHYs", 4) == 0 && len == 9)
+        {
+            if (! read(buf, 9 + 4, read_arg))
+                break;
+
+            info->has_phys = 1;
+            info->phys_x = get_ulong(buf);
+            info->phys_y = get_ulong(buf+4);
+            info->phys_unit = buf[8];
+        }
+        else if (memcmp(buf+4, "acTL", 4) == 0 && len == 8)
+        {
+            if (! read(buf, 8 + 4, read_arg))
+                break;
+
+            info->has_actl = 1;
+            info->num_frames = get_ulong(buf);
+            info->num_plays = get_ulong(buf+4);
+        }
+        else if (! read(0, len+4, read_arg))
+        {
+            break;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ *	Fills the tables for the sRGB curve (gamma 0) or for a plain
+ *	power curve with the gAMA value of the file. The result is
+ *	put back into the same encoding. The round trip is not exact
+ *	for every value, so ConvertRowsLinear() leaves opaque pixels
+ *	alone and only the partly transparent ones change.
+ */
+static void BuildLut(lut_t * lut, ulong gamma)
+{
+    double v;
+    int    i;
+
+    for (i = 0; i < 256; i++)
+    {
+        v = i / 255.0;
+        if (gamma)
+            v = pow(v, 100000.0 / gamma);
+        else
+            v = (v <= 0.04045) ? v / 12.92 : pow((v + 0.055) / 1.055, 2.4);
+        lut->dec[i] = (unsigned short)(v * LINEAR_MAX + 0.5);
+    }
+
+    for (i = 0; i <= LINEAR_MAX; i++)
+    {
+        v = (double)i / LINEAR_MAX;
+        if (gamma)
+            v = pow(v, gamma / 100000.0);
+        else
+            v = (v <= 0.0031308) ? v * 12.92 : 1.055 * pow(v, 1 / 2.4) - 0.055;
+        lut->enc[i] = (uchar)(v * 255 + 0.5);
+    }
+}
+
+/*
+ *	The sRGB tables are built once. Two threads that get here
+ *	first fill them with the same values, which is harmless.
+ */
+static const lut_t * GetSrgbLut(void)
+{
+    if (! srgb_lut_ready)
+    {
+        BuildLut(&srgb_lut, 0);
+        InterlockedExchange(&srgb_lut_ready, 1);
+    }
+
+    return &srgb_lut;
+}
+
+/*
+ *	Converts unfiltered rows [y0, y1) to the bottom-up DIB and
+ *	premultiplies them in linear light.
+ */
+static void ConvertRowsLinear(png_t * png, uchar * dib, ulong y0, ulong y1, const lut_t * lut)
+{
+    uchar * dst;
+    uchar * src, * tmp;
+    ulong   alpha;
+    int     bpl;
+    ulong   x, y;
+
+    bpl = png->bpp * png->w + 1;
+    src = png->pix + (y1 - 1) * bpl + 1;
+    dst = dib + (png->h - y1) * png->w * 4;
+
+    for (y = y0; y < y1; y++, src -= bpl)
+    {
+        tmp = src;
+
+        for (x = 0; x < png->w; x++, dst += 4, tmp += 4)
+        {
+            /*
+             *	opaque pixels are copied, the tables do not give
+             *	them back exactly: a gAMA curve takes the darkest
+             *	values below the first step of 'dec'. Transparent
+             *	ones come out as 0 either way.
+             */
+            alpha = tmp[3];
+            if (alpha == 255)
+            {
+                dst[0] = tmp[2];
+                dst[1] = tmp[1];
+                dst[2] = tmp[0];
+            }
+            else
+            {
+                dst[0] = lut->enc[(lut->dec[tmp[2]] * alpha + 127) / 255];
+                dst[1] = lut->enc[(lut->dec[tmp[1]] * alpha + 127) / 255];
+                dst[2] = lut->enc[(lut->dec[tmp[0]] * alpha + 127) / 255];
+            }
+            dst[3] = (uchar)alpha;
+        }
+    }
+}
+
+/*
+ *	Converts unfiltered rows [y0, y1) to the bottom-up DIB.
+ */
+static void ConvertRows(png_t * png, uchar * dib, ulong y0, ulong y1, BOOL premultiply, const lut_t * lut)
 {
-    BITMAPINFO bmi = { sizeof(bmi) };
-    HBITMAP dib;
     uchar * dst;
     uchar * src, * tmp;
     uchar  alpha;
     int    bpl;
     ulong  x, y;
 
-    if (png->bpp != 3 && png->bpp != 4)
-        return NULL;
-
-    //
-    bmi.bmiHeader.biWidth = png->w;
-    bmi.bmiHeader.biHeight = png->h;
-    bmi.bmiHeader.biPlanes = 1;
-    bmi.bmiHeader.biBitCount = 32;
-    bmi.bmiHeader.biCompression = BI_RGB;
-    bmi.bmiHeader.biSizeImage = 0;
-    bmi.bmiHeader.biXPelsPerMeter = 0;
-    bmi.bmiHeader.biYPelsPerMeter = 0;
-    bmi.bmiHeader.biClrUsed = 0;
-    bmi.bmiHeader.biClrImportant = 0;
-
-    dib = CreateDIBSection(NULL, &bmi, DIB_RGB_COLORS, &dst, NULL, 0);
-    if (! dib)
-        return NULL;
+    if (lut && premultiply && png->bpp == 4)
+    {
+        ConvertRowsLinear(png, dib, y0, y1, lut);
+        return;
+    }
 
     bpl = png->bpp * png->w + 1;              // bytes per line
-    src = png->pix + (png->h - 1) * bpl + 1;  // start of the last line
+    src = png->pix + y0 * bpl + 1;
+    dst = dib + (png->h - y1) * png->w * 4;
 
-    for (y = 0; y < png->h; y++, src -= bpl)
+    /* DIB lines go bottom to top, start from the last one */
+    src += (y1 - y0 - 1) * bpl;
+
+    for (y = y0; y < y1; y++, src -= bpl)
     {
         tmp = src;
 
@@ -377,10 +715,243 @@ static HBITMAP PngToDib(png_t * png, BOOL premultiply)
             tmp += png->bpp;
         }
     }
+}
+
+static int ConvertSerial(png_t * png, uchar * dib, BOOL premultiply, const lut_t * lut)
+{
+    if (! UnfilterRows(png, 0, png->h))
+        return 0;
+
+    ConvertRows(png, dib, 0, png->h, premultiply, lut);
+    return 1;
+}
+
+static void ConvertBand(job_t * job, ulong band)
+{
+    ulong y0 = band * job->band_rows;
+    ulong y1 = y0 + job->band_rows;
+
+    if (y1 > job->png->h)
+        y1 = job->png->h;
+
+    ConvertRows(job->png, job->dib, y0, y1, job->premultiply, job->lut);
+}
+
+static DWORD WINAPI ConvertWorker(LPVOID arg)
+{
+    job_t * job = (job_t *)arg;
+    LONG band;
+
+    for (;;)
+    {
+        WaitForSingleObject(job->ready, INFINITE);
+
+        band = InterlockedIncrement(&job->next) - 1;
+        if (band >= job->bands)
+            break;
+
+        ConvertBand(job, band);
+    }
+
+    return 0;
+}
+
+/*
+ *	Unfilters on the calling thread and converts finished bands
+ *	on up to 'threads' - 1 workers. Once unfiltering is done the
+ *	calling thread joins in and takes whatever bands are left.
+ *	Returns 0 if the image data is corrupt.
+ */
+static int ConvertParallel(png_t * png, uchar * dib, BOOL premultiply, const lut_t * lut, int threads)
+{
+    job_t  job;
+    HANDLE workers[MAX_THREADS];
+    int    n = 0, i;
+    LONG   band, bands;
+    int    ok = 1;
+
+    job.png = png;
+    job.dib = dib;
+    job.premultiply = premultiply;
+    job.lut = lut;
+    job.band_rows = BAND_PIXELS / png->w;
+    if (job.band_rows == 0)
+        job.band_rows = 1;
+    bands = (LONG)((png->h + job.band_rows - 1) / job.band_rows);
+    job.bands = bands;
+    job.next = 0;
+
+    /* a count per band and one per thread to let it go */
+    job.ready = CreateSemaphore(NULL, 0, bands + threads, NULL);
+    if (! job.ready)
+        return ConvertSerial(png, dib, premultiply, lut);
+
+    for (i = 1; i < threads; i++)
+    {
+        workers[n] = CreateThread(NULL, 0, ConvertWorker, &job, 0, NULL);
+        if (workers[n])
+            n++;
+    }
+
+    for (band = 0; band < bands; band++)
+    {
+        if (! UnfilterRows(png, band * job.band_rows,
+                           min(png->h, (band + 1) * job.band_rows)))
+        {
+            /* workers must not touch the bands that are not done */
+            job.bands = band;
+            ok = 0;
+            break;
+        }
+
+        ReleaseSemaphore(job.ready, 1, NULL);
+    }
+
+    ReleaseSemaphore(job.ready, n + 1, NULL);
+    ConvertWorker(&job);
+
+    for (i = 0; i < n; i++)
+    {
+        WaitForSingleObject(workers[i], INFINITE);
+        CloseHandle(workers[i]);
+    }
+
+    CloseHandle(job.ready);
+    return ok;
+}
+
+/*
+ *
+ */
+static HBITMAP PngToDib(png_t * png, BOOL premultiply)
+{
+    BITMAPINFO bmi = { sizeof(bmi) };
+    HBITMAP dib;
+    uchar * dst;
+    int     ok;
+    lut_t * own = NULL;
+    const lut_t * lut = NULL;
+
+    if (png->bpp != 3 && png->bpp != 4)
+        return NULL;
+
+    if (premultiply == LPNG_PREMULTIPLY_LINEAR && png->bpp == 4)
+    {
+        if (png->gamma == 0)
+        {
+            lut = GetSrgbLut();
+        }
+        else
+        {
+            own = malloc(sizeof(*own));
+            if (! own)
+                return NULL;
+            BuildLut(own, png->gamma);
+            lut = own;
+        }
+    }
+
+    //
+    bmi.bmiHeader.biWidth = png->w;
+    bmi.bmiHeader.biHeight = png->h;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+    bmi.bmiHeader.biSizeImage = 0;
+    bmi.bmiHeader.biXPelsPerMeter = 0;
+    bmi.bmiHeader.biYPelsPerMeter = 0;
+    bmi.bmiHeader.biClrUsed = 0;
+    bmi.bmiHeader.biClrImportant = 0;
+
+    dib = CreateDIBSection(NULL, &bmi, DIB_RGB_COLORS, (void **)&dst, NULL, 0);
+    if (! dib)
+    {
+        free(own);
+        return NULL;
+    }
+
+    if (par_threads > 1 && png->h > 1 && png->w * png->h >= par_min_pixels)
+        ok = ConvertParallel(png, dst, premultiply, lut, par_threads);
+    else
+        ok = ConvertSerial(png, dst, premultiply, lut);
+
+    free(own);
+
+    if (! ok)
+    {
+        DeleteObject(dib);
+        return NULL;
+    }
 
     return dib;
 }
 
+/*
+ *
+ */
+int lpng_probe(const wchar_t * res_name,
+    const wchar_t * res_type,
+    HMODULE         res_inst,
+    lpng_info     * info)
+{
+    FILE  * fh;
+    buf_t   buf;
+    int     r = 0;
+
+    if (res_type)
+    {
+        if (LockPngResource(res_name, res_type, res_inst, &buf))
+            r = ProbePngEx(data_reader, &buf, info);
+    }
+    else
+    {
+        fh = _wfopen(res_name, L"rb");
+        if (fh)
+        {
+            r = ProbePngEx(file_reader, fh, info);
+            fclose(fh);
+        }
+    }
+
+    return r;
+}
+
+int lpng_probe_mem(const void * data, unsigned long len, lpng_info * info)
+{
+    buf_t buf;
+
+    buf.ptr = (uchar *)data;
+    buf.len = len;
+
+    return ProbePngEx(data_reader, &buf, info);
+}
+
+/*
+ *
+ */
+void lpng_set_limits(unsigned long maxPixels, unsigned long maxBytes)
+{
+    max_pixels = maxPixels ? maxPixels : DEFAULT_MAX_PIXELS;
+    max_bytes = maxBytes ? maxBytes : DEFAULT_MAX_BYTES;
+}
+
+/*
+ *
+ */
+void lpng_set_threads(int threads, unsigned long minPixels)
+{
+    SYSTEM_INFO si;
+
+    if (threads <= 0)
+    {
+        GetSystemInfo(&si);
+        threads = (int)si.dwNumberOfProcessors;
+    }
+
+    par_threads = (threads > MAX_THREADS) ? MAX_THREADS : threads;
+    par_min_pixels = minPixels ? minPixels : DEFAULT_MIN_PARALLEL;
+}
+
 /*
  *
  */
@@ -408,3 +979,24 @@ HBITMAP LoadPng(const wchar_t * res_name,
 
     return bmp;
 }
+
+HBITMAP LoadPngMem(const void * data,
+    unsigned long   len,
+    BOOL            premultiply)
+{
+    HBITMAP  bmp;
+    png_t  * png;
+    buf_t    buf;
+
+    buf.ptr = (uchar *)data;
+    buf.len = len;
+
+    png = LoadPngEx(data_reader, &buf);
+    if (! png)
+        return NULL;
+
+    bmp = PngToDib(png, premultiply);
+
+    free(png);
+    return bmp;
+}
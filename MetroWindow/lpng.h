@@ -43,8 +43,77 @@
  *	where "1001" is a type of the resource. It is selected,
  *	when the .png image is imported into the resource file
  *	and it can be whatever.
+ *
+ *	An image that is already in memory is loaded with:
+ *
+ *		LoadPngMem(data, len, FALSE);
+ *
+ *	The last argument, if not FALSE, premultiplies the color
+ *	by alpha for AlphaBlend(). TRUE (LPNG_PREMULTIPLY) does it
+ *	on the encoded values, like most software. Use
+ *	LPNG_PREMULTIPLY_LINEAR to do it in linear light instead,
+ *	which keeps soft edges from going dark. The curve is taken
+ *	from the gAMA or sRGB chunk, sRGB if there is neither.
+ *
+ *	Every load is bounded by a decode budget: the number of
+ *	pixels, and the bytes of compressed plus inflated data.
+ *	Images over budget fail to load before anything large is
+ *	allocated. The defaults are 4096 x 4096 pixels and 64 MB;
+ *	to change them (0 restores a default) use:
+ *
+ *		lpng_set_limits(8192 * 8192, 256 * 1024 * 1024);
+ *
+ *	To get the size and format of an image without decoding
+ *	it use lpng_probe() with the same arguments as LoadPng():
+ *
+ *		lpng_info info;
+ *
+ *		if (lpng_probe(L"c:\\sample.png", NULL, NULL, &info))
+ *			layout(info.width, info.height);
+ *
+ *	or lpng_probe_mem() for an image that is already in memory.
+ *	Only the signature, IHDR and the chunks in front of the
+ *	image data are read - no inflate, no large allocation.
+ *
+ *	Large images can be converted to the DIB on several threads.
+ *	The data is still inflated and unfiltered on the calling
+ *	thread, but the conversion of every finished band of rows
+ *	runs on a pool of workers in the meantime. It is off by
+ *	default; to turn it on for images of 1 megapixel and more,
+ *	with a thread per CPU, use:
+ *
+ *		lpng_set_threads(0, 1024 * 1024);
+ *
+ *	lpng_set_threads(1, 0) turns it back off.
  */
 
+#define LPNG_PREMULTIPLY        1
+#define LPNG_PREMULTIPLY_LINEAR 2
+
+typedef struct _lpng_info lpng_info;
+
+struct _lpng_info
+{
+    unsigned long width;
+    unsigned long height;
+    unsigned char bit_depth;
+    unsigned char color_type;
+    unsigned char interlace;
+    unsigned char has_alpha;   /* color type with an alpha channel */
+    unsigned char loadable;    /* the format LoadPng() can decode  */
+
+    /* pHYs */
+    unsigned char has_phys;
+    unsigned char phys_unit;   /* 1 - pixels per meter, 0 - aspect only */
+    unsigned long phys_x;
+    unsigned long phys_y;
+
+    /* acTL, animated png */
+    unsigned char has_actl;
+    unsigned long num_frames;
+    unsigned long num_plays;   /* 0 - loop forever */
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -54,6 +123,25 @@ HBITMAP LoadPng(const wchar_t * resName,
                 HMODULE         resInst,
                 BOOL   premultiplyAlpha);
 
+HBITMAP LoadPngMem(const void    * data,
+                   unsigned long   len,
+                   BOOL            premultiplyAlpha);
+
+void lpng_set_limits(unsigned long maxPixels,
+                     unsigned long maxBytes);
+
+void lpng_set_threads(int           threads,
+                      unsigned long minPixels);
+
+int lpng_probe(const wchar_t * resName,
+               const wchar_t * resType,
+               HMODULE         resInst,
+               lpng_info     * info);
+
+int lpng_probe_mem(const void    * data,
+                   unsigned long   len,
+                   lpng_info     * info);
+
 #ifdef __cplusplus
 }
 #endif
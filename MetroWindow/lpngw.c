@@ -0,0 +1,814 @@
+/*
+ *	lpngw.c - PNG writer companion of the Light PNG Loader (lpng.c).
+ *
+ *	The program is distributed under terms of BSD license.
+ *	You can obtain the copy of the license by visiting:
+ *
+ *	http://www.opensource.org/licenses/bsd-license.php
+ */
+
+/*
+ *	The writer is tuned for dumping frames quickly rather than for
+ *	producing the smallest files:
+ *
+ *	- every row is filtered with the filter that gives the smallest
+ *	  sum of absolute values (the usual libpng heuristic);
+ *	- the deflate stream uses the fixed Huffman codes only, with no
+ *	  matching (stored), distance-1 runs (RLE) or a single-probe hash
+ *	  table without chains (greedy);
+ *	- row groups are filtered and compressed independently, so they
+ *	  can run on several threads; each group ends with a sync flush
+ *	  and the Adler-32 sums are combined at the end.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <windows.h>
+
+#include "lpngw.h"
+
+/*
+ *	A group is not split further once it gets smaller than this,
+ *	thread startup would cost more than the compression itself.
+ */
+#define MIN_GROUP_BYTES (64*1024)
+#define MAX_THREADS     16
+
+#define HASH_BITS       15
+#define HASH_SIZE       (1 << HASH_BITS)
+#define WINDOW_SIZE     32768
+#define MIN_MATCH       3
+#define MAX_MATCH       258
+#define MAX_STORED      65535
+
+/*
+ *
+ */
+#pragma warning (disable: 4996)
+
+typedef unsigned char  uchar;
+typedef unsigned long  ulong;
+typedef struct _out    out_t;
+typedef struct _huff   huff_t;
+typedef struct _job    job_t;
+
+struct _out
+{
+    uchar * ptr;
+    ulong   len;
+    ulong   bitbuf;
+    int     bitcnt;
+};
+
+/* fixed Huffman codes, already bit-reversed */
+struct _huff
+{
+    unsigned short lit_code[288];
+    uchar          lit_bits[288];
+    uchar          dist_code[30];
+    uchar          len_sym[MAX_MATCH+1];   /* match length -> length code */
+    uchar          dist_lo[256];           /* distance-1 < 256 -> code    */
+    uchar          dist_hi[256];           /* (distance-1) >> 7 -> code   */
+};
+
+struct _job
+{
+    const uchar  * pixels;
+    long           stride;
+    ulong          w;
+    ulong          y0, y1;
+    int            bpp;
+    int            flags;
+    int            level;
+    const huff_t * huff;
+
+    out_t          out;
+    ulong          raw_len;
+    ulong          adler;
+    int            ok;
+};
+
+static const unsigned short len_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uchar len_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const unsigned short dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577 };
+static const uchar dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+static const uchar png_sig[] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+
+//
+static __inline void put_ulong(uchar * v, ulong r)
+{
+    v[0] = (uchar)(r >> 24);
+    v[1] = (uchar)(r >> 16);
+    v[2] = (uchar)(r >> 8);
+    v[3] = (uchar)r;
+}
+
+static __inline void put_bits(out_t * o, ulong value, int count)
+{
+    o->bitbuf |= value << o->bitcnt;
+    o->bitcnt += count;
+    while (o->bitcnt >= 8)
+    {
+        o->ptr[o->len++] = (uchar)o->bitbuf;
+        o->bitbuf >>= 8;
+        o->bitcnt -= 8;
+    }
+}
+
+static __inline void align_bits(out_t * o)
+{
+    if (o->bitcnt > 0)
+        o->ptr[o->len++] = (uchar)o->bitbuf;
+    o->bitbuf = 0;
+    o->bitcnt = 0;
+}
+
+static __inline int abs_byte(uchar v)
+{
+    return v < 128 ? v : 256 - v;
+}
+
+static __inline uchar paeth(uchar a, uchar b, uchar c)
+{
+    int p = a + b - c;
+    int pa = p > a ? p-a : a-p;
+    int pb = p > b ? p-b : b-p;
+    int pc = p > c ? p-c : c-p;
+    return (pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c;
+}
+
+/*
+ *	checksums
+ */
+static void make_crc_table(ulong * table)
+{
+    ulong c;
+    int   n, k;
+
+    for (n = 0; n < 256; n++)
+    {
+        c = (ulong)n;
+        for (k = 0; k < 8; k++)
+            c = (c & 1) ? 0xedb88320UL ^ (c >> 1) : c >> 1;
+        table[n] = c;
+    }
+}
+
+static ulong crc32(const ulong * table, const uchar * buf, ulong len)
+{
+    ulong c = 0xffffffffUL;
+    ulong i;
+
+    for (i = 0; i < len; i++)
+        c = table[(c ^ buf[i]) & 0xff] ^ (c >> 8);
+
+    return c ^ 0xffffffffUL;
+}
+
+#define ADLER_BASE 65521UL
+#define ADLER_NMAX 5552
+
+static ulong adler32(ulong adler, const uchar * buf, ulong len)
+{
+    ulong s1 = adler & 0xffff;
+    ulong s2 = adler >> 16;
+    ulong n;
+
+    while (len > 0)
+    {
+        n = len < ADLER_NMAX ? len : ADLER_NMAX;
+        len -= n;
+        while (n--)
+        {
+            s1 += *buf++;
+            s2 += s1;
+        }
+        s1 %= ADLER_BASE;
+        s2 %= ADLER_BASE;
+    }
+
+    return (s2 << 16) | s1;
+}
+
+/* same as adler32_combine() of zlib */
+static ulong adler32_combine(ulong adler1, ulong adler2, ulong len2)
+{
+    ulong rem = len2 % ADLER_BASE;
+    ulong sum1 = adler1 & 0xffff;
+    ulong sum2 = (rem * sum1) % ADLER_BASE;
+
+    sum1 += (adler2 & 0xffff) + ADLER_BASE - 1;
+    sum2 += ((adler1 >> 16) & 0xffff) + ((adler2 >> 16) & 0xffff) + ADLER_BASE - rem;
+    if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+    if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+    if (sum2 >= (ADLER_BASE << 1)) sum2 -= (ADLER_BASE << 1);
+    if (sum2 >= ADLER_BASE) sum2 -= ADLER_BASE;
+
+    return sum1 | (sum2 << 16);
+}
+
+/*
+ *	fixed Huffman codes
+ */
+static unsigned short reverse_bits(unsigned short code, int len)
+{
+    unsigned short r = 0;
+    while (len--)
+    {
+        r = (r << 1) | (code & 1);
+        code >>= 1;
+    }
+    return r;
+}
+
+static void make_huff(huff_t * h)
+{
+    int i, code;
+
+    for (i = 0; i < 288; i++)
+    {
+        if (i < 144)      { code = 0x30 + i;         h->lit_bits[i] = 8; }
+        else if (i < 256) { code = 0x190 + i - 144;  h->lit_bits[i] = 9; }
+        else if (i < 280) { code = i - 256;          h->lit_bits[i] = 7; }
+        else              { code = 0xc0 + i - 280;   h->lit_bits[i] = 8; }
+        h->lit_code[i] = reverse_bits((unsigned short)code, h->lit_bits[i]);
+    }
+
+    for (i = 0; i < 30; i++)
+        h->dist_code[i] = (uchar)reverse_bits((unsigned short)i, 5);
+
+    for (code = 0, i = MIN_MATCH; i <= MAX_MATCH; i++)
+    {
+        while (code < 28 && i >= len_base[code+1])
+            code++;
+        h->len_sym[i] = (uchar)code;
+    }
+
+    for (code = 0, i = 0; i < 256; i++)
+    {
+        while (code < 29 && (ulong)i + 1 >= dist_base[code+1])
+            code++;
+        h->dist_lo[i] = (uchar)code;
+    }
+
+    for (code = 0, i = 0; i < 256; i++)
+    {
+        while (code < 29 && ((ulong)i << 7) + 1 >= dist_base[code+1])
+            code++;
+        h->dist_hi[i] = (uchar)code;
+    }
+}
+
+static __inline void put_literal(out_t * o, const huff_t * h, int lit)
+{
+    put_bits(o, h->lit_code[lit], h->lit_bits[lit]);
+}
+
+static __inline void put_match(out_t * o, const huff_t * h, ulong len, ulong dist)
+{
+    int code = h->len_sym[len];
+
+    put_bits(o, h->lit_code[257 + code], h->lit_bits[257 + code]);
+    if (len_extra[code])
+        put_bits(o, len - len_base[code], len_extra[code]);
+
+    dist--;
+    code = dist < 256 ? h->dist_lo[dist] : h->dist_hi[dist >> 7];
+    put_bits(o, h->dist_code[code], 5);
+    if (dist_extra[code])
+        put_bits(o, dist + 1 - dist_base[code], dist_extra[code]);
+}
+
+/*
+ *	deflate levels, each one writes a complete non-final run of blocks
+ *	that ends on a byte boundary
+ */
+static void deflate_stored(out_t * o, const uchar * buf, ulong len)
+{
+    ulong n;
+
+    while (len > 0)
+    {
+        n = len < MAX_STORED ? len : MAX_STORED;
+
+        o->ptr[o->len++] = 0; /* not final, stored */
+        o->ptr[o->len++] = (uchar)n;
+        o->ptr[o->len++] = (uchar)(n >> 8);
+        o->ptr[o->len++] = (uchar)~n;
+        o->ptr[o->len++] = (uchar)(~n >> 8);
+        memcpy(o->ptr + o->len, buf, n);
+
+        o->len += n;
+        buf += n;
+        len -= n;
+    }
+}
+
+static void deflate_rle(out_t * o, const huff_t * h, const uchar * buf, ulong len)
+{
+    ulong i = 0, run, max;
+
+    while (i < len)
+    {
+        run = 0;
+        if (i > 0)
+        {
+            max = len - i < MAX_MATCH ? len - i : MAX_MATCH;
+            while (run < max && buf[i + run] == buf[i - 1])
+                run++;
+        }
+
+        if (run >= MIN_MATCH)
+        {
+            put_match(o, h, run, 1);
+            i += run;
+        }
+        else
+        {
+            put_literal(o, h, buf[i++]);
+        }
+    }
+}
+
+#define HASH(p) ((((ulong)(p)[0] << 16 | (ulong)(p)[1] << 8 | (p)[2]) * 0x9e3779b1UL) >> (32 - HASH_BITS))
+
+static int deflate_fast(out_t * o, const huff_t * h, const uchar * buf, ulong len)
+{
+    ulong * head;
+    ulong   i = 0, j, cand = 0, run, max;
+
+    /* head[] keeps position + 1 of the latest string with the hash */
+    head = calloc(HASH_SIZE, sizeof(*head));
+    if (! head)
+        return 0;
+
+    while (i < len)
+    {
+        run = 0;
+        if (i + MIN_MATCH <= len)
+        {
+            j = HASH(buf + i) & (HASH_SIZE - 1);
+            cand = head[j];
+            head[j] = i + 1;
+
+            if (cand != 0 && i - (cand - 1) <= WINDOW_SIZE)
+            {
+                cand--;
+                max = len - i < MAX_MATCH ? len - i : MAX_MATCH;
+                while (run < max && buf[cand + run] == buf[i + run])
+                    run++;
+            }
+        }
+
+        if (run >= MIN_MATCH)
+        {
+            put_match(o, h, run, i - cand);
+
+            /* index the rest of the match, but not past the end */
+            for (j = i + 1; j < i + run && j + MIN_MATCH <= len; j++)
+                head[HASH(buf + j) & (HASH_SIZE - 1)] = j + 1;
+
+            i += run;
+        }
+        else
+        {
+            put_literal(o, h, buf[i++]);
+        }
+    }
+
+    free(head);
+    return 1;
+}
+
+/*
+ *	row conversion and filtering
+ */
+static void convert_row(const uchar * src, uchar * dst, ulong w, int bpp, int flags)
+{
+    ulong x;
+    uchar a;
+
+    for (x = 0; x < w; x++, src += 4, dst += bpp)
+    {
+        a = src[3];
+        if (bpp == 4 && (flags & LPNGW_UNPREMULTIPLY) && a != 0xff)
+        {
+            if (a == 0)
+            {
+                dst[0] = dst[1] = dst[2] = 0;
+            }
+            else
+            {
+                dst[0] = (uchar)(src[2] >= a ? 0xff : (src[2] * 255 + a / 2) / a);
+                dst[1] = (uchar)(src[1] >= a ? 0xff : (src[1] * 255 + a / 2) / a);
+                dst[2] = (uchar)(src[0] >= a ? 0xff : (src[0] * 255 + a / 2) / a);
+            }
+        }
+        else
+        {
+            dst[0] = src[2];
+            dst[1] = src[1];
+            dst[2] = src[0];
+        }
+
+        if (bpp == 4)
+            dst[3] = a;
+    }
+}
+
+/* returns the cost of the filtered row, 'prev' is all zeroes for the first row */
+static ulong filter_row(int type, const uchar * line, const uchar * prev,
+                        uchar * dst, ulong len, int bpp)
+{
+    ulong j, cost = 0;
+
+    dst[0] = (uchar)type;
+    dst++;
+
+    switch (type)
+    {
+    case 0: /* none */
+        for (j = 0; j < len; j++)
+            dst[j] = line[j];
+        break;
+    case 1: /* sub */
+        for (j = 0; j < (ulong)bpp; j++)
+            dst[j] = line[j];
+        for (   ; j < len; j++)
+            dst[j] = line[j] - line[j-bpp];
+        break;
+    case 2: /* up */
+        for (j = 0; j < len; j++)
+            dst[j] = line[j] - prev[j];
+        break;
+    case 3: /* avg */
+        for (j = 0; j < (ulong)bpp; j++)
+            dst[j] = line[j] - prev[j]/2;
+        for (   ; j < len; j++)
+            dst[j] = line[j] - (line[j-bpp] + prev[j])/2;
+        break;
+    case 4: /* paeth */
+        for (j = 0; j < (ulong)bpp; j++)
+            dst[j] = line[j] - prev[j];
+        for (   ; j < len; j++)
+            dst[j] = line[j] - paeth(line[j-bpp], prev[j], prev[j-bpp]);
+        break;
+    }
+
+    for (j = 0; j < len; j++)
+        cost += abs_byte(dst[j]);
+
+    return cost;
+}
+
+/*
+ *	compress rows [y0, y1) into job->out
+ */
+static void run_job(job_t * job)
+{
+    ulong   len = job->w * job->bpp;
+    ulong   y, cost, best_cost;
+    uchar * raw = NULL, * rows = NULL, * dst;
+    uchar * line, * prev, * tmp;
+    uchar * cand, * best;
+    int     type;
+
+    job->ok = 0;
+    job->raw_len = (job->y1 - job->y0) * (len + 1);
+
+    /* two converted rows, two filter candidates */
+    raw = malloc(4 * (len + 1));
+    rows = malloc(job->raw_len);
+    if (! raw || ! rows)
+        goto done;
+
+    line = raw;
+    prev = raw + len + 1;
+    cand = raw + 2 * (len + 1);
+    best = raw + 3 * (len + 1);
+
+    /* the first row of a group is filtered against its real predecessor */
+    if (job->y0 > 0)
+        convert_row(job->pixels + (long)(job->y0 - 1) * job->stride, prev, job->w, job->bpp, job->flags);
+    else
+        memset(prev, 0, len);
+
+    dst = rows;
+    for (y = job->y0; y < job->y1; y++, dst += len + 1)
+    {
+        convert_row(job->pixels + (long)y * job->stride, line, job->w, job->bpp, job->flags);
+
+        if (job->level == LPNGW_STORED)
+        {
+            filter_row(0, line, prev, dst, len, job->bpp);
+        }
+        else
+        {
+            best_cost = filter_row(0, line, prev, best, len, job->bpp);
+            for (type = 1; type <= 4; type++)
+            {
+                cost = filter_row(type, line, prev, cand, len, job->bpp);
+                if (cost < best_cost)
+                {
+                    best_cost = cost;
+                    tmp = best; best = cand; cand = tmp;
+                }
+            }
+            memcpy(dst, best, len + 1);
+        }
+
+        tmp = prev; prev = line; line = tmp;
+    }
+
+    job->adler = adler32(1, rows, job->raw_len);
+
+    /*
+     *	The worst case is a 3 byte match with the longest distance, it
+     *	takes 31 bits - a bit more than 10 bits per byte. Stored blocks
+     *	and the sync flush add a few bytes on top.
+     */
+    job->out.ptr = malloc(job->raw_len + job->raw_len / 2 + 64);
+    job->out.len = 0;
+    job->out.bitbuf = 0;
+    job->out.bitcnt = 0;
+    if (! job->out.ptr)
+        goto done;
+
+    if (job->level == LPNGW_STORED)
+    {
+        deflate_stored(&job->out, rows, job->raw_len);
+    }
+    else
+    {
+        put_bits(&job->out, 0, 1); /* not final */
+        put_bits(&job->out, 1, 2); /* fixed codes */
+
+        if (job->level == LPNGW_RLE)
+            deflate_rle(&job->out, job->huff, rows, job->raw_len);
+        else if (! deflate_fast(&job->out, job->huff, rows, job->raw_len))
+            goto done;
+
+        put_literal(&job->out, job->huff, 256);
+
+        /* sync flush - an empty stored block to get back on a byte boundary */
+        put_bits(&job->out, 0, 3);
+        align_bits(&job->out);
+        job->out.ptr[job->out.len++] = 0x00;
+        job->out.ptr[job->out.len++] = 0x00;
+        job->out.ptr[job->out.len++] = 0xff;
+        job->out.ptr[job->out.len++] = 0xff;
+    }
+
+    job->ok = 1;
+done:
+    free(raw);
+    free(rows);
+}
+
+static DWORD WINAPI job_proc(LPVOID arg)
+{
+    run_job((job_t *)arg);
+    return 0;
+}
+
+static uchar * put_chunk(uchar * p, const ulong * crc_table, const char * type,
+                         const uchar * data, ulong len)
+{
+    put_ulong(p, len);
+    memcpy(p + 4, type, 4);
+    if (data && data != p + 8)
+        memcpy(p + 8, data, len);
+    put_ulong(p + 8 + len, crc32(crc_table, p + 4, len + 4));
+    return p + 12 + len;
+}
+
+/*
+ *
+ */
+int EncodePng(const void    * pixels,
+              unsigned long   w,
+              unsigned long   h,
+              long            stride,
+              int             flags,
+              int             level,
+              int             threads,
+              unsigned char ** out,
+              unsigned long * out_len)
+{
+    job_t    jobs[MAX_THREADS];
+    HANDLE   handles[MAX_THREADS];
+    huff_t   huff;
+    ulong    crc_table[256];
+    uchar    ihdr[13];
+    ulong    groups, rows, i, y;
+    ulong    idat_len, adler;
+    uchar  * png = NULL, * p, * idat;
+    int      bpp = (flags & LPNGW_ALPHA) ? 4 : 3;
+    int      ok = 0;
+
+    *out = NULL;
+    *out_len = 0;
+
+    if (! pixels || w == 0 || h == 0 || level < LPNGW_STORED || level > LPNGW_FAST)
+        return 0;
+
+    /* the largest dimension the png format allows, also keeps the row math in range */
+    if (w > 0x7fffffffUL / 4 || h > 0x7fffffffUL / (w * bpp + 1))
+        return 0;
+
+    make_huff(&huff);
+    make_crc_table(crc_table);
+
+    /* split into row groups, no smaller than MIN_GROUP_BYTES */
+    groups = (threads > 1) ? (ulong)threads : 1;
+    if (groups > MAX_THREADS)
+        groups = MAX_THREADS;
+    if (groups > (w * bpp + 1) * h / MIN_GROUP_BYTES)
+        groups = (w * bpp + 1) * h / MIN_GROUP_BYTES;
+    if (groups < 1)
+        groups = 1;
+    rows = (h + groups - 1) / groups;
+    groups = (h + rows - 1) / rows;
+
+    memset(jobs, 0, sizeof(jobs));
+    for (i = 0, y = 0; i < groups; i++, y += rows)
+    {
+        jobs[i].pixels = pixels;
+        jobs[i].stride = stride;
+        jobs[i].w = w;
+        jobs[i].y0 = y;
+        jobs[i].y1 = (y + rows < h) ? y + rows : h;
+        jobs[i].bpp = bpp;
+        jobs[i].flags = flags;
+        jobs[i].level = level;
+        jobs[i].huff = &huff;
+    }
+
+    /* the calling thread takes the first group itself */
+    for (i = 1; i < groups; i++)
+    {
+        handles[i] = CreateThread(NULL, 0, job_proc, &jobs[i], 0, NULL);
+        if (! handles[i])
+            run_job(&jobs[i]);
+    }
+
+    run_job(&jobs[0]);
+
+    for (i = 1; i < groups; i++)
+    {
+        if (handles[i])
+        {
+            WaitForSingleObject(handles[i], INFINITE);
+            CloseHandle(handles[i]);
+        }
+    }
+
+    /* zlib header + groups + final empty block + adler */
+    idat_len = 2 + 2 + 4;
+    for (i = 0; i < groups; i++)
+    {
+        if (! jobs[i].ok)
+            goto done;
+        idat_len += jobs[i].out.len;
+    }
+
+    png = malloc(sizeof(png_sig) + (12 + 13) + (12 + idat_len) + 12);
+    if (! png)
+        goto done;
+
+    memcpy(png, png_sig, sizeof(png_sig));
+    p = png + sizeof(png_sig);
+
+    put_ulong(ihdr, w);
+    put_ulong(ihdr + 4, h);
+    ihdr[8] = 8;                    /* bit depth */
+    ihdr[9] = (bpp == 4) ? 6 : 2;   /* truecolor (+ alpha) */
+    ihdr[10] = 0;                   /* deflate */
+    ihdr[11] = 0;                   /* adaptive filtering */
+    ihdr[12] = 0;                   /* no interlace */
+    p = put_chunk(p, crc_table, "IHDR", ihdr, sizeof(ihdr));
+
+    /* assemble IDAT in place */
+    idat = p + 8;
+    idat[0] = 0x78;                 /* deflate, 32K window */
+    idat[1] = 0x01;
+    idat += 2;
+
+    adler = 1;
+    for (i = 0; i < groups; i++)
+    {
+        memcpy(idat, jobs[i].out.ptr, jobs[i].out.len);
+        idat += jobs[i].out.len;
+        adler = adler32_combine(adler, jobs[i].adler, jobs[i].raw_len);
+    }
+
+    *idat++ = 0x03;                 /* final, fixed codes, end of block */
+    *idat++ = 0x00;
+    put_ulong(idat, adler);
+
+    p = put_chunk(p, crc_table, "IDAT", p + 8, idat_len);
+    p = put_chunk(p, crc_table, "IEND", NULL, 0);
+
+    *out = png;
+    *out_len = (ulong)(p - png);
+    ok = 1;
+done:
+    for (i = 0; i < groups; i++)
+        free(jobs[i].out.ptr);
+    return ok;
+}
+
+void FreePng(unsigned char * png)
+{
+    free(png);
+}
+
+/*
+ *
+ */
+BOOL SavePng(const wchar_t * name, HBITMAP bmp, int flags, int level, int threads)
+{
+    DIBSECTION ds;
+    BITMAPINFO bmi;
+    HDC     hdc;
+    uchar * bits = NULL, * png = NULL;
+    ulong   png_len;
+    long    w, h, stride;
+    const uchar * src;
+    FILE  * fh;
+    BOOL    ok = FALSE;
+
+    memset(&ds, 0, sizeof(ds));
+    if (! GetObject(bmp, sizeof(ds), &ds))
+        return FALSE;
+
+    w = ds.dsBm.bmWidth;
+    h = ds.dsBm.bmHeight;
+    if (w <= 0 || h <= 0)
+        return FALSE;
+
+    if (ds.dsBm.bmBits && ds.dsBm.bmBitsPixel == 32)
+    {
+        /* a 32-bit DIB section, read the pixels in place */
+        GdiFlush();
+        stride = ds.dsBm.bmWidthBytes;
+        src = ds.dsBm.bmBits;
+        if (ds.dsBmih.biHeight > 0)
+        {
+            src += (h - 1) * stride;
+            stride = -stride;
+        }
+    }
+    else
+    {
+        memset(&bmi, 0, sizeof(bmi));
+        bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+        bmi.bmiHeader.biWidth = w;
+        bmi.bmiHeader.biHeight = -h;
+        bmi.bmiHeader.biPlanes = 1;
+        bmi.bmiHeader.biBitCount = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+
+        bits = malloc(w * 4 * h);
+        if (! bits)
+            return FALSE;
+
+        hdc = GetDC(NULL);
+        if (! GetDIBits(hdc, bmp, 0, h, bits, &bmi, DIB_RGB_COLORS))
+        {
+            ReleaseDC(NULL, hdc);
+            goto done;
+        }
+        ReleaseDC(NULL, hdc);
+
+        stride = w * 4;
+        src = bits;
+    }
+
+    if (! EncodePng(src, w, h, stride, flags, level, threads, &png, &png_len))
+        goto done;
+
+    fh = _wfopen(name, L"wb");
+    if (fh)
+    {
+        ok = fwrite(png, 1, png_len, fh) == png_len;
+        if (fclose(fh) != 0)
+            ok = FALSE;
+    }
+
+done:
+    free(bits);
+    FreePng(png);
+    return ok;
+}
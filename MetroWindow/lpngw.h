@@ -0,0 +1,76 @@
+/*
+ *	lpngw.h - PNG writer companion of the Light PNG Loader (lpng.h).
+ *
+ *	The program is distributed under terms of BSD license.
+ *	You can obtain the copy of the license by visiting:
+ *
+ *	http://www.opensource.org/licenses/bsd-license.php
+ */
+
+#ifndef _SAVE_PNG_H_
+#define _SAVE_PNG_H_
+
+/*
+ *	To dump a 32-bit DIB (for example the back buffer of a frame)
+ *	to a disk file use:
+ *
+ *		SavePng(L"c:\\frame.png", hbmp, LPNGW_ALPHA, LPNGW_FAST, 0);
+ *
+ *	To encode raw BGRA pixels into a memory buffer use:
+ *
+ *		unsigned char * png;
+ *		unsigned long   len;
+ *
+ *		if (EncodePng(bits, width, height, width * 4,
+ *		              0, LPNGW_RLE, 4, &png, &len))
+ *		{
+ *			...
+ *			FreePng(png);
+ *		}
+ *
+ *	Pixels are 32-bit B, G, R, A in memory order - the layout of a
+ *	32-bit DIB section. 'stride' is the distance in bytes between the
+ *	first pixels of two adjacent rows, so a bottom-up DIB is passed as
+ *	a pointer to its last line with a negative stride.
+ *
+ *	'threads' greater than 1 splits the image into row groups that are
+ *	filtered and compressed in parallel. The groups are joined with a
+ *	sync flush, so the output is a single ordinary zlib stream.
+ */
+
+/* compression levels */
+#define LPNGW_STORED        0   /* no compression, fastest           */
+#define LPNGW_RLE           1   /* run-length matches only (dist 1)  */
+#define LPNGW_FAST          2   /* greedy hash matching              */
+
+/* flags */
+#define LPNGW_ALPHA         0x01 /* write the alpha channel (RGBA)    */
+#define LPNGW_UNPREMULTIPLY 0x02 /* source is premultiplied, undo it  */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int EncodePng(const void    * pixels,
+              unsigned long   width,
+              unsigned long   height,
+              long            stride,
+              int             flags,
+              int             level,
+              int             threads,
+              unsigned char ** out,
+              unsigned long * outLen);
+
+void FreePng(unsigned char * png);
+
+BOOL SavePng(const wchar_t * fileName,
+             HBITMAP         bmp,
+             int             flags,
+             int             level,
+             int             threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,85 @@
+#include "Bench.h"
+
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+namespace
+{
+    unsigned long allocations;
+    unsigned long long allocated_bytes;
+    bool quick;
+    const void* volatile sink;
+
+} // namespace
+
+// Counts what the code under test allocates with new, which is how the
+// library allocates. The C code of lpng allocates with malloc directly
+// and is not counted.
+void* operator new(size_t size)
+{
+    __sync_add_and_fetch(&allocations, 1);
+    __sync_add_and_fetch(&allocated_bytes, (unsigned long long)size);
+
+    void* p = malloc(size ? size : 1);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) throw()
+{
+    free(p);
+}
+
+void operator delete[](void* p) throw()
+{
+    free(p);
+}
+
+namespace Bench
+{
+
+unsigned long long Now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+unsigned long GetAllocations()
+{
+    return allocations;
+}
+
+unsigned long long GetAllocatedBytes()
+{
+    return allocated_bytes;
+}
+
+bool IsQuick()
+{
+    return quick;
+}
+
+void ParseArgs(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--quick") == 0)
+            quick = true;
+    }
+}
+
+void Consume(const void* p)
+{
+    sink = p;
+}
+
+} // namespace Bench
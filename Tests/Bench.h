@@ -0,0 +1,53 @@
+#pragma once
+
+// Helpers for the benchmarks: a clock, a loop that runs a piece of work
+// long enough to time it, and a count of the allocations made.
+//
+// A benchmark run with --quick does a few iterations of everything, so
+// that ctest can keep it building and running without timing anything.
+
+namespace Bench
+{
+    // Nanoseconds from a monotonic clock.
+    unsigned long long Now();
+
+    // Allocations made with operator new so far by any thread, and the
+    // bytes they asked for.
+    unsigned long GetAllocations();
+    unsigned long long GetAllocatedBytes();
+
+    // True if the benchmark was started with --quick.
+    bool IsQuick();
+    void ParseArgs(int argc, char* argv[]);
+
+    // Keeps the compiler from dropping a result that is never used.
+    void Consume(const void* p);
+
+    // Runs 'work' until about 'minNanoseconds' have passed, at least
+    // once, and returns the nanoseconds per call. The first call is not
+    // timed, it warms the caches and makes the first allocations.
+    template <typename Work>
+    double Measure(Work& work, unsigned long long minNanoseconds = 200000000ULL)
+    {
+        work();
+        if (IsQuick())
+            minNanoseconds = 0;
+
+        unsigned long long calls = 0;
+        unsigned long long start = Now();
+        unsigned long long elapsed = 0;
+        unsigned long long batch = 1;
+        do
+        {
+            for (unsigned long long i = 0; i < batch; ++i)
+                work();
+            calls += batch;
+            elapsed = Now() - start;
+            if (batch < (1ULL << 20))
+                batch *= 2;
+        } while (elapsed < minNanoseconds);
+
+        return (double)elapsed / (double)calls;
+    }
+
+} // namespace Bench
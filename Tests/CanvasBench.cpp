@@ -0,0 +1,126 @@
+#include <stdio.h>
+
+#include <vector>
+
+#include "Bench.h"
+#include "RasterCanvas.h"
+
+// What the raster canvas costs for what the frame draws: the caption
+// and border fills, the button outlines, the icons and the title run.
+// The GDI canvas needs a desktop and is not measured here.
+
+using namespace MetroWindow;
+
+namespace
+{
+    typedef std::vector<unsigned char> Pixels;
+
+    enum Operation
+    {
+        OpFill,
+        OpFrame,
+        OpImage,
+        OpGlyphs
+    };
+
+    const char* const kOperationNames[] = { "fill", "frame", "image", "glyphs" };
+
+    struct CanvasWork
+    {
+        RasterCanvas* canvas;
+        Operation operation;
+        int width;
+        int height;
+        CanvasImage image;
+        const unsigned char* coverage;
+        unsigned long color;
+
+        void operator()()
+        {
+            CanvasRect rect = { 1, 1, 1 + width, 1 + height };
+            switch (operation)
+            {
+                case OpFill:
+                    canvas->FillRect(rect, color);
+                    break;
+
+                case OpFrame:
+                    canvas->FrameRect(rect, color);
+                    break;
+
+                case OpImage:
+                    {
+                        CanvasRect src = { 0, 0, width, height };
+                        canvas->BlendImage(1, 1, image, src);
+                    }
+                    break;
+
+                case OpGlyphs:
+                    canvas->BlendGlyphRun(1, 1, coverage, width, width, height, color);
+                    break;
+            }
+
+            // Another color every time, so nothing can be skipped.
+            color ^= 0x010101;
+        }
+    };
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Bench::ParseArgs(argc, argv);
+
+    const int kSurfaceWidth = 3842;
+    const int kSurfaceHeight = 2162;
+    Pixels surface((size_t)kSurfaceWidth * kSurfaceHeight * 4, 0x80);
+    RasterCanvas canvas(&surface[0], kSurfaceWidth * 4, kSurfaceWidth, kSurfaceHeight);
+
+    // Premultiplied pixels with every alpha, and coverage like text.
+    Pixels image((size_t)3840 * 2160 * 4);
+    for (size_t i = 0; i < image.size(); i += 4)
+    {
+        unsigned char alpha = (unsigned char)(i * 13 / 4);
+        image[i + 0] = (unsigned char)(alpha / 3);
+        image[i + 1] = (unsigned char)(alpha / 2);
+        image[i + 2] = alpha;
+        image[i + 3] = alpha;
+    }
+
+    Pixels coverage((size_t)3840 * 2160);
+    for (size_t i = 0; i < coverage.size(); ++i)
+        coverage[i] = (unsigned char)((i % 7) * (i % 5) * 37);
+
+    // An icon, a caption button, a title, a caption bar, a window.
+    static const int kSizes[][2] =
+    {
+        { 16, 16 }, { 46, 30 }, { 320, 20 }, { 1920, 30 }, { 1920, 1080 }, { 3840, 2160 }
+    };
+
+    printf("%-7s %-11s %12s %10s\n", "op", "size", "ns", "Mpix/s");
+
+    for (int op = OpFill; op <= OpGlyphs; ++op)
+    {
+        for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); ++i)
+        {
+            CanvasWork work;
+            work.canvas = &canvas;
+            work.operation = (Operation)op;
+            work.width = kSizes[i][0];
+            work.height = kSizes[i][1];
+            work.color = 0x204060;
+            work.coverage = &coverage[0];
+
+            CanvasImage canvasImage = { &image[0], work.width * 4, work.width, work.height, NULL };
+            work.image = canvasImage;
+
+            double ns = Bench::Measure(work);
+            double pixels = (op == OpFrame) ? 2.0 * (work.width + work.height) : (double)work.width * work.height;
+            printf("%-7s %5dx%-5d %12.0f %10.1f\n", kOperationNames[op], work.width, work.height,
+                ns, pixels * 1000.0 / ns);
+        }
+    }
+
+    Bench::Consume(&surface[0]);
+    return 0;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+// A small test runner. TEST(Name) defines a test that registers itself,
+// CHECK and CHECK_EQUAL report a failure and end the test that failed.
+//
+//     TEST(SurfaceCapacityRoundsUp)
+//     {
+//         CHECK_EQUAL(64, SurfaceCapacity::RoundUp(1));
+//     }
+
+#include <sstream>
+#include <string>
+
+namespace Check
+{
+    typedef void (* TestFunction)();
+
+    class Registrar
+    {
+    public:
+        Registrar(const char* name, TestFunction function);
+    };
+
+    // Marks the current test failed.
+    void Fail(const char* file, int line, const std::string& message);
+
+    template <typename T>
+    std::string ToString(const T& value)
+    {
+        std::ostringstream out;
+        out << value;
+        return out.str();
+    }
+
+    // Characters print as numbers, they are pixel values here.
+    inline std::string ToString(unsigned char value)
+    {
+        return ToString((int)value);
+    }
+
+    inline std::string ToString(bool value)
+    {
+        return value ? "true" : "false";
+    }
+
+} // namespace Check
+
+#define TEST(name) \
+    static void name(); \
+    static Check::Registrar name##Registrar(#name, name); \
+    static void name()
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            Check::Fail(__FILE__, __LINE__, #condition); \
+            return; \
+        } \
+    } while (0)
+
+#define CHECK_EQUAL(expected, actual) \
+    do \
+    { \
+        if (!((expected) == (actual))) \
+        { \
+            Check::Fail(__FILE__, __LINE__, std::string(#actual) + " is " + \
+                Check::ToString(actual) + ", expected " + Check::ToString(expected)); \
+            return; \
+        } \
+    } while (0)
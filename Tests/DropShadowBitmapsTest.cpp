@@ -0,0 +1,58 @@
+#include "stdafx.h"
+
+#include "Check.h"
+#include "DropShadowBitmaps.h"
+
+using namespace MetroWindow;
+
+namespace
+{
+    unsigned long HashMask(const std::vector<unsigned char>& mask)
+    {
+        unsigned long hash = 2166136261u;
+        for (size_t i = 0; i < mask.size(); ++i)
+            hash = ((hash ^ mask[i]) * 16777619u) & 0xFFFFFFFFu;
+        return hash;
+    }
+
+} // namespace
+
+// The alpha of the eight bitmaps the built-in shadow was drawn from
+// when every pixel was looked up in kShadowCorner and kShadowBorder
+// through its rotation, row by row.
+TEST(DropShadowBitmapsDefaultMasksAreGolden)
+{
+    const unsigned long kCorners[4] = { 0x8D08A27AUL, 0x4426B9A4UL, 0x23EB5FF9UL, 0xDDEB05F2UL };
+    const unsigned long kEdges[4] = { 0x2EA2D364UL, 0xFBAAB1EFUL, 0xFBAAB1EFUL, 0x2EA2D364UL };
+
+    DropShadowBitmaps bitmaps;
+    bitmaps.Initialize();
+
+    const ShadowMasks& masks = bitmaps.GetMasks();
+    CHECK_EQUAL(12, masks.shadow_size);
+    CHECK_EQUAL(26, masks.corner_size);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        CHECK_EQUAL((size_t)(26 * 26), masks.corners[i].size());
+        CHECK_EQUAL((size_t)12, masks.edges[i].size());
+        CHECK_EQUAL(kCorners[i], HashMask(masks.corners[i]));
+        CHECK_EQUAL(kEdges[i], HashMask(masks.edges[i]));
+    }
+}
+
+TEST(DropShadowBitmapsFallBackToDefault)
+{
+    ShadowParams bad = { 0, 0, 0, 0, 0 };
+    DropShadowBitmaps fallback(bad);
+    fallback.Initialize();
+
+    DropShadowBitmaps standard;
+    standard.Initialize();
+
+    for (int i = 0; i < 4; ++i)
+    {
+        CHECK(fallback.GetMasks().corners[i] == standard.GetMasks().corners[i]);
+        CHECK(fallback.GetMasks().edges[i] == standard.GetMasks().edges[i]);
+    }
+}
@@ -0,0 +1,108 @@
+#include "stdafx.h"
+
+#include "Check.h"
+#include "FrameBuffer.h"
+
+using namespace MetroWindow;
+
+TEST(FrameBufferReusesTheBitmap)
+{
+    unsigned long live = ShimGetLiveObjects();
+    CFrameBuffer buffer;
+
+    HDC hdc = buffer.Prepare(800, 600);
+    CHECK(hdc != NULL);
+    CHECK(buffer.GetBits() != NULL);
+    CHECK_EQUAL(2UL, buffer.GetAllocations());
+    CHECK_EQUAL(832, buffer.GetCapacityWidth());
+    CHECK_EQUAL(640, buffer.GetCapacityHeight());
+    CHECK_EQUAL(832 * 4, buffer.GetStride());
+    CHECK_EQUAL(live + 2, ShimGetLiveObjects());
+
+    // Painting at the same or any smaller size creates nothing.
+    BYTE* bits = buffer.GetBits();
+    unsigned long created = ShimGetCreatedObjects();
+    const int kSizes[][2] = { { 800, 600 }, { 832, 640 }, { 400, 300 }, { 1, 1 }, { 810, 610 } };
+    for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); ++i)
+    {
+        CHECK(buffer.Prepare(kSizes[i][0], kSizes[i][1]) == hdc);
+        CHECK(buffer.GetBits() == bits);
+    }
+    CHECK_EQUAL(2UL, buffer.GetAllocations());
+    CHECK_EQUAL(created, ShimGetCreatedObjects());
+
+    // Growing replaces the bitmap and keeps the DC.
+    CHECK(buffer.Prepare(1100, 600) == hdc);
+    CHECK_EQUAL(3UL, buffer.GetAllocations());
+    CHECK_EQUAL(1280, buffer.GetCapacityWidth());
+    CHECK_EQUAL(640, buffer.GetCapacityHeight());
+    CHECK_EQUAL(live + 2, ShimGetLiveObjects());
+
+    // The whole capacity can be written.
+    memset(buffer.GetBits(), 0xFF, (size_t)buffer.GetStride() * buffer.GetCapacityHeight());
+}
+
+TEST(FrameBufferMakesTheDamageRgn)
+{
+    CFrameBuffer buffer;
+    FrameDamage damage;
+    damage.Add(0, 0, 800, 30);
+    damage.Add(0, 30, 4, 600);
+
+    HRGN hrgn = buffer.GetDamageRgn(damage, 10, 20);
+    CHECK(hrgn != NULL);
+    CHECK_EQUAL(2UL, buffer.GetAllocations());
+
+    RECT box;
+    CHECK_EQUAL(COMPLEXREGION, GetRgnBox(hrgn, &box));
+    CHECK_EQUAL(10L, box.left);
+    CHECK_EQUAL(20L, box.top);
+    CHECK_EQUAL(810L, box.right);
+    CHECK_EQUAL(620L, box.bottom);
+    CHECK(PtInRegion(hrgn, 10, 20));
+    CHECK(PtInRegion(hrgn, 13, 619));
+    CHECK(!PtInRegion(hrgn, 14, 50));
+
+    // The next paint reuses both regions.
+    unsigned long created = ShimGetCreatedObjects();
+    FrameDamage button;
+    button.Add(700, 0, 734, 30);
+    CHECK(buffer.GetDamageRgn(button, 0, 0) == hrgn);
+    CHECK_EQUAL(SIMPLEREGION, GetRgnBox(hrgn, &box));
+    CHECK_EQUAL(700L, box.left);
+    CHECK_EQUAL(734L, box.right);
+
+    FrameDamage nothing;
+    CHECK(buffer.GetDamageRgn(nothing, 0, 0) == hrgn);
+    CHECK_EQUAL(NULLREGION, GetRgnBox(hrgn, &box));
+
+    CHECK_EQUAL(2UL, buffer.GetAllocations());
+    CHECK_EQUAL(created, ShimGetCreatedObjects());
+}
+
+TEST(FrameBufferReleasesEverything)
+{
+    unsigned long live = ShimGetLiveObjects();
+    {
+        CFrameBuffer buffer;
+        FrameDamage damage;
+        damage.Add(0, 0, 10, 10);
+
+        CHECK(buffer.Prepare(300, 200) != NULL);
+        CHECK(buffer.GetDamageRgn(damage, 0, 0) != NULL);
+        CHECK_EQUAL(live + 4, ShimGetLiveObjects());
+
+        buffer.Release();
+        CHECK_EQUAL(live, ShimGetLiveObjects());
+        CHECK(buffer.GetDC() == NULL);
+        CHECK(buffer.GetBits() == NULL);
+        CHECK_EQUAL(0, buffer.GetCapacityWidth());
+
+        // The next paint allocates again.
+        CHECK(buffer.Prepare(300, 200) != NULL);
+        CHECK_EQUAL(6UL, buffer.GetAllocations());
+        CHECK_EQUAL(live + 2, ShimGetLiveObjects());
+    }
+
+    CHECK_EQUAL(live, ShimGetLiveObjects());
+}
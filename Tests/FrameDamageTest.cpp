@@ -0,0 +1,169 @@
+#include "Check.h"
+#include "FrameDamage.h"
+
+using namespace MetroWindow;
+
+namespace
+{
+    DamageRect MakeRect(int left, int top, int right, int bottom)
+    {
+        DamageRect rect = { left, top, right, bottom };
+        return rect;
+    }
+
+    bool SameRect(const DamageRect& a, const DamageRect& b)
+    {
+        return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+    }
+
+    bool Covers(const FrameDamage& damage, int x, int y)
+    {
+        for (int i = 0; i < damage.GetCount(); ++i)
+        {
+            const DamageRect& rect = damage.GetRect(i);
+            if (x >= rect.left && x < rect.right && y >= rect.top && y < rect.bottom)
+                return true;
+        }
+        return false;
+    }
+
+} // namespace
+
+TEST(FrameDamageIgnoresEmptyRects)
+{
+    FrameDamage damage;
+    damage.Add(10, 10, 10, 20);
+    damage.Add(10, 10, 20, 10);
+    damage.Add(20, 20, 10, 10);
+
+    CHECK(damage.IsEmpty());
+    CHECK_EQUAL(0L, damage.GetArea());
+    CHECK(SameRect(MakeRect(0, 0, 0, 0), damage.GetBounds()));
+}
+
+TEST(FrameDamageMergesNeighbours)
+{
+    // Three caption buttons side by side.
+    FrameDamage damage;
+    damage.Add(700, 0, 734, 30);
+    damage.Add(768, 0, 802, 30);
+    CHECK_EQUAL(2, damage.GetCount());
+
+    // The one in the middle joins all three.
+    damage.Add(734, 0, 768, 30);
+    CHECK_EQUAL(1, damage.GetCount());
+    CHECK(SameRect(MakeRect(700, 0, 802, 30), damage.GetRect(0)));
+    CHECK_EQUAL(102L * 30, damage.GetArea());
+
+    // Inside or the same adds nothing.
+    damage.Add(710, 5, 720, 25);
+    damage.Add(700, 0, 802, 30);
+    CHECK_EQUAL(1, damage.GetCount());
+    CHECK_EQUAL(102L * 30, damage.GetArea());
+}
+
+TEST(FrameDamageKeepsDistantRectsApart)
+{
+    // The caption and the left border would cover the whole window.
+    FrameDamage damage;
+    damage.Add(0, 0, 800, 30);
+    damage.Add(0, 30, 4, 600);
+    CHECK_EQUAL(2, damage.GetCount());
+    CHECK_EQUAL(800L * 30 + 4L * 570, damage.GetArea());
+    CHECK(SameRect(MakeRect(0, 0, 800, 600), damage.GetBounds()));
+
+    // Overlapping but not worth merging: the overlap counts twice.
+    FrameDamage overlap;
+    overlap.Add(0, 0, 10, 10);
+    overlap.Add(5, 5, 100, 100);
+    CHECK_EQUAL(2, overlap.GetCount());
+    CHECK_EQUAL(100L + 95L * 95, overlap.GetArea());
+}
+
+TEST(FrameDamageCollapsesPastTheLimit)
+{
+    FrameDamage damage;
+    for (int i = 0; i < FrameDamage::kMaxRects; ++i)
+        damage.Add(i * 100, i * 100, i * 100 + 10, i * 100 + 10);
+    CHECK_EQUAL((int)FrameDamage::kMaxRects, damage.GetCount());
+
+    damage.Add(5000, 5000, 5010, 5010);
+    CHECK_EQUAL(1, damage.GetCount());
+    CHECK(SameRect(MakeRect(0, 0, 5010, 5010), damage.GetRect(0)));
+}
+
+TEST(FrameDamageCoversEveryRectAdded)
+{
+    // Random rects on a small grid: whatever is merged, every pixel
+    // added stays covered and the bounds are those of the rects added.
+    const int kSize = 48;
+    unsigned int seed = 12345;
+
+    for (int round = 0; round < 200; ++round)
+    {
+        FrameDamage damage;
+        std::vector<bool> added(kSize * kSize);
+        DamageRect bounds = { kSize, kSize, 0, 0 };
+        int count = 1 + round % 12;
+
+        for (int i = 0; i < count; ++i)
+        {
+            int coords[4];
+            for (int c = 0; c < 4; ++c)
+            {
+                seed = seed * 1103515245u + 12345u;
+                coords[c] = (int)((seed >> 16) % (kSize + 1));
+            }
+
+            DamageRect rect = MakeRect(std::min<int>(coords[0], coords[2]), std::min<int>(coords[1], coords[3]),
+                std::max<int>(coords[0], coords[2]), std::max<int>(coords[1], coords[3]));
+            damage.Add(rect);
+            if (rect.left >= rect.right || rect.top >= rect.bottom)
+                continue;
+
+            for (int y = rect.top; y < rect.bottom; ++y)
+                for (int x = rect.left; x < rect.right; ++x)
+                    added[y * kSize + x] = true;
+
+            bounds.left = std::min<int>(bounds.left, rect.left);
+            bounds.top = std::min<int>(bounds.top, rect.top);
+            bounds.right = std::max<int>(bounds.right, rect.right);
+            bounds.bottom = std::max<int>(bounds.bottom, rect.bottom);
+        }
+
+        CHECK(damage.GetCount() <= FrameDamage::kMaxRects);
+        if (damage.IsEmpty())
+            continue;
+
+        CHECK(SameRect(bounds, damage.GetBounds()));
+        for (int y = 0; y < kSize; ++y)
+        {
+            for (int x = 0; x < kSize; ++x)
+            {
+                if (added[y * kSize + x])
+                    CHECK(Covers(damage, x, y));
+            }
+        }
+    }
+}
+
+TEST(FrameDamageClips)
+{
+    FrameDamage damage;
+    damage.Add(-20, -20, 30, 10);
+    damage.Add(700, 400, 900, 700);
+    damage.Add(1000, 1000, 1100, 1100);
+
+    damage.Clip(MakeRect(0, 0, 800, 600));
+    CHECK_EQUAL(2, damage.GetCount());
+    CHECK(SameRect(MakeRect(0, 0, 30, 10), damage.GetRect(0)));
+    CHECK(SameRect(MakeRect(700, 400, 800, 600), damage.GetRect(1)));
+    CHECK_EQUAL(300L + 100L * 200, damage.GetArea());
+
+    CHECK(damage.Intersects(MakeRect(29, 9, 40, 40)));
+    CHECK(!damage.Intersects(MakeRect(30, 10, 40, 40)));
+    CHECK(!damage.Intersects(MakeRect(1000, 1000, 1100, 1100)));
+
+    damage.Clip(MakeRect(0, 0, 0, 0));
+    CHECK(damage.IsEmpty());
+}
@@ -0,0 +1,200 @@
+#include "Check.h"
+#include "FrameHitTest.h"
+
+using namespace MetroWindow;
+
+namespace
+{
+    bool PtInRect(const CanvasRect& rect, int x, int y)
+    {
+        return x >= rect.left && x < rect.right && y >= rect.top && y < rect.bottom;
+    }
+
+    CanvasRect InflateRect(const CanvasRect& rect, int dx, int dy)
+    {
+        CanvasRect inflated = { rect.left - dx, rect.top - dy, rect.right + dx, rect.bottom + dy };
+        return inflated;
+    }
+
+    // CMetroFrame::OnNcHitTest as it was before the layout was cached,
+    // in window coordinates. The caption buttons were found by their
+    // bounds, which the button manager set from FrameLayout::GetButton,
+    // the last one containing the point winning. "Left to the default
+    // window procedure" is FrameHitDefault.
+    FrameHit OldHitTest(const FrameLayout& layout, bool fullscreen, int x, int y, int* button)
+    {
+        const FrameMetrics& metrics = layout.GetMetrics();
+        CanvasRect rectScreen = { 0, 0, metrics.window_width, metrics.window_height };
+
+        if (!PtInRect(rectScreen, x, y))
+            return FrameHitNowhere;
+
+        CanvasRect rect = rectScreen;
+        if (!fullscreen)
+        {
+            rect = InflateRect(rect, -1, -1);
+            if (!PtInRect(rect, x, y))
+                return (!metrics.dwm_enabled || metrics.sizable) ? FrameHitDefault : FrameHitClient;
+        }
+
+        int found = -1;
+        for (int i = 0; i < metrics.button_count; ++i)
+        {
+            if (PtInRect(layout.GetButton(i), x, y))
+                found = i;
+        }
+        if (found >= 0)
+        {
+            *button = found;
+            return FrameHitButton;
+        }
+
+        if (!fullscreen)
+        {
+            rect = InflateRect(rect, -metrics.border_cx + 1, -metrics.border_cy + 1);
+            if (!PtInRect(rect, x, y))
+                return (!metrics.dwm_enabled || metrics.sizable) ? FrameHitDefault : FrameHitClient;
+        }
+
+        CanvasRect rectCaption = rect;
+        rectCaption.bottom = rectCaption.top + metrics.caption_height;
+        if (!PtInRect(rectCaption, x, y))
+            return FrameHitClient;
+
+        if (metrics.has_sys_menu && PtInRect(layout.GetIcon(), x, y))
+            return FrameHitSysMenu;
+
+        return FrameHitCaption;
+    }
+
+    // The system metrics at 96 and 144 dpi, one without borders, and
+    // one with borders wider than the caption.
+    const int kMetrics[][6] =
+    {
+        // border_cx, border_cy, caption, icon, button_cx, button_cy
+        { 8, 8, 23, 16, 46, 29 },
+        { 11, 11, 34, 24, 68, 43 },
+        { 0, 0, 30, 16, 46, 30 },
+        { 20, 3, 2, 32, 10, 40 }
+    };
+
+    FrameMetrics MakeMetrics(int width, int height, const int* system, int buttons, int styles)
+    {
+        FrameMetrics metrics;
+        metrics.window_width = width;
+        metrics.window_height = height;
+        metrics.border_cx = system[0];
+        metrics.border_cy = system[1];
+        metrics.caption_height = system[2];
+        metrics.icon_cx = system[3];
+        metrics.icon_cy = system[3];
+        metrics.button_cx = system[4];
+        metrics.button_cy = system[5];
+        metrics.button_count = buttons;
+        metrics.has_sys_menu = (styles & 1) != 0;
+        metrics.show_icon = metrics.has_sys_menu;
+        metrics.sizable = (styles & 2) != 0;
+        metrics.dwm_enabled = (styles & 4) != 0;
+        return metrics;
+    }
+
+    // Compares every pixel of the window and a margin around it, in
+    // and out of fullscreen. Returns the number of differences.
+    long CompareEveryPixel(const FrameLayout& layout)
+    {
+        const FrameMetrics& metrics = layout.GetMetrics();
+        const int kMargin = 3;
+        long differences = 0;
+
+        for (int fullscreen = 0; fullscreen < 2; ++fullscreen)
+        {
+            for (int y = -kMargin; y < metrics.window_height + kMargin; ++y)
+            {
+                for (int x = -kMargin; x < metrics.window_width + kMargin; ++x)
+                {
+                    int expectedButton = -1;
+                    int actualButton = -1;
+                    FrameHit expected = OldHitTest(layout, fullscreen != 0, x, y, &expectedButton);
+                    FrameHit actual = FrameHitTest::Classify(layout, fullscreen != 0, x, y, &actualButton);
+
+                    if (expected != actual || (expected == FrameHitButton && expectedButton != actualButton))
+                        ++differences;
+                }
+            }
+        }
+
+        return differences;
+    }
+
+} // namespace
+
+TEST(FrameHitTestMatchesOldHitTest)
+{
+    // From smaller than the borders to a full window, for every style:
+    // system menu, sizable and DWM on or off, with 0 to 3 buttons.
+    const int kSizes[][2] = { { 1, 1 }, { 2, 5 }, { 17, 9 }, { 60, 40 }, { 150, 100 }, { 333, 211 }, { 480, 320 } };
+    const int kButtons[] = { 0, 1, 3 };
+
+    for (size_t m = 0; m < sizeof(kMetrics) / sizeof(kMetrics[0]); ++m)
+    {
+        for (size_t s = 0; s < sizeof(kSizes) / sizeof(kSizes[0]); ++s)
+        {
+            for (size_t b = 0; b < sizeof(kButtons) / sizeof(kButtons[0]); ++b)
+            {
+                for (int styles = 0; styles < 8; ++styles)
+                {
+                    FrameLayout layout(MakeMetrics(kSizes[s][0], kSizes[s][1], kMetrics[m], kButtons[b], styles));
+                    CHECK_EQUAL(0L, CompareEveryPixel(layout));
+                }
+            }
+        }
+    }
+}
+
+TEST(FrameHitTestMatchesOldHitTestOnRandomLayouts)
+{
+    unsigned int seed = 2024;
+    for (int round = 0; round < 400; ++round)
+    {
+        int values[12];
+        for (int i = 0; i < 12; ++i)
+        {
+            seed = seed * 1103515245u + 12345u;
+            values[i] = (int)((seed >> 16) & 0x7FFF);
+        }
+
+        const int system[6] = { values[0] % 16, values[1] % 16, values[2] % 48, 1 + values[3] % 32,
+            1 + values[4] % 80, values[5] % 50 };
+        FrameLayout layout(MakeMetrics(1 + values[6] % 300, 1 + values[7] % 200, system,
+            values[8] % 5, values[9] % 8));
+        CHECK_EQUAL(0L, CompareEveryPixel(layout));
+    }
+}
+
+TEST(FrameHitTestFindsTheParts)
+{
+    // A 96 dpi window with DWM, sizable, three buttons.
+    FrameLayout layout(MakeMetrics(800, 600, kMetrics[0], 3, 7));
+    int button = -1;
+
+    CHECK_EQUAL((int)FrameHitNowhere, (int)FrameHitTest::Classify(layout, false, -1, 10, &button));
+    CHECK_EQUAL((int)FrameHitNowhere, (int)FrameHitTest::Classify(layout, false, 800, 10, &button));
+    CHECK_EQUAL((int)FrameHitDefault, (int)FrameHitTest::Classify(layout, false, 0, 300, &button));
+    CHECK_EQUAL((int)FrameHitDefault, (int)FrameHitTest::Classify(layout, false, 4, 300, &button));
+    CHECK_EQUAL((int)FrameHitClient, (int)FrameHitTest::Classify(layout, false, 400, 300, &button));
+    CHECK_EQUAL((int)FrameHitCaption, (int)FrameHitTest::Classify(layout, false, 400, 15, &button));
+    CHECK_EQUAL((int)FrameHitSysMenu, (int)FrameHitTest::Classify(layout, false, 10, 15, &button));
+
+    // The buttons count from the right.
+    CHECK_EQUAL((int)FrameHitButton, (int)FrameHitTest::Classify(layout, false, 791, 10, &button));
+    CHECK_EQUAL(0, button);
+    CHECK_EQUAL((int)FrameHitButton, (int)FrameHitTest::Classify(layout, false, 792 - 46 * 3, 10, &button));
+    CHECK_EQUAL(2, button);
+
+    // Fullscreen has no borders.
+    CHECK_EQUAL((int)FrameHitClient, (int)FrameHitTest::Classify(layout, true, 0, 300, &button));
+
+    // Not sizable with DWM, the borders are the client's.
+    FrameLayout fixed(MakeMetrics(800, 600, kMetrics[0], 3, 5));
+    CHECK_EQUAL((int)FrameHitClient, (int)FrameHitTest::Classify(fixed, false, 0, 300, &button));
+}
@@ -0,0 +1,85 @@
+#include "FreeTypeGlyphRasterizer.h"
+
+#include <string.h>
+
+namespace
+{
+    // 26.6 fixed point to pixels, rounded up or to the nearest.
+    int CeilPixels(FT_Pos value)
+    {
+        return (int)((value + 63) >> 6);
+    }
+
+    int RoundPixels(FT_Pos value)
+    {
+        return (int)((value + 32) >> 6);
+    }
+
+    // The font is told apart by its file.
+    unsigned long HashPath(const char* path)
+    {
+        unsigned long hash = 2166136261u;
+        for (; *path != '\0'; ++path)
+            hash = ((hash ^ (unsigned char)*path) * 16777619u) & 0xFFFFFFFFu;
+        return hash;
+    }
+
+} // namespace
+
+FreeTypeGlyphRasterizer::FreeTypeGlyphRasterizer(const char* path, int pixelSize)
+    : library_(NULL), face_(NULL), font_id_(HashPath(path)), pixel_size_(pixelSize), ascent_(0), height_(0)
+{
+    if (FT_Init_FreeType(&library_) != 0)
+    {
+        library_ = NULL;
+        return;
+    }
+
+    if (FT_New_Face(library_, path, 0, &face_) != 0)
+    {
+        face_ = NULL;
+        return;
+    }
+
+    if (FT_Set_Pixel_Sizes(face_, 0, pixelSize) != 0)
+    {
+        FT_Done_Face(face_);
+        face_ = NULL;
+        return;
+    }
+
+    ascent_ = CeilPixels(face_->size->metrics.ascender);
+    height_ = ascent_ + CeilPixels(-face_->size->metrics.descender);
+}
+
+FreeTypeGlyphRasterizer::~FreeTypeGlyphRasterizer()
+{
+    if (face_ != NULL)
+        FT_Done_Face(face_);
+    if (library_ != NULL)
+        FT_Done_FreeType(library_);
+}
+
+bool FreeTypeGlyphRasterizer::Rasterize(unsigned int ch, MetroWindow::GlyphBitmap* glyph)
+{
+    if (face_ == NULL)
+        return false;
+
+    FT_UInt index = FT_Get_Char_Index(face_, ch);
+    if (index == 0 || FT_Load_Glyph(face_, index, FT_LOAD_RENDER) != 0)
+        return false;
+
+    const FT_GlyphSlot slot = face_->glyph;
+    if (slot->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY && slot->bitmap.rows > 0)
+        return false;
+
+    memset(glyph, 0, sizeof(*glyph));
+    glyph->coverage = slot->bitmap.buffer;
+    glyph->stride = slot->bitmap.pitch;
+    glyph->width = (int)slot->bitmap.width;
+    glyph->height = (int)slot->bitmap.rows;
+    glyph->left = slot->bitmap_left;
+    glyph->top = slot->bitmap_top;
+    glyph->advance = RoundPixels(slot->advance.x);
+    return true;
+}
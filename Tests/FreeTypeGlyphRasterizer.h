@@ -0,0 +1,35 @@
+#pragma once
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "GlyphAtlas.h"
+
+// Rasterizes the glyphs of a font file with FreeType as 8-bit gray, for
+// the tests and benchmarks that want real glyphs where there is no GDI.
+// METROWINDOW_TEST_FONT is the path of the bundled font.
+class FreeTypeGlyphRasterizer : public MetroWindow::IGlyphRasterizer
+{
+public:
+    // 'pixelSize' is the height of the em in pixels, the way a font of
+    // -pixelSize height is asked for in a LOGFONT.
+    FreeTypeGlyphRasterizer(const char* path, int pixelSize);
+    virtual ~FreeTypeGlyphRasterizer();
+
+    // False if the font file could not be read.
+    bool IsValid() const { return face_ != NULL; }
+
+    virtual unsigned long GetFontId() const { return font_id_; }
+    virtual int GetFontSize() const { return pixel_size_; }
+    virtual int GetAscent() const { return ascent_; }
+    virtual int GetHeight() const { return height_; }
+    virtual bool Rasterize(unsigned int ch, MetroWindow::GlyphBitmap* glyph);
+
+private:
+    FT_Library library_;
+    FT_Face face_;
+    unsigned long font_id_;
+    int pixel_size_;
+    int ascent_;
+    int height_;
+};
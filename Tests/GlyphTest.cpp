@@ -0,0 +1,433 @@
+#include "Check.h"
+#include "GlyphAtlas.h"
+#include "GlyphRun.h"
+#include "PixelOps.h"
+#include "RasterCanvas.h"
+
+#include <string.h>
+#include <wchar.h>
+
+#include <vector>
+
+#ifdef METROWINDOW_TEST_FONT
+#include "FreeTypeGlyphRasterizer.h"
+#endif
+
+using namespace MetroWindow;
+
+namespace
+{
+    typedef std::vector<unsigned char> Pixels;
+
+    // Glyphs made up from the character code, the same on every machine,
+    // so a picture of them can be checked against a hash. Their ink
+    // reaches left of the pen and below the baseline for some, the space
+    // is blank, and characters from 0x4000 up have no glyph.
+    class TestRasterizer : public IGlyphRasterizer
+    {
+    public:
+        TestRasterizer(unsigned long fontId, int size)
+            : font_id_(fontId), size_(size), calls_(0)
+        {
+        }
+
+        virtual unsigned long GetFontId() const { return font_id_; }
+        virtual int GetFontSize() const { return size_; }
+        virtual int GetAscent() const { return size_; }
+        virtual int GetHeight() const { return size_ + size_ / 4 + 1; }
+
+        virtual bool Rasterize(unsigned int ch, GlyphBitmap* glyph)
+        {
+            ++calls_;
+            if (ch >= 0x4000)
+                return false;
+
+            glyph->advance = size_ / 2 + (int)(ch % 5);
+            glyph->left = (int)(ch % 3) - 1;
+            if (ch == L' ')
+            {
+                glyph->width = 0;
+                glyph->height = 0;
+                glyph->top = 0;
+            }
+            else
+            {
+                glyph->width = size_ / 2 + (int)(ch % 4);
+                glyph->height = size_ / 2 + (int)(ch % 7);
+                glyph->top = glyph->height - (int)(ch % 3);
+            }
+
+            glyph->stride = glyph->width + 3;
+            coverage_.assign(glyph->stride * glyph->height + 1, 0);
+            for (int y = 0; y < glyph->height; ++y)
+            {
+                for (int x = 0; x < glyph->width; ++x)
+                    coverage_[y * glyph->stride + x] = (unsigned char)(x * 37 + y * 91 + ch * 13);
+            }
+            glyph->coverage = &coverage_[0];
+            return true;
+        }
+
+        int GetCalls() const { return calls_; }
+
+    private:
+        unsigned long font_id_;
+        int size_;
+        int calls_;
+        Pixels coverage_;
+    };
+
+    // The coverage of 'ch' in the atlas matches what the rasterizer made.
+    bool IsInAtlas(const GlyphAtlas& atlas, IGlyphRasterizer& rasterizer, unsigned int ch,
+        const AtlasGlyph& glyph)
+    {
+        GlyphBitmap bitmap = GlyphBitmap();
+        if (!rasterizer.Rasterize(ch, &bitmap))
+            return false;
+
+        if (glyph.width != bitmap.width || glyph.height != bitmap.height || glyph.left != bitmap.left ||
+            glyph.top != bitmap.top || glyph.advance != bitmap.advance)
+        {
+            return false;
+        }
+
+        for (int y = 0; y < bitmap.height; ++y)
+        {
+            if (memcmp(atlas.GetPixels() + (glyph.y + y) * atlas.GetStride() + glyph.x,
+                bitmap.coverage + y * bitmap.stride, bitmap.width) != 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Draws 'text' the slow way: every glyph rasterized again and added
+    // into one coverage image the size of 'bounds', at the pen positions
+    // of the advances, centered the way GlyphRun::Draw centers. The
+    // ellipsis is not drawn, so the text has to fit.
+    void DrawReference(ICanvas& canvas, IGlyphRasterizer& rasterizer, const wchar_t* text,
+        const CanvasRect& bounds, unsigned long color)
+    {
+        int length = (int)wcslen(text);
+        int width = 0;
+        for (int i = 0; i < length; ++i)
+        {
+            GlyphBitmap bitmap = GlyphBitmap();
+            rasterizer.Rasterize(text[i], &bitmap);
+            width += bitmap.advance;
+        }
+
+        int boundsWidth = bounds.right - bounds.left;
+        int boundsHeight = bounds.bottom - bounds.top;
+        int pen = (boundsWidth - width) / 2;
+        int baseline = (boundsHeight - rasterizer.GetHeight()) / 2 + rasterizer.GetAscent();
+
+        Pixels coverage(boundsWidth * boundsHeight, 0);
+        for (int i = 0; i < length; ++i)
+        {
+            GlyphBitmap bitmap = GlyphBitmap();
+            rasterizer.Rasterize(text[i], &bitmap);
+
+            for (int y = 0; y < bitmap.height; ++y)
+            {
+                for (int x = 0; x < bitmap.width; ++x)
+                {
+                    unsigned char& dst = coverage[(baseline - bitmap.top + y) * boundsWidth + pen + bitmap.left + x];
+                    int sum = dst + bitmap.coverage[y * bitmap.stride + x];
+                    dst = (unsigned char)(sum > 255 ? 255 : sum);
+                }
+            }
+            pen += bitmap.advance;
+        }
+
+        canvas.BlendGlyphRun(bounds.left, bounds.top, &coverage[0], boundsWidth, boundsWidth, boundsHeight, color);
+    }
+
+    unsigned long Hash(const Pixels& pixels)
+    {
+        unsigned long hash = 2166136261u;
+        for (size_t i = 0; i < pixels.size(); ++i)
+            hash = ((hash ^ pixels[i]) * 16777619u) & 0xFFFFFFFFu;
+        return hash;
+    }
+
+    // A COLORREF, which this file has no windows.h for.
+    unsigned long MakeColor(int r, int g, int b)
+    {
+        return (unsigned long)r | ((unsigned long)g << 8) | ((unsigned long)b << 16);
+    }
+
+    // A caption bar with a gradient under the title, drawn with the run
+    // and with the reference, and the pixels of each.
+    void DrawCaption(IGlyphRasterizer& rasterizer, GlyphAtlas& atlas, const wchar_t* text,
+        Pixels* drawn, Pixels* expected)
+    {
+        const int kWidth = 320;
+        const int kHeight = 40;
+
+        Pixels background(kWidth * kHeight * 4);
+        for (size_t i = 0; i < background.size(); ++i)
+            background[i] = (unsigned char)(i * 7 / 5);
+
+        CanvasRect bounds = { 10, 3, kWidth - 10, kHeight - 3 };
+        unsigned long color = MakeColor(250, 240, 20);
+
+        *drawn = background;
+        RasterCanvas canvas(&(*drawn)[0], kWidth * 4, kWidth, kHeight);
+        GlyphRun run;
+        CHECK(run.Layout(atlas, rasterizer, text, (int)wcslen(text), bounds.right - bounds.left));
+        CHECK(!run.IsTruncated());
+        run.Draw(canvas, bounds, color);
+
+        *expected = background;
+        RasterCanvas reference(&(*expected)[0], kWidth * 4, kWidth, kHeight);
+        DrawReference(reference, rasterizer, text, bounds, color);
+    }
+
+} // namespace
+
+TEST(GlyphAtlasRasterizesOncePerFontAndSize)
+{
+    GlyphAtlas atlas;
+    TestRasterizer font(1, 16);
+    TestRasterizer larger(1, 24);
+    TestRasterizer other(2, 16);
+    AtlasGlyph glyph;
+
+    CHECK(atlas.GetGlyph(font, L'A', &glyph));
+    CHECK(atlas.GetGlyph(font, L'A', &glyph));
+    CHECK(atlas.GetGlyph(font, L'A', &glyph));
+    CHECK_EQUAL(1, font.GetCalls());
+    CHECK_EQUAL(2UL, atlas.GetStats().hits);
+    CHECK_EQUAL(1UL, atlas.GetStats().misses);
+
+    // Another size or another font is another glyph.
+    CHECK(atlas.GetGlyph(larger, L'A', &glyph));
+    CHECK(atlas.GetGlyph(other, L'A', &glyph));
+    CHECK_EQUAL(1, larger.GetCalls());
+    CHECK_EQUAL(1, other.GetCalls());
+    CHECK_EQUAL(3UL, atlas.GetStats().misses);
+
+    // Each of them kept its own coverage.
+    CHECK(atlas.GetGlyph(font, L'A', &glyph));
+    CHECK(IsInAtlas(atlas, font, L'A', glyph));
+    CHECK(atlas.GetGlyph(larger, L'A', &glyph));
+    CHECK(IsInAtlas(atlas, larger, L'A', glyph));
+    CHECK_EQUAL(0UL, atlas.GetStats().resets);
+}
+
+TEST(GlyphAtlasKeepsEveryGlyph)
+{
+    // Enough glyphs in three sizes to need many shelves, and more slots
+    // than the table starts with. None may overwrite another.
+    GlyphAtlas atlas(512, 512);
+    TestRasterizer fonts[3] = { TestRasterizer(1, 8), TestRasterizer(1, 13), TestRasterizer(1, 20) };
+
+    for (int f = 0; f < 3; ++f)
+    {
+        for (unsigned int ch = 0x21; ch < 0x21 + 150; ++ch)
+        {
+            AtlasGlyph glyph;
+            CHECK(atlas.GetGlyph(fonts[f], ch, &glyph));
+        }
+    }
+    CHECK_EQUAL(0UL, atlas.GetStats().resets);
+
+    for (int f = 0; f < 3; ++f)
+    {
+        for (unsigned int ch = 0x21; ch < 0x21 + 150; ++ch)
+        {
+            AtlasGlyph glyph;
+            CHECK(atlas.GetGlyph(fonts[f], ch, &glyph));
+            CHECK(IsInAtlas(atlas, fonts[f], ch, glyph));
+        }
+    }
+    CHECK_EQUAL(450UL, atlas.GetStats().misses);
+}
+
+TEST(GlyphAtlasStartsOverWhenFull)
+{
+    GlyphAtlas atlas(48, 48);
+    TestRasterizer font(1, 16);
+    AtlasGlyph glyph;
+
+    unsigned long generation = atlas.GetGeneration();
+    unsigned int ch = 0x21;
+    while (atlas.GetStats().resets == 0)
+        CHECK(atlas.GetGlyph(font, ch++, &glyph));
+
+    // The glyph that did not fit went in after the reset, the ones
+    // before it are gone.
+    CHECK(atlas.GetGeneration() != generation);
+    CHECK(IsInAtlas(atlas, font, ch - 1, glyph));
+
+    int calls = font.GetCalls();
+    CHECK(atlas.GetGlyph(font, 0x21, &glyph));
+    CHECK_EQUAL(calls + 1, font.GetCalls());
+    CHECK(IsInAtlas(atlas, font, 0x21, glyph));
+
+    // Cleared, nothing is left.
+    atlas.Clear();
+    CHECK(atlas.GetPixels() == NULL);
+    CHECK(atlas.GetGlyph(font, 0x21, &glyph));
+    CHECK_EQUAL(calls + 3, font.GetCalls());
+}
+
+TEST(GlyphAtlasRefusesMissingAndOversizedGlyphs)
+{
+    GlyphAtlas atlas(16, 16);
+    TestRasterizer font(1, 16);
+    TestRasterizer huge(1, 40);
+    AtlasGlyph glyph;
+
+    CHECK(!atlas.GetGlyph(font, 0x4000, &glyph));
+    CHECK(!atlas.GetGlyph(huge, L'A', &glyph));
+    CHECK_EQUAL(0UL, atlas.GetStats().resets);
+
+    // The space takes no room.
+    CHECK(atlas.GetGlyph(huge, L' ', &glyph));
+    CHECK_EQUAL(0, (int)glyph.width);
+    CHECK_EQUAL(22, (int)glyph.advance);
+}
+
+TEST(GlyphRunMatchesTheReference)
+{
+    GlyphAtlas atlas;
+    TestRasterizer font(1, 16);
+    const wchar_t* const kTitles[] = { L"Downloading... 42%", L"Metro Window", L"a", L"(ij) [qy] {gj}" };
+
+    for (size_t i = 0; i < sizeof(kTitles) / sizeof(kTitles[0]); ++i)
+    {
+        Pixels drawn;
+        Pixels expected;
+        DrawCaption(font, atlas, kTitles[i], &drawn, &expected);
+        CHECK(drawn == expected);
+
+        // The golden: the first title as first drawn.
+        if (i == 0)
+            CHECK_EQUAL(0x26F06385UL, Hash(drawn));
+    }
+}
+
+TEST(GlyphRunLaysOutAgainWhenTheAtlasStartsOver)
+{
+    // Room for a few glyphs only: the atlas starts over in the middle
+    // of the text, and the run places it all again.
+    GlyphAtlas atlas(48, 40);
+    TestRasterizer font(1, 16);
+    AtlasGlyph glyph;
+
+    for (unsigned int ch = L'a'; ch <= L'g'; ++ch)
+        CHECK(atlas.GetGlyph(font, ch, &glyph));
+    CHECK_EQUAL(0UL, atlas.GetStats().resets);
+
+    Pixels drawn;
+    Pixels expected;
+    DrawCaption(font, atlas, L"zyxwv", &drawn, &expected);
+    CHECK_EQUAL(1UL, atlas.GetStats().resets);
+    CHECK(drawn == expected);
+
+    // Text that needs more than the whole atlas is not laid out.
+    GlyphRun run;
+    CHECK(!run.Layout(atlas, font, L"ABCDEFGHIJKLMNOP", 16, 1000));
+    CHECK(run.IsEmpty());
+}
+
+TEST(GlyphRunEndsWithAnEllipsis)
+{
+    GlyphAtlas atlas;
+    TestRasterizer font(1, 16);
+    const wchar_t* const kText = L"Downloading... 42%";
+    int length = (int)wcslen(kText);
+
+    // The advances of the text and of a dot.
+    int advances[32];
+    int full = 0;
+    for (int i = 0; i < length; ++i)
+    {
+        GlyphBitmap bitmap = GlyphBitmap();
+        font.Rasterize(kText[i], &bitmap);
+        advances[i] = bitmap.advance;
+        full += bitmap.advance;
+    }
+    GlyphBitmap dot = GlyphBitmap();
+    font.Rasterize(L'.', &dot);
+
+    for (int maxWidth = 0; maxWidth <= full + 2; ++maxWidth)
+    {
+        GlyphRun run;
+        CHECK(run.Layout(atlas, font, kText, length, maxWidth));
+
+        if (maxWidth >= full)
+        {
+            CHECK(!run.IsTruncated());
+            CHECK_EQUAL(full, run.GetWidth());
+            continue;
+        }
+
+        // As many characters as fit with the three dots, and none when
+        // not even the dots fit.
+        int kept = 0;
+        int pen = 0;
+        while (kept < length && pen + advances[kept] + dot.advance * 3 <= maxWidth)
+            pen += advances[kept++];
+
+        CHECK(run.IsTruncated());
+        CHECK_EQUAL(pen + dot.advance * 3, run.GetWidth());
+        CHECK(run.GetWidth() <= maxWidth || kept == 0);
+        CHECK_EQUAL(font.GetHeight(), run.GetHeight());
+    }
+}
+
+TEST(GlyphRunLeavesComplexTextToDrawText)
+{
+    GlyphAtlas atlas;
+    TestRasterizer font(1, 16);
+    GlyphRun run;
+
+    CHECK(GlyphRun::IsSimpleText(L"Plain text, 100%", 16));
+    CHECK(GlyphRun::IsSimpleText(L"\x00E9t\x00E9 \x00FC\x00DF \x0416", 8));
+    CHECK(!GlyphRun::IsSimpleText(L"tab\there", 8));
+    CHECK(!GlyphRun::IsSimpleText(L"e\x0301", 2));
+    CHECK(!GlyphRun::IsSimpleText(L"\x05E9\x05DC\x05D5\x05DD", 4));
+    CHECK(!GlyphRun::IsSimpleText(L"\x0645\x0631\x062D\x0628\x0627", 5));
+    CHECK(!GlyphRun::IsSimpleText(L"a\x200Db", 3));
+    CHECK(!GlyphRun::IsSimpleText(L"\xFEFFtitle", 6));
+
+    CHECK(!run.Layout(atlas, font, L"e\x0301", 2, 1000));
+    CHECK(run.IsEmpty());
+
+    // The font has no glyph for one of the characters.
+    CHECK(!run.Layout(atlas, font, L"a\x4E00", 2, 1000));
+    CHECK(run.IsEmpty());
+
+    CHECK(!run.Layout(atlas, font, NULL, 0, 1000));
+    CHECK(run.Layout(atlas, font, L"ok", 2, 1000));
+    CHECK(!run.IsEmpty());
+}
+
+#ifdef METROWINDOW_TEST_FONT
+
+TEST(GlyphRunMatchesTheReferenceWithTheTestFont)
+{
+    // Real glyphs, from the bundled font. Their pixels depend on the
+    // FreeType version, so there is no golden here, only the reference.
+    const int kSizes[] = { 12, 16, 18, 24 };
+
+    for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); ++i)
+    {
+        FreeTypeGlyphRasterizer font(METROWINDOW_TEST_FONT, kSizes[i]);
+        CHECK(font.IsValid());
+        if (!font.IsValid())
+            return;
+
+        GlyphAtlas atlas;
+        Pixels drawn;
+        Pixels expected;
+        DrawCaption(font, atlas, L"Downloading... 42% (Wj)", &drawn, &expected);
+        CHECK(drawn == expected);
+    }
+}
+
+#endif
@@ -0,0 +1,93 @@
+#include <stdio.h>
+
+#include <vector>
+
+#include "Bench.h"
+#include "FrameHitTest.h"
+
+// What a WM_NCHITTEST costs in the frame: one FrameHitTest::Classify on
+// the cached layout, for points spread over the window the way a mouse
+// crosses it, and for points on the caption, where the buttons are
+// looked at as well.
+
+using namespace MetroWindow;
+
+namespace
+{
+    struct Point
+    {
+        int x;
+        int y;
+    };
+
+    struct HitWork
+    {
+        const FrameLayout* layout;
+        const std::vector<Point>* points;
+        size_t next;
+        int hits;
+
+        void operator()()
+        {
+            const Point& point = (*points)[next];
+            next = (next + 1) % points->size();
+
+            int button = 0;
+            hits += FrameHitTest::Classify(*layout, false, point.x, point.y, &button) + button;
+        }
+    };
+
+    // 'count' points in the top 'band' rows of a width x height window,
+    // all of it for a band of 0, with a margin of a few pixels around.
+    std::vector<Point> MakePoints(int width, int height, int band, int count)
+    {
+        std::vector<Point> points(count);
+        unsigned int seed = 7;
+        int rows = band > 0 ? band : height + 6;
+
+        for (int i = 0; i < count; ++i)
+        {
+            seed = seed * 1103515245u + 12345u;
+            points[i].x = (int)((seed >> 8) % (unsigned int)(width + 6)) - 3;
+            seed = seed * 1103515245u + 12345u;
+            points[i].y = (int)((seed >> 8) % (unsigned int)rows) - (band > 0 ? 0 : 3);
+        }
+        return points;
+    }
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Bench::ParseArgs(argc, argv);
+
+    static const int kSizes[][2] = { { 200, 150 }, { 800, 600 }, { 1280, 800 }, { 3840, 2160 } };
+    static const char* const kPlaces[] = { "window", "caption" };
+
+    printf("%-11s %-8s %8s\n", "window", "points", "ns/call");
+
+    for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); ++i)
+    {
+        // 96 dpi, DWM on, sizable, three buttons and the icon.
+        FrameMetrics metrics = { kSizes[i][0], kSizes[i][1], 8, 8, 23, 16, 16, 46, 29, 3, true, true, true, true };
+        FrameLayout layout(metrics);
+
+        for (int place = 0; place < 2; ++place)
+        {
+            std::vector<Point> points = MakePoints(metrics.window_width, metrics.window_height,
+                place == 0 ? 0 : metrics.border_cy + metrics.caption_height, 4096);
+
+            HitWork work;
+            work.layout = &layout;
+            work.points = &points;
+            work.next = 0;
+            work.hits = 0;
+
+            double ns = Bench::Measure(work);
+            Bench::Consume(&work.hits);
+            printf("%5dx%-5d %-8s %8.2f\n", metrics.window_width, metrics.window_height, kPlaces[place], ns);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,508 @@
+#include <windows.h>
+
+#include "Check.h"
+#include "PngSamples.h"
+#include "lpng.h"
+
+using namespace PngSamples;
+
+namespace
+{
+    // Sets the decode budget for one test and puts the default back.
+    class ScopedLimits
+    {
+    public:
+        ScopedLimits(unsigned long maxPixels, unsigned long maxBytes)
+        {
+            lpng_set_limits(maxPixels, maxBytes);
+        }
+
+        ~ScopedLimits()
+        {
+            lpng_set_limits(0, 0);
+        }
+    };
+
+    HBITMAP Load(const Bytes& png, BOOL premultiply)
+    {
+        return LoadPngMem(png.empty() ? NULL : &png[0], (unsigned long)png.size(), premultiply);
+    }
+
+    // The bottom-up DIB of a loaded image as top-down BGRA.
+    Bytes GetPixels(HBITMAP bmp)
+    {
+        DIBSECTION ds;
+        if (GetObject(bmp, sizeof(ds), &ds) != sizeof(ds))
+            return Bytes();
+
+        int width = ds.dsBm.bmWidth;
+        int height = ds.dsBm.bmHeight;
+        const unsigned char* bits = (const unsigned char *)ds.dsBm.bmBits;
+
+        Bytes pixels((size_t)width * height * 4);
+        for (int y = 0; y < height; ++y)
+        {
+            memcpy(&pixels[(size_t)y * width * 4],
+                bits + (size_t)(height - 1 - y) * width * 4, (size_t)width * 4);
+        }
+        return pixels;
+    }
+
+} // namespace
+
+TEST(LpngLoadsWithinBudget)
+{
+    Bytes pixels = MakePixels(64, 48, 1);
+    Bytes png = Encode(pixels, 64, 48, true);
+    CHECK(!png.empty());
+
+    HBITMAP bmp = Load(png, FALSE);
+    CHECK(bmp != NULL);
+    Bytes loaded = GetPixels(bmp);
+    DeleteObject(bmp);
+
+    CHECK(loaded == pixels);
+}
+
+TEST(LpngRejectsTooManyPixels)
+{
+    Bytes png = Encode(MakePixels(64, 48, 2), 64, 48, true);
+    ScopedLimits limits(64 * 48 - 1, 0);
+
+    unsigned long live = ShimGetLiveObjects();
+    CHECK(Load(png, FALSE) == NULL);
+    CHECK_EQUAL(live, ShimGetLiveObjects());
+
+    // The probe reads the header only and has no budget.
+    lpng_info info;
+    CHECK(lpng_probe_mem(&png[0], (unsigned long)png.size(), &info));
+    CHECK_EQUAL(64UL, info.width);
+    CHECK_EQUAL(48UL, info.height);
+}
+
+TEST(LpngRejectsTooManyBytes)
+{
+    Bytes png = Encode(MakePixels(64, 48, 3), 64, 48, true);
+
+    // The inflated data alone is (64 * 4 + 1) * 48 bytes.
+    ScopedLimits limits(0, (64 * 4 + 1) * 48);
+    CHECK(Load(png, FALSE) == NULL);
+}
+
+TEST(LpngRejectsSizesThatOverflow)
+{
+    ScopedLimits limits(0xFFFFFFFFUL, 0xFFFFFFFFUL);
+
+    unsigned long live = ShimGetLiveObjects();
+    CHECK(Load(MakeHeader(0x7FFFFFFFUL, 0x7FFFFFFFUL, 8, 6), FALSE) == NULL);
+    CHECK(Load(MakeHeader(0x7FFFFFFFUL, 1, 8, 6), FALSE) == NULL);
+    CHECK(Load(MakeHeader(1, 0x7FFFFFFFUL, 8, 2), FALSE) == NULL);
+    CHECK(Load(MakeHeader(0x80000000UL, 1, 8, 6), FALSE) == NULL);
+    CHECK(Load(MakeHeader(0, 1, 8, 6), FALSE) == NULL);
+    CHECK_EQUAL(live, ShimGetLiveObjects());
+}
+
+TEST(LpngRejectsTruncatedFiles)
+{
+    Bytes png = Encode(MakePixels(32, 32, 4), 32, 32, false);
+
+    for (size_t len = 0; len < png.size(); len += 7)
+    {
+        Bytes part(png.begin(), png.begin() + len);
+        CHECK(Load(part, FALSE) == NULL);
+    }
+}
+
+TEST(LpngRejectsUnsupportedFormats)
+{
+    // palette, gray and 16-bit images are not loaded
+    CHECK(Load(MakeHeader(16, 16, 8, 3), FALSE) == NULL);
+    CHECK(Load(MakeHeader(16, 16, 8, 0), FALSE) == NULL);
+    CHECK(Load(MakeHeader(16, 16, 16, 6), FALSE) == NULL);
+
+    Bytes header = MakeHeader(16, 16, 16, 6);
+    lpng_info info;
+    CHECK(lpng_probe_mem(&header[0], (unsigned long)header.size(), &info));
+    CHECK_EQUAL(0, (int)info.loadable);
+}
+
+TEST(LpngProbeReadsTheHeader)
+{
+    Bytes png = Encode(MakePixels(37, 19, 5), 37, 19, true);
+
+    lpng_info info;
+    CHECK(lpng_probe_mem(&png[0], (unsigned long)png.size(), &info));
+    CHECK_EQUAL(37UL, info.width);
+    CHECK_EQUAL(19UL, info.height);
+    CHECK_EQUAL(8, (int)info.bit_depth);
+    CHECK_EQUAL(6, (int)info.color_type);
+    CHECK_EQUAL(1, (int)info.has_alpha);
+    CHECK_EQUAL(1, (int)info.loadable);
+    CHECK_EQUAL(0, (int)info.has_phys);
+    CHECK_EQUAL(0, (int)info.has_actl);
+
+    Bytes opaque = Encode(MakePixels(5, 5, 5), 5, 5, false);
+    CHECK(lpng_probe_mem(&opaque[0], (unsigned long)opaque.size(), &info));
+    CHECK_EQUAL(2, (int)info.color_type);
+    CHECK_EQUAL(0, (int)info.has_alpha);
+    CHECK_EQUAL(1, (int)info.loadable);
+
+    // Not a PNG, or cut in the header.
+    Bytes bad = png;
+    bad[1] = 'Q';
+    CHECK(!lpng_probe_mem(&bad[0], (unsigned long)bad.size(), &info));
+    CHECK(!lpng_probe_mem(&png[0], 8 + 8 + 13 + 3, &info));
+    CHECK(!lpng_probe_mem(NULL, 0, &info));
+
+    Bytes empty = MakeHeader(0, 5, 8, 6);
+    CHECK(!lpng_probe_mem(&empty[0], (unsigned long)empty.size(), &info));
+}
+
+TEST(LpngProbeReadsPhysAndActl)
+{
+    Bytes png = Encode(MakePixels(16, 16, 6), 16, 16, true);
+    Bytes both = AddActl(AddPhys(png, 3780, 7560, 1), 12, 3);
+
+    lpng_info info;
+    CHECK(lpng_probe_mem(&both[0], (unsigned long)both.size(), &info));
+    CHECK_EQUAL(1, (int)info.has_phys);
+    CHECK_EQUAL(3780UL, info.phys_x);
+    CHECK_EQUAL(7560UL, info.phys_y);
+    CHECK_EQUAL(1, (int)info.phys_unit);
+    CHECK_EQUAL(1, (int)info.has_actl);
+    CHECK_EQUAL(12UL, info.num_frames);
+    CHECK_EQUAL(3UL, info.num_plays);
+    CHECK_EQUAL(16UL, info.width);
+
+    // Either one alone, and an aspect ratio without a unit.
+    Bytes phys = AddPhys(png, 2, 1, 0);
+    CHECK(lpng_probe_mem(&phys[0], (unsigned long)phys.size(), &info));
+    CHECK_EQUAL(1, (int)info.has_phys);
+    CHECK_EQUAL(0, (int)info.phys_unit);
+    CHECK_EQUAL(0, (int)info.has_actl);
+
+    Bytes actl = AddActl(png, 1, 0);
+    CHECK(lpng_probe_mem(&actl[0], (unsigned long)actl.size(), &info));
+    CHECK_EQUAL(0, (int)info.has_phys);
+    CHECK_EQUAL(1, (int)info.has_actl);
+    CHECK_EQUAL(1UL, info.num_frames);
+    CHECK_EQUAL(0UL, info.num_plays);
+
+    // The decoder skips both.
+    HBITMAP bmp = Load(both, FALSE);
+    CHECK(bmp != NULL);
+    DeleteObject(bmp);
+}
+
+TEST(LpngProbeSkipsMalformedChunks)
+{
+    Bytes png = Encode(MakePixels(16, 16, 7), 16, 16, true);
+
+    // A pHYs of the wrong length is skipped like any other chunk, and
+    // the acTL after it is still found.
+    Bytes shortPhys = InsertChunk(AddActl(png, 4, 0), "pHYs", Bytes(8, 1));
+    lpng_info info;
+    CHECK(lpng_probe_mem(&shortPhys[0], (unsigned long)shortPhys.size(), &info));
+    CHECK_EQUAL(0, (int)info.has_phys);
+    CHECK_EQUAL(1, (int)info.has_actl);
+    CHECK_EQUAL(4UL, info.num_frames);
+
+    Bytes longActl = InsertChunk(AddPhys(png, 1, 1, 1), "acTL", Bytes(9, 1));
+    CHECK(lpng_probe_mem(&longActl[0], (unsigned long)longActl.size(), &info));
+    CHECK_EQUAL(0, (int)info.has_actl);
+    CHECK_EQUAL(1, (int)info.has_phys);
+
+    // Only the chunks in front of the image data are looked at.
+    Bytes late = png;
+    Bytes moved = AddPhys(MakeHeader(16, 16, 8, 6), 5, 5, 1);
+    late.insert(late.end() - 12, moved.begin() + 8 + 25, moved.end() - 12);
+    CHECK(lpng_probe_mem(&late[0], (unsigned long)late.size(), &info));
+    CHECK_EQUAL(0, (int)info.has_phys);
+
+    // A length past what PNG allows ends the scan, not the probe.
+    Bytes huge = InsertChunk(AddPhys(png, 1, 1, 1), "tEXt", Bytes());
+    huge[8 + 25] = 0xFF;
+    CHECK(lpng_probe_mem(&huge[0], (unsigned long)huge.size(), &info));
+    CHECK_EQUAL(16UL, info.width);
+    CHECK_EQUAL(0, (int)info.has_phys);
+}
+
+TEST(LpngProbeStopsAtTheEndOfTruncatedFiles)
+{
+    Bytes png = Encode(MakePixels(16, 16, 8), 16, 16, true);
+    Bytes both = AddPhys(AddActl(png, 2, 0), 3780, 3780, 1);
+
+    // pHYs is first, 21 bytes with its length, type and CRC, then acTL
+    // in 20. Cut anywhere past IHDR, the header is still read.
+    const size_t afterHeader = 8 + 25;
+    for (size_t len = afterHeader; len < afterHeader + 21 + 20 + 8; ++len)
+    {
+        lpng_info info;
+        CHECK(lpng_probe_mem(&both[0], (unsigned long)len, &info));
+        CHECK_EQUAL(16UL, info.width);
+        CHECK_EQUAL(16UL, info.height);
+
+        // A chunk counts once its data and CRC are all there.
+        CHECK_EQUAL(len >= afterHeader + 21 ? 1 : 0, (int)info.has_phys);
+        CHECK_EQUAL(len >= afterHeader + 21 + 20 ? 1 : 0, (int)info.has_actl);
+    }
+}
+
+TEST(LpngProbeLooksAtABoundedNumberOfChunks)
+{
+    Bytes png = Encode(MakePixels(8, 8, 9), 8, 8, true);
+
+    Bytes near = AddPhys(png, 1, 1, 1);
+    for (int i = 0; i < 30; ++i)
+        near = InsertChunk(near, "tEXt", Bytes(3, 'a'));
+
+    lpng_info info;
+    CHECK(lpng_probe_mem(&near[0], (unsigned long)near.size(), &info));
+    CHECK_EQUAL(1, (int)info.has_phys);
+
+    Bytes far = AddPhys(png, 1, 1, 1);
+    for (int i = 0; i < 40; ++i)
+        far = InsertChunk(far, "tEXt", Bytes(3, 'a'));
+
+    CHECK(lpng_probe_mem(&far[0], (unsigned long)far.size(), &info));
+    CHECK_EQUAL(0, (int)info.has_phys);
+    CHECK_EQUAL(8UL, info.width);
+}
+
+namespace
+{
+    // Turns the parallel conversion on for one test and back off.
+    class ScopedThreads
+    {
+    public:
+        ScopedThreads(int threads, unsigned long minPixels)
+        {
+            lpng_set_threads(threads, minPixels);
+        }
+
+        ~ScopedThreads()
+        {
+            lpng_set_threads(1, 0);
+        }
+    };
+
+    // Rows of every filter type in turn over noise, already filtered,
+    // for a file made with MakeFiltered. Any bytes unfilter to some
+    // image, so every filter is used on every kind of row above it.
+    Bytes MakeFilteredRows(int width, int height, bool alpha, unsigned int seed)
+    {
+        size_t rowLength = (size_t)width * (alpha ? 4 : 3) + 1;
+        Bytes rows(rowLength * height);
+        unsigned int noise = seed * 2654435761u + 1;
+
+        for (int y = 0; y < height; ++y)
+        {
+            unsigned char* row = &rows[rowLength * y];
+            row[0] = (unsigned char)((y + seed) % 5);
+            for (size_t i = 1; i < rowLength; ++i)
+            {
+                noise = noise * 1103515245u + 12345u;
+                row[i] = (unsigned char)(noise >> 16);
+            }
+        }
+        return rows;
+    }
+
+    // Loads 'png' on one thread and on 'threads', and compares the
+    // pixels. Both fail or both give the same image.
+    bool LoadsTheSameInParallel(const Bytes& png, BOOL premultiply, int threads)
+    {
+        Bytes serial;
+        HBITMAP bmp = Load(png, premultiply);
+        if (bmp != NULL)
+        {
+            serial = GetPixels(bmp);
+            DeleteObject(bmp);
+        }
+
+        ScopedThreads parallel(threads, 1);
+        bmp = Load(png, premultiply);
+        if (bmp == NULL)
+            return serial.empty();
+
+        Bytes pixels = GetPixels(bmp);
+        DeleteObject(bmp);
+        return !serial.empty() && pixels == serial;
+    }
+
+    const BOOL kPremultiplyModes[] = { FALSE, LPNG_PREMULTIPLY, LPNG_PREMULTIPLY_LINEAR };
+
+} // namespace
+
+TEST(LpngParallelMatchesSerial)
+{
+    // One row per band, a few bands, a short last band, a band that is
+    // the whole image but one row, and more threads than bands.
+    const int kSizes[][2] = { { 70000, 3 }, { 256, 1024 }, { 1000, 333 }, { 3, 70000 }, { 65536, 2 } };
+    const int kThreads[] = { 2, 4, 16 };
+
+    for (size_t s = 0; s < sizeof(kSizes) / sizeof(kSizes[0]); ++s)
+    {
+        int width = kSizes[s][0];
+        int height = kSizes[s][1];
+
+        for (int alpha = 0; alpha < 2; ++alpha)
+        {
+            Bytes png = MakeFiltered(MakeFilteredRows(width, height, alpha != 0, (unsigned int)s),
+                width, height, alpha != 0);
+
+            for (size_t m = 0; m < sizeof(kPremultiplyModes) / sizeof(kPremultiplyModes[0]); ++m)
+            {
+                for (size_t t = 0; t < sizeof(kThreads) / sizeof(kThreads[0]); ++t)
+                    CHECK(LoadsTheSameInParallel(png, kPremultiplyModes[m], kThreads[t]));
+            }
+        }
+    }
+
+    // And what the encoder writes.
+    Bytes png = Encode(MakePixels(777, 555, 3), 777, 555, true);
+    CHECK(LoadsTheSameInParallel(png, FALSE, 4));
+    CHECK(LoadsTheSameInParallel(png, LPNG_PREMULTIPLY_LINEAR, 4));
+}
+
+TEST(LpngParallelStaysOffForSmallImages)
+{
+    // Under the least pixels, and one row, convert on the calling
+    // thread: the DIB is the only object made, no semaphore or workers.
+    Bytes png = Encode(MakePixels(64, 64, 4), 64, 64, true);
+    ScopedThreads parallel(4, 64 * 64 + 1);
+
+    unsigned long created = ShimGetCreatedObjects();
+    HBITMAP bmp = Load(png, LPNG_PREMULTIPLY);
+    CHECK(bmp != NULL);
+    DeleteObject(bmp);
+    CHECK_EQUAL(created + 1, ShimGetCreatedObjects());
+
+    lpng_set_threads(4, 1);
+    Bytes row = Encode(MakePixels(70000, 1, 4), 70000, 1, true);
+    created = ShimGetCreatedObjects();
+    bmp = Load(row, LPNG_PREMULTIPLY);
+    CHECK(bmp != NULL);
+    DeleteObject(bmp);
+    CHECK_EQUAL(created + 1, ShimGetCreatedObjects());
+
+    // The DIB, the semaphore and three workers.
+    created = ShimGetCreatedObjects();
+    bmp = Load(png, LPNG_PREMULTIPLY);
+    CHECK(bmp != NULL);
+    DeleteObject(bmp);
+    CHECK_EQUAL(created + 5, ShimGetCreatedObjects());
+}
+
+TEST(LpngParallelFailsOnACorruptFilterByte)
+{
+    // 256 x 1024 is four bands of 256 rows. The bad filter byte is in
+    // the first row, in a band a worker would take, and in the last row.
+    const int width = 256;
+    const int height = 1024;
+    const int kBadRows[] = { 0, 255, 256, 700, 1023 };
+    ScopedThreads parallel(4, 1);
+
+    for (size_t r = 0; r < sizeof(kBadRows) / sizeof(kBadRows[0]); ++r)
+    {
+        Bytes rows = MakeFilteredRows(width, height, true, 9);
+        rows[((size_t)width * 4 + 1) * kBadRows[r]] = 5;
+        Bytes png = MakeFiltered(rows, width, height, true);
+
+        // Often, for the workers to be at any point when it fails.
+        for (int i = 0; i < 20; ++i)
+        {
+            unsigned long live = ShimGetLiveObjects();
+            CHECK(Load(png, LPNG_PREMULTIPLY) == NULL);
+            CHECK_EQUAL(live, ShimGetLiveObjects());
+        }
+    }
+}
+
+namespace
+{
+    // A 256 x 1 image of every gray level with the same alpha.
+    Bytes MakeGrays(unsigned char alpha)
+    {
+        Bytes pixels(256 * 4);
+        for (int i = 0; i < 256; ++i)
+        {
+            pixels[i * 4 + 0] = (unsigned char)i;
+            pixels[i * 4 + 1] = (unsigned char)(255 - i);
+            pixels[i * 4 + 2] = (unsigned char)i;
+            pixels[i * 4 + 3] = alpha;
+        }
+        return pixels;
+    }
+
+    // The curves a file can have: none (sRGB), sRGB, and gAMA alone.
+    Bytes WithCurve(const Bytes& png, int curve)
+    {
+        static const unsigned long kGammas[] = { 45455, 100000, 55556, 25000, 180000 };
+
+        if (curve == 0)
+            return png;
+        if (curve == 1)
+            return AddSrgb(png);
+        return AddGamma(png, kGammas[curve - 2]);
+    }
+
+    const int kCurves = 7;
+
+} // namespace
+
+TEST(LpngLinearKeepsOpaquePixels)
+{
+    Bytes pixels = MakeGrays(255);
+    Bytes png = Encode(pixels, 256, 1, true);
+
+    for (int curve = 0; curve < kCurves; ++curve)
+    {
+        HBITMAP bmp = Load(WithCurve(png, curve), LPNG_PREMULTIPLY_LINEAR);
+        CHECK(bmp != NULL);
+        Bytes loaded = GetPixels(bmp);
+        DeleteObject(bmp);
+
+        for (int i = 0; i < 256 * 4; ++i)
+            CHECK_EQUAL(pixels[i], loaded[i]);
+    }
+}
+
+TEST(LpngLinearClearsTransparentPixels)
+{
+    Bytes png = Encode(MakeGrays(0), 256, 1, true);
+
+    for (int curve = 0; curve < kCurves; ++curve)
+    {
+        HBITMAP bmp = Load(WithCurve(png, curve), LPNG_PREMULTIPLY_LINEAR);
+        CHECK(bmp != NULL);
+        Bytes loaded = GetPixels(bmp);
+        DeleteObject(bmp);
+
+        for (int i = 0; i < 256 * 4; ++i)
+            CHECK_EQUAL(0, (int)loaded[i]);
+    }
+}
+
+TEST(LpngLinearPremultipliesInLinearLight)
+{
+    // Half covered white is half the light, which sRGB encodes as 188,
+    // where premultiplying the encoded value gives a darker 128.
+    Bytes pixels(4, 255);
+    pixels[3] = 128;
+    Bytes png = Encode(pixels, 1, 1, true);
+
+    HBITMAP bmp = Load(png, LPNG_PREMULTIPLY_LINEAR);
+    CHECK(bmp != NULL);
+    Bytes linear = GetPixels(bmp);
+    DeleteObject(bmp);
+
+    bmp = Load(png, LPNG_PREMULTIPLY);
+    CHECK(bmp != NULL);
+    Bytes encoded = GetPixels(bmp);
+    DeleteObject(bmp);
+
+    CHECK(linear[0] >= 187 && linear[0] <= 189);
+    CHECK_EQUAL(128, (int)linear[3]);
+    CHECK_EQUAL(128, (int)encoded[0]);
+}
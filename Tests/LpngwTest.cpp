@@ -0,0 +1,206 @@
+#include <windows.h>
+
+#include "Check.h"
+#include "PngSamples.h"
+#include "lpng.h"
+#include "lpngw.h"
+
+using namespace PngSamples;
+
+namespace
+{
+    // Encodes with lpngw and decodes with lpng, as top-down BGRA.
+    Bytes RoundTrip(const Bytes& pixels, int width, int height, int flags, int level, int threads)
+    {
+        Bytes png = EncodeEx(pixels, width, height, flags, level, threads);
+        if (png.empty())
+            return Bytes();
+
+        HBITMAP bmp = LoadPngMem(&png[0], (unsigned long)png.size(), FALSE);
+        if (bmp == NULL)
+            return Bytes();
+
+        DIBSECTION ds;
+        GetObject(bmp, sizeof(ds), &ds);
+        const unsigned char* bits = (const unsigned char *)ds.dsBm.bmBits;
+
+        Bytes decoded((size_t)width * height * 4);
+        for (int y = 0; y < height; ++y)
+        {
+            memcpy(&decoded[(size_t)y * width * 4],
+                bits + (size_t)(height - 1 - y) * width * 4, (size_t)width * 4);
+        }
+
+        DeleteObject(bmp);
+        return decoded;
+    }
+
+    // What a file without alpha gives back: the colors, opaque.
+    Bytes MakeOpaque(const Bytes& pixels)
+    {
+        Bytes opaque = pixels;
+        for (size_t i = 3; i < opaque.size(); i += 4)
+            opaque[i] = 255;
+        return opaque;
+    }
+
+    // A frame dump: flat caption and client with a little text and a
+    // gradient border, which the RLE level is made for.
+    Bytes MakeFrame(int width, int height)
+    {
+        Bytes pixels((size_t)width * height * 4);
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                unsigned char* p = &pixels[((size_t)y * width + x) * 4];
+                bool caption = y < 30;
+                bool text = caption && x > 40 && x < 200 && ((x * 7 + y * 3) % 11) < 3;
+
+                p[0] = (unsigned char)(text ? 255 : caption ? 0x80 : 0xF0);
+                p[1] = (unsigned char)(text ? 255 : caption ? 0x40 : 0xF0);
+                p[2] = (unsigned char)(text ? 255 : caption ? 0x20 : 0xF0);
+                p[3] = (unsigned char)(x < 8 ? x * 32 : 255);
+            }
+        }
+        return pixels;
+    }
+
+    const int kLevels[] = { LPNGW_STORED, LPNGW_RLE, LPNGW_FAST };
+    const int kThreads[] = { 1, 2, 4, 16 };
+
+} // namespace
+
+TEST(LpngwRoundTripsEveryLevelAndThreadCount)
+{
+    // Large enough for several row groups, and a size that leaves a
+    // short group at the end.
+    const int kSizes[][2] = { { 1, 1 }, { 3, 2 }, { 97, 61 }, { 300, 457 } };
+
+    for (size_t s = 0; s < sizeof(kSizes) / sizeof(kSizes[0]); ++s)
+    {
+        int width = kSizes[s][0];
+        int height = kSizes[s][1];
+        Bytes pixels = MakePixels(width, height, (unsigned int)s);
+        Bytes opaque = MakeOpaque(pixels);
+
+        for (size_t l = 0; l < sizeof(kLevels) / sizeof(kLevels[0]); ++l)
+        {
+            for (size_t t = 0; t < sizeof(kThreads) / sizeof(kThreads[0]); ++t)
+            {
+                CHECK(RoundTrip(pixels, width, height, LPNGW_ALPHA, kLevels[l], kThreads[t]) == pixels);
+                CHECK(RoundTrip(pixels, width, height, 0, kLevels[l], kThreads[t]) == opaque);
+            }
+        }
+    }
+}
+
+TEST(LpngwRoundTripsFrameDumps)
+{
+    Bytes pixels = MakeFrame(640, 480);
+
+    for (size_t l = 0; l < sizeof(kLevels) / sizeof(kLevels[0]); ++l)
+    {
+        for (size_t t = 0; t < sizeof(kThreads) / sizeof(kThreads[0]); ++t)
+            CHECK(RoundTrip(pixels, 640, 480, LPNGW_ALPHA, kLevels[l], kThreads[t]) == pixels);
+    }
+
+    // The levels do what they say for flat pixels.
+    size_t stored = EncodeEx(pixels, 640, 480, LPNGW_ALPHA, LPNGW_STORED, 1).size();
+    size_t rle = EncodeEx(pixels, 640, 480, LPNGW_ALPHA, LPNGW_RLE, 1).size();
+    size_t fast = EncodeEx(pixels, 640, 480, LPNGW_ALPHA, LPNGW_FAST, 1).size();
+    CHECK(stored > (size_t)640 * 480 * 4);
+    CHECK(rle * 10 < stored);
+    CHECK(fast <= rle);
+
+    // Row groups end with a sync flush, so more threads is another
+    // file with the same pixels.
+    CHECK(EncodeEx(pixels, 640, 480, LPNGW_ALPHA, LPNGW_FAST, 4) !=
+        EncodeEx(pixels, 640, 480, LPNGW_ALPHA, LPNGW_FAST, 1));
+}
+
+TEST(LpngwEncodesBottomUpRows)
+{
+    // A bottom-up DIB is passed as its last line with a negative stride.
+    const int width = 33;
+    const int height = 21;
+    Bytes pixels = MakePixels(width, height, 7);
+
+    Bytes bottomUp(pixels.size());
+    for (int y = 0; y < height; ++y)
+    {
+        memcpy(&bottomUp[(size_t)(height - 1 - y) * width * 4],
+            &pixels[(size_t)y * width * 4], (size_t)width * 4);
+    }
+
+    unsigned char* png = NULL;
+    unsigned long len = 0;
+    CHECK(EncodePng(&bottomUp[(size_t)(height - 1) * width * 4], width, height, -width * 4,
+        LPNGW_ALPHA, LPNGW_FAST, 1, &png, &len));
+
+    HBITMAP bmp = LoadPngMem(png, len, FALSE);
+    FreePng(png);
+    CHECK(bmp != NULL);
+
+    // The DIB lpng makes is bottom-up too.
+    DIBSECTION ds;
+    GetObject(bmp, sizeof(ds), &ds);
+    CHECK(memcmp(ds.dsBm.bmBits, &bottomUp[0], bottomUp.size()) == 0);
+    DeleteObject(bmp);
+}
+
+TEST(LpngwUndoesPremultiplication)
+{
+    // Every alpha with colors that go up to it, and some over it.
+    Bytes premultiplied(256 * 4 * 4);
+    for (int a = 0; a < 256; ++a)
+    {
+        for (int k = 0; k < 4; ++k)
+        {
+            unsigned char* p = &premultiplied[(a * 4 + k) * 4];
+            p[0] = (unsigned char)(a * k / 3);
+            p[1] = (unsigned char)(a / 2);
+            p[2] = (unsigned char)(k == 3 ? (a + 9 > 255 ? 255 : a + 9) : a / 7);
+            p[3] = (unsigned char)a;
+        }
+    }
+
+    for (size_t l = 0; l < sizeof(kLevels) / sizeof(kLevels[0]); ++l)
+    {
+        Bytes decoded = RoundTrip(premultiplied, 1024, 1, LPNGW_ALPHA | LPNGW_UNPREMULTIPLY, kLevels[l], 1);
+        CHECK_EQUAL(premultiplied.size(), decoded.size());
+
+        for (size_t i = 0; i < premultiplied.size() && i < decoded.size(); i += 4)
+        {
+            int a = premultiplied[i + 3];
+            CHECK_EQUAL(a, (int)decoded[i + 3]);
+
+            for (int c = 0; c < 3; ++c)
+            {
+                int value = premultiplied[i + c];
+                int expected = (a == 0) ? 0 : (value >= a) ? 255 : (value * 255 + a / 2) / a;
+                CHECK_EQUAL(expected, (int)decoded[i + c]);
+            }
+        }
+    }
+
+    // Without alpha in the file there is nothing to undo.
+    CHECK(RoundTrip(premultiplied, 1024, 1, LPNGW_UNPREMULTIPLY, LPNGW_FAST, 1) == MakeOpaque(premultiplied));
+}
+
+TEST(LpngwRejectsBadArguments)
+{
+    Bytes pixels = MakePixels(4, 4, 1);
+    unsigned char* png = (unsigned char*)&pixels[0];
+    unsigned long len = 1;
+
+    CHECK(!EncodePng(NULL, 4, 4, 16, 0, LPNGW_FAST, 1, &png, &len));
+    CHECK(png == NULL);
+    CHECK_EQUAL(0UL, len);
+    CHECK(!EncodePng(&pixels[0], 0, 4, 16, 0, LPNGW_FAST, 1, &png, &len));
+    CHECK(!EncodePng(&pixels[0], 4, 0, 16, 0, LPNGW_FAST, 1, &png, &len));
+    CHECK(!EncodePng(&pixels[0], 4, 4, 16, 0, LPNGW_FAST + 1, 1, &png, &len));
+    CHECK(!EncodePng(&pixels[0], 4, 4, 16, 0, LPNGW_STORED - 1, 1, &png, &len));
+    CHECK(!EncodePng(&pixels[0], 0x40000000UL, 4, 16, 0, LPNGW_FAST, 1, &png, &len));
+    CHECK(png == NULL);
+}
@@ -0,0 +1,240 @@
+#include "Check.h"
+#include "FrameDamage.h"
+#include "PaintScheduler.h"
+
+using namespace MetroWindow;
+
+namespace
+{
+    // CMetroFrame::SchedulePaint and FlushPaint with the message queue,
+    // the timer and the paint played by counters.
+    struct FakeFrame
+    {
+        PaintScheduler scheduler;
+        FrameDamage damage;
+        bool can_post;
+        int posted;             // flush messages in the queue
+        unsigned long timer;    // the delay of the timer set, 0 for none
+        int paints;
+        long painted_area;
+
+        FakeFrame(void)
+            : can_post(true), posted(0), timer(0), paints(0), painted_area(0)
+        {
+        }
+
+        void Invalidate(int left, int top, int right, int bottom, unsigned long now)
+        {
+            damage.Add(left, top, right, bottom);
+            if (scheduler.Request())
+            {
+                if (can_post)
+                    ++posted;
+                else
+                    Flush(false, now);
+            }
+        }
+
+        // The flush message or the timer arrived.
+        void Flush(bool delayed, unsigned long now)
+        {
+            unsigned long delay = 0;
+            bool paint = delayed ? scheduler.FlushDelayed(now, &delay) : scheduler.Flush(now, &delay);
+
+            if (delay != 0)
+                timer = delay;
+            if (paint)
+                Paint(now);
+        }
+
+        // Handles the flush messages in the queue.
+        void RunQueue(unsigned long now)
+        {
+            while (posted > 0)
+            {
+                --posted;
+                Flush(false, now);
+            }
+        }
+
+        void FireTimer(unsigned long now)
+        {
+            CHECK(timer != 0);
+            timer = 0;
+            Flush(true, now);
+        }
+
+        // PaintFrameDamage, also called for WM_NCPAINT.
+        void Paint(unsigned long now)
+        {
+            ++paints;
+            painted_area += damage.GetArea();
+            damage.Clear();
+            scheduler.Painted(now);
+        }
+    };
+
+} // namespace
+
+TEST(PaintSchedulerPaintsManyChangesOnce)
+{
+    const int kCounts[] = { 1, 2, 8, 100, 1000 };
+
+    for (size_t i = 0; i < sizeof(kCounts) / sizeof(kCounts[0]); ++i)
+    {
+        FakeFrame frame;
+
+        // The caption buttons, the title and the icon all change in one
+        // turn of the message loop.
+        for (int n = 0; n < kCounts[i]; ++n)
+            frame.Invalidate(10 + (n % 4) * 46, 0, 56 + (n % 4) * 46, 30, 1000);
+
+        CHECK_EQUAL(1, frame.posted);
+        CHECK_EQUAL(0, frame.paints);
+        CHECK(frame.scheduler.IsPending());
+
+        frame.RunQueue(1000);
+        CHECK_EQUAL(1, frame.paints);
+        CHECK(!frame.scheduler.IsPending());
+
+        // The buttons side by side were painted as one rectangle.
+        CHECK_EQUAL((kCounts[i] < 4 ? kCounts[i] : 4) * 46L * 30L, frame.painted_area);
+
+        const PaintSchedulerStats& stats = frame.scheduler.GetStats();
+        CHECK_EQUAL((unsigned long)kCounts[i], stats.requests);
+        CHECK_EQUAL(1UL, stats.paints);
+        CHECK_EQUAL(0UL, stats.delays);
+    }
+}
+
+TEST(PaintSchedulerPostsAgainAfterTheFlush)
+{
+    FakeFrame frame;
+
+    for (int turn = 0; turn < 5; ++turn)
+    {
+        frame.Invalidate(0, 0, 100, 30, turn * 100);
+        frame.Invalidate(0, 0, 100, 30, turn * 100);
+        CHECK_EQUAL(1, frame.posted);
+
+        frame.RunQueue(turn * 100);
+        CHECK_EQUAL(turn + 1, frame.paints);
+    }
+
+    // A flush with nothing owed paints nothing.
+    unsigned long delay = 1;
+    CHECK(!frame.scheduler.Flush(1000, &delay));
+    CHECK_EQUAL(0UL, delay);
+    CHECK_EQUAL(5UL, frame.scheduler.GetStats().paints);
+}
+
+TEST(PaintSchedulerFlushesAtOnceWhenItCannotPost)
+{
+    FakeFrame frame;
+    frame.can_post = false;
+
+    frame.Invalidate(0, 0, 100, 30, 0);
+    CHECK_EQUAL(1, frame.paints);
+
+    // Every change paints, there is no message to wait for.
+    frame.Invalidate(0, 0, 100, 30, 1);
+    CHECK_EQUAL(2, frame.paints);
+    CHECK_EQUAL(0, frame.posted);
+}
+
+TEST(PaintSchedulerSkipsTheFlushAfterAnNcPaint)
+{
+    FakeFrame frame;
+
+    frame.Invalidate(0, 0, 100, 30, 0);
+
+    // WM_NCPAINT came first and painted the damage.
+    frame.Paint(5);
+    frame.RunQueue(6);
+
+    CHECK_EQUAL(1, frame.paints);
+    CHECK_EQUAL(0UL, frame.scheduler.GetStats().paints);
+}
+
+TEST(PaintSchedulerKeepsPaintsApartDuringLiveResize)
+{
+    FakeFrame frame;
+    frame.scheduler.SetMinInterval(16);
+
+    // The first paint has nothing to wait for.
+    frame.Invalidate(0, 0, 800, 600, 1000);
+    frame.RunQueue(1000);
+    CHECK_EQUAL(1, frame.paints);
+
+    // WM_SIZE every 4 ms: each turn posts again, and the first flush
+    // too early sets the timer for the rest of the interval.
+    frame.Invalidate(0, 0, 801, 600, 1004);
+    frame.RunQueue(1004);
+    CHECK_EQUAL(1, frame.paints);
+    CHECK_EQUAL(12UL, frame.timer);
+
+    frame.Invalidate(0, 0, 802, 600, 1008);
+    frame.RunQueue(1008);
+    frame.Invalidate(0, 0, 803, 600, 1012);
+    frame.RunQueue(1012);
+    CHECK_EQUAL(1, frame.paints);
+    CHECK_EQUAL(1UL, frame.scheduler.GetStats().delays);
+
+    // The timer paints all of it once.
+    frame.FireTimer(1016);
+    CHECK_EQUAL(2, frame.paints);
+    CHECK(!frame.scheduler.IsPending());
+    CHECK_EQUAL(0UL, frame.timer);
+
+    // Once the interval has passed a flush paints right away.
+    frame.Invalidate(0, 0, 804, 600, 1040);
+    frame.RunQueue(1040);
+    CHECK_EQUAL(3, frame.paints);
+
+    const PaintSchedulerStats& stats = frame.scheduler.GetStats();
+    CHECK_EQUAL(5UL, stats.requests);
+    CHECK_EQUAL(3UL, stats.paints);
+    CHECK_EQUAL(1UL, stats.delays);
+}
+
+TEST(PaintSchedulerCountsTheIntervalAcrossAClockWrap)
+{
+    FakeFrame frame;
+    frame.scheduler.SetMinInterval(16);
+
+    unsigned long start = (unsigned long)-5;
+    frame.Invalidate(0, 0, 100, 30, start);
+    frame.RunQueue(start);
+
+    // 5 ms later the clock reads 0.
+    frame.Invalidate(0, 0, 100, 30, 0);
+    frame.RunQueue(0);
+    CHECK_EQUAL(1, frame.paints);
+    CHECK_EQUAL(11UL, frame.timer);
+
+    frame.FireTimer(11);
+    CHECK_EQUAL(2, frame.paints);
+}
+
+TEST(PaintSchedulerPaintsWhenTheIntervalIsDropped)
+{
+    FakeFrame frame;
+    frame.scheduler.SetMinInterval(16);
+
+    frame.Invalidate(0, 0, 100, 30, 0);
+    frame.RunQueue(0);
+    frame.Invalidate(0, 0, 100, 30, 2);
+    frame.RunQueue(2);
+    CHECK_EQUAL(14UL, frame.timer);
+
+    // The user let go before the timer fired.
+    frame.scheduler.SetMinInterval(0);
+    frame.FireTimer(3);
+    CHECK_EQUAL(2, frame.paints);
+
+    // Without an interval nothing waits.
+    frame.Invalidate(0, 0, 100, 30, 4);
+    frame.RunQueue(4);
+    CHECK_EQUAL(3, frame.paints);
+    CHECK_EQUAL(1UL, frame.scheduler.GetStats().delays);
+}
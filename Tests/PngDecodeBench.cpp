@@ -0,0 +1,94 @@
+#include <windows.h>
+#include <stdio.h>
+
+#include "Bench.h"
+#include "PngSamples.h"
+#include "lpng.h"
+
+// Decode throughput of lpng, and what the checks made before decoding
+// cost next to it. The probe reads the signature and IHDR and makes the
+// same format and size checks as the decoder, so its time is an upper
+// bound for the budget checks.
+//
+// Every decode is also timed with the conversion to the DIB on four
+// threads. Bands are 64K pixels, so up to 256x256 the image is one band
+// and the column shows what starting the workers costs.
+
+using namespace PngSamples;
+
+namespace
+{
+    struct Decode
+    {
+        const Bytes* png;
+        BOOL premultiply;
+
+        void operator()()
+        {
+            HBITMAP bmp = LoadPngMem(&(*png)[0], (unsigned long)png->size(), premultiply);
+            Bench::Consume(bmp);
+            DeleteObject(bmp);
+        }
+    };
+
+    struct Probe
+    {
+        const Bytes* png;
+
+        void operator()()
+        {
+            lpng_info info;
+            lpng_probe_mem(&(*png)[0], (unsigned long)png->size(), &info);
+            Bench::Consume(&info);
+        }
+    };
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Bench::ParseArgs(argc, argv);
+
+    static const int kSizes[][2] =
+    {
+        { 16, 16 }, { 64, 64 }, { 256, 256 }, { 1024, 768 }, { 2048, 2048 }
+    };
+
+    printf("%-11s %-8s %12s %9s %12s %8s %10s %8s\n",
+        "size", "mode", "decode ns", "MB/s", "4 thr ns", "speedup", "probe ns", "probe %");
+
+    for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); ++i)
+    {
+        int width = kSizes[i][0];
+        int height = kSizes[i][1];
+        if (Bench::IsQuick() && width > 256)
+            break;
+
+        Bytes png = Encode(MakePixels(width, height, (unsigned int)i), width, height, true);
+        if (png.empty())
+            return 1;
+
+        Probe probe = { &png };
+        double probeNs = Bench::Measure(probe);
+
+        static const BOOL kModes[] = { FALSE, LPNG_PREMULTIPLY, LPNG_PREMULTIPLY_LINEAR };
+        static const char* kModeNames[] = { "plain", "premul", "linear" };
+
+        for (size_t mode = 0; mode < sizeof(kModes) / sizeof(kModes[0]); ++mode)
+        {
+            Decode decode = { &png, kModes[mode] };
+            double decodeNs = Bench::Measure(decode);
+            double megabytes = (double)width * height * 4 / (1024.0 * 1024.0);
+
+            lpng_set_threads(4, 1);
+            double parallelNs = Bench::Measure(decode);
+            lpng_set_threads(1, 0);
+
+            printf("%5dx%-5d %-8s %12.0f %9.1f %12.0f %7.2fx %10.0f %7.3f%%\n",
+                width, height, kModeNames[mode], decodeNs, megabytes / (decodeNs / 1e9),
+                parallelNs, decodeNs / parallelNs, probeNs, probeNs * 100.0 / decodeNs);
+        }
+    }
+
+    return 0;
+}
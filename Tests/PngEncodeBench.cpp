@@ -0,0 +1,103 @@
+#include <windows.h>
+#include <stdio.h>
+
+#include "Bench.h"
+#include "PngSamples.h"
+#include "lpngw.h"
+
+// Encode throughput of lpngw for every level, on one thread and on
+// four, and the size of the file next to the raw pixels. Two kinds of
+// image: a frame dump, flat with a little text, which is what lpngw is
+// for, and noisy gradients, which compress the least.
+
+using namespace PngSamples;
+
+namespace
+{
+    struct EncodeWork
+    {
+        const Bytes* pixels;
+        int width;
+        int height;
+        int level;
+        int threads;
+        unsigned long length;
+
+        void operator()()
+        {
+            unsigned char* png = NULL;
+            if (EncodePng(&(*pixels)[0], width, height, width * 4, LPNGW_ALPHA, level, threads,
+                    &png, &length))
+            {
+                Bench::Consume(png);
+                FreePng(png);
+            }
+        }
+    };
+
+    Bytes MakeFrame(int width, int height)
+    {
+        Bytes pixels((size_t)width * height * 4);
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                unsigned char* p = &pixels[((size_t)y * width + x) * 4];
+                bool caption = y < 30;
+                bool text = caption && x > 40 && x < 200 && ((x * 7 + y * 3) % 11) < 3;
+
+                p[0] = (unsigned char)(text ? 255 : caption ? 0x80 : 0xF0);
+                p[1] = (unsigned char)(text ? 255 : caption ? 0x40 : 0xF0);
+                p[2] = (unsigned char)(text ? 255 : caption ? 0x20 : 0xF0);
+                p[3] = 255;
+            }
+        }
+        return pixels;
+    }
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Bench::ParseArgs(argc, argv);
+
+    static const int kSizes[][2] =
+    {
+        { 64, 64 }, { 256, 256 }, { 1024, 768 }, { 1920, 1080 }, { 3840, 2160 }
+    };
+    static const int kLevels[] = { LPNGW_STORED, LPNGW_RLE, LPNGW_FAST };
+    static const char* const kLevelNames[] = { "stored", "rle", "fast" };
+    static const int kThreads[] = { 1, 4 };
+
+    printf("%-11s %-6s %-7s %7s %12s %9s %8s\n",
+        "size", "image", "level", "threads", "encode ns", "MB/s", "size %");
+
+    for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); ++i)
+    {
+        int width = kSizes[i][0];
+        int height = kSizes[i][1];
+        if (Bench::IsQuick() && width > 256)
+            break;
+
+        for (int image = 0; image < 2; ++image)
+        {
+            Bytes pixels = (image == 0) ? MakeFrame(width, height) : MakePixels(width, height, (unsigned int)i);
+
+            for (size_t l = 0; l < sizeof(kLevels) / sizeof(kLevels[0]); ++l)
+            {
+                for (size_t t = 0; t < sizeof(kThreads) / sizeof(kThreads[0]); ++t)
+                {
+                    EncodeWork work = { &pixels, width, height, kLevels[l], kThreads[t], 0 };
+                    double ns = Bench::Measure(work);
+                    double megabytes = (double)pixels.size() / (1024.0 * 1024.0);
+
+                    printf("%5dx%-5d %-6s %-7s %7d %12.0f %9.1f %7.2f%%\n",
+                        width, height, image == 0 ? "frame" : "noise", kLevelNames[l], kThreads[t], ns,
+                        megabytes / (ns / 1e9), work.length * 100.0 / pixels.size());
+                }
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include <windows.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "lpng.h"
+
+// Feeds the input to the probe and to the decoder with a small budget,
+// in every premultiply mode. Built for libFuzzer when the compiler has
+// it, otherwise PngFuzzMain.cpp drives it.
+//
+// Besides crashes, it stops on a decoder that accepted what the probe
+// says it cannot load, or an image over the budget.
+
+namespace
+{
+    const unsigned long kMaxPixels = 1024 * 1024;
+    const unsigned long kMaxBytes = 8 * 1024 * 1024;
+
+    const BOOL kModes[] = { FALSE, LPNG_PREMULTIPLY, LPNG_PREMULTIPLY_LINEAR };
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    static bool initialized = false;
+    if (!initialized)
+    {
+        lpng_set_limits(kMaxPixels, kMaxBytes);
+        initialized = true;
+    }
+
+    if (size > 0xFFFFFFFFUL)
+        return 0;
+
+    lpng_info info;
+    int probed = lpng_probe_mem(data, (unsigned long)size, &info);
+
+    for (size_t i = 0; i < sizeof(kModes) / sizeof(kModes[0]); ++i)
+    {
+        HBITMAP bmp = LoadPngMem(data, (unsigned long)size, kModes[i]);
+        if (bmp == NULL)
+            break;
+
+        DIBSECTION ds;
+        if (!probed || !info.loadable ||
+            GetObject(bmp, sizeof(ds), &ds) != sizeof(ds) ||
+            (unsigned long)ds.dsBm.bmWidth != info.width ||
+            (unsigned long)ds.dsBm.bmHeight != info.height ||
+            info.width > kMaxPixels / info.height)
+        {
+            abort();
+        }
+
+        DeleteObject(bmp);
+    }
+
+    return 0;
+}
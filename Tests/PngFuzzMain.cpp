@@ -0,0 +1,137 @@
+#include <windows.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "PngSamples.h"
+
+// Runs the fuzz target without libFuzzer: over the files named on the
+// command line, or over mutations of a few generated images. The
+// mutations are random but seeded, so a failure is repeatable.
+//
+//     PngFuzz [-runs=N] [file...]
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+using namespace PngSamples;
+
+namespace
+{
+    unsigned int state = 12345;
+
+    unsigned int Random(unsigned int range)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state % range;
+    }
+
+    void Run(const Bytes& input)
+    {
+        LLVMFuzzerTestOneInput(input.empty() ? NULL : &input[0], input.size());
+    }
+
+    bool RunFile(const char* name)
+    {
+        FILE* fh = fopen(name, "rb");
+        if (fh == NULL)
+        {
+            fprintf(stderr, "cannot open %s\n", name);
+            return false;
+        }
+
+        Bytes input;
+        unsigned char buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), fh)) > 0)
+            input.insert(input.end(), buf, buf + n);
+        fclose(fh);
+
+        Run(input);
+        return true;
+    }
+
+    Bytes Mutate(const Bytes& seed)
+    {
+        Bytes input = seed;
+        int count = 1 + (int)Random(4);
+
+        for (int i = 0; i < count && !input.empty(); ++i)
+        {
+            size_t at = Random((unsigned int)input.size());
+            switch (Random(5))
+            {
+            case 0: // flip a bit
+                input[at] ^= (unsigned char)(1 << Random(8));
+                break;
+            case 1: // an extreme byte, for lengths and sizes
+                input[at] = (Random(2) != 0) ? 0xFF : 0x00;
+                break;
+            case 2: // cut the file short
+                input.resize(at);
+                break;
+            case 3: // a big-endian word that overflows
+                if (at + 4 <= input.size())
+                {
+                    input[at] = 0x7F;
+                    input[at + 1] = (unsigned char)Random(256);
+                    input[at + 2] = 0xFF;
+                    input[at + 3] = 0xFF;
+                }
+                break;
+            default: // repeat a run of bytes
+                {
+                    size_t len = Random(64) + 1;
+                    if (at + len <= input.size())
+                    {
+                        Bytes run(input.begin() + at, input.begin() + at + len);
+                        input.insert(input.begin() + at, run.begin(), run.end());
+                    }
+                }
+                break;
+            }
+        }
+
+        return input;
+    }
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    long runs = 20000;
+    bool files = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strncmp(argv[i], "-runs=", 6) == 0)
+        {
+            runs = atol(argv[i] + 6);
+            continue;
+        }
+
+        if (!RunFile(argv[i]))
+            return 1;
+        files = true;
+    }
+
+    if (files)
+        return 0;
+
+    Bytes seeds[4];
+    seeds[0] = Encode(MakePixels(17, 9, 1), 17, 9, true);
+    seeds[1] = Encode(MakePixels(40, 3, 2), 40, 3, false);
+    seeds[2] = AddGamma(Encode(MakePixels(8, 8, 3), 8, 8, true), 45455);
+    seeds[3] = AddSrgb(Encode(MakePixels(1, 33, 4), 1, 33, true));
+
+    for (int i = 0; i < 4; ++i)
+        Run(seeds[i]);
+
+    for (long i = 0; i < runs; ++i)
+        Run(Mutate(seeds[Random(4)]));
+
+    printf("%ld runs\n", runs);
+    return 0;
+}
@@ -0,0 +1,198 @@
+#include "PngSamples.h"
+
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lpngw.h"
+
+namespace PngSamples
+{
+
+namespace
+{
+    const unsigned char kSignature[] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+
+    void PutUlong(Bytes& out, unsigned long value)
+    {
+        out.push_back((unsigned char)(value >> 24));
+        out.push_back((unsigned char)(value >> 16));
+        out.push_back((unsigned char)(value >> 8));
+        out.push_back((unsigned char)value);
+    }
+
+    unsigned long Crc(const unsigned char* p, size_t len)
+    {
+        unsigned long crc = 0xFFFFFFFFUL;
+        for (size_t i = 0; i < len; ++i)
+        {
+            crc ^= p[i];
+            for (int k = 0; k < 8; ++k)
+                crc = (crc >> 1) ^ (0xEDB88320UL & (0UL - (crc & 1)));
+        }
+        return crc ^ 0xFFFFFFFFUL;
+    }
+
+    void PutChunk(Bytes& out, const char* type, const Bytes& data)
+    {
+        PutUlong(out, (unsigned long)data.size());
+
+        size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data.begin(), data.end());
+        PutUlong(out, Crc(&out[start], out.size() - start));
+    }
+
+} // namespace
+
+Bytes MakePixels(int width, int height, unsigned int seed)
+{
+    Bytes pixels((size_t)width * height * 4);
+    unsigned int noise = seed * 2654435761u + 1;
+
+    for (int y = 0; y < height; ++y)
+    {
+        unsigned char* p = &pixels[(size_t)y * width * 4];
+        for (int x = 0; x < width; ++x, p += 4)
+        {
+            noise = noise * 1103515245u + 12345u;
+            int n = (int)((noise >> 16) & 7);
+            p[0] = (unsigned char)(x * 255 / width + n);
+            p[1] = (unsigned char)(y * 255 / height + n);
+            p[2] = (unsigned char)((x + y) * 127 / (width + height) + n);
+            p[3] = (unsigned char)(((x ^ y) & 64) ? 255 : (x * 4 + y) & 255);
+        }
+    }
+
+    return pixels;
+}
+
+Bytes Encode(const Bytes& pixels, int width, int height, bool alpha)
+{
+    return EncodeEx(pixels, width, height, alpha ? LPNGW_ALPHA : 0, LPNGW_FAST, 1);
+}
+
+Bytes EncodeEx(const Bytes& pixels, int width, int height, int flags, int level, int threads)
+{
+    unsigned char* png = NULL;
+    unsigned long len = 0;
+
+    if (!EncodePng(&pixels[0], width, height, width * 4, flags, level, threads, &png, &len))
+        return Bytes();
+
+    Bytes out(png, png + len);
+    FreePng(png);
+    return out;
+}
+
+Bytes MakeFiltered(const Bytes& rows, int width, int height, bool alpha)
+{
+    Bytes out(kSignature, kSignature + sizeof(kSignature));
+
+    Bytes ihdr;
+    PutUlong(ihdr, (unsigned long)width);
+    PutUlong(ihdr, (unsigned long)height);
+    ihdr.push_back(8);
+    ihdr.push_back(alpha ? 6 : 2);
+    ihdr.push_back(0);
+    ihdr.push_back(0);
+    ihdr.push_back(0);
+    PutChunk(out, "IHDR", ihdr);
+
+    // zlib header, stored blocks of up to 65535 bytes, Adler-32
+    Bytes idat;
+    idat.push_back(0x78);
+    idat.push_back(0x01);
+
+    size_t at = 0;
+    do
+    {
+        size_t len = rows.size() - at;
+        if (len > 65535)
+            len = 65535;
+
+        idat.push_back(at + len == rows.size() ? 1 : 0);
+        idat.push_back((unsigned char)len);
+        idat.push_back((unsigned char)(len >> 8));
+        idat.push_back((unsigned char)~len);
+        idat.push_back((unsigned char)(~len >> 8));
+        idat.insert(idat.end(), rows.begin() + at, rows.begin() + at + len);
+        at += len;
+    } while (at < rows.size());
+
+    unsigned long a = 1;
+    unsigned long b = 0;
+    for (size_t i = 0; i < rows.size(); ++i)
+    {
+        a = (a + rows[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    PutUlong(idat, (b << 16) | a);
+
+    PutChunk(out, "IDAT", idat);
+    PutChunk(out, "IEND", Bytes());
+    return out;
+}
+
+Bytes InsertChunk(const Bytes& png, const char* type, const Bytes& data)
+{
+    // signature, then IHDR: length, type, 13 bytes and the CRC
+    const size_t afterHeader = 8 + 4 + 4 + 13 + 4;
+    if (png.size() < afterHeader)
+        return png;
+
+    Bytes out(png.begin(), png.begin() + afterHeader);
+    PutChunk(out, type, data);
+    out.insert(out.end(), png.begin() + afterHeader, png.end());
+    return out;
+}
+
+Bytes AddGamma(const Bytes& png, unsigned long gamma)
+{
+    Bytes data;
+    PutUlong(data, gamma);
+    return InsertChunk(png, "gAMA", data);
+}
+
+Bytes AddSrgb(const Bytes& png)
+{
+    // rendering intent: perceptual
+    return InsertChunk(png, "sRGB", Bytes(1, 0));
+}
+
+Bytes AddPhys(const Bytes& png, unsigned long x, unsigned long y, unsigned char unit)
+{
+    Bytes data;
+    PutUlong(data, x);
+    PutUlong(data, y);
+    data.push_back(unit);
+    return InsertChunk(png, "pHYs", data);
+}
+
+Bytes AddActl(const Bytes& png, unsigned long frames, unsigned long plays)
+{
+    Bytes data;
+    PutUlong(data, frames);
+    PutUlong(data, plays);
+    return InsertChunk(png, "acTL", data);
+}
+
+Bytes MakeHeader(unsigned long width, unsigned long height,
+    unsigned char bitDepth, unsigned char colorType)
+{
+    Bytes out(kSignature, kSignature + sizeof(kSignature));
+
+    Bytes ihdr;
+    PutUlong(ihdr, width);
+    PutUlong(ihdr, height);
+    ihdr.push_back(bitDepth);
+    ihdr.push_back(colorType);
+    ihdr.push_back(0);  // compression
+    ihdr.push_back(0);  // filter
+    ihdr.push_back(0);  // interlace
+    PutChunk(out, "IHDR", ihdr);
+    PutChunk(out, "IEND", Bytes());
+    return out;
+}
+
+} // namespace PngSamples
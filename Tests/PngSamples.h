@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+
+// PNG files made up by the tests, encoded with lpngw.
+namespace PngSamples
+{
+    typedef std::vector<unsigned char> Bytes;
+
+    // A width x height top-down BGRA image with gradients in every
+    // channel and a little noise, so that it compresses like a picture.
+    Bytes MakePixels(int width, int height, unsigned int seed);
+
+    // Encodes top-down BGRA pixels, with the alpha channel or without.
+    Bytes Encode(const Bytes& pixels, int width, int height, bool alpha);
+
+    // The same with the flags, level and threads of EncodePng.
+    Bytes EncodeEx(const Bytes& pixels, int width, int height, int flags, int level, int threads);
+
+    // A file of rows that are filtered already, each one a filter byte
+    // and the row, in a zlib stream of stored blocks. For filter bytes
+    // the encoder would not write.
+    Bytes MakeFiltered(const Bytes& rows, int width, int height, bool alpha);
+
+    // Puts a chunk right after IHDR, with its CRC.
+    Bytes InsertChunk(const Bytes& png, const char* type, const Bytes& data);
+
+    // A gAMA chunk with 'gamma' (100000 is 1.0) or an sRGB chunk.
+    Bytes AddGamma(const Bytes& png, unsigned long gamma);
+    Bytes AddSrgb(const Bytes& png);
+
+    // A pHYs chunk, 'unit' 1 for pixels per meter, and an acTL chunk.
+    Bytes AddPhys(const Bytes& png, unsigned long x, unsigned long y, unsigned char unit);
+    Bytes AddActl(const Bytes& png, unsigned long frames, unsigned long plays);
+
+    // A file with just the signature, an IHDR with these fields and
+    // IEND, for the checks made before any image data is read.
+    Bytes MakeHeader(unsigned long width, unsigned long height,
+        unsigned char bitDepth, unsigned char colorType);
+
+} // namespace PngSamples
@@ -0,0 +1,398 @@
+#include "Check.h"
+#include "PixelOps.h"
+#include "RasterCanvas.h"
+
+#include <stdlib.h>
+
+#include <vector>
+
+using namespace MetroWindow;
+
+namespace
+{
+    typedef std::vector<unsigned char> Pixels;
+
+    // x / 255 to the nearest, the way the formulas read.
+    unsigned int RoundDivide255(unsigned int x)
+    {
+        return (x * 2 + 255) / 510;
+    }
+
+    // A COLORREF, which this file has no windows.h for.
+    unsigned long MakeColor(int r, int g, int b)
+    {
+        return (unsigned long)r | ((unsigned long)g << 8) | ((unsigned long)b << 16);
+    }
+
+    // A pixel count that runs the wide loops and the rest after them.
+    const int kRowLength = 4 * 64 + 3;
+
+} // namespace
+
+TEST(PixelOpsBlendsPremultipliedExactly)
+{
+    // Every premultiplied source over every destination value, against
+    // AlphaBlend: d = s + d * (255 - sa) / 255.
+    Pixels src(kRowLength * 4);
+    Pixels dst(kRowLength * 4);
+
+    for (int alpha = 0; alpha < 256; ++alpha)
+    {
+        for (int base = 0; base < 256; base += kRowLength)
+        {
+            for (int i = 0; i < kRowLength; ++i)
+            {
+                int d = (base + i) & 0xFF;
+                int c = (d * 7 + alpha) % (alpha + 1);
+                src[i * 4 + 0] = (unsigned char)c;
+                src[i * 4 + 1] = (unsigned char)(alpha - c);
+                src[i * 4 + 2] = (unsigned char)(alpha / 2);
+                src[i * 4 + 3] = (unsigned char)alpha;
+                dst[i * 4 + 0] = (unsigned char)d;
+                dst[i * 4 + 1] = (unsigned char)(255 - d);
+                dst[i * 4 + 2] = (unsigned char)(d / 3);
+                dst[i * 4 + 3] = (unsigned char)d;
+            }
+
+            Pixels blended = dst;
+            PixelOps::BlendPremultiplied(&src[0], kRowLength, &blended[0]);
+
+            for (int i = 0; i < kRowLength * 4; ++i)
+            {
+                unsigned int expected = src[i] + RoundDivide255(dst[i] * (255 - alpha));
+                CHECK_EQUAL(expected, (unsigned int)blended[i]);
+            }
+        }
+    }
+}
+
+TEST(PixelOpsBlendsCoverageExactly)
+{
+    // Every coverage over every destination value, for a few colors,
+    // against d = (c * m + d * (255 - m)) / 255.
+    const unsigned char kColors[][3] = { { 0, 0, 0 }, { 255, 255, 255 }, { 0x12, 0x9A, 0xF0 } };
+    Pixels mask(kRowLength);
+    Pixels dst(kRowLength * 4);
+
+    for (size_t k = 0; k < sizeof(kColors) / sizeof(kColors[0]); ++k)
+    {
+        const unsigned char* color = kColors[k];
+        const unsigned int channels[4] = { color[2], color[1], color[0], 255 };
+
+        for (int d = 0; d < 256; ++d)
+        {
+            for (int i = 0; i < kRowLength; ++i)
+            {
+                mask[i] = (unsigned char)(i + d);
+                for (int c = 0; c < 4; ++c)
+                    dst[i * 4 + c] = (unsigned char)(d ^ (c * 0x55));
+            }
+
+            Pixels blended = dst;
+            PixelOps::BlendCoverage(&mask[0], kRowLength, color[0], color[1], color[2], &blended[0]);
+
+            for (int i = 0; i < kRowLength; ++i)
+            {
+                for (int c = 0; c < 4; ++c)
+                {
+                    unsigned int expected = RoundDivide255(channels[c] * mask[i] + dst[i * 4 + c] * (255 - mask[i]));
+                    CHECK_EQUAL(expected, (unsigned int)blended[i * 4 + c]);
+                }
+            }
+        }
+    }
+}
+
+TEST(PixelOpsCoverageIsCloseToTheGdiPath)
+{
+    // The GDI canvas colors a glyph run into a bitmap, (c * m) >> 8,
+    // and alpha blends it. The raster canvas blends the coverage in one
+    // step, which is never more than two off.
+    Pixels mask(256);
+    Pixels colored(256 * 4);
+    for (int i = 0; i < 256; ++i)
+        mask[i] = (unsigned char)i;
+
+    const unsigned char kColors[][3] = { { 0, 0, 0 }, { 255, 255, 255 }, { 0x12, 0x9A, 0xF0 }, { 200, 1, 77 } };
+    for (size_t k = 0; k < sizeof(kColors) / sizeof(kColors[0]); ++k)
+    {
+        const unsigned char* color = kColors[k];
+        PixelOps::ColorizeMask(&mask[0], 256, color[0], color[1], color[2], &colored[0]);
+
+        for (int d = 0; d < 256; d += 5)
+        {
+            Pixels viaGdi(256 * 4, (unsigned char)d);
+            Pixels direct(256 * 4, (unsigned char)d);
+            PixelOps::BlendPremultiplied(&colored[0], 256, &viaGdi[0]);
+            PixelOps::BlendCoverage(&mask[0], 256, color[0], color[1], color[2], &direct[0]);
+
+            for (int i = 0; i < 256 * 4; ++i)
+                CHECK(abs((int)viaGdi[i] - (int)direct[i]) <= 2);
+        }
+    }
+}
+
+namespace
+{
+    // The canvas the obvious way, one pixel at a time, with the rules
+    // of a GDI DC: the viewport origin moves everything drawn, the clip
+    // is set in logical coordinates and stays on the surface.
+    class ReferenceCanvas : public ICanvas
+    {
+    public:
+        ReferenceCanvas(Pixels* pixels, int width, int height)
+            : pixels_(pixels), width_(width), height_(height), origin_x_(0), origin_y_(0)
+        {
+            CanvasRect all = { 0, 0, width, height };
+            clip_ = all;
+        }
+
+        void SetViewportOrg(int x, int y)
+        {
+            origin_x_ = x;
+            origin_y_ = y;
+        }
+
+        void SetClip(const CanvasRect& clip)
+        {
+            CanvasRect device = { clip.left + origin_x_, clip.top + origin_y_,
+                clip.right + origin_x_, clip.bottom + origin_y_ };
+            clip_ = device;
+        }
+
+        virtual void FillRect(const CanvasRect& rect, unsigned long color)
+        {
+            for (int y = rect.top; y < rect.bottom; ++y)
+                for (int x = rect.left; x < rect.right; ++x)
+                    Fill(x, y, color);
+        }
+
+        virtual void FrameRect(const CanvasRect& rect, unsigned long color)
+        {
+            for (int y = rect.top; y < rect.bottom; ++y)
+            {
+                for (int x = rect.left; x < rect.right; ++x)
+                {
+                    if (x == rect.left || x == rect.right - 1 || y == rect.top || y == rect.bottom - 1)
+                        Fill(x, y, color);
+                }
+            }
+        }
+
+        virtual void BlendImage(int x, int y, const CanvasImage& image, const CanvasRect& src)
+        {
+            for (int sy = src.top; sy < src.bottom; ++sy)
+            {
+                for (int sx = src.left; sx < src.right; ++sx)
+                {
+                    unsigned char* d = Pixel(x + sx - src.left, y + sy - src.top);
+                    if (d == NULL || sx < 0 || sy < 0 || sx >= image.width || sy >= image.height)
+                        continue;
+
+                    const unsigned char* s = image.bits + sy * image.stride + sx * 4;
+                    for (int c = 0; c < 4; ++c)
+                        d[c] = (unsigned char)(s[c] + RoundDivide255(d[c] * (255 - s[3])));
+                }
+            }
+        }
+
+        virtual void BlendGlyphRun(int x, int y, const unsigned char* coverage, int stride,
+            int width, int height, unsigned long color)
+        {
+            const unsigned int channels[4] =
+            {
+                (unsigned int)((color >> 16) & 0xFF), (unsigned int)((color >> 8) & 0xFF),
+                (unsigned int)(color & 0xFF), 255
+            };
+
+            for (int row = 0; row < height; ++row)
+            {
+                for (int col = 0; col < width; ++col)
+                {
+                    unsigned char* d = Pixel(x + col, y + row);
+                    if (d == NULL)
+                        continue;
+
+                    unsigned int m = coverage[row * stride + col];
+                    for (int c = 0; c < 4; ++c)
+                        d[c] = (unsigned char)RoundDivide255(channels[c] * m + d[c] * (255 - m));
+                }
+            }
+        }
+
+        virtual bool IsVisible(const CanvasRect& rect) const
+        {
+            for (int y = rect.top; y < rect.bottom; ++y)
+                for (int x = rect.left; x < rect.right; ++x)
+                    if (Pixel(x, y) != NULL)
+                        return true;
+            return false;
+        }
+
+    private:
+        // The pixel at logical (x, y), NULL if it is clipped away.
+        unsigned char* Pixel(int x, int y) const
+        {
+            x += origin_x_;
+            y += origin_y_;
+            if (x < 0 || y < 0 || x >= width_ || y >= height_ ||
+                x < clip_.left || y < clip_.top || x >= clip_.right || y >= clip_.bottom)
+            {
+                return NULL;
+            }
+            return &(*pixels_)[(y * width_ + x) * 4];
+        }
+
+        void Fill(int x, int y, unsigned long color)
+        {
+            unsigned char* d = Pixel(x, y);
+            if (d == NULL)
+                return;
+
+            d[0] = (unsigned char)(color >> 16);
+            d[1] = (unsigned char)(color >> 8);
+            d[2] = (unsigned char)color;
+            d[3] = 255;
+        }
+
+        Pixels* pixels_;
+        int width_;
+        int height_;
+        int origin_x_;
+        int origin_y_;
+        CanvasRect clip_;
+    };
+
+    CanvasRect MakeRect(int left, int top, int right, int bottom)
+    {
+        CanvasRect rect = { left, top, right, bottom };
+        return rect;
+    }
+
+    // A premultiplied 37 x 23 image with every alpha, stored bottom-up.
+    struct TestImage
+    {
+        Pixels bits;
+        CanvasImage image;
+
+        TestImage()
+            : bits(37 * 23 * 4)
+        {
+            for (int y = 0; y < 23; ++y)
+            {
+                for (int x = 0; x < 37; ++x)
+                {
+                    unsigned char* p = &bits[((22 - y) * 37 + x) * 4];
+                    int alpha = (x * 7 + y * 11) & 0xFF;
+                    p[0] = (unsigned char)(alpha * x / 36);
+                    p[1] = (unsigned char)(alpha * y / 22);
+                    p[2] = (unsigned char)(alpha / 2);
+                    p[3] = (unsigned char)alpha;
+                }
+            }
+
+            image.bits = &bits[22 * 37 * 4];
+            image.stride = -37 * 4;
+            image.width = 37;
+            image.height = 23;
+            image.handle = NULL;
+        }
+    };
+
+    // Text-like coverage, 61 x 13.
+    Pixels MakeCoverage()
+    {
+        Pixels coverage(61 * 13);
+        for (int y = 0; y < 13; ++y)
+            for (int x = 0; x < 61; ++x)
+                coverage[y * 61 + x] = (unsigned char)(((x % 7) * (y % 5) * 37) & 0xFF);
+        return coverage;
+    }
+
+    // Something like a frame: a caption, borders, buttons with icons,
+    // a title, then the same again moved and clipped, as the painter
+    // does when it paints damage through a viewport.
+    void DrawScene(ICanvas* canvas, const TestImage& image, const Pixels& coverage)
+    {
+        canvas->FillRect(MakeRect(0, 0, 160, 120), MakeColor(0xF0, 0xF0, 0xF0));
+        canvas->FillRect(MakeRect(0, 0, 160, 30), MakeColor(0x2B, 0x57, 0x9A));
+        canvas->FrameRect(MakeRect(0, 0, 160, 120), MakeColor(0x10, 0x20, 0x30));
+        canvas->FrameRect(MakeRect(100, 4, 101, 5), MakeColor(255, 0, 0));
+        canvas->FrameRect(MakeRect(110, 4, 110, 20), MakeColor(255, 0, 0));
+
+        canvas->BlendImage(4, 3, image.image, MakeRect(0, 0, 37, 23));
+        canvas->BlendImage(120, 10, image.image, MakeRect(10, 5, 37, 23));
+        canvas->BlendImage(-5, 100, image.image, MakeRect(-3, -2, 40, 30));
+        canvas->BlendGlyphRun(48, 8, &coverage[0], 61, 61, 13, MakeColor(255, 255, 255));
+        canvas->BlendGlyphRun(140, 112, &coverage[0], 61, 61, 13, MakeColor(0x80, 0, 0x40));
+    }
+
+    unsigned long Hash(const Pixels& pixels)
+    {
+        unsigned long hash = 2166136261u;
+        for (size_t i = 0; i < pixels.size(); ++i)
+            hash = ((hash ^ pixels[i]) * 16777619u) & 0xFFFFFFFFu;
+        return hash;
+    }
+
+    template <typename Canvas>
+    Pixels Render(const TestImage& image, const Pixels& coverage)
+    {
+        const int kWidth = 200;
+        const int kHeight = 150;
+        Pixels pixels(kWidth * kHeight * 4, 0x5A);
+        Canvas canvas(&pixels, kWidth, kHeight);
+
+        DrawScene(&canvas, image, coverage);
+
+        canvas.SetViewportOrg(30, 20);
+        canvas.SetClip(MakeRect(10, 10, 150, 100));
+        DrawScene(&canvas, image, coverage);
+
+        canvas.SetViewportOrg(-50, 60);
+        canvas.SetClip(MakeRect(60, -10, 300, 200));
+        DrawScene(&canvas, image, coverage);
+        return pixels;
+    }
+
+    // RasterCanvas on a vector, for Render.
+    class VectorRasterCanvas : public RasterCanvas
+    {
+    public:
+        VectorRasterCanvas(Pixels* pixels, int width, int height)
+            : RasterCanvas(&(*pixels)[0], width * 4, width, height)
+        {
+        }
+    };
+
+} // namespace
+
+TEST(RasterCanvasMatchesReference)
+{
+    TestImage image;
+    Pixels coverage = MakeCoverage();
+
+    Pixels expected = Render<ReferenceCanvas>(image, coverage);
+    Pixels actual = Render<VectorRasterCanvas>(image, coverage);
+    CHECK(expected == actual);
+
+    // The scene as it was first drawn, so that a change the reference
+    // would follow shows as well.
+    CHECK_EQUAL(0x3E20FB2CUL, Hash(actual));
+}
+
+TEST(RasterCanvasTellsWhatIsVisible)
+{
+    Pixels pixels(100 * 80 * 4);
+    RasterCanvas canvas(&pixels[0], 400, 100, 80);
+
+    CHECK(canvas.IsVisible(MakeRect(0, 0, 1, 1)));
+    CHECK(!canvas.IsVisible(MakeRect(100, 0, 200, 80)));
+    CHECK(!canvas.IsVisible(MakeRect(10, 10, 10, 20)));
+
+    canvas.SetViewportOrg(20, 10);
+    canvas.SetClip(MakeRect(0, 0, 30, 30));
+    CHECK(canvas.IsVisible(MakeRect(29, 29, 40, 40)));
+    CHECK(!canvas.IsVisible(MakeRect(30, 0, 40, 40)));
+    CHECK(!canvas.IsVisible(MakeRect(-20, -10, 0, 0)));
+}
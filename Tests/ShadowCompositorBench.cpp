@@ -0,0 +1,94 @@
+#include "stdafx.h"
+
+#include <stdio.h>
+
+#include "Bench.h"
+#include "DropShadowBitmaps.h"
+#include "ShadowCompositor.h"
+
+// What drawing the four shadow strips of a window costs with the
+// nine-slice compositor, across window sizes, for the built-in shadow
+// and a generated one.
+
+using namespace MetroWindow;
+
+namespace
+{
+    struct ComposeAll
+    {
+        const ShadowMasks* masks;
+        int width;
+        int height;
+        std::vector<unsigned char> horizontal;
+        std::vector<unsigned char> vertical;
+        long pixels;
+
+        void Prepare()
+        {
+            int size = masks->shadow_size;
+            horizontal.resize((size_t)(width + size * 2) * size * 4);
+            vertical.resize((size_t)size * height * 4);
+        }
+
+        // The top and bottom strips reach over the window corners, the
+        // side strips are as high as the window.
+        void operator()()
+        {
+            int size = masks->shadow_size;
+            int stripWidth = width + size * 2;
+
+            pixels = 0;
+            pixels += ShadowCompositor::ComposeSide(*masks, 0, 0, 0, Top,
+                &horizontal[0], stripWidth * 4, stripWidth, size);
+            pixels += ShadowCompositor::ComposeSide(*masks, 0, 0, 0, Bottom,
+                &horizontal[0], stripWidth * 4, stripWidth, size);
+            pixels += ShadowCompositor::ComposeSide(*masks, 0, 0, 0, Left,
+                &vertical[0], size * 4, size, height);
+            pixels += ShadowCompositor::ComposeSide(*masks, 0, 0, 0, Right,
+                &vertical[0], size * 4, size, height);
+            Bench::Consume(&horizontal[0]);
+        }
+    };
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Bench::ParseArgs(argc, argv);
+
+    DropShadowBitmaps standard;
+    standard.Initialize();
+
+    ShadowMasks generated;
+    ShadowParams params = { 24, 0, 100, 0, 4 };
+    ShadowGenerator::Generate(params, &generated);
+
+    const ShadowMasks* kMasks[] = { &standard.GetMasks(), &generated };
+    const char* kNames[] = { "built-in", "radius 24" };
+
+    static const int kSizes[][2] =
+    {
+        { 200, 150 }, { 400, 300 }, { 800, 600 }, { 1280, 800 },
+        { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 }
+    };
+
+    printf("%-10s %-11s %10s %10s %8s\n", "shadow", "window", "ns", "pixels", "GB/s");
+
+    for (int m = 0; m < 2; ++m)
+    {
+        for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); ++i)
+        {
+            ComposeAll compose;
+            compose.masks = kMasks[m];
+            compose.width = kSizes[i][0];
+            compose.height = kSizes[i][1];
+            compose.Prepare();
+
+            double ns = Bench::Measure(compose);
+            printf("%-10s %5dx%-5d %10.0f %10ld %8.2f\n", kNames[m], compose.width, compose.height,
+                ns, compose.pixels, compose.pixels * 4.0 / ns);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,263 @@
+#include "stdafx.h"
+
+#include "Check.h"
+#include "DropShadowBitmaps.h"
+#include "ShadowCompositor.h"
+
+#include <string.h>
+
+using namespace MetroWindow;
+
+namespace
+{
+    typedef std::vector<unsigned char> Mask;
+
+    struct Color
+    {
+        unsigned char r;
+        unsigned char g;
+        unsigned char b;
+    };
+
+    // A top-down BGRA surface with rows 'stride' bytes apart. The bytes
+    // past the width of a row are padding nothing may write to.
+    struct Surface
+    {
+        int width;
+        int height;
+        int stride;
+        std::vector<unsigned char> bits;
+
+        Surface(int w, int h, int padding, unsigned char fill)
+            : width(w), height(h), stride((w + padding) * 4),
+            bits((size_t)(w + padding) * 4 * h, fill)
+        {
+        }
+
+        unsigned char* Pixel(int x, int y)
+        {
+            return &bits[y * stride + x * 4];
+        }
+    };
+
+    // The strips as GDI drew them: every corner bitmap was copied with
+    // BitBlt, and every edge was one tile of a pattern brush that
+    // FillRect repeated from the origin of the surface. The bitmaps were
+    // colored with (c * a) >> 8.
+    void PutPixel(Surface* surface, int x, int y, unsigned char alpha, const Color& color)
+    {
+        if (x < 0 || y < 0 || x >= surface->width || y >= surface->height)
+            return;
+
+        unsigned char* p = surface->Pixel(x, y);
+        p[0] = (unsigned char)((color.b * alpha) >> 8);
+        p[1] = (unsigned char)((color.g * alpha) >> 8);
+        p[2] = (unsigned char)((color.r * alpha) >> 8);
+        p[3] = alpha;
+    }
+
+    void BlitCorner(Surface* surface, const Mask& mask, int size, int x, int y, const Color& color)
+    {
+        for (int row = 0; row < size; ++row)
+            for (int col = 0; col < size; ++col)
+                PutPixel(surface, x + col, y + row, mask[row * size + col], color);
+    }
+
+    void FillPattern(Surface* surface, const Mask& tile, int tileWidth,
+        int x, int y, int cx, int cy, const Color& color)
+    {
+        int tileHeight = (int)tile.size() / tileWidth;
+        for (int row = y; row < y + cy; ++row)
+        {
+            for (int col = x; col < x + cx; ++col)
+            {
+                PutPixel(surface, col, row,
+                    tile[(row % tileHeight) * tileWidth + col % tileWidth], color);
+            }
+        }
+    }
+
+    void ReferenceComposeSide(const ShadowMasks& masks, const Color& color,
+        ShadowSide side, Surface* surface)
+    {
+        int cornerSize = masks.corner_size;
+        int borderWidth = masks.shadow_size;
+        int width = surface->width;
+        int height = surface->height;
+
+        int top = 0;
+        int left = 0;
+        int right = width;
+        int bottom = height;
+        if (side == Left || side == Right)
+        {
+            top -= borderWidth;
+            bottom += borderWidth;
+            height += borderWidth * 2;
+        }
+
+        if (side == Left || side == Top)
+            BlitCorner(surface, masks.corners[CornerNW], cornerSize, left, top, color);
+        if (side == Right || side == Top)
+            BlitCorner(surface, masks.corners[CornerNE], cornerSize, right - cornerSize, top, color);
+        if (side == Left || side == Bottom)
+            BlitCorner(surface, masks.corners[CornerSW], cornerSize, left, bottom - cornerSize, color);
+        if (side == Right || side == Bottom)
+            BlitCorner(surface, masks.corners[CornerSE], cornerSize, right - cornerSize, bottom - cornerSize, color);
+
+        if (side == Top)
+        {
+            FillPattern(surface, masks.edges[EdgeN], 1, left + cornerSize, top,
+                width - cornerSize * 2, borderWidth, color);
+        }
+        else if (side == Bottom)
+        {
+            FillPattern(surface, masks.edges[EdgeS], 1, left + cornerSize, bottom - borderWidth,
+                width - cornerSize * 2, borderWidth, color);
+        }
+        else if (side == Left)
+        {
+            FillPattern(surface, masks.edges[EdgeW], borderWidth, left, top + cornerSize,
+                borderWidth, height - cornerSize * 2, color);
+        }
+        else
+        {
+            FillPattern(surface, masks.edges[EdgeE], borderWidth, right - borderWidth,
+                top + cornerSize, borderWidth, height - cornerSize * 2, color);
+        }
+    }
+
+    void GetMaskSets(std::vector<ShadowMasks>* sets)
+    {
+        DropShadowBitmaps standard;
+        standard.Initialize();
+        sets->push_back(standard.GetMasks());
+
+        const ShadowParams kParams[] = { { 8, 1, 128, 1, 3 }, { 20, 0, 90, 0, 6 } };
+        for (size_t i = 0; i < sizeof(kParams) / sizeof(kParams[0]); ++i)
+        {
+            ShadowMasks masks;
+            ShadowGenerator::Generate(kParams[i], &masks);
+            sets->push_back(masks);
+        }
+    }
+
+    const ShadowSide kSides[] = { Left, Top, Right, Bottom };
+    const Color kColors[] = { { 0, 0, 0 }, { 0x12, 0x34, 0x56 }, { 255, 255, 255 } };
+
+} // namespace
+
+TEST(ShadowCompositorMatchesGdiDrawing)
+{
+    std::vector<ShadowMasks> sets;
+    GetMaskSets(&sets);
+
+    for (size_t set = 0; set < sets.size(); ++set)
+    {
+        const ShadowMasks& masks = sets[set];
+        int depth = masks.shadow_size;
+        int maxLength = masks.corner_size * 3 + 2;
+
+        for (int s = 0; s < 4; ++s)
+        {
+            bool horizontal = (kSides[s] == Top || kSides[s] == Bottom);
+
+            for (int length = 1; length <= maxLength; ++length)
+            {
+                const Color& color = kColors[length % 3];
+                int width = horizontal ? length : depth;
+                int height = horizontal ? depth : length;
+
+                Surface expected(width, height, 3, 0xCD);
+                Surface actual(width, height, 3, 0xCD);
+                ReferenceComposeSide(masks, color, kSides[s], &expected);
+                ShadowCompositor::ComposeSide(masks, color.r, color.g, color.b, kSides[s],
+                    &actual.bits[0], actual.stride, width, height);
+
+                CHECK(expected.bits == actual.bits);
+            }
+        }
+    }
+}
+
+TEST(ShadowCompositorDrawsFromOnly)
+{
+    std::vector<ShadowMasks> sets;
+    GetMaskSets(&sets);
+    const ShadowMasks& masks = sets[0];
+    const Color color = { 10, 20, 30 };
+
+    for (int s = 0; s < 4; ++s)
+    {
+        bool horizontal = (kSides[s] == Top || kSides[s] == Bottom);
+        int length = 150;
+        int width = horizontal ? length : masks.shadow_size;
+        int height = horizontal ? masks.shadow_size : length;
+
+        Surface full(width, height, 0, 0xCD);
+        ShadowCompositor::ComposeSide(masks, color.r, color.g, color.b, kSides[s],
+            &full.bits[0], full.stride, width, height);
+
+        for (int from = 0; from <= length; from += 7)
+        {
+            Surface part(width, height, 0, 0xCD);
+            int written = ShadowCompositor::ComposeSide(masks, color.r, color.g, color.b, kSides[s],
+                &part.bits[0], part.stride, width, height, from);
+
+            int changed = 0;
+            for (int y = 0; y < height; ++y)
+            {
+                for (int x = 0; x < width; ++x)
+                {
+                    bool drawn = (horizontal ? x : y) >= from;
+                    unsigned char* p = part.Pixel(x, y);
+                    if (drawn)
+                        CHECK(memcmp(p, full.Pixel(x, y), 4) == 0);
+                    else
+                        CHECK(p[0] == 0xCD && p[1] == 0xCD && p[2] == 0xCD && p[3] == 0xCD);
+                    changed += drawn ? 1 : 0;
+                }
+            }
+
+            // Corners may overlap on short strips and count twice.
+            CHECK(written >= changed);
+        }
+    }
+}
+
+TEST(ShadowCompositorFarCornerExtent)
+{
+    std::vector<ShadowMasks> sets;
+    GetMaskSets(&sets);
+    const ShadowMasks& masks = sets[1];
+    const Color color = { 0, 0, 0 };
+
+    // Growing a strip changes nothing before the far corner of the
+    // shorter one.
+    for (int s = 0; s < 4; ++s)
+    {
+        bool horizontal = (kSides[s] == Top || kSides[s] == Bottom);
+        int extent = ShadowCompositor::GetFarCornerExtent(masks, kSides[s]);
+        int shortLength = 120;
+        int longLength = 173;
+
+        Surface shorter(horizontal ? longLength : masks.shadow_size,
+            horizontal ? masks.shadow_size : longLength, 0, 0);
+        Surface longer(shorter.width, shorter.height, 0, 0);
+        ShadowCompositor::ComposeSide(masks, color.r, color.g, color.b, kSides[s],
+            &shorter.bits[0], shorter.stride,
+            horizontal ? shortLength : shorter.width, horizontal ? shorter.height : shortLength);
+        ShadowCompositor::ComposeSide(masks, color.r, color.g, color.b, kSides[s],
+            &longer.bits[0], longer.stride, longer.width, longer.height);
+
+        for (int i = 0; i < shortLength - extent; ++i)
+        {
+            for (int j = 0; j < masks.shadow_size; ++j)
+            {
+                int x = horizontal ? i : j;
+                int y = horizontal ? j : i;
+                CHECK(memcmp(shorter.Pixel(x, y), longer.Pixel(x, y), 4) == 0);
+            }
+        }
+    }
+}
@@ -0,0 +1,142 @@
+#include "Check.h"
+#include "ShadowFade.h"
+
+using namespace MetroWindow;
+
+namespace
+{
+    unsigned long MakeColor(int red, int green, int blue)
+    {
+        return (unsigned long)red | ((unsigned long)green << 8) | ((unsigned long)blue << 16);
+    }
+
+    int GetRed(unsigned long color) { return (int)(color & 0xFF); }
+    int GetGreen(unsigned long color) { return (int)((color >> 8) & 0xFF); }
+    int GetBlue(unsigned long color) { return (int)((color >> 16) & 0xFF); }
+
+    // 256 * (3t^2 - 2t^3), rounded, for t = step / kSteps.
+    int GetWeight(int step)
+    {
+        double t = (double)step / ShadowFade::kSteps;
+        return (int)(256.0 * (3.0 * t * t - 2.0 * t * t * t) + 0.5);
+    }
+
+} // namespace
+
+TEST(ShadowFadeStartsIdle)
+{
+    ShadowFade fade;
+    CHECK(!fade.IsRunning());
+    CHECK(!fade.Step());
+    CHECK_EQUAL(0UL, fade.GetColor());
+}
+
+TEST(ShadowFadeGoesFromOneColorToTheOther)
+{
+    const unsigned long from = MakeColor(0x20, 0x20, 0x20);
+    const unsigned long to = MakeColor(0x00, 0x78, 0xD7);
+
+    ShadowFade fade;
+    fade.Start(from, to);
+    CHECK(fade.IsRunning());
+    CHECK_EQUAL(from, fade.GetColor());
+
+    // kSteps frames, the last one in the new color.
+    for (int step = 1; step < ShadowFade::kSteps; ++step)
+        CHECK(fade.Step());
+
+    CHECK(!fade.Step());
+    CHECK(!fade.IsRunning());
+    CHECK_EQUAL(to, fade.GetColor());
+
+    // Done is done.
+    CHECK(!fade.Step());
+    CHECK_EQUAL(to, fade.GetColor());
+}
+
+TEST(ShadowFadeFollowsTheEasingCurve)
+{
+    ShadowFade fade;
+    fade.Start(MakeColor(0, 0, 0), MakeColor(255, 255, 255));
+
+    int previous = -1;
+    for (int step = 0; step <= ShadowFade::kSteps; ++step)
+    {
+        int expected = (255 * GetWeight(step) + 128) >> 8;
+        int red = GetRed(fade.GetColor());
+        CHECK_EQUAL(expected, red);
+        CHECK(red >= previous);
+        previous = red;
+        fade.Step();
+    }
+
+    // Ease in and out: the first and last steps are the smallest, the
+    // middle ones the largest, and the curve is symmetric.
+    for (int step = 1; step <= ShadowFade::kSteps / 2; ++step)
+    {
+        int early = GetWeight(step) - GetWeight(step - 1);
+        int late = GetWeight(ShadowFade::kSteps - step + 1) - GetWeight(ShadowFade::kSteps - step);
+        CHECK(late >= early - 1 && late <= early + 1);
+        if (step > 1)
+            CHECK(early > GetWeight(step - 1) - GetWeight(step - 2));
+    }
+}
+
+TEST(ShadowFadeLerpsEveryChannelOnItsOwn)
+{
+    // Red goes up, green comes down, blue stays.
+    const unsigned long from = MakeColor(10, 200, 40);
+    const unsigned long to = MakeColor(250, 0, 40);
+
+    ShadowFade fade;
+    fade.Start(from, to);
+
+    for (int step = 0; step <= ShadowFade::kSteps; ++step)
+    {
+        unsigned long color = fade.GetColor();
+        int weight = GetWeight(step);
+
+        CHECK_EQUAL((10 * (256 - weight) + 250 * weight + 128) >> 8, GetRed(color));
+        CHECK_EQUAL((200 * (256 - weight) + 128) >> 8, GetGreen(color));
+        CHECK_EQUAL(40, GetBlue(color));
+        CHECK_EQUAL(0UL, color & 0xFF000000UL);
+        fade.Step();
+    }
+
+    // A white that fades to itself never leaves its bytes.
+    fade.Start(0xFFFFFFUL, 0xFFFFFFUL);
+    while (fade.Step())
+        CHECK_EQUAL(0xFFFFFFUL, fade.GetColor());
+}
+
+TEST(ShadowFadeStopsInTheNewColor)
+{
+    ShadowFade fade;
+    fade.Start(MakeColor(0, 0, 0), MakeColor(0, 120, 215));
+    fade.Step();
+    fade.Step();
+
+    fade.Stop();
+    CHECK(!fade.IsRunning());
+    CHECK_EQUAL(MakeColor(0, 120, 215), fade.GetColor());
+}
+
+TEST(ShadowFadeRestartsFromWhereItIs)
+{
+    // Activated again half way through: the window starts a new fade
+    // from the color on screen.
+    ShadowFade fade;
+    fade.Start(MakeColor(0, 0, 0), MakeColor(200, 200, 200));
+    for (int step = 0; step < ShadowFade::kSteps / 2; ++step)
+        fade.Step();
+
+    unsigned long current = fade.GetColor();
+    CHECK_EQUAL(100, GetRed(current));
+
+    fade.Start(current, MakeColor(0, 0, 0));
+    CHECK(fade.IsRunning());
+    CHECK_EQUAL(current, fade.GetColor());
+    while (fade.Step())
+        CHECK(GetRed(fade.GetColor()) <= 100);
+    CHECK_EQUAL(0UL, fade.GetColor());
+}
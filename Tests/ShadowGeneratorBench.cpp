@@ -0,0 +1,135 @@
+#include "stdafx.h"
+
+#include <stdio.h>
+
+#include "Bench.h"
+#include "DropShadowBitmaps.h"
+#include "ShadowGenerator.h"
+
+// How long generating the masks of a shadow takes across radii, to pick
+// shadows per window and per DPI at run time. Also what setting up the
+// built-in shadow costs, and turning a mask into place row by row next
+// to looking every pixel up through a switch on the rotation.
+
+using namespace MetroWindow;
+
+namespace
+{
+    struct Generate
+    {
+        ShadowParams params;
+        ShadowMasks masks;
+
+        void operator()()
+        {
+            ShadowGenerator::Generate(params, &masks);
+            Bench::Consume(&masks);
+        }
+    };
+
+    struct InitializeDefault
+    {
+        void operator()()
+        {
+            DropShadowBitmaps bitmaps;
+            bitmaps.Initialize();
+            Bench::Consume(&bitmaps.GetMasks());
+        }
+    };
+
+    struct Rotate
+    {
+        std::vector<unsigned char> src;
+        std::vector<unsigned char> dst;
+        int size;
+        int rotation;
+
+        void operator()()
+        {
+            ShadowGenerator::RotateMask(src, size, size, rotation, &dst);
+            Bench::Consume(&dst[0]);
+        }
+    };
+
+    // The pixel by pixel way: columns outside, a switch per pixel.
+    struct RotateByPixel
+    {
+        std::vector<unsigned char> src;
+        std::vector<unsigned char> dst;
+        int size;
+        int rotation;
+
+        unsigned char GetPixel(int x, int y) const
+        {
+            switch (rotation % 4)
+            {
+            case 0: return src[y * size + x];
+            case 1: return src[(size - 1 - x) * size + y];
+            case 2: return src[(size - 1 - y) * size + size - 1 - x];
+            default: return src[x * size + size - 1 - y];
+            }
+        }
+
+        void operator()()
+        {
+            dst.resize(size * size);
+            for (int x = 0; x < size; ++x)
+                for (int y = 0; y < size; ++y)
+                    dst[y * size + x] = GetPixel(x, y);
+            Bench::Consume(&dst[0]);
+        }
+    };
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Bench::ParseArgs(argc, argv);
+
+    static const int kRadii[] = { 4, 6, 8, 12, 16, 24, 32, 48, 64 };
+
+    printf("%6s %6s %6s %12s %12s\n", "radius", "spread", "size", "ns", "allocs");
+
+    for (size_t i = 0; i < sizeof(kRadii) / sizeof(kRadii[0]); ++i)
+    {
+        for (int spread = 0; spread <= 1; ++spread)
+        {
+            Generate generate;
+            ShadowParams params = { kRadii[i], spread * kRadii[i] / 4, 115, 0, kRadii[i] / 6 };
+            generate.params = params;
+
+            double ns = Bench::Measure(generate);
+
+            unsigned long allocations = Bench::GetAllocations();
+            generate();
+            allocations = Bench::GetAllocations() - allocations;
+
+            printf("%6d %6d %6d %12.0f %12lu\n", params.radius, params.spread,
+                generate.masks.shadow_size, ns, allocations);
+        }
+    }
+
+    InitializeDefault initialize;
+    printf("\nbuilt-in shadow Initialize: %.0f ns\n", Bench::Measure(initialize));
+
+    printf("\n%6s %8s %12s %12s\n", "mask", "rotation", "rows ns", "pixels ns");
+    static const int kMaskSizes[] = { 26, 64, 184 };
+    for (size_t i = 0; i < sizeof(kMaskSizes) / sizeof(kMaskSizes[0]); ++i)
+    {
+        for (int rotation = 1; rotation < 4; ++rotation)
+        {
+            Rotate rotate;
+            RotateByPixel byPixel;
+            rotate.size = byPixel.size = kMaskSizes[i];
+            rotate.rotation = byPixel.rotation = rotation;
+            rotate.src.resize(kMaskSizes[i] * kMaskSizes[i], 1);
+            byPixel.src = rotate.src;
+
+            double rows = Bench::Measure(rotate);
+            double pixels = Bench::Measure(byPixel);
+            printf("%6d %8d %12.0f %12.0f\n", kMaskSizes[i], rotation, rows, pixels);
+        }
+    }
+
+    return 0;
+}
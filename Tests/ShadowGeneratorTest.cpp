@@ -0,0 +1,294 @@
+#include "Check.h"
+#include "ShadowGenerator.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+
+using namespace MetroWindow;
+
+namespace
+{
+    typedef std::vector<unsigned char> Mask;
+
+    // The generator the slow and obvious way: the shape is drawn on the
+    // whole canvas, every box pass sums its window again for every pixel,
+    // and the parts under the window are cleared by their place on the
+    // canvas. The rounding is the one the generator documents.
+    unsigned char DivideBox(unsigned int sum, int box)
+    {
+        unsigned int half = (box * 2 + 1) / 2;
+        unsigned int inv = 65536 / (box * 2 + 1);
+        return (unsigned char)(((sum + half) * inv) >> 16);
+    }
+
+    void BoxPass(const Mask& src, Mask* dst, int size, int box, bool horizontal)
+    {
+        for (int line = 0; line < size; ++line)
+        {
+            for (int i = 0; i < size; ++i)
+            {
+                unsigned int sum = 0;
+                for (int j = std::max<int>(i - box, 0); j <= std::min<int>(i + box, size - 1); ++j)
+                    sum += horizontal ? src[line * size + j] : src[j * size + line];
+
+                (*dst)[horizontal ? line * size + i : i * size + line] = DivideBox(sum, box);
+            }
+        }
+    }
+
+    void ReferenceGenerate(const ShadowParams& params, ShadowMasks* masks)
+    {
+        int box = (params.radius + 2) / 3;
+        int shadowSize = ShadowGenerator::GetShadowSize(params);
+        int cornerSize = shadowSize * 2;
+        int size = cornerSize * 2;
+
+        Mask canvas(size * size);
+        Mask scratch(size * size);
+        for (int y = shadowSize - params.spread + params.offsetY;
+             y < size - shadowSize + params.spread + params.offsetY; ++y)
+        {
+            for (int x = shadowSize - params.spread + params.offsetX;
+                 x < size - shadowSize + params.spread + params.offsetX; ++x)
+            {
+                canvas[y * size + x] = (unsigned char)params.opacity;
+            }
+        }
+
+        for (int pass = 0; pass < 3; ++pass)
+        {
+            BoxPass(canvas, &scratch, size, box, true);
+            canvas.swap(scratch);
+        }
+        for (int pass = 0; pass < 3; ++pass)
+        {
+            BoxPass(canvas, &scratch, size, box, false);
+            canvas.swap(scratch);
+        }
+
+        masks->shadow_size = shadowSize;
+        masks->corner_size = cornerSize;
+
+        const int kLeft[4] = { 0, size - cornerSize, size - cornerSize, 0 };
+        const int kTop[4] = { 0, 0, size - cornerSize, size - cornerSize };
+        for (int c = 0; c < 4; ++c)
+        {
+            masks->corners[c].resize(cornerSize * cornerSize);
+            for (int y = 0; y < cornerSize; ++y)
+            {
+                for (int x = 0; x < cornerSize; ++x)
+                {
+                    int cx = kLeft[c] + x;
+                    int cy = kTop[c] + y;
+                    bool window = cx >= shadowSize && cx < size - shadowSize &&
+                        cy >= shadowSize && cy < size - shadowSize;
+                    masks->corners[c][y * cornerSize + x] = window ? 0 : canvas[cy * size + cx];
+                }
+            }
+        }
+
+        int middle = size / 2;
+        for (int e = 0; e < 4; ++e)
+            masks->edges[e].resize(shadowSize);
+
+        for (int i = 0; i < shadowSize; ++i)
+        {
+            masks->edges[EdgeN][i] = canvas[i * size + middle];
+            masks->edges[EdgeS][i] = canvas[(size - shadowSize + i) * size + middle];
+            masks->edges[EdgeW][i] = canvas[middle * size + i];
+            masks->edges[EdgeE][i] = canvas[middle * size + size - shadowSize + i];
+        }
+    }
+
+    bool SameMasks(const ShadowMasks& a, const ShadowMasks& b)
+    {
+        if (a.shadow_size != b.shadow_size || a.corner_size != b.corner_size)
+            return false;
+
+        for (int i = 0; i < 4; ++i)
+        {
+            if (a.corners[i] != b.corners[i] || a.edges[i] != b.edges[i])
+                return false;
+        }
+        return true;
+    }
+
+    unsigned long HashMasks(const ShadowMasks& masks)
+    {
+        unsigned long hash = 2166136261u;
+        for (int i = 0; i < 8; ++i)
+        {
+            const Mask& mask = (i < 4) ? masks.corners[i] : masks.edges[i - 4];
+            for (size_t j = 0; j < mask.size(); ++j)
+                hash = ((hash ^ mask[j]) * 16777619u) & 0xFFFFFFFFu;
+        }
+        return hash;
+    }
+
+    ShadowParams MakeParams(int radius, int spread, int opacity, int offsetX, int offsetY)
+    {
+        ShadowParams params = { radius, spread, opacity, offsetX, offsetY };
+        return params;
+    }
+
+} // namespace
+
+TEST(ShadowGeneratorMatchesReference)
+{
+    for (int radius = 1; radius <= 24; ++radius)
+    {
+        const ShadowParams kCases[] =
+        {
+            MakeParams(radius, 0, 255, 0, 0),
+            MakeParams(radius, radius, 115, 0, radius / 2),
+            MakeParams(radius, -radius, 200, radius, 0),
+            MakeParams(radius, radius / 2, 64, -radius / 3, radius)
+        };
+
+        for (size_t i = 0; i < sizeof(kCases) / sizeof(kCases[0]); ++i)
+        {
+            ShadowMasks masks;
+            ShadowMasks reference;
+            CHECK(ShadowGenerator::Generate(kCases[i], &masks));
+            ReferenceGenerate(kCases[i], &reference);
+            CHECK(SameMasks(reference, masks));
+        }
+    }
+}
+
+TEST(ShadowGeneratorMatchesReferenceAtLargeRadii)
+{
+    const ShadowParams kCases[] =
+    {
+        MakeParams(32, 0, 90, 0, 8),
+        MakeParams(48, 12, 255, 0, 0),
+        MakeParams(64, 0, 80, 0, 16)
+    };
+
+    for (size_t i = 0; i < sizeof(kCases) / sizeof(kCases[0]); ++i)
+    {
+        ShadowMasks masks;
+        ShadowMasks reference;
+        CHECK(ShadowGenerator::Generate(kCases[i], &masks));
+        ReferenceGenerate(kCases[i], &reference);
+        CHECK(SameMasks(reference, masks));
+    }
+}
+
+// The masks of a few shadows as they were first generated, so that a
+// change to the blur, which the reference above would follow, shows.
+TEST(ShadowGeneratorGoldenMasks)
+{
+    const struct
+    {
+        ShadowParams params;
+        int shadow_size;
+        unsigned long hash;
+    } kGolden[] =
+    {
+        { { 12, 0, 115, 0, 2 }, 14, 0xAB8E8C2FUL },
+        { { 8, 2, 128, 1, 3 }, 14, 0x2947FFA9UL },
+        { { 32, -8, 200, 0, 0 }, 33, 0x696DD841UL },
+        { { 64, 0, 80, 0, 16 }, 82, 0xE30AA075UL },
+        { { 96, 96, 255, 96, 96 }, 288, 0x5031DD9CUL }
+    };
+
+    for (size_t i = 0; i < sizeof(kGolden) / sizeof(kGolden[0]); ++i)
+    {
+        ShadowMasks masks;
+        CHECK(ShadowGenerator::Generate(kGolden[i].params, &masks));
+        CHECK_EQUAL(kGolden[i].shadow_size, masks.shadow_size);
+        CHECK_EQUAL(kGolden[i].hash, HashMasks(masks));
+    }
+}
+
+TEST(ShadowGeneratorIsSymmetricWithoutOffset)
+{
+    ShadowMasks masks;
+    CHECK(ShadowGenerator::Generate(MakeParams(20, 3, 180, 0, 0), &masks));
+
+    int size = masks.corner_size;
+    for (int y = 0; y < size; ++y)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            unsigned char nw = masks.corners[CornerNW][y * size + x];
+            CHECK_EQUAL(nw, masks.corners[CornerNE][y * size + size - 1 - x]);
+            CHECK_EQUAL(nw, masks.corners[CornerSW][(size - 1 - y) * size + x]);
+            CHECK_EQUAL(nw, masks.corners[CornerSE][(size - 1 - y) * size + size - 1 - x]);
+        }
+    }
+
+    int depth = masks.shadow_size;
+    for (int i = 0; i < depth; ++i)
+    {
+        CHECK_EQUAL(masks.edges[EdgeN][i], masks.edges[EdgeS][depth - 1 - i]);
+        CHECK_EQUAL(masks.edges[EdgeW][i], masks.edges[EdgeE][depth - 1 - i]);
+
+        // darker toward the window, never over the opacity
+        if (i > 0)
+            CHECK(masks.edges[EdgeN][i] >= masks.edges[EdgeN][i - 1]);
+        CHECK(masks.edges[EdgeN][i] <= 180);
+    }
+}
+
+TEST(ShadowGeneratorRejectsBadParams)
+{
+    ShadowMasks masks;
+    CHECK(!ShadowGenerator::Generate(MakeParams(0, 0, 100, 0, 0), &masks));
+    CHECK(!ShadowGenerator::Generate(MakeParams(kMaxShadowRadius + 1, 0, 100, 0, 0), &masks));
+    CHECK(!ShadowGenerator::Generate(MakeParams(8, 9, 100, 0, 0), &masks));
+    CHECK(!ShadowGenerator::Generate(MakeParams(8, -9, 100, 0, 0), &masks));
+    CHECK(!ShadowGenerator::Generate(MakeParams(8, 0, 256, 0, 0), &masks));
+    CHECK(!ShadowGenerator::Generate(MakeParams(8, 0, -1, 0, 0), &masks));
+    CHECK(!ShadowGenerator::Generate(MakeParams(8, 0, 100, 9, 0), &masks));
+    CHECK(!ShadowGenerator::Generate(MakeParams(8, 0, 100, 0, -9), &masks));
+}
+
+namespace
+{
+    // What a quarter turn clockwise means: the pixel at (x, y) of the
+    // source ends up at (height - 1 - y, x) of the result, which is
+    // 'height' pixels wide.
+    Mask RotateByDefinition(const Mask& src, int width, int height, int rotation)
+    {
+        Mask dst = src;
+        for (int turn = 0; turn < rotation % 4; ++turn)
+        {
+            Mask turned(dst.size());
+            for (int y = 0; y < height; ++y)
+            {
+                for (int x = 0; x < width; ++x)
+                    turned[x * height + (height - 1 - y)] = dst[y * width + x];
+            }
+
+            dst.swap(turned);
+            std::swap(width, height);
+        }
+        return dst;
+    }
+
+} // namespace
+
+TEST(ShadowGeneratorRotatesMasks)
+{
+    const int kSizes[][2] = { { 1, 1 }, { 1, 12 }, { 12, 1 }, { 26, 26 }, { 7, 3 }, { 5, 16 } };
+
+    for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); ++i)
+    {
+        int width = kSizes[i][0];
+        int height = kSizes[i][1];
+
+        Mask src(width * height);
+        for (size_t p = 0; p < src.size(); ++p)
+            src[p] = (unsigned char)(p * 7 + 1);
+
+        for (int rotation = 0; rotation < 8; ++rotation)
+        {
+            Mask dst;
+            ShadowGenerator::RotateMask(src, width, height, rotation, &dst);
+            CHECK(dst == RotateByDefinition(src, width, height, rotation));
+        }
+    }
+}
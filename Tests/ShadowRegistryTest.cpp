@@ -0,0 +1,78 @@
+#include "stdafx.h"
+
+#include "Check.h"
+#include "ShadowRegistry.h"
+
+using namespace MetroWindow;
+
+namespace
+{
+    // Initializes the registry for one test, as DllMain does.
+    class ScopedRegistry
+    {
+    public:
+        ScopedRegistry()
+        {
+            ShadowRegistry::Initialize();
+        }
+
+        ~ScopedRegistry()
+        {
+            ShadowRegistry::Uninitialize();
+        }
+    };
+
+} // namespace
+
+TEST(ShadowRegistrySharesSets)
+{
+    ScopedRegistry registry;
+    ShadowParams params = { 12, 0, 115, 0, 2 };
+
+    const DropShadowBitmaps* standard = ShadowRegistry::Acquire(NULL, 96);
+    CHECK(standard != NULL);
+    CHECK(ShadowRegistry::Acquire(NULL, 192) == standard);
+
+    const DropShadowBitmaps* custom = ShadowRegistry::Acquire(&params, 96);
+    CHECK(custom != NULL && custom != standard);
+    CHECK(ShadowRegistry::Acquire(&params, 96) == custom);
+    CHECK_EQUAL(2, ShadowRegistry::GetCount());
+
+    // Scaled for the dpi, and a set of its own.
+    const DropShadowBitmaps* large = ShadowRegistry::Acquire(&params, 192);
+    CHECK(large != custom);
+    CHECK(large->GetMasks().shadow_size > custom->GetMasks().shadow_size);
+    CHECK_EQUAL(3, ShadowRegistry::GetCount());
+
+    ShadowRegistry::Release(large);
+    CHECK_EQUAL(2, ShadowRegistry::GetCount());
+
+    // Freed with the last reference.
+    ShadowRegistry::Release(custom);
+    CHECK_EQUAL(2, ShadowRegistry::GetCount());
+    ShadowRegistry::Release(custom);
+    CHECK_EQUAL(1, ShadowRegistry::GetCount());
+
+    ShadowRegistry::Release(standard);
+    ShadowRegistry::Release(standard);
+    ShadowRegistry::Release(NULL);
+    CHECK_EQUAL(0, ShadowRegistry::GetCount());
+}
+
+TEST(ShadowRegistryKeepsLargeShadowsInRange)
+{
+    ScopedRegistry registry;
+    ShadowParams params = { kMaxShadowRadius, 8, 90, 0, 16 };
+
+    // Four times the largest radius is drawn at the largest one, with
+    // the rest shrunk as much, which is where it started.
+    const DropShadowBitmaps* shadow = ShadowRegistry::Acquire(&params, 96 * 4);
+    CHECK(shadow != NULL);
+
+    ShadowMasks masks;
+    CHECK(ShadowGenerator::Generate(params, &masks));
+    CHECK_EQUAL(masks.shadow_size, shadow->GetMasks().shadow_size);
+    CHECK(masks.corners[CornerSE] == shadow->GetMasks().corners[CornerSE]);
+
+    ShadowRegistry::Release(shadow);
+}
@@ -0,0 +1,150 @@
+#include "stdafx.h"
+
+#include "Check.h"
+#include "DropShadowBitmaps.h"
+#include "ShadowSurround.h"
+
+#include <string.h>
+
+using namespace MetroWindow;
+
+namespace
+{
+    const ShadowSide kSides[] = { Left, Top, Right, Bottom };
+
+    int GetArea(const ShadowRect& rect)
+    {
+        return (rect.right - rect.left) * (rect.bottom - rect.top);
+    }
+
+    // Adds one to every pixel of 'rect' in a surfaceWidth wide counter.
+    void Cover(std::vector<int>* counts, int surfaceWidth, const ShadowRect& rect)
+    {
+        for (int y = rect.top; y < rect.bottom; ++y)
+            for (int x = rect.left; x < rect.right; ++x)
+                ++(*counts)[y * surfaceWidth + x];
+    }
+
+} // namespace
+
+TEST(ShadowSurroundTilesTheSurface)
+{
+    const int kSizes[][3] = { { 1, 1, 1 }, { 640, 480, 14 }, { 3, 200, 26 }, { 200, 3, 7 } };
+
+    for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); ++i)
+    {
+        int width = kSizes[i][0];
+        int height = kSizes[i][1];
+        int shadowSize = kSizes[i][2];
+        int surfaceWidth = ShadowSurround::GetSurfaceWidth(width, shadowSize);
+        int surfaceHeight = ShadowSurround::GetSurfaceHeight(height, shadowSize);
+        CHECK_EQUAL(width + shadowSize * 2, surfaceWidth);
+        CHECK_EQUAL(height + shadowSize * 2, surfaceHeight);
+
+        // The strips and the inside cover every pixel once.
+        std::vector<int> counts(surfaceWidth * surfaceHeight);
+        for (int s = 0; s < 4; ++s)
+            Cover(&counts, surfaceWidth, ShadowSurround::GetStripBounds(kSides[s], width, height, shadowSize));
+
+        ShadowRect interior = ShadowSurround::GetInterior(width, height, shadowSize);
+        CHECK_EQUAL(width * height, GetArea(interior));
+        Cover(&counts, surfaceWidth, interior);
+
+        for (size_t p = 0; p < counts.size(); ++p)
+            CHECK_EQUAL(1, counts[p]);
+    }
+}
+
+TEST(ShadowSurroundStripsMatchTheWindows)
+{
+    // The strip windows: the top and bottom ones are as wide as the
+    // window and both shadows, the side ones as tall as the window.
+    int width = 300;
+    int height = 200;
+    int shadowSize = 14;
+
+    ShadowRect top = ShadowSurround::GetStripBounds(Top, width, height, shadowSize);
+    ShadowRect bottom = ShadowSurround::GetStripBounds(Bottom, width, height, shadowSize);
+    ShadowRect left = ShadowSurround::GetStripBounds(Left, width, height, shadowSize);
+    ShadowRect right = ShadowSurround::GetStripBounds(Right, width, height, shadowSize);
+
+    CHECK_EQUAL(width + shadowSize * 2, top.right - top.left);
+    CHECK_EQUAL(shadowSize, top.bottom - top.top);
+    CHECK_EQUAL(width + shadowSize * 2, bottom.right - bottom.left);
+    CHECK_EQUAL(shadowSize + height, bottom.top);
+    CHECK_EQUAL(shadowSize, left.right - left.left);
+    CHECK_EQUAL(height, left.bottom - left.top);
+    CHECK_EQUAL(shadowSize + width, right.left);
+    CHECK_EQUAL(height, right.bottom - right.top);
+}
+
+TEST(ShadowSurroundComposesTheStrips)
+{
+    DropShadowBitmaps bitmaps;
+    bitmaps.Initialize();
+    const ShadowMasks& masks = bitmaps.GetMasks();
+
+    int width = 173;
+    int height = 91;
+    int shadowSize = masks.shadow_size;
+    int surfaceWidth = ShadowSurround::GetSurfaceWidth(width, shadowSize);
+    int surfaceHeight = ShadowSurround::GetSurfaceHeight(height, shadowSize);
+    int stride = surfaceWidth * 4;
+
+    std::vector<unsigned char> surface(stride * surfaceHeight, 0xCD);
+    int written = ShadowSurround::Compose(masks, 0x12, 0x34, 0x56, &surface[0], stride, width, height);
+
+    int expectedWritten = 0;
+    for (int s = 0; s < 4; ++s)
+    {
+        // Every strip as the strip window would have it.
+        ShadowRect strip = ShadowSurround::GetStripBounds(kSides[s], width, height, shadowSize);
+        int cx = strip.right - strip.left;
+        int cy = strip.bottom - strip.top;
+
+        std::vector<unsigned char> alone(cx * 4 * cy);
+        expectedWritten += ShadowCompositor::ComposeSide(masks, 0x12, 0x34, 0x56, kSides[s],
+            &alone[0], cx * 4, cx, cy);
+
+        for (int y = 0; y < cy; ++y)
+            CHECK(memcmp(&alone[y * cx * 4], &surface[(strip.top + y) * stride + strip.left * 4], cx * 4) == 0);
+    }
+    CHECK_EQUAL(expectedWritten, written);
+
+    // The inside is left alone.
+    ShadowRect interior = ShadowSurround::GetInterior(width, height, shadowSize);
+    for (int y = interior.top; y < interior.bottom; ++y)
+        for (int x = interior.left * 4; x < interior.right * 4; ++x)
+            CHECK_EQUAL(0xCD, (int)surface[y * stride + x]);
+}
+
+TEST(ShadowSurroundClearsTheStrips)
+{
+    int width = 64;
+    int height = 40;
+    int shadowSize = 9;
+    int surfaceWidth = ShadowSurround::GetSurfaceWidth(width, shadowSize);
+    int surfaceHeight = ShadowSurround::GetSurfaceHeight(height, shadowSize);
+
+    // Padded rows, which must not be touched either.
+    int stride = (surfaceWidth + 2) * 4;
+    std::vector<unsigned char> surface(stride * surfaceHeight, 0xCD);
+
+    int written = ShadowSurround::Clear(&surface[0], stride, width, height, shadowSize);
+    CHECK_EQUAL(surfaceWidth * surfaceHeight - width * height, written);
+
+    ShadowRect interior = ShadowSurround::GetInterior(width, height, shadowSize);
+    for (int y = 0; y < surfaceHeight; ++y)
+    {
+        for (int x = 0; x < surfaceWidth + 2; ++x)
+        {
+            bool inside = x >= interior.left && x < interior.right &&
+                y >= interior.top && y < interior.bottom;
+            bool strip = x < surfaceWidth && !inside;
+            const unsigned char* p = &surface[y * stride + x * 4];
+
+            for (int c = 0; c < 4; ++c)
+                CHECK_EQUAL(strip ? 0 : 0xCD, (int)p[c]);
+        }
+    }
+}
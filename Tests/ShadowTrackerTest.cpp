@@ -0,0 +1,77 @@
+#include "Check.h"
+#include "ShadowTracker.h"
+
+using namespace MetroWindow;
+
+namespace
+{
+    ShadowPlacement MakePlacement(int left, int top, int width, int height, unsigned long color)
+    {
+        ShadowPlacement placement = { left, top, width, height, color };
+        return placement;
+    }
+
+} // namespace
+
+TEST(ShadowTrackerChangesFirst)
+{
+    ShadowTracker tracker;
+    CHECK_EQUAL((int)ShadowChanged, (int)tracker.Update(MakePlacement(0, 0, 0, 0, 0), false));
+}
+
+TEST(ShadowTrackerSkipsAnUnchangedRect)
+{
+    ShadowTracker tracker;
+    ShadowPlacement placement = MakePlacement(100, 80, 640, 480, 0x202020);
+    tracker.Update(placement, false);
+
+    // The messages a window gets while it is activated or repainted in
+    // place leave the shadow alone.
+    for (int i = 0; i < 10; ++i)
+        CHECK_EQUAL((int)ShadowUnchanged, (int)tracker.Update(placement, false));
+}
+
+TEST(ShadowTrackerMovesWithoutRedrawing)
+{
+    ShadowTracker tracker;
+    tracker.Update(MakePlacement(100, 80, 640, 480, 0x202020), false);
+
+    // A drag: every step a move, none a change.
+    for (int i = 1; i <= 50; ++i)
+    {
+        ShadowPlacement placement = MakePlacement(100 + i * 3, 80 - i, 640, 480, 0x202020);
+        CHECK_EQUAL((int)ShadowMoved, (int)tracker.Update(placement, false));
+    }
+
+    CHECK_EQUAL((int)ShadowUnchanged,
+        (int)tracker.Update(MakePlacement(250, 30, 640, 480, 0x202020), false));
+}
+
+TEST(ShadowTrackerRedrawsOnSizeOrColor)
+{
+    ShadowTracker tracker;
+    tracker.Update(MakePlacement(100, 80, 640, 480, 0x202020), false);
+
+    CHECK_EQUAL((int)ShadowChanged, (int)tracker.Update(MakePlacement(100, 80, 641, 480, 0x202020), false));
+    CHECK_EQUAL((int)ShadowChanged, (int)tracker.Update(MakePlacement(100, 80, 641, 479, 0x202020), false));
+    CHECK_EQUAL((int)ShadowChanged, (int)tracker.Update(MakePlacement(100, 80, 641, 479, 0x0000FF), false));
+
+    // A move that also resizes is a change.
+    CHECK_EQUAL((int)ShadowChanged, (int)tracker.Update(MakePlacement(0, 0, 800, 600, 0x0000FF), false));
+    CHECK_EQUAL((int)ShadowUnchanged, (int)tracker.Update(MakePlacement(0, 0, 800, 600, 0x0000FF), false));
+}
+
+TEST(ShadowTrackerForcesAndResets)
+{
+    ShadowTracker tracker;
+    ShadowPlacement placement = MakePlacement(10, 20, 300, 200, 0);
+    tracker.Update(placement, false);
+
+    CHECK_EQUAL((int)ShadowChanged, (int)tracker.Update(placement, true));
+    CHECK_EQUAL((int)ShadowUnchanged, (int)tracker.Update(placement, false));
+
+    // Shown again after being hidden, it is drawn again.
+    tracker.Reset();
+    CHECK_EQUAL((int)ShadowChanged, (int)tracker.Update(placement, false));
+    CHECK_EQUAL((int)ShadowUnchanged, (int)tracker.Update(placement, false));
+}
@@ -0,0 +1,251 @@
+#include "stdafx.h"
+
+#include <stdio.h>
+
+#include "Bench.h"
+#include "DropShadowBitmaps.h"
+#include "ShadowFade.h"
+#include "ShadowRegistry.h"
+#include "SurfaceCapacity.h"
+
+// What updating the four shadow strips of a window costs, across window
+// sizes and display scales. The strip windows are played on memory
+// surfaces the way CDropShadowWnd::UpdateShadow drives its DIB
+// sections: SurfaceCapacity plans the update, the surface is kept while
+// it is large enough, and the masks are drawn from where the strip
+// changed.
+//
+// Four cases for every window:
+//   show    four new strip windows showing the shadow the first time
+//   redraw  the kept surfaces drawn again in full, as for a color change
+//   drag    one step of a resize drag, the size going up and down by a
+//           pixel at a time
+//   fade    one frame of the activation fade, the color stepped by
+//           ShadowFade and the kept surfaces drawn again in it
+//
+// The generated shadow comes from the registry at the dpi of the scale.
+// The built-in one is a fixed bitmap and is only run at 100%.
+
+using namespace MetroWindow;
+
+namespace
+{
+    struct UpdateStats
+    {
+        long updates;
+        long allocations;
+        long long bytes_written;
+    };
+
+    // The surface of one strip window, in memory.
+    class StripWindow
+    {
+    public:
+        explicit StripWindow(ShadowSide side)
+            : side_(side), capacity_width_(0), capacity_height_(0), width_(0), height_(0), color_(0)
+        {
+        }
+
+        void Update(const DropShadowBitmaps& shadow, int windowWidth, int windowHeight, COLORREF color,
+            bool force, UpdateStats* stats)
+        {
+            int shadowSize = shadow.GetShadowSize();
+            bool horizontal = (side_ == Top || side_ == Bottom);
+            int width = horizontal ? windowWidth + shadowSize * 2 : shadowSize;
+            int height = horizontal ? shadowSize : windowHeight;
+
+            SurfaceCapacity::Strip strip = { capacity_width_, capacity_height_, width_, height_, !bits_.empty() };
+            SurfaceCapacity::Update update = SurfaceCapacity::PlanStripUpdate(strip, width, height,
+                horizontal, shadow.GetFarCornerExtent(side_), force || color != color_);
+
+            if (update.reallocate)
+            {
+                // A new DIB section, the old one freed.
+                std::vector<BYTE>((size_t)update.capacity_width * update.capacity_height * 4).swap(bits_);
+                capacity_width_ = update.capacity_width;
+                capacity_height_ = update.capacity_height;
+                ++stats->allocations;
+            }
+
+            if (update.redraw_from >= 0)
+            {
+                int written = shadow.MakeShadow(&bits_[0], capacity_width_ * 4, width, height, side_, color,
+                    update.redraw_from);
+                stats->bytes_written += written * 4;
+            }
+
+            width_ = width;
+            height_ = height;
+            color_ = color;
+        }
+
+        const BYTE* GetBits() const { return bits_.empty() ? NULL : &bits_[0]; }
+
+    private:
+        ShadowSide side_;
+        std::vector<BYTE> bits_;
+        int capacity_width_;
+        int capacity_height_;
+        int width_;
+        int height_;
+        COLORREF color_;
+    };
+
+    // The four strip windows of a frame.
+    class StripShadow
+    {
+    public:
+        StripShadow(void)
+            : left_(Left), top_(Top), right_(Right), bottom_(Bottom)
+        {
+        }
+
+        void Update(const DropShadowBitmaps& shadow, int width, int height, COLORREF color, bool force,
+            UpdateStats* stats)
+        {
+            left_.Update(shadow, width, height, color, force, stats);
+            top_.Update(shadow, width, height, color, force, stats);
+            right_.Update(shadow, width, height, color, force, stats);
+            bottom_.Update(shadow, width, height, color, force, stats);
+            ++stats->updates;
+            Bench::Consume(top_.GetBits());
+        }
+
+    private:
+        StripWindow left_;
+        StripWindow top_;
+        StripWindow right_;
+        StripWindow bottom_;
+    };
+
+    enum UpdateCase
+    {
+        CaseShow,
+        CaseRedraw,
+        CaseDrag,
+        CaseFade
+    };
+
+    const char* const kCaseNames[] = { "show", "redraw", "drag", "fade" };
+
+    struct UpdateWork
+    {
+        const DropShadowBitmaps* shadow;
+        UpdateCase update_case;
+        int width;
+        int height;
+        StripShadow kept;
+        int step;
+        ShadowFade fade;
+        UpdateStats stats;
+
+        void operator()()
+        {
+            switch (update_case)
+            {
+                case CaseShow:
+                    {
+                        StripShadow shown;
+                        shown.Update(*shadow, width, height, RGB(0, 0, 0), true, &stats);
+                    }
+                    break;
+
+                case CaseRedraw:
+                    kept.Update(*shadow, width, height, RGB(0, 0, 0), true, &stats);
+                    break;
+
+                case CaseDrag:
+                    {
+                        // Out 32 pixels and back again, one pixel a step.
+                        int offset = step % 64 < 32 ? step % 64 : 63 - step % 64;
+                        kept.Update(*shadow, width + offset, height + offset / 2, RGB(0, 0, 0), false, &stats);
+                        ++step;
+                    }
+                    break;
+
+                case CaseFade:
+                    // Activated and deactivated, over and over.
+                    if (!fade.Step())
+                    {
+                        COLORREF from = fade.GetColor();
+                        fade.Start(from, from == RGB(0, 0, 0) ? RGB(0, 120, 215) : RGB(0, 0, 0));
+                    }
+                    kept.Update(*shadow, width, height, fade.GetColor(), false, &stats);
+                    break;
+            }
+        }
+    };
+
+    void Run(const char* name, int scale, const DropShadowBitmaps* shadow, int width, int height)
+    {
+        for (int c = CaseShow; c <= CaseFade; ++c)
+        {
+            UpdateWork work;
+            work.shadow = shadow;
+            work.update_case = (UpdateCase)c;
+            work.width = width;
+            work.height = height;
+            work.step = 0;
+            ZeroMemory(&work.stats, sizeof(work.stats));
+
+            // The kept windows are shown before they are timed.
+            if (work.update_case != CaseShow)
+            {
+                work.kept.Update(*shadow, width, height, RGB(0, 0, 0), true, &work.stats);
+                ZeroMemory(&work.stats, sizeof(work.stats));
+            }
+
+            // The fade is under way when it is timed.
+            if (work.update_case == CaseFade)
+                work.fade.Start(RGB(0, 0, 0), RGB(0, 120, 215));
+
+            // Every allocation counts here, not only the surfaces.
+            unsigned long allocations = Bench::GetAllocations();
+            double ns = Bench::Measure(work);
+            allocations = Bench::GetAllocations() - allocations;
+
+            long updates = work.stats.updates;
+            printf("%-10s %4d%% %5dx%-5d %-7s %12.0f %12.0f %10.3f %10.3f\n", name, scale, width, height,
+                kCaseNames[c], ns, (double)work.stats.bytes_written / updates,
+                (double)work.stats.allocations / updates, (double)allocations / updates);
+        }
+    }
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Bench::ParseArgs(argc, argv);
+    ShadowRegistry::Initialize();
+
+    static const int kScales[] = { 100, 125, 150, 175, 200, 250, 300 };
+    static const int kSizes[][2] =
+    {
+        { 200, 150 }, { 400, 300 }, { 800, 600 }, { 1280, 800 },
+        { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 }
+    };
+    ShadowParams params = { 12, 0, 115, 0, 2 };
+
+    printf("%-10s %5s %-11s %-7s %12s %12s %10s %10s\n", "shadow", "scale", "window", "case",
+        "ns/update", "bytes/upd", "surf/upd", "allocs/upd");
+
+    for (int s = 0; s < (int)(sizeof(kScales) / sizeof(kScales[0])); ++s)
+    {
+        int dpi = 96 * kScales[s] / 100;
+        const DropShadowBitmaps* standard = (kScales[s] == 100) ? ShadowRegistry::Acquire(NULL, dpi) : NULL;
+        const DropShadowBitmaps* generated = ShadowRegistry::Acquire(&params, dpi);
+
+        for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); ++i)
+        {
+            if (standard != NULL)
+                Run("built-in", kScales[s], standard, kSizes[i][0], kSizes[i][1]);
+            Run("radius 12", kScales[s], generated, kSizes[i][0], kSizes[i][1]);
+        }
+
+        ShadowRegistry::Release(standard);
+        ShadowRegistry::Release(generated);
+    }
+
+    ShadowRegistry::Uninitialize();
+    return 0;
+}
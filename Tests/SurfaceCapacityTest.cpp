@@ -0,0 +1,154 @@
+#include "Check.h"
+#include "SurfaceCapacity.h"
+
+using namespace MetroWindow;
+
+namespace
+{
+    SurfaceCapacity::Strip MakeStrip(int capacityWidth, int capacityHeight, int width, int height)
+    {
+        SurfaceCapacity::Strip strip = { capacityWidth, capacityHeight, width, height, true };
+        return strip;
+    }
+
+} // namespace
+
+TEST(SurfaceCapacityRoundsUp)
+{
+    CHECK_EQUAL(0, SurfaceCapacity::RoundUp(0));
+    CHECK_EQUAL(64, SurfaceCapacity::RoundUp(1));
+    CHECK_EQUAL(64, SurfaceCapacity::RoundUp(64));
+    CHECK_EQUAL(128, SurfaceCapacity::RoundUp(65));
+    CHECK_EQUAL(1024, SurfaceCapacity::RoundUp(1024));
+    CHECK_EQUAL(1280, SurfaceCapacity::RoundUp(1025));
+    CHECK_EQUAL(3840, SurfaceCapacity::RoundUp(3840));
+    CHECK_EQUAL(4096, SurfaceCapacity::RoundUp(3841));
+}
+
+TEST(SurfaceCapacityGrowsWithSlack)
+{
+    int capacityWidth = 0;
+    int capacityHeight = 0;
+
+    CHECK(SurfaceCapacity::Grow(&capacityWidth, &capacityHeight, 300, 12));
+    CHECK_EQUAL(320, capacityWidth);
+    CHECK_EQUAL(64, capacityHeight);
+
+    // Anything that fits costs nothing.
+    for (int width = 1; width <= 320; width += 3)
+        CHECK(!SurfaceCapacity::Grow(&capacityWidth, &capacityHeight, width, 12));
+
+    // Growing one way keeps the other.
+    CHECK(SurfaceCapacity::Grow(&capacityWidth, &capacityHeight, 321, 12));
+    CHECK_EQUAL(384, capacityWidth);
+    CHECK_EQUAL(64, capacityHeight);
+
+    CHECK(SurfaceCapacity::Grow(&capacityWidth, &capacityHeight, 10, 65));
+    CHECK_EQUAL(384, capacityWidth);
+    CHECK_EQUAL(128, capacityHeight);
+}
+
+TEST(SurfaceCapacityNeverShrinks)
+{
+    int capacityWidth = 0;
+    int capacityHeight = 0;
+    CHECK(SurfaceCapacity::Grow(&capacityWidth, &capacityHeight, 3840, 2160));
+
+    // Shrinking to any size and back up again allocates nothing.
+    for (int size = 3840; size > 0; size /= 2)
+        CHECK(!SurfaceCapacity::Grow(&capacityWidth, &capacityHeight, size, size / 2));
+    CHECK(!SurfaceCapacity::Grow(&capacityWidth, &capacityHeight, 3840, 2160));
+
+    CHECK_EQUAL(3840, capacityWidth);
+    CHECK_EQUAL(2304, capacityHeight);
+}
+
+TEST(SurfaceCapacityDragAllocatesOnce)
+{
+    // A live resize from 400 to 1900 pixels wide, a pixel at a time and
+    // back: allocations only when crossing a step, none on the way back.
+    SurfaceCapacity::Strip strip = { 0, 0, 0, 0, false };
+    int allocations = 0;
+
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (int i = 0; i <= 1500; ++i)
+        {
+            int width = pass == 0 ? 400 + i : 1900 - i;
+            SurfaceCapacity::Update update = SurfaceCapacity::PlanStripUpdate(strip, width, 12, true, 26, false);
+            if (update.reallocate)
+            {
+                ++allocations;
+                strip.capacity_width = update.capacity_width;
+                strip.capacity_height = update.capacity_height;
+                strip.allocated = true;
+            }
+
+            strip.width = width;
+            strip.height = 12;
+        }
+    }
+
+    // 448 ... 1024 in steps of 64, then 1280 ... 2048 in steps of 256
+    CHECK_EQUAL(1 + 9 + 4, allocations);
+    CHECK_EQUAL(2048, strip.capacity_width);
+}
+
+TEST(SurfaceCapacityPlansTheFirstUpdate)
+{
+    SurfaceCapacity::Strip strip = { 0, 0, 0, 0, false };
+    SurfaceCapacity::Update update = SurfaceCapacity::PlanStripUpdate(strip, 500, 12, true, 26, false);
+
+    CHECK(update.reallocate);
+    CHECK_EQUAL(512, update.capacity_width);
+    CHECK_EQUAL(64, update.capacity_height);
+    CHECK_EQUAL(0, update.redraw_from);
+}
+
+TEST(SurfaceCapacityRedrawsOnlyTheFarEnd)
+{
+    SurfaceCapacity::Strip strip = MakeStrip(512, 64, 400, 12);
+
+    // Same size: nothing to draw.
+    SurfaceCapacity::Update update = SurfaceCapacity::PlanStripUpdate(strip, 400, 12, true, 26, false);
+    CHECK(!update.reallocate);
+    CHECK_EQUAL(-1, update.redraw_from);
+
+    // Longer or shorter: from the far corner of the shorter one.
+    update = SurfaceCapacity::PlanStripUpdate(strip, 450, 12, true, 26, false);
+    CHECK(!update.reallocate);
+    CHECK_EQUAL(400 - 26, update.redraw_from);
+
+    update = SurfaceCapacity::PlanStripUpdate(strip, 300, 12, true, 26, false);
+    CHECK(!update.reallocate);
+    CHECK_EQUAL(300 - 26, update.redraw_from);
+
+    // A strip shorter than the corner is drawn in full.
+    update = SurfaceCapacity::PlanStripUpdate(strip, 10, 12, true, 26, false);
+    CHECK_EQUAL(0, update.redraw_from);
+
+    // A vertical strip measures its length in rows.
+    SurfaceCapacity::Strip side = MakeStrip(64, 512, 12, 400);
+    update = SurfaceCapacity::PlanStripUpdate(side, 12, 420, false, 14, false);
+    CHECK_EQUAL(400 - 14, update.redraw_from);
+}
+
+TEST(SurfaceCapacityRedrawsAllOnDepthOrForce)
+{
+    SurfaceCapacity::Strip strip = MakeStrip(512, 64, 400, 12);
+
+    SurfaceCapacity::Update update = SurfaceCapacity::PlanStripUpdate(strip, 400, 14, true, 26, false);
+    CHECK(!update.reallocate);
+    CHECK_EQUAL(0, update.redraw_from);
+
+    update = SurfaceCapacity::PlanStripUpdate(strip, 400, 12, true, 26, true);
+    CHECK(!update.reallocate);
+    CHECK_EQUAL(0, update.redraw_from);
+
+    // Past the capacity it is allocated again, keeping the other length.
+    update = SurfaceCapacity::PlanStripUpdate(strip, 513, 12, true, 26, false);
+    CHECK(update.reallocate);
+    CHECK_EQUAL(576, update.capacity_width);
+    CHECK_EQUAL(64, update.capacity_height);
+    CHECK_EQUAL(0, update.redraw_from);
+}
@@ -0,0 +1,69 @@
+#include "Check.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace
+{
+    struct Test
+    {
+        const char* name;
+        Check::TestFunction function;
+    };
+
+    std::vector<Test>& GetTests()
+    {
+        // Built on first use, the registrars run before main in any order.
+        static std::vector<Test> tests;
+        return tests;
+    }
+
+    bool failed = false;
+
+} // namespace
+
+namespace Check
+{
+
+Registrar::Registrar(const char* name, TestFunction function)
+{
+    Test test = { name, function };
+    GetTests().push_back(test);
+}
+
+void Fail(const char* file, int line, const std::string& message)
+{
+    fprintf(stderr, "%s(%d): %s\n", file, line, message.c_str());
+    failed = true;
+}
+
+} // namespace Check
+
+// Runs every test, or those whose name contains the argument.
+int main(int argc, char* argv[])
+{
+    const char* filter = (argc > 1) ? argv[1] : NULL;
+    int run = 0;
+    int failures = 0;
+
+    std::vector<Test>& tests = GetTests();
+    for (size_t i = 0; i < tests.size(); ++i)
+    {
+        if (filter != NULL && strstr(tests[i].name, filter) == NULL)
+            continue;
+
+        failed = false;
+        tests[i].function();
+        ++run;
+
+        if (failed)
+        {
+            fprintf(stderr, "FAILED %s\n", tests[i].name);
+            ++failures;
+        }
+    }
+
+    printf("%d tests, %d failed\n", run, failures);
+    return (failures == 0 && run > 0) ? 0 : 1;
+}
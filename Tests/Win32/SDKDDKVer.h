@@ -0,0 +1 @@
+/* The platform version, nothing to pick here. */
@@ -0,0 +1 @@
+/* Visual styles, the tests need none. */
@@ -0,0 +1,548 @@
+#include <windows.h>
+
+#include <limits.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace
+{
+    enum ObjectType
+    {
+        kThread = 1,
+        kSemaphore,
+        kBitmap,
+        kDC,
+        kRegion,
+        kStock
+    };
+
+    // Every handle points at one of these, the type first.
+    struct Object
+    {
+        int type;
+    };
+
+    struct Thread
+    {
+        Object header;
+        pthread_t thread;
+        LPTHREAD_START_ROUTINE start;
+        LPVOID param;
+        bool joined;
+    };
+
+    struct Semaphore
+    {
+        Object header;
+        sem_t sem;
+    };
+
+    struct Bitmap
+    {
+        Object header;
+        DIBSECTION dib;
+    };
+
+    struct DC
+    {
+        Object header;
+        HGDIOBJ selected;
+    };
+
+    struct Region
+    {
+        Object header;
+        RECT* rects;
+        int count;
+    };
+
+    // What a new DC has selected, as the 1 x 1 stock bitmap of GDI. It
+    // is not created and cannot be deleted.
+    Object stock_bitmap = { kStock };
+
+    unsigned long live_objects;
+    unsigned long created_objects;
+
+    template <typename T>
+    T* NewObject(int type)
+    {
+        T* object = (T *)calloc(1, sizeof(T));
+        if (object == NULL)
+            return NULL;
+
+        object->header.type = type;
+        __sync_add_and_fetch(&live_objects, 1);
+        __sync_add_and_fetch(&created_objects, 1);
+        return object;
+    }
+
+    void FreeObject(Object* object)
+    {
+        __sync_sub_and_fetch(&live_objects, 1);
+        free(object);
+    }
+
+    bool IsType(const void* handle, int type)
+    {
+        return handle != NULL && ((const Object *)handle)->type == type;
+    }
+
+    bool IsEmptyRect(const RECT& rect)
+    {
+        return rect.left >= rect.right || rect.top >= rect.bottom;
+    }
+
+    int GetRegionType(const Region* region)
+    {
+        if (region->count == 0)
+            return NULLREGION;
+        return region->count == 1 ? SIMPLEREGION : COMPLEXREGION;
+    }
+
+    // Makes 'region' the 'count' rects at 'rects', leaving out the
+    // empty ones.
+    bool SetRegionRects(Region* region, const RECT* rects, int count)
+    {
+        RECT* copy = (RECT *)malloc(sizeof(RECT) * (count > 0 ? count : 1));
+        if (copy == NULL)
+            return false;
+
+        int kept = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            if (!IsEmptyRect(rects[i]))
+                copy[kept++] = rects[i];
+        }
+
+        free(region->rects);
+        region->rects = copy;
+        region->count = kept;
+        return true;
+    }
+
+    void* RunThread(void* param)
+    {
+        Thread* thread = (Thread *)param;
+        thread->start(thread->param);
+        return NULL;
+    }
+
+} // namespace
+
+HANDLE CreateThread(void*, size_t, LPTHREAD_START_ROUTINE start, LPVOID param,
+                    DWORD, DWORD* threadId)
+{
+    Thread* thread = NewObject<Thread>(kThread);
+    if (thread == NULL)
+        return NULL;
+
+    thread->start = start;
+    thread->param = param;
+    if (pthread_create(&thread->thread, NULL, RunThread, thread) != 0)
+    {
+        FreeObject(&thread->header);
+        return NULL;
+    }
+
+    if (threadId != NULL)
+        *threadId = 0;
+    return thread;
+}
+
+HANDLE CreateSemaphore(void*, LONG initialCount, LONG, LPCWSTR)
+{
+    Semaphore* semaphore = NewObject<Semaphore>(kSemaphore);
+    if (semaphore == NULL)
+        return NULL;
+
+    if (sem_init(&semaphore->sem, 0, (unsigned int)initialCount) != 0)
+    {
+        FreeObject(&semaphore->header);
+        return NULL;
+    }
+
+    return semaphore;
+}
+
+BOOL ReleaseSemaphore(HANDLE handle, LONG releaseCount, LONG* previousCount)
+{
+    if (!IsType(handle, kSemaphore))
+        return FALSE;
+
+    Semaphore* semaphore = (Semaphore *)handle;
+    if (previousCount != NULL)
+    {
+        int value = 0;
+        sem_getvalue(&semaphore->sem, &value);
+        *previousCount = value;
+    }
+
+    for (LONG i = 0; i < releaseCount; ++i)
+        sem_post(&semaphore->sem);
+    return TRUE;
+}
+
+DWORD WaitForSingleObject(HANDLE handle, DWORD milliseconds)
+{
+    // Only infinite waits, which is all the library does.
+    if (milliseconds != INFINITE)
+        return WAIT_FAILED;
+
+    if (IsType(handle, kThread))
+    {
+        Thread* thread = (Thread *)handle;
+        if (!thread->joined)
+        {
+            pthread_join(thread->thread, NULL);
+            thread->joined = true;
+        }
+        return WAIT_OBJECT_0;
+    }
+
+    if (IsType(handle, kSemaphore))
+    {
+        while (sem_wait(&((Semaphore *)handle)->sem) != 0)
+            ;
+        return WAIT_OBJECT_0;
+    }
+
+    return WAIT_FAILED;
+}
+
+BOOL CloseHandle(HANDLE handle)
+{
+    if (IsType(handle, kThread))
+    {
+        Thread* thread = (Thread *)handle;
+        if (!thread->joined)
+            pthread_detach(thread->thread);
+        FreeObject(&thread->header);
+        return TRUE;
+    }
+
+    if (IsType(handle, kSemaphore))
+    {
+        sem_destroy(&((Semaphore *)handle)->sem);
+        FreeObject((Object *)handle);
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+void InitializeCriticalSection(CRITICAL_SECTION* section)
+{
+    // Recursive, as critical sections are.
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&section->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void DeleteCriticalSection(CRITICAL_SECTION* section)
+{
+    pthread_mutex_destroy(&section->mutex);
+}
+
+void EnterCriticalSection(CRITICAL_SECTION* section)
+{
+    pthread_mutex_lock(&section->mutex);
+}
+
+void LeaveCriticalSection(CRITICAL_SECTION* section)
+{
+    pthread_mutex_unlock(&section->mutex);
+}
+
+void GetSystemInfo(SYSTEM_INFO* info)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    info->dwNumberOfProcessors = (count > 0) ? (DWORD)count : 1;
+}
+
+int MulDiv(int number, int numerator, int denominator)
+{
+    if (denominator == 0)
+        return -1;
+
+    long long product = (long long)number * numerator;
+    bool negative = (product < 0) != (denominator < 0);
+    unsigned long long magnitude = (unsigned long long)(product < 0 ? -product : product);
+    unsigned long long divisor = (unsigned long long)(denominator < 0 ? -(long long)denominator : denominator);
+
+    unsigned long long quotient = (magnitude + divisor / 2) / divisor;
+    if (quotient > (unsigned long long)INT_MAX)
+        return -1;
+    return negative ? -(int)quotient : (int)quotient;
+}
+
+HRSRC FindResource(HMODULE, LPCWSTR, LPCWSTR)
+{
+    return NULL;
+}
+
+DWORD SizeofResource(HMODULE, HRSRC)
+{
+    return 0;
+}
+
+HGLOBAL LoadResource(HMODULE, HRSRC)
+{
+    return NULL;
+}
+
+LPVOID LockResource(HGLOBAL)
+{
+    return NULL;
+}
+
+FILE* _wfopen(const wchar_t* name, const wchar_t* mode)
+{
+    char path[4096];
+    char flags[16];
+
+    if (wcstombs(path, name, sizeof(path)) >= sizeof(path) ||
+        wcstombs(flags, mode, sizeof(flags)) >= sizeof(flags))
+    {
+        return NULL;
+    }
+
+    return fopen(path, flags);
+}
+
+HBITMAP CreateDIBSection(HDC, const BITMAPINFO* bmi, UINT, void** bits, HANDLE, DWORD)
+{
+    const BITMAPINFOHEADER& header = bmi->bmiHeader;
+    *bits = NULL;
+
+    // 32 bits per pixel only, which needs no palette and no padding.
+    if (header.biBitCount != 32 || header.biWidth <= 0 || header.biHeight == 0)
+        return NULL;
+
+    size_t width = (size_t)header.biWidth;
+    size_t height = (size_t)labs(header.biHeight);
+    if (height > (size_t)-1 / 4 / width)
+        return NULL;
+
+    void* pixels = malloc(width * height * 4);
+    if (pixels == NULL)
+        return NULL;
+
+    Bitmap* bitmap = NewObject<Bitmap>(kBitmap);
+    if (bitmap == NULL)
+    {
+        free(pixels);
+        return NULL;
+    }
+
+    bitmap->dib.dsBm.bmWidth = header.biWidth;
+    bitmap->dib.dsBm.bmHeight = (LONG)height;
+    bitmap->dib.dsBm.bmWidthBytes = header.biWidth * 4;
+    bitmap->dib.dsBm.bmPlanes = 1;
+    bitmap->dib.dsBm.bmBitsPixel = 32;
+    bitmap->dib.dsBm.bmBits = pixels;
+    bitmap->dib.dsBmih = header;
+
+    *bits = pixels;
+    return (HBITMAP)bitmap;
+}
+
+BOOL DeleteObject(HGDIOBJ obj)
+{
+    if (IsType(obj, kRegion))
+    {
+        free(((Region *)obj)->rects);
+        FreeObject((Object *)obj);
+        return TRUE;
+    }
+
+    if (IsType(obj, kBitmap))
+    {
+        free(((Bitmap *)obj)->dib.dsBm.bmBits);
+        FreeObject((Object *)obj);
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+int GetObject(HANDLE obj, int size, LPVOID buffer)
+{
+    if (!IsType(obj, kBitmap))
+        return 0;
+
+    const DIBSECTION& dib = ((Bitmap *)obj)->dib;
+    if (size >= (int)sizeof(DIBSECTION))
+    {
+        memcpy(buffer, &dib, sizeof(DIBSECTION));
+        return sizeof(DIBSECTION);
+    }
+
+    if (size >= (int)sizeof(BITMAP))
+    {
+        memcpy(buffer, &dib.dsBm, sizeof(BITMAP));
+        return sizeof(BITMAP);
+    }
+
+    return 0;
+}
+
+BOOL GdiFlush(void)
+{
+    return TRUE;
+}
+
+HDC GetDC(HWND)
+{
+    return NULL;
+}
+
+int ReleaseDC(HWND, HDC)
+{
+    return 1;
+}
+
+int GetDIBits(HDC, HBITMAP, UINT, UINT, LPVOID, BITMAPINFO*, UINT)
+{
+    // Every bitmap is a DIB section, which is read in place.
+    return 0;
+}
+
+HDC CreateCompatibleDC(HDC)
+{
+    DC* dc = NewObject<DC>(kDC);
+    if (dc == NULL)
+        return NULL;
+
+    dc->selected = &stock_bitmap;
+    return (HDC)dc;
+}
+
+HGDIOBJ SelectObject(HDC hdc, HGDIOBJ obj)
+{
+    if (!IsType(hdc, kDC) || !(IsType(obj, kBitmap) || IsType(obj, kStock)))
+        return NULL;
+
+    DC* dc = (DC *)hdc;
+    HGDIOBJ old = dc->selected;
+    dc->selected = obj;
+    return old;
+}
+
+BOOL DeleteDC(HDC hdc)
+{
+    if (!IsType(hdc, kDC))
+        return FALSE;
+
+    FreeObject((Object *)hdc);
+    return TRUE;
+}
+
+HRGN CreateRectRgn(int left, int top, int right, int bottom)
+{
+    Region* region = NewObject<Region>(kRegion);
+    if (region == NULL)
+        return NULL;
+
+    if (!SetRectRgn((HRGN)region, left, top, right, bottom))
+    {
+        FreeObject(&region->header);
+        return NULL;
+    }
+
+    return (HRGN)region;
+}
+
+BOOL SetRectRgn(HRGN rgn, int left, int top, int right, int bottom)
+{
+    if (!IsType(rgn, kRegion))
+        return FALSE;
+
+    RECT rect = { left, top, right, bottom };
+    return SetRegionRects((Region *)rgn, &rect, 1) ? TRUE : FALSE;
+}
+
+int CombineRgn(HRGN dst, HRGN src1, HRGN src2, int mode)
+{
+    if (!IsType(dst, kRegion) || !IsType(src1, kRegion))
+        return ERROR;
+
+    const Region* first = (const Region *)src1;
+    if (mode == RGN_COPY)
+    {
+        if (dst != src1 && !SetRegionRects((Region *)dst, first->rects, first->count))
+            return ERROR;
+        return GetRegionType((Region *)dst);
+    }
+
+    if (mode != RGN_OR || !IsType(src2, kRegion))
+        return ERROR;
+
+    const Region* second = (const Region *)src2;
+    int count = first->count + second->count;
+    RECT* rects = (RECT *)malloc(sizeof(RECT) * (count > 0 ? count : 1));
+    if (rects == NULL)
+        return ERROR;
+
+    memcpy(rects, first->rects, sizeof(RECT) * first->count);
+    memcpy(rects + first->count, second->rects, sizeof(RECT) * second->count);
+    bool set = SetRegionRects((Region *)dst, rects, count);
+    free(rects);
+
+    return set ? GetRegionType((Region *)dst) : ERROR;
+}
+
+int GetRgnBox(HRGN rgn, RECT* rect)
+{
+    if (!IsType(rgn, kRegion))
+        return ERROR;
+
+    const Region* region = (const Region *)rgn;
+    RECT box = { 0, 0, 0, 0 };
+    for (int i = 0; i < region->count; ++i)
+    {
+        const RECT& r = region->rects[i];
+        if (i == 0)
+        {
+            box = r;
+            continue;
+        }
+
+        box.left = r.left < box.left ? r.left : box.left;
+        box.top = r.top < box.top ? r.top : box.top;
+        box.right = r.right > box.right ? r.right : box.right;
+        box.bottom = r.bottom > box.bottom ? r.bottom : box.bottom;
+    }
+
+    *rect = box;
+    return GetRegionType(region);
+}
+
+BOOL PtInRegion(HRGN rgn, int x, int y)
+{
+    if (!IsType(rgn, kRegion))
+        return FALSE;
+
+    const Region* region = (const Region *)rgn;
+    for (int i = 0; i < region->count; ++i)
+    {
+        const RECT& r = region->rects[i];
+        if (x >= r.left && x < r.right && y >= r.top && y < r.bottom)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+unsigned long ShimGetLiveObjects(void)
+{
+    return live_objects;
+}
+
+unsigned long ShimGetCreatedObjects(void)
+{
+    return created_objects;
+}
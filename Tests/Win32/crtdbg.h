@@ -0,0 +1,10 @@
+/* Debug CRT, asserts only. */
+
+#ifndef _TESTS_WIN32_CRTDBG_H_
+#define _TESTS_WIN32_CRTDBG_H_
+
+#include <assert.h>
+
+#define _ASSERTE(expr) assert(expr)
+
+#endif
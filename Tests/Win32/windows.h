@@ -0,0 +1,228 @@
+/*
+ *	The part of the Win32 API that the library code built by the
+ *	tests uses, on top of POSIX. Kernel objects are real: threads and
+ *	semaphores run on pthreads. GDI objects live in memory only: a DIB
+ *	section is a malloc'ed block. Nothing is drawn.
+ *
+ *	Every object the shim creates is counted until it is deleted, so
+ *	a test can tell what the code under test allocated and leaked.
+ */
+
+#ifndef _TESTS_WIN32_WINDOWS_H_
+#define _TESTS_WIN32_WINDOWS_H_
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <wchar.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WINAPI
+#define CALLBACK
+
+typedef int             BOOL;
+typedef unsigned char   BYTE;
+typedef unsigned short  WORD;
+typedef unsigned int    DWORD;
+typedef unsigned int    UINT;
+typedef long            LONG;
+typedef void *          LPVOID;
+typedef wchar_t         WCHAR;
+typedef const wchar_t * LPCWSTR;
+
+#define TRUE  1
+#define FALSE 0
+
+#define DECLARE_HANDLE(name) struct name##__ { int unused; }; typedef struct name##__ * name
+
+typedef void * HANDLE;
+typedef void * HGDIOBJ;
+typedef void * HGLOBAL;
+DECLARE_HANDLE(HINSTANCE);
+DECLARE_HANDLE(HRSRC);
+DECLARE_HANDLE(HWND);
+DECLARE_HANDLE(HDC);
+DECLARE_HANDLE(HBITMAP);
+DECLARE_HANDLE(HRGN);
+typedef HINSTANCE HMODULE;
+
+/* C++ code uses std::min and std::max, as with NOMINMAX */
+#ifndef __cplusplus
+#ifndef min
+#define min(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+#endif
+
+#define ZeroMemory(p, n) memset((p), 0, (n))
+
+/*
+ *	Threads and synchronization
+ */
+typedef DWORD (WINAPI * LPTHREAD_START_ROUTINE)(LPVOID);
+
+#define INFINITE      0xFFFFFFFFu
+#define WAIT_OBJECT_0 0u
+#define WAIT_FAILED   0xFFFFFFFFu
+
+HANDLE CreateThread(void * attributes, size_t stackSize,
+                    LPTHREAD_START_ROUTINE start, LPVOID param,
+                    DWORD flags, DWORD * threadId);
+HANDLE CreateSemaphore(void * attributes, LONG initialCount,
+                       LONG maximumCount, LPCWSTR name);
+BOOL   ReleaseSemaphore(HANDLE semaphore, LONG releaseCount, LONG * previousCount);
+DWORD  WaitForSingleObject(HANDLE handle, DWORD milliseconds);
+BOOL   CloseHandle(HANDLE handle);
+
+typedef struct _CRITICAL_SECTION
+{
+    pthread_mutex_t mutex;
+} CRITICAL_SECTION;
+
+void InitializeCriticalSection(CRITICAL_SECTION * section);
+void DeleteCriticalSection(CRITICAL_SECTION * section);
+void EnterCriticalSection(CRITICAL_SECTION * section);
+void LeaveCriticalSection(CRITICAL_SECTION * section);
+
+#define InterlockedIncrement(p)   __sync_add_and_fetch((p), 1)
+#define InterlockedDecrement(p)   __sync_sub_and_fetch((p), 1)
+#define InterlockedExchange(p, v) __sync_lock_test_and_set((p), (v))
+
+typedef struct _SYSTEM_INFO
+{
+    DWORD dwNumberOfProcessors;
+} SYSTEM_INFO;
+
+void GetSystemInfo(SYSTEM_INFO * info);
+
+/* (a * b) / c rounded half away from zero, -1 on overflow */
+int MulDiv(int number, int numerator, int denominator);
+
+/*
+ *	Resources, there are none
+ */
+HRSRC   FindResource(HMODULE module, LPCWSTR name, LPCWSTR type);
+DWORD   SizeofResource(HMODULE module, HRSRC res);
+HGLOBAL LoadResource(HMODULE module, HRSRC res);
+LPVOID  LockResource(HGLOBAL data);
+
+FILE * _wfopen(const wchar_t * name, const wchar_t * mode);
+
+/*
+ *	GDI
+ */
+typedef struct tagRGBQUAD
+{
+    BYTE rgbBlue;
+    BYTE rgbGreen;
+    BYTE rgbRed;
+    BYTE rgbReserved;
+} RGBQUAD;
+
+typedef struct tagBITMAPINFOHEADER
+{
+    DWORD biSize;
+    LONG  biWidth;
+    LONG  biHeight;
+    WORD  biPlanes;
+    WORD  biBitCount;
+    DWORD biCompression;
+    DWORD biSizeImage;
+    LONG  biXPelsPerMeter;
+    LONG  biYPelsPerMeter;
+    DWORD biClrUsed;
+    DWORD biClrImportant;
+} BITMAPINFOHEADER;
+
+typedef struct tagBITMAPINFO
+{
+    BITMAPINFOHEADER bmiHeader;
+    RGBQUAD          bmiColors[1];
+} BITMAPINFO;
+
+typedef struct tagBITMAP
+{
+    LONG   bmType;
+    LONG   bmWidth;
+    LONG   bmHeight;
+    LONG   bmWidthBytes;
+    WORD   bmPlanes;
+    WORD   bmBitsPixel;
+    LPVOID bmBits;
+} BITMAP;
+
+typedef struct tagDIBSECTION
+{
+    BITMAP           dsBm;
+    BITMAPINFOHEADER dsBmih;
+    DWORD            dsBitfields[3];
+    HANDLE           dshSection;
+    DWORD            dsOffset;
+} DIBSECTION;
+
+typedef DWORD COLORREF;
+
+typedef struct tagRECT
+{
+    LONG left;
+    LONG top;
+    LONG right;
+    LONG bottom;
+} RECT;
+
+#define RGB(r, g, b)  ((COLORREF)(((BYTE)(r)) | ((WORD)((BYTE)(g)) << 8) | (((DWORD)(BYTE)(b)) << 16)))
+#define GetRValue(rgb) ((BYTE)(rgb))
+#define GetGValue(rgb) ((BYTE)(((WORD)(rgb)) >> 8))
+#define GetBValue(rgb) ((BYTE)((rgb) >> 16))
+
+#define BI_RGB         0
+#define DIB_RGB_COLORS 0
+
+HBITMAP CreateDIBSection(HDC hdc, const BITMAPINFO * bmi, UINT usage,
+                         void ** bits, HANDLE section, DWORD offset);
+BOOL    DeleteObject(HGDIOBJ obj);
+int     GetObject(HANDLE obj, int size, LPVOID buffer);
+BOOL    GdiFlush(void);
+HDC     GetDC(HWND hwnd);
+int     ReleaseDC(HWND hwnd, HDC hdc);
+int     GetDIBits(HDC hdc, HBITMAP bmp, UINT start, UINT lines,
+                  LPVOID bits, BITMAPINFO * bmi, UINT usage);
+
+/* Memory DCs hold the object selected into them and draw nothing. */
+HDC     CreateCompatibleDC(HDC hdc);
+HGDIOBJ SelectObject(HDC hdc, HGDIOBJ obj);
+BOOL    DeleteDC(HDC hdc);
+
+/* Regions are lists of rectangles, which may overlap. */
+#define ERROR         0
+#define NULLREGION    1
+#define SIMPLEREGION  2
+#define COMPLEXREGION 3
+
+#define RGN_OR   2
+#define RGN_COPY 5
+
+HRGN CreateRectRgn(int left, int top, int right, int bottom);
+BOOL SetRectRgn(HRGN rgn, int left, int top, int right, int bottom);
+int  CombineRgn(HRGN dst, HRGN src1, HRGN src2, int mode);
+int  GetRgnBox(HRGN rgn, RECT * rect);
+BOOL PtInRegion(HRGN rgn, int x, int y);
+
+/*
+ *	Not Win32: the objects created and not deleted yet, and the
+ *	objects created in all
+ */
+unsigned long ShimGetLiveObjects(void);
+unsigned long ShimGetCreatedObjects(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
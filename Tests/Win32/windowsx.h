@@ -0,0 +1 @@
+/* Message crackers, the tests need none. */